@@ -10,6 +10,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <NodesetLoader/Extension.h>
+#include <NodesetLoader/NodesetLoader.h>
 
 #if defined(_WIN32)
 #ifdef __GNUC__
@@ -33,6 +34,18 @@ struct UA_Server;
 
 LOADER_EXPORT bool NodesetLoader_loadFile(struct UA_Server *, const char *path,
                             NodesetLoader_ExtensionInterface *extensionHandling);
+// NodesetLoader_loadFile which reports the progress of the import, the sort
+// and of adding the nodes to the server, progressContext is passed to
+// progress, returning false cancels the load, nodes which were added to the
+// server until then stay
+LOADER_EXPORT bool NodesetLoader_loadFileWithProgress(
+    struct UA_Server *, const char *path,
+    NodesetLoader_ExtensionInterface *extensionHandling,
+    NL_progressCallback progress, void *progressContext);
+// loads a nodeset which is already in memory, e.g. embedded in the binary
+LOADER_EXPORT bool NodesetLoader_loadBuffer(struct UA_Server *, const char *data,
+                            size_t length,
+                            NodesetLoader_ExtensionInterface *extensionHandling);
 
 #ifdef __cplusplus
 }
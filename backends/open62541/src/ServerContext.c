@@ -14,6 +14,8 @@ struct ServerContext
     UA_Server *server;
     size_t namespaceCnt;
     UA_UInt16 *namespaceIdxMapping;
+    NL_progressCallback progress;
+    void *progressContext;
 };
 
 ServerContext *ServerContext_new(UA_Server *server)
@@ -88,3 +90,21 @@ UA_UInt16 ServerContext_translateToServerIdx(const ServerContext *serverContext,
         return UA_UINT16_MAX;
     }
 }
+
+void ServerContext_setProgress(ServerContext *serverContext, NL_progressCallback progress,
+                               void *context)
+{
+    if (!serverContext)
+        return;
+
+    serverContext->progress = progress;
+    serverContext->progressContext = context;
+}
+
+bool ServerContext_reportProgress(ServerContext *serverContext, const NL_Progress *progress)
+{
+    if (!serverContext || !serverContext->progress)
+        return true;
+
+    return serverContext->progress(serverContext->progressContext, progress);
+}
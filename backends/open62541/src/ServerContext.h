@@ -8,6 +8,7 @@
 #ifndef SERVERCONTEXT_H
 #define SERVERCONTEXT_H
 
+#include <NodesetLoader/NodesetLoader.h>
 #include <open62541/types.h>
 
 struct UA_Server;
@@ -33,4 +34,11 @@ void ServerContext_addNamespaceIdx(ServerContext *serverContext, UA_UInt16 serve
 // Translates from an index used in the nodeset file to an index used in the server
 UA_UInt16 ServerContext_translateToServerIdx(const ServerContext *serverContext, UA_UInt16 nodesetIdx);
 
+// Sets the progress callback of the import, progress may be NULL
+void ServerContext_setProgress(ServerContext *serverContext, NL_progressCallback progress,
+                               void *context);
+
+// Passes the progress to the callback, returns false if the import is cancelled
+bool ServerContext_reportProgress(ServerContext *serverContext, const NL_Progress *progress);
+
 #endif
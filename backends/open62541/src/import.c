@@ -122,7 +122,7 @@ handleObjectNode(const NL_ObjectNode *node, UA_NodeId *id,
     UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
     oAttr.displayName = *lt;
     oAttr.description = *description;
-    oAttr.eventNotifier = (UA_Byte)atoi(node->eventNotifier);
+    oAttr.eventNotifier = node->typed.eventNotifier;
 
     UA_NodeId typeDefId = UA_NODEID_NULL;
     if (node->refToTypeDef)
@@ -147,8 +147,8 @@ handleViewNode(const NL_ViewNode *node, UA_NodeId *id, const UA_NodeId *parentId
     UA_ViewAttributes attr = UA_ViewAttributes_default;
     attr.displayName = *lt;
     attr.description = *description;
-    attr.eventNotifier = (UA_Byte)atoi(node->eventNotifier);
-    attr.containsNoLoops = isTrue(node->containsNoLoops);
+    attr.eventNotifier = node->typed.eventNotifier;
+    attr.containsNoLoops = node->typed.containsNoLoops;
     UA_Server_addViewNode(server, *id, *parentId, *parentReferenceId, *qn, attr,
                           node->extension, NULL);
 }
@@ -160,8 +160,8 @@ handleMethodNode(const NL_MethodNode *node, UA_NodeId *id,
                  const UA_LocalizedText *description, UA_Server *server)
 {
     UA_MethodAttributes attr = UA_MethodAttributes_default;
-    attr.executable = isTrue(node->executable);
-    attr.userExecutable = isTrue(node->userExecutable);
+    attr.executable = node->typed.executable;
+    attr.userExecutable = node->typed.userExecutable;
     attr.displayName = *lt;
     attr.description = *description;
 
@@ -205,36 +205,50 @@ static void handleVariableNode(const NL_VariableNode *node, UA_NodeId *id,
                                const ServerContext *serverContext)
 {
     UA_VariableAttributes attr = UA_VariableAttributes_default;
+    // built here if the nodeset was parsed with NL_PARSER_OPTION_LAZY_VALUES
+    const NL_Value *value = NodesetLoader_getValue(node);
     attr.displayName = *lt;
     attr.dataType = getNodeIdFromChars(node->datatype);
-    attr.valueRank = atoi(node->valueRank);
-    UA_UInt32 *arrDims = NULL;
-    attr.arrayDimensionsSize =
-        getArrayDimensions(node->arrayDimensions, &arrDims);
-    attr.arrayDimensions = arrDims;
-    attr.accessLevel = (UA_Byte)atoi(node->accessLevel);
-    attr.userAccessLevel = (UA_Byte)atoi(node->userAccessLevel);
+    attr.valueRank = node->typed.valueRank;
+    UA_UInt32 arrayDimensions[NL_MAX_ARRAY_DIMENSIONS];
+    UA_UInt32 *allocatedDims = NULL;
+    attr.arrayDimensionsSize = node->typed.arrayDimensionsSize;
+    if (attr.arrayDimensionsSize > NL_MAX_ARRAY_DIMENSIONS)
+    {
+        // only the first dimensions are decoded by the loader
+        attr.arrayDimensionsSize =
+            getArrayDimensions(node->arrayDimensions, &allocatedDims);
+        attr.arrayDimensions = allocatedDims;
+    }
+    else if (attr.arrayDimensionsSize > 0)
+    {
+        memcpy(arrayDimensions, node->typed.arrayDimensions,
+               attr.arrayDimensionsSize * sizeof(UA_UInt32));
+        attr.arrayDimensions = arrayDimensions;
+    }
+    attr.accessLevel = node->typed.accessLevel;
+    attr.userAccessLevel = node->typed.userAccessLevel;
     attr.description = *description;
-    attr.historizing = isTrue(node->historizing);
+    attr.historizing = node->typed.historizing;
 
     // this case is only needed for the euromap83 comparison, think the nodeset
     // is not valid
     if (attr.arrayDimensions == NULL && attr.valueRank == 1)
     {
         attr.arrayDimensionsSize = 1;
-        attr.arrayDimensions = UA_UInt32_new();
-        *attr.arrayDimensions = 0;
+        arrayDimensions[0] = 0;
+        attr.arrayDimensions = arrayDimensions;
     }
 
-    if (attr.arrayDimensionsSize == 0 && node->value && node->value->isArray)
+    if (attr.arrayDimensionsSize == 0 && value && value->isArray)
     {
-        attr.arrayDimensions = UA_UInt32_new();
-        *attr.arrayDimensions =
-            (UA_UInt32)node->value->data->val.complexData.membersSize;
+        arrayDimensions[0] =
+            (UA_UInt32)value->data->val.complexData.membersSize;
+        attr.arrayDimensions = arrayDimensions;
         attr.arrayDimensionsSize = 1;
     }
     RawData *data = NULL;
-    if (node->value)
+    if (value)
     {
         const UA_DataType *dataType = UA_findDataType(&attr.dataType);
         if (!dataType)
@@ -256,11 +270,11 @@ static void handleVariableNode(const NL_VariableNode *node, UA_NodeId *id,
 
         if (data)
         {
-            if (node->value->isArray)
+            if (value->isArray)
             {
                 UA_Variant_setArray(
                     &attr.value, data->mem,
-                    node->value->data->val.complexData.membersSize, dataType);
+                    value->data->val.complexData.membersSize, dataType);
             }
             else
             {
@@ -281,7 +295,7 @@ static void handleVariableNode(const NL_VariableNode *node, UA_NodeId *id,
     //cannot call addNode finish, otherwise the nodes for e.g. range will be instantiated twice
     //UA_Server_addNode_finish(server, *id);
     RawData_delete(data);
-    UA_free(attr.arrayDimensions);
+    free(allocatedDims);
 
 
 }
@@ -296,7 +310,7 @@ static void handleObjectTypeNode(const NL_ObjectTypeNode *node, UA_NodeId *id,
 {
     UA_ObjectTypeAttributes oAttr = UA_ObjectTypeAttributes_default;
     oAttr.displayName = *lt;
-    oAttr.isAbstract = isTrue(node->isAbstract);
+    oAttr.isAbstract = node->typed.isAbstract;
     oAttr.description = *description;
 
     UA_Server_addObjectTypeNode(server, *id, *parentId, *parentReferenceId, *qn,
@@ -312,7 +326,7 @@ static void handleReferenceTypeNode(const NL_ReferenceTypeNode *node,
                                     UA_Server *server)
 {
     UA_ReferenceTypeAttributes attr = UA_ReferenceTypeAttributes_default;
-    attr.symmetric = isTrue(node->symmetric);
+    attr.symmetric = node->typed.symmetric;
     attr.displayName = *lt;
     attr.description = *description;
     attr.inverseName =
@@ -334,14 +348,14 @@ static void handleVariableTypeNode(const NL_VariableTypeNode *node, UA_NodeId *i
     attr.displayName = *lt;
     attr.dataType = getNodeIdFromChars(node->datatype);
     attr.description = *description;
-    attr.valueRank = atoi(node->valueRank);
-    attr.isAbstract = isTrue(node->isAbstract);
+    attr.valueRank = node->typed.valueRank;
+    attr.isAbstract = node->typed.isAbstract;
+    UA_UInt32 arrayDimensions[1];
     if (attr.valueRank >= 0)
     {
-        if (!strcmp(node->arrayDimensions, ""))
+        if (node->typed.arrayDimensionsSize == 0)
         {
             attr.arrayDimensionsSize = 1;
-            UA_UInt32 arrayDimensions[1];
             arrayDimensions[0] = 0;
             attr.arrayDimensions = &arrayDimensions[0];
         }
@@ -364,7 +378,7 @@ static void handleDataTypeNode(const NL_DataTypeNode *node, UA_NodeId *id,
     UA_DataTypeAttributes attr = UA_DataTypeAttributes_default;
     attr.displayName = *lt;
     attr.description = *description;
-    attr.isAbstract = isTrue(node->isAbstract);
+    attr.isAbstract = node->typed.isAbstract;
 
     UA_Server_addDataTypeNode(server, *id, *parentId, *parentReferenceId, *qn,
                               attr, node->extension, NULL);
@@ -537,7 +551,36 @@ static void addNonHierachicalRefs(UA_Server *server, NL_Node *node)
     }
 }
 
-static void addNodes(NodesetLoader *loader, ServerContext *serverContext,
+// nodes between two calls of the progress callback
+#define ADD_PROGRESS_INTERVAL 4096
+
+struct NodeAdder
+{
+    ServerContext *serverContext;
+    size_t added;
+    bool cancelled;
+};
+
+// adds the node unless the import was cancelled and reports the progress
+static void addNodeWithProgress(struct NodeAdder *adder, const NL_Node *node)
+{
+    if (adder->cancelled)
+    {
+        return;
+    }
+    addNode(adder->serverContext, node);
+    adder->added++;
+    if (adder->added % ADD_PROGRESS_INTERVAL == 0)
+    {
+        NL_Progress progress = {NL_PROGRESS_ADD, 0, adder->added};
+        adder->cancelled =
+            !ServerContext_reportProgress(adder->serverContext, &progress);
+    }
+}
+
+// returns false if the progress callback cancelled the import, the nodes
+// which were added until then stay in the server
+static bool addNodes(NodesetLoader *loader, ServerContext *serverContext,
                      NodesetLoader_Logger *logger)
 {
     const NL_NodeClass order[NL_NODECLASS_COUNT] = {
@@ -545,12 +588,13 @@ static void addNodes(NodesetLoader *loader, ServerContext *serverContext,
         NODECLASS_OBJECT,        NODECLASS_METHOD,   NODECLASS_VARIABLETYPE,
         NODECLASS_VARIABLE,      NODECLASS_VIEW};
 
-    for (size_t i = 0; i < NL_NODECLASS_COUNT; i++)
+    struct NodeAdder adder = {serverContext, 0, false};
+    for (size_t i = 0; i < NL_NODECLASS_COUNT && !adder.cancelled; i++)
     {
         const NL_NodeClass classToImport = order[i];
-        size_t cnt =
-            NodesetLoader_forEachNode(loader, classToImport, serverContext,
-                                      (NodesetLoader_forEachNode_Func)addNode);
+        size_t cnt = NodesetLoader_forEachNode(
+            loader, classToImport, &adder,
+            (NodesetLoader_forEachNode_Func)addNodeWithProgress);
         if (classToImport == NODECLASS_DATATYPE)
         {
             importDataTypes(loader, ServerContext_getServerObject(serverContext));
@@ -558,6 +602,10 @@ static void addNodes(NodesetLoader *loader, ServerContext *serverContext,
         logger->log(logger->context, NODESETLOADER_LOGLEVEL_DEBUG,
                     "imported %ss: %zu", NL_NODECLASS_NAME[classToImport], cnt);
     }
+    if (adder.cancelled)
+    {
+        return false;
+    }
 
     for (size_t i = 0; i < NL_NODECLASS_COUNT; i++)
     {
@@ -566,27 +614,58 @@ static void addNodes(NodesetLoader *loader, ServerContext *serverContext,
             loader, classToImport, ServerContext_getServerObject(serverContext),
             (NodesetLoader_forEachNode_Func)addNonHierachicalRefs);
     }
+    NL_Progress progress = {NL_PROGRESS_ADD, 0, adder.added};
+    return ServerContext_reportProgress(serverContext, &progress);
 }
 
-bool NodesetLoader_loadFile(struct UA_Server *server, const char *path,
-                            NodesetLoader_ExtensionInterface *extensionHandling)
+static void logStats(NodesetLoader *loader, NodesetLoader_Logger *logger)
 {
-    if (!server)
-    {
-        return false;
-    }
-    if (!path)
+    NL_Stats stats;
+    NodesetLoader_getStats(loader, &stats);
+    logger->log(logger->context, NODESETLOADER_LOGLEVEL_DEBUG,
+                "nodeset stats: import %.1f ms (parse %.1f ms, io wait %.1f ms, "
+                "%zu bytes, %zu chunks), resolve %.1f ms, sort %.1f ms, "
+                "add %.1f ms",
+                stats.importMs, stats.parseMs, stats.ioWaitMs, stats.bytes,
+                stats.parseChunks, stats.resolveMs, stats.sortMs,
+                stats.forEachNodeMs);
+    for (size_t i = 0; i < NL_NODECLASS_COUNT; i++)
     {
-        return false;
+        logger->log(logger->context, NODESETLOADER_LOGLEVEL_DEBUG,
+                    "nodeset stats: %zu %ss", stats.nodes[i],
+                    NL_NODECLASS_NAME[i]);
     }
+    logger->log(logger->context, NODESETLOADER_LOGLEVEL_DEBUG,
+                "nodeset stats: references %zu hierarchical, %zu "
+                "non hierarchical, %zu unknown (%zu resolved), arena %zu "
+                "bytes, peak %zu nodes with unknown references, peak %zu "
+                "nodes to sort",
+                stats.hierarchicalRefs, stats.nonHierarchicalRefs,
+                stats.unknownRefs, stats.unknownRefsResolved, stats.arenaBytes,
+                stats.peakUnknownRefNodes, stats.peakSortNodes);
+}
 
+static bool forwardProgress(void *userContext, const NL_Progress *progress)
+{
+    return ServerContext_reportProgress((ServerContext *)userContext, progress);
+}
+
+// imports the nodeset from path or, if path is NULL, from data
+static bool load(struct UA_Server *server, const char *path, const char *data,
+                 size_t length,
+                 NodesetLoader_ExtensionInterface *extensionHandling,
+                 NL_progressCallback progress, void *progressContext)
+{
     ServerContext *serverContext = ServerContext_new(server);
+    ServerContext_setProgress(serverContext, progress, progressContext);
 
     NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
     handler.addNamespace = NodesetLoader_BackendOpen62541_addNamespace;
     handler.userContext = serverContext;
     handler.file = path;
     handler.extensionHandling = extensionHandling;
+    handler.progress = progress ? forwardProgress : NULL;
 
     UA_ServerConfig *config = UA_Server_getConfig(server);
     NodesetLoader_Logger *logger =
@@ -596,23 +675,83 @@ bool NodesetLoader_loadFile(struct UA_Server *server, const char *path,
     NL_ReferenceService *refService = RefServiceImpl_new(server);
 
     NodesetLoader *loader = NodesetLoader_new(logger, refService);
-    logger->log(logger->context, NODESETLOADER_LOGLEVEL_DEBUG,
-                "Start import nodeset: %s", path);
-    bool importStatus = NodesetLoader_importFile(loader, &handler);
+    bool importStatus = false;
+    if (path)
+    {
+        logger->log(logger->context, NODESETLOADER_LOGLEVEL_DEBUG,
+                    "Start import nodeset: %s", path);
+        importStatus = NodesetLoader_importFile(loader, &handler);
+    }
+    else
+    {
+        logger->log(logger->context, NODESETLOADER_LOGLEVEL_DEBUG,
+                    "Start import nodeset from buffer (%lu bytes)",
+                    (unsigned long)length);
+        importStatus =
+            NodesetLoader_importBuffer(loader, &handler, data, length);
+    }
     bool sortStatus = NodesetLoader_sort(loader);
     bool status = importStatus && sortStatus;
     if (status && sortStatus)
     {
-        addNodes(loader, serverContext, logger);
+        status = addNodes(loader, serverContext, logger);
+        if (!status)
+        {
+            logger->log(logger->context, NODESETLOADER_LOGLEVEL_WARNING,
+                        "adding the nodes was cancelled");
+        }
     }
     else
     {
         logger->log(logger->context, NODESETLOADER_LOGLEVEL_ERROR,
                     "importing the nodeset failed, nodes were not added");
     }
+    logStats(loader, logger);
     RefServiceImpl_delete(refService);
     NodesetLoader_delete(loader);
     ServerContext_delete(serverContext);
     free(logger);
     return status;
 }
+
+bool NodesetLoader_loadFile(struct UA_Server *server, const char *path,
+                            NodesetLoader_ExtensionInterface *extensionHandling)
+{
+    if (!server)
+    {
+        return false;
+    }
+    if (!path)
+    {
+        return false;
+    }
+    return load(server, path, NULL, 0, extensionHandling, NULL, NULL);
+}
+
+bool NodesetLoader_loadFileWithProgress(
+    struct UA_Server *server, const char *path,
+    NodesetLoader_ExtensionInterface *extensionHandling,
+    NL_progressCallback progress, void *progressContext)
+{
+    if (!server || !path)
+    {
+        return false;
+    }
+    return load(server, path, NULL, 0, extensionHandling, progress,
+                progressContext);
+}
+
+bool NodesetLoader_loadBuffer(struct UA_Server *server, const char *data,
+                              size_t length,
+                              NodesetLoader_ExtensionInterface *extensionHandling)
+{
+    if (!server)
+    {
+        return false;
+    }
+    if (!data || !length)
+    {
+        return false;
+    }
+    return load(server, NULL, data, length, extensionHandling, NULL, NULL);
+}
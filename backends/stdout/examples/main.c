@@ -7,6 +7,7 @@
 
 #include "backend.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 int main(int argc, char *argv[])
@@ -18,21 +19,31 @@ int main(int argc, char *argv[])
     }
 
     int maxValueRank = -1;
-    NL_FileContext handler;
-    handler.addNamespace = addNamespace;
-    handler.userContext = &maxValueRank;
+    size_t fileCount = (size_t)argc - 1;
+    NL_FileContext *handlers =
+        (NL_FileContext *)calloc(fileCount, sizeof(NL_FileContext));
+    if (!handlers)
+    {
+        return 1;
+    }
+    for (size_t cnt = 0; cnt < fileCount; cnt++)
+    {
+        handlers[cnt].addNamespace = addNamespace;
+        handlers[cnt].userContext = &maxValueRank;
+        handlers[cnt].file = argv[cnt + 1];
+    }
 
     NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
 
-    for (int cnt = 1; cnt < argc; cnt++)
+    // the files are parsed concurrently and added in the given order
+    if (!NodesetLoader_importFiles(loader, handlers, fileCount))
     {
-        handler.file = argv[cnt];
-        if (!NodesetLoader_importFile(loader, &handler))
-        {
-            printf("nodeset could not be loaded, exit\n");
-            return 1;
-        }
+        printf("nodeset could not be loaded, exit\n");
+        NodesetLoader_delete(loader);
+        free(handlers);
+        return 1;
     }
+    free(handlers);
 
     NodesetLoader_sort(loader);
 
@@ -0,0 +1,163 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+ * measures the cost of mapping an element name to the loader's token, the
+ * token lookup is compared against the strcmp chains which were used before,
+ * the element names of the nodeset are collected first, so only the dispatch
+ * is measured
+ * usage: elementDispatchBench [-r repetitions] nodeset.xml
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include "ElementToken.h"
+#include "Parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct Names
+{
+    char **names;
+    size_t size;
+    size_t capacity;
+};
+
+// the names in the order the state machine compared them before
+static const char *chain[] = {
+    "UAVariable", "UAObject", "UAObjectType", "UADataType", "UAMethod",
+    "UAReferenceType", "UAVariableType", "UAView", "NamespaceUris", "Alias",
+    "UANodeSet", "Aliases", "Extensions", "DisplayName", "References",
+    "Description", "Value", "Definition", "InverseName", "Uri", "Field",
+    "Extension", "Reference", "ExtensionObject", "TypeId", "Body",
+    "Identifier"};
+
+static void onStart(void *ctx, const char *localname, const char *prefix,
+                    const char *URI, int nb_namespaces, const char **namespaces,
+                    int nb_attributes, int nb_defaulted,
+                    const char **attributes)
+{
+    struct Names *names = (struct Names *)ctx;
+    if (names->size == names->capacity)
+    {
+        names->capacity = names->capacity ? names->capacity * 2 : 1024;
+        names->names = (char **)realloc(names->names,
+                                        names->capacity * sizeof(char *));
+    }
+    size_t len = strlen(localname);
+    char *name = (char *)malloc(len + 1);
+    memcpy(name, localname, len + 1);
+    names->names[names->size++] = name;
+}
+
+static void onEnd(void *ctx, const char *localname, const char *prefix,
+                  const char *URI)
+{
+}
+
+static void onChars(void *ctx, const char *ch, int len) {}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+    return (d > 0) - (d < 0);
+}
+
+static size_t lookupChain(const char *name)
+{
+    for (size_t i = 0; i < sizeof(chain) / sizeof(chain[0]); i++)
+    {
+        if (!strcmp(name, chain[i]))
+        {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// returns the median time per element in ns
+// known counts the names which are known by the loader
+static double run(const struct Names *names, int useTokens, int repetitions,
+                  size_t *known)
+{
+    double *times = (double *)calloc((size_t)repetitions, sizeof(double));
+    for (int r = 0; r < repetitions; r++)
+    {
+        size_t sum = 0;
+        double begin = now();
+        for (size_t i = 0; i < names->size; i++)
+        {
+            sum += useTokens ? ElementToken_lookup(names->names[i]) !=
+                                   TOKEN_UNKNOWN
+                             : lookupChain(names->names[i]) != 0;
+        }
+        times[r] = (now() - begin) / (double)names->size;
+        *known = sum;
+    }
+    qsort(times, (size_t)repetitions, sizeof(double), cmpDouble);
+    double median = times[repetitions / 2];
+    free(times);
+    return median;
+}
+
+int main(int argc, char *argv[])
+{
+    int repetitions = 50;
+    int first = 1;
+    if (argc > 2 && !strcmp(argv[1], "-r"))
+    {
+        repetitions = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || repetitions <= 0)
+    {
+        printf("usage: elementDispatchBench [-r repetitions] nodeset.xml\n");
+        return 1;
+    }
+    FILE *f = fopen(argv[first], "rb");
+    if (!f)
+    {
+        printf("%s: cannot open file\n", argv[first]);
+        return 1;
+    }
+    struct Names names = {NULL, 0, 0};
+    Parser *parser = Parser_new(&names);
+    int status = Parser_run(parser, f, onStart, onEnd, onChars);
+    Parser_delete(parser);
+    fclose(f);
+    if (status || !names.size)
+    {
+        printf("%s: parsing failed\n", argv[first]);
+        return 1;
+    }
+
+    size_t chainKnown = 0;
+    size_t tokenKnown = 0;
+    double tChain = run(&names, 0, repetitions, &chainKnown);
+    double tToken = run(&names, 1, repetitions, &tokenKnown);
+    if (chainKnown != tokenKnown)
+    {
+        printf("lookups differ: %zu %zu\n", chainKnown, tokenKnown);
+        return 1;
+    }
+    printf("%zu elements, %zu known\n", names.size, tokenKnown);
+    printf("%-20s %10.2f ns/element\n", "strcmp chain", tChain);
+    printf("%-20s %10.2f ns/element\n", "token lookup", tToken);
+    printf("speedup %.2fx\n", tChain / tToken);
+
+    for (size_t i = 0; i < names.size; i++)
+    {
+        free(names.names[i]);
+    }
+    free(names.names);
+    return 0;
+}
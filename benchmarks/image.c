@@ -0,0 +1,158 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+ * compares importing and sorting nodesets with loading an image of the
+ * sorted nodes, the nodesets are imported in the given order into one loader
+ * usage: imageBench [-r repetitions] nodeset1.xml nodeset2.xml ...
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <NodesetLoader/NodesetLoader.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define IMAGE_PATH "imageBench.image"
+
+static int addNamespace(void *userContext, const char *uri)
+{
+    return ++*(int *)userContext;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+    return (d > 0) - (d < 0);
+}
+
+static void countNode(void *context, NL_Node *node)
+{
+    (*(size_t *)context)++;
+}
+
+static size_t countNodes(NodesetLoader *loader)
+{
+    size_t count = 0;
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &count, countNode);
+    }
+    return count;
+}
+
+// imports the files, writes the image if image is set, returns the time in
+// ms or -1 on errors
+static double importXml(char **files, int count, const char *image,
+                        size_t *nodes)
+{
+    int nsIdx = 0;
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.userContext = &nsIdx;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    double begin = now();
+    bool status = true;
+    for (int i = 0; i < count && status; i++)
+    {
+        handler.file = files[i];
+        status = NodesetLoader_importFile(loader, &handler);
+    }
+    status = NodesetLoader_sort(loader) && status;
+    double time = now() - begin;
+    *nodes = countNodes(loader);
+    if (image)
+    {
+        status = NodesetLoader_writeImage(loader, image) && status;
+    }
+    NodesetLoader_delete(loader);
+    return status ? time : -1;
+}
+
+static double loadImage(const char *image, size_t *nodes)
+{
+    int nsIdx = 0;
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.userContext = &nsIdx;
+    handler.file = image;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    double begin = now();
+    bool status = NodesetLoader_loadImage(loader, &handler);
+    double time = now() - begin;
+    *nodes = status ? countNodes(loader) : 0;
+    NodesetLoader_delete(loader);
+    return status ? time : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    int repetitions = 10;
+    int first = 1;
+    if (argc > 2 && !strcmp(argv[1], "-r"))
+    {
+        repetitions = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || repetitions <= 0)
+    {
+        printf("usage: imageBench [-r repetitions] nodeset.xml ...\n");
+        return 1;
+    }
+    size_t xmlNodes = 0;
+    size_t imageNodes = 0;
+    if (importXml(&argv[first], argc - first, IMAGE_PATH, &xmlNodes) < 0)
+    {
+        printf("import failed\n");
+        return 1;
+    }
+    double *xmlTimes = (double *)calloc((size_t)repetitions, sizeof(double));
+    double *imageTimes = (double *)calloc((size_t)repetitions, sizeof(double));
+    bool failed = false;
+    for (int i = 0; i < repetitions && !failed; i++)
+    {
+        xmlTimes[i] =
+            importXml(&argv[first], argc - first, NULL, &xmlNodes);
+        imageTimes[i] = loadImage(IMAGE_PATH, &imageNodes);
+        failed = xmlTimes[i] < 0 || imageTimes[i] < 0 ||
+                 imageNodes != xmlNodes;
+    }
+    FILE *f = fopen(IMAGE_PATH, "rb");
+    long imageSize = 0;
+    if (f)
+    {
+        fseek(f, 0, SEEK_END);
+        imageSize = ftell(f);
+        fclose(f);
+    }
+    remove(IMAGE_PATH);
+    if (failed)
+    {
+        printf("loading the image failed\n");
+        free(xmlTimes);
+        free(imageTimes);
+        return 1;
+    }
+    qsort(xmlTimes, (size_t)repetitions, sizeof(double), cmpDouble);
+    qsort(imageTimes, (size_t)repetitions, sizeof(double), cmpDouble);
+    double xml = xmlTimes[repetitions / 2];
+    double image = imageTimes[repetitions / 2];
+    printf("%10s %12s %12s %12s %8s\n", "nodes", "image bytes", "xml ms",
+           "image ms", "speedup");
+    printf("%10zu %12ld %12.3f %12.3f %7.2fx\n", xmlNodes, imageSize, xml,
+           image, xml / image);
+    free(xmlTimes);
+    free(imageTimes);
+    return 0;
+}
@@ -0,0 +1,408 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+ * times the import, the sort and NodesetLoader_forEachNode separately on the
+ * bundled nodesets, each one is imported together with the nodesets it
+ * depends on like a server would, further nodesets are imported on top of
+ * namespace zero
+ * reports the median and the 95th percentile of each phase, nodes/s of
+ * import and sort together and MB/s of the import, with -o the results are
+ * written as json to compare them across commits
+ * a case whose sort fails (euromap_instances contains a loop) is still
+ * timed, it is marked as unsorted
+ * -b 0 skips the bundled nodesets, e.g. to measure only generated nodesets of
+ * different sizes, see nodesetGen
+ * usage: nodesetBench [-r repetitions] [-w warmups] [-o results.json]
+ *                     [-b 0|1] nodesetsDir [nodeset.xml ...]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <NodesetLoader/NodesetLoader.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NS0 "Opc.Ua.NodeSet2.xml"
+#define DI "Opc.Ua.Di.NodeSet2.xml"
+#define GENERALTYPES "euromap/Opc.Ua.PlasticsRubber.GeneralTypes.NodeSet2.xml"
+#define IMM2MES "euromap/Opc.Ua.PlasticsRubber.IMM2MES.NodeSet2.xml"
+#define MAX_FILES 6
+#define MAX_NAMESPACES 32
+
+struct Case
+{
+    const char *name;
+    // relative to the nodesets directory, in the order of the import
+    const char *files[MAX_FILES];
+};
+
+static const struct Case bundled[] = {
+    {"NS0", {NS0}},
+    {"DI", {NS0, DI}},
+    {"PLC", {NS0, DI, "Opc.Ua.Plc.NodeSet2.xml"}},
+    {"euromap", {NS0, DI, GENERALTYPES, IMM2MES}},
+    {"euromap_instances",
+     {NS0, DI, GENERALTYPES, IMM2MES,
+      "euromap_instances/euromapinstances.xml"}},
+    {"struct_union_optionset",
+     {NS0, "struct_union_optionset/structtest.xml"}}};
+
+enum Phase
+{
+    PHASE_IMPORT,
+    PHASE_SORT,
+    PHASE_FOREACH,
+    PHASE_COUNT
+};
+
+static const char *phaseNames[PHASE_COUNT] = {"import", "sort",
+                                              "forEachNode"};
+
+struct Result
+{
+    const char *name;
+    size_t files;
+    size_t bytes;
+    size_t nodes;
+    bool sorted;
+    double median[PHASE_COUNT];
+    double p95[PHASE_COUNT];
+};
+
+// a uri gets the same index in all files of a case, like a server does it
+struct Namespaces
+{
+    const char *uris[MAX_NAMESPACES];
+    int count;
+};
+
+static int addNamespace(void *userContext, const char *uri)
+{
+    struct Namespaces *ns = (struct Namespaces *)userContext;
+    for (int i = 0; i < ns->count; i++)
+    {
+        if (!strcmp(ns->uris[i], uri))
+        {
+            return i + 1;
+        }
+    }
+    if (ns->count < MAX_NAMESPACES)
+    {
+        ns->uris[ns->count++] = uri;
+    }
+    return ns->count;
+}
+
+// only the messages of the first run of a case are printed
+static void logMessage(void *context, enum NodesetLoader_LogLevel level,
+                       const char *message, ...)
+{
+    if (*(const bool *)context || level == NODESETLOADER_LOGLEVEL_DEBUG)
+    {
+        return;
+    }
+    va_list args;
+    va_start(args, message);
+    vprintf(message, args);
+    va_end(args);
+    printf("\n");
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+    return (d > 0) - (d < 0);
+}
+
+static void countNode(void *context, NL_Node *node)
+{
+    (*(size_t *)context)++;
+}
+
+static size_t fileSize(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size > 0 ? (size_t)size : 0;
+}
+
+// one run of all phases, the times are in ms, returns false if the import
+// failed
+static bool runOnce(char **paths, size_t count, NodesetLoader_Logger *logger,
+                    double *times, struct Result *result)
+{
+    struct Namespaces ns;
+    ns.count = 0;
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.userContext = &ns;
+    NodesetLoader *loader = NodesetLoader_new(logger, NULL);
+    bool status = true;
+    double begin = now();
+    for (size_t i = 0; i < count && status; i++)
+    {
+        handler.file = paths[i];
+        status = NodesetLoader_importFile(loader, &handler);
+    }
+    double imported = now();
+    result->sorted = status && NodesetLoader_sort(loader);
+    double sorted = now();
+    result->nodes = 0;
+    for (int i = 0; i < NL_NODECLASS_COUNT && status; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &result->nodes,
+                                  countNode);
+    }
+    double iterated = now();
+    NodesetLoader_delete(loader);
+    times[PHASE_IMPORT] = imported - begin;
+    times[PHASE_SORT] = sorted - imported;
+    times[PHASE_FOREACH] = iterated - sorted;
+    return status;
+}
+
+static bool runCase(char **paths, size_t count, int warmups, int repetitions,
+                    struct Result *result)
+{
+    result->files = count;
+    result->bytes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        result->bytes += fileSize(paths[i]);
+    }
+    bool quiet = false;
+    NodesetLoader_Logger logger = {&quiet, logMessage};
+    double times[PHASE_COUNT];
+    for (int i = 0; i < warmups; i++)
+    {
+        if (!runOnce(paths, count, &logger, times, result))
+        {
+            return false;
+        }
+        quiet = true;
+    }
+    double *samples[PHASE_COUNT];
+    for (int p = 0; p < PHASE_COUNT; p++)
+    {
+        samples[p] = (double *)calloc((size_t)repetitions, sizeof(double));
+    }
+    bool status = true;
+    for (int i = 0; i < repetitions && status; i++)
+    {
+        status = runOnce(paths, count, &logger, times, result);
+        quiet = true;
+        for (int p = 0; p < PHASE_COUNT; p++)
+        {
+            samples[p][i] = times[p];
+        }
+    }
+    // the smallest sample which is at least as large as 95% of the samples
+    size_t p95 = ((size_t)repetitions * 95 + 99) / 100 - 1;
+    for (int p = 0; p < PHASE_COUNT; p++)
+    {
+        qsort(samples[p], (size_t)repetitions, sizeof(double), cmpDouble);
+        result->median[p] = samples[p][repetitions / 2];
+        result->p95[p] = samples[p][p95];
+        free(samples[p]);
+    }
+    return status;
+}
+
+static double nodesPerSecond(const struct Result *r)
+{
+    double ms = r->median[PHASE_IMPORT] + r->median[PHASE_SORT];
+    return ms > 0 ? (double)r->nodes * 1e3 / ms : 0;
+}
+
+static double megabytesPerSecond(const struct Result *r)
+{
+    double ms = r->median[PHASE_IMPORT];
+    return ms > 0 ? (double)r->bytes / (1024.0 * 1024.0) * 1e3 / ms : 0;
+}
+
+static void printResult(const struct Result *r)
+{
+    printf("%-24s %8zu %10zu", r->name, r->nodes, r->bytes);
+    for (int p = 0; p < PHASE_COUNT; p++)
+    {
+        printf(" %9.3f %9.3f", r->median[p], r->p95[p]);
+    }
+    printf(" %10.0f %8.2f%s\n", nodesPerSecond(r), megabytesPerSecond(r),
+           r->sorted ? "" : " unsorted");
+}
+
+static bool writeJson(const char *path, const struct Result *results,
+                      size_t count, int warmups, int repetitions)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return false;
+    }
+    fprintf(f, "{\n  \"warmups\": %d,\n  \"repetitions\": %d,\n", warmups,
+            repetitions);
+    fprintf(f, "  \"cases\": [\n");
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct Result *r = &results[i];
+        fprintf(f,
+                "    {\n      \"name\": \"%s\",\n      \"files\": %zu,\n"
+                "      \"bytes\": %zu,\n      \"nodes\": %zu,\n"
+                "      \"sorted\": %s,\n",
+                r->name, r->files, r->bytes, r->nodes,
+                r->sorted ? "true" : "false");
+        for (int p = 0; p < PHASE_COUNT; p++)
+        {
+            fprintf(f,
+                    "      \"%s\": {\"median_ms\": %.4f, \"p95_ms\": %.4f},\n",
+                    phaseNames[p], r->median[p], r->p95[p]);
+        }
+        fprintf(f,
+                "      \"nodes_per_s\": %.1f,\n      \"mb_per_s\": %.3f\n"
+                "    }%s\n",
+                nodesPerSecond(r), megabytesPerSecond(r),
+                i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+static char *joinPath(const char *dir, const char *file)
+{
+    size_t length = strlen(dir) + strlen(file) + 2;
+    char *path = (char *)malloc(length);
+    if (path)
+    {
+        snprintf(path, length, "%s/%s", dir, file);
+    }
+    return path;
+}
+
+// the name of a nodeset which is not bundled is its file name
+static const char *baseName(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+int main(int argc, char *argv[])
+{
+    int repetitions = 10;
+    int warmups = 2;
+    const char *json = NULL;
+    int withBundled = 1;
+    int first = 1;
+    while (first + 1 < argc && argv[first][0] == '-')
+    {
+        if (!strcmp(argv[first], "-r"))
+        {
+            repetitions = atoi(argv[first + 1]);
+        }
+        else if (!strcmp(argv[first], "-w"))
+        {
+            warmups = atoi(argv[first + 1]);
+        }
+        else if (!strcmp(argv[first], "-o"))
+        {
+            json = argv[first + 1];
+        }
+        else if (!strcmp(argv[first], "-b"))
+        {
+            withBundled = atoi(argv[first + 1]);
+        }
+        else
+        {
+            break;
+        }
+        first += 2;
+    }
+    if (first >= argc || repetitions <= 0 || warmups < 0)
+    {
+        printf("usage: nodesetBench [-r repetitions] [-w warmups] "
+               "[-o results.json] [-b 0|1] nodesetsDir [nodeset.xml ...]\n");
+        return 1;
+    }
+    const char *dir = argv[first];
+    size_t bundledCount =
+        withBundled ? sizeof(bundled) / sizeof(bundled[0]) : 0;
+    size_t caseCount = bundledCount + (size_t)(argc - first - 1);
+    struct Result *results =
+        (struct Result *)calloc(caseCount, sizeof(struct Result));
+    if (!results)
+    {
+        return 1;
+    }
+
+    printf("%-24s %8s %10s", "nodeset", "nodes", "bytes");
+    for (int p = 0; p < PHASE_COUNT; p++)
+    {
+        printf(" %9.9s %9s", phaseNames[p], "p95");
+    }
+    printf(" %10s %8s\n", "nodes/s", "MB/s");
+    bool failed = false;
+    for (size_t c = 0; c < caseCount && !failed; c++)
+    {
+        char *paths[MAX_FILES] = {NULL};
+        size_t count = 0;
+        if (c < bundledCount)
+        {
+            results[c].name = bundled[c].name;
+            for (; count < MAX_FILES && bundled[c].files[count]; count++)
+            {
+                paths[count] = joinPath(dir, bundled[c].files[count]);
+            }
+        }
+        else
+        {
+            const char *file = argv[first + 1 + (int)(c - bundledCount)];
+            results[c].name = baseName(file);
+            paths[count++] = joinPath(dir, NS0);
+            size_t length = strlen(file) + 1;
+            paths[count] = (char *)malloc(length);
+            if (paths[count])
+            {
+                memcpy(paths[count], file, length);
+            }
+            count++;
+        }
+        failed = !runCase(paths, count, warmups, repetitions, &results[c]);
+        if (failed)
+        {
+            printf("%s: import failed\n", results[c].name);
+        }
+        else
+        {
+            printResult(&results[c]);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            free(paths[i]);
+        }
+    }
+    if (!failed && json &&
+        !writeJson(json, results, caseCount, warmups, repetitions))
+    {
+        printf("%s could not be written\n", json);
+        failed = true;
+    }
+    free(results);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+ * compares the time for parsing a nodeset with a memory mapped input against
+ * reading the file in chunks on the parsing thread and on a read ahead
+ * thread, only the raw SAX events are counted, the nodeset is not built up,
+ * compressed nodesets (.gz) are always read as a stream
+ * the io wait column is the time the parser waited for the read ahead thread
+ * usage: parserInputBench [-r repetitions] nodeset1.xml nodeset2.xml ...
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include "Parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct EventCount
+{
+    size_t elements;
+    size_t characters;
+};
+
+static void onStart(void *ctx, const char *localname, const char *prefix,
+                    const char *URI, int nb_namespaces, const char **namespaces,
+                    int nb_attributes, int nb_defaulted,
+                    const char **attributes)
+{
+    ((struct EventCount *)ctx)->elements++;
+}
+
+static void onEnd(void *ctx, const char *localname, const char *prefix,
+                  const char *URI)
+{
+}
+
+static void onChars(void *ctx, const char *ch, int len)
+{
+    ((struct EventCount *)ctx)->characters += (size_t)len;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+    return (d > 0) - (d < 0);
+}
+
+static double run(const char *path, Parser_InputMode mode, int repetitions,
+                  struct EventCount *count, double *ioWait)
+{
+    double *times = (double *)calloc((size_t)repetitions, sizeof(double));
+    double *waits = (double *)calloc((size_t)repetitions, sizeof(double));
+    for (int i = 0; i < repetitions; i++)
+    {
+        FILE *f = fopen(path, "r");
+        if (!f)
+        {
+            free(times);
+            free(waits);
+            return -1;
+        }
+        memset(count, 0, sizeof(*count));
+        Parser *parser = Parser_new(count);
+        Parser_setInputMode(parser, mode);
+        double begin = now();
+        int status = Parser_run(parser, f, onStart, onEnd, onChars);
+        times[i] = now() - begin;
+        waits[i] = Parser_getTiming(parser)->ioWait;
+        Parser_delete(parser);
+        fclose(f);
+        if (status)
+        {
+            free(times);
+            free(waits);
+            return -1;
+        }
+    }
+    qsort(times, (size_t)repetitions, sizeof(double), cmpDouble);
+    qsort(waits, (size_t)repetitions, sizeof(double), cmpDouble);
+    double median = times[repetitions / 2];
+    *ioWait = waits[repetitions / 2];
+    free(times);
+    free(waits);
+    return median;
+}
+
+int main(int argc, char *argv[])
+{
+    int repetitions = 10;
+    int first = 1;
+    if (argc > 2 && !strcmp(argv[1], "-r"))
+    {
+        repetitions = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || repetitions <= 0)
+    {
+        printf("usage: parserInputBench [-r repetitions] nodeset.xml ...\n");
+        return 1;
+    }
+    printf("%-50s %10s %12s %12s %8s %12s %12s\n", "file", "elements",
+           "buffered ms", "mapped ms", "speedup", "readahead ms", "io wait ms");
+    for (int i = first; i < argc; i++)
+    {
+        struct EventCount buffered;
+        struct EventCount mapped;
+        struct EventCount readAhead;
+        double wait;
+        double tBuffered =
+            run(argv[i], PARSER_INPUT_BUFFERED, repetitions, &buffered, &wait);
+        double tMapped =
+            run(argv[i], PARSER_INPUT_AUTO, repetitions, &mapped, &wait);
+        double tReadAhead = run(argv[i], PARSER_INPUT_READAHEAD, repetitions,
+                                &readAhead, &wait);
+        if (tBuffered < 0 || tMapped < 0 || tReadAhead < 0 ||
+            buffered.elements != mapped.elements ||
+            buffered.characters != mapped.characters ||
+            readAhead.elements != mapped.elements ||
+            readAhead.characters != mapped.characters)
+        {
+            printf("%s: parsing failed\n", argv[i]);
+            return 1;
+        }
+        const char *name = strrchr(argv[i], '/');
+        printf("%-50s %10zu %12.3f %12.3f %7.2fx %12.3f %12.3f\n",
+               name ? name + 1 : argv[i], mapped.elements, tBuffered, tMapped,
+               tBuffered / tMapped, tReadAhead, wait);
+    }
+    return 0;
+}
@@ -0,0 +1,323 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+ * measures the hot primitives of the loader in isolation for growing input
+ * sizes, so a complexity regression shows up as a growing time per operation
+ * - CharArenaAllocator_malloc: size allocations of 8 to 55 bytes
+ * - CharArenaAllocator_realloc: one allocation grown size times by 8 bytes
+ * - AliasList_getNodeId: lookups in a list of size aliases, every other name
+ *   is no alias, like the node ids which are looked up as well
+ * - NodesetLoader_NodeId_cmp: qsort of size node ids
+ * - Sort_addNode and Sort_start: a hierarchy of size nodes with 4 children
+ *   each, added parents first
+ * - Value_start/Value_end: a ListOfInt32 with size elements
+ * the alias list keeps at most 300 aliases, so its sizes stop there
+ * usage: primitivesBench [-r repetitions] [-n maxSize]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include "AliasList.h"
+#include "CharAllocator.h"
+#include "Sort.h"
+#include "Value.h"
+#include <NodesetLoader/NodesetLoader.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ARENA_SIZE (1024 * 1024)
+#define ALIAS_LOOKUPS 100000
+#define MAX_ALIASES 300
+#define SORT_FANOUT 4
+#define ID_LENGTH 24
+
+// runs the primitive once on the input size, returns the milliseconds of the
+// measured part and the operations it did
+typedef double (*Bench_run)(size_t size, size_t *ops);
+
+struct Bench
+{
+    const char *name;
+    Bench_run run;
+    // largest size of the benchmark, 0 if only limited by -n
+    size_t maxSize;
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+    return (d > 0) - (d < 0);
+}
+
+// size strings "i=<n>" in one allocation, ID_LENGTH bytes each
+static char *newIds(size_t size, size_t offset)
+{
+    char *ids = (char *)malloc(size * ID_LENGTH);
+    for (size_t i = 0; ids && i < size; i++)
+    {
+        snprintf(ids + i * ID_LENGTH, ID_LENGTH, "i=%zu", offset + i);
+    }
+    return ids;
+}
+
+static double benchArenaMalloc(size_t size, size_t *ops)
+{
+    CharArenaAllocator *arena = CharArenaAllocator_new(ARENA_SIZE);
+    double begin = now();
+    for (size_t i = 0; i < size; i++)
+    {
+        char *p = CharArenaAllocator_malloc(arena, 8 + i % 48);
+        p[0] = (char)i;
+    }
+    double time = now() - begin;
+    CharArenaAllocator_delete(arena);
+    *ops = size;
+    return time;
+}
+
+static double benchArenaRealloc(size_t size, size_t *ops)
+{
+    CharArenaAllocator *arena = CharArenaAllocator_new(ARENA_SIZE);
+    char *p = CharArenaAllocator_malloc(arena, 8);
+    double begin = now();
+    for (size_t i = 0; i < size; i++)
+    {
+        p = CharArenaAllocator_realloc(arena, 8);
+        p[i * 8] = (char)i;
+    }
+    double time = now() - begin;
+    CharArenaAllocator_delete(arena);
+    *ops = size;
+    return time;
+}
+
+static double benchAliasList(size_t size, size_t *ops)
+{
+    char *names = (char *)malloc(size * ID_LENGTH);
+    AliasList *list = AliasList_new();
+    for (size_t i = 0; i < size; i++)
+    {
+        char *name = names + i * ID_LENGTH;
+        snprintf(name, ID_LENGTH, "Alias%zu", i);
+        Alias *alias = AliasList_newAlias(list, name);
+        alias->id.id = name;
+    }
+    const char *miss = "ns=1;i=1000";
+    double begin = now();
+    for (size_t i = 0; i < ALIAS_LOOKUPS; i++)
+    {
+        const char *name =
+            i % 2 ? miss : names + (i / 2 * 7 % size) * ID_LENGTH;
+        AliasList_getNodeId(list, name);
+    }
+    double time = now() - begin;
+    AliasList_delete(list);
+    free(names);
+    *ops = ALIAS_LOOKUPS;
+    return time;
+}
+
+static size_t compares = 0;
+
+static int cmpNodeId(const void *a, const void *b)
+{
+    compares++;
+    return NodesetLoader_NodeId_cmp((const NL_NodeId *)a,
+                                    (const NL_NodeId *)b);
+}
+
+static double benchNodeIdCmp(size_t size, size_t *ops)
+{
+    char *ids = newIds(size, 1000);
+    NL_NodeId *nodeIds = (NL_NodeId *)malloc(size * sizeof(NL_NodeId));
+    // a fixed permutation over a few namespaces
+    for (size_t i = 0; i < size; i++)
+    {
+        size_t k = (i * 7919) % size;
+        nodeIds[i].nsIdx = (int)(k % 4);
+        nodeIds[i].id = ids + k * ID_LENGTH;
+    }
+    compares = 0;
+    double begin = now();
+    qsort(nodeIds, size, sizeof(NL_NodeId), cmpNodeId);
+    double time = now() - begin;
+    free(nodeIds);
+    free(ids);
+    *ops = compares;
+    return time;
+}
+
+struct SortInput
+{
+    char *ids;
+    NL_ObjectNode *nodes;
+    NL_Reference *refs;
+};
+
+static size_t sortedNodes = 0;
+
+static void onSorted(struct Nodeset *nodeset, NL_Node *node)
+{
+    sortedNodes++;
+}
+
+// node i is a child of node (i - 1) / SORT_FANOUT by an inverse reference
+static void newSortInput(struct SortInput *in, size_t size)
+{
+    in->ids = newIds(size, 1000);
+    in->nodes = (NL_ObjectNode *)calloc(size, sizeof(NL_ObjectNode));
+    in->refs = (NL_Reference *)calloc(size, sizeof(NL_Reference));
+    for (size_t i = 0; i < size; i++)
+    {
+        NL_ObjectNode *node = &in->nodes[i];
+        node->nodeClass = NODECLASS_OBJECT;
+        node->id.nsIdx = 1;
+        node->id.id = in->ids + i * ID_LENGTH;
+        if (i > 0)
+        {
+            NL_Reference *ref = &in->refs[i];
+            ref->isForward = false;
+            ref->target = in->nodes[(i - 1) / SORT_FANOUT].id;
+            node->hierachicalRefs = ref;
+        }
+    }
+}
+
+static void deleteSortInput(struct SortInput *in)
+{
+    free(in->refs);
+    free(in->nodes);
+    free(in->ids);
+}
+
+static double benchSortAddNode(size_t size, size_t *ops)
+{
+    struct SortInput in;
+    newSortInput(&in, size);
+    SortContext *ctx = Sort_init();
+    double begin = now();
+    for (size_t i = 0; i < size; i++)
+    {
+        Sort_addNode(ctx, (NL_Node *)&in.nodes[i]);
+    }
+    double time = now() - begin;
+    Sort_cleanup(ctx);
+    deleteSortInput(&in);
+    *ops = size;
+    return time;
+}
+
+static double benchSortStart(size_t size, size_t *ops)
+{
+    struct SortInput in;
+    newSortInput(&in, size);
+    SortContext *ctx = Sort_init();
+    for (size_t i = 0; i < size; i++)
+    {
+        Sort_addNode(ctx, (NL_Node *)&in.nodes[i]);
+    }
+    sortedNodes = 0;
+    double begin = now();
+    Sort_start(ctx, NULL, onSorted, NULL);
+    double time = now() - begin;
+    Sort_cleanup(ctx);
+    deleteSortInput(&in);
+    *ops = sortedNodes;
+    return time;
+}
+
+static double benchValueListOf(size_t size, size_t *ops)
+{
+    double begin = now();
+    NL_Value *val = Value_new(NULL);
+    Value_start(val, "ListOfInt32");
+    for (size_t i = 0; i < size; i++)
+    {
+        Value_start(val, "Int32");
+        Value_end(val, "Int32", "42");
+    }
+    Value_end(val, "ListOfInt32", NULL);
+    double time = now() - begin;
+    *ops = val->data->val.complexData.membersSize;
+    Value_delete(val);
+    return time;
+}
+
+static const struct Bench benches[] = {
+    {"CharArenaAllocator_malloc", benchArenaMalloc, 0},
+    {"CharArenaAllocator_realloc", benchArenaRealloc, 0},
+    {"AliasList_getNodeId", benchAliasList, MAX_ALIASES},
+    {"NodesetLoader_NodeId_cmp", benchNodeIdCmp, 0},
+    {"Sort_addNode", benchSortAddNode, 0},
+    {"Sort_start", benchSortStart, 0},
+    {"Value_start/Value_end", benchValueListOf, 0}};
+
+// sizes 10, 100, ... up to maxSize, the limit of the benchmark is the last
+// size if it is smaller
+static void runBench(const struct Bench *bench, size_t maxSize,
+                     int repetitions, double *times)
+{
+    size_t limit = bench->maxSize && bench->maxSize < maxSize ? bench->maxSize
+                                                               : maxSize;
+    for (size_t size = 10; size <= limit; size *= 10)
+    {
+        size_t ops = 0;
+        for (int i = 0; i < repetitions; i++)
+        {
+            times[i] = bench->run(size, &ops);
+        }
+        qsort(times, (size_t)repetitions, sizeof(double), cmpDouble);
+        double median = times[repetitions / 2];
+        printf("%-28s %10zu %12.3f %12zu %10.1f\n", bench->name, size, median,
+               ops, ops ? median * 1e6 / (double)ops : 0);
+        if (size < limit && size * 10 > limit)
+        {
+            size = limit / 10;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int repetitions = 5;
+    size_t maxSize = 100000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!strcmp(argv[i], "-r"))
+        {
+            repetitions = atoi(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "-n"))
+        {
+            maxSize = (size_t)atol(argv[i + 1]);
+        }
+    }
+    if (repetitions <= 0 || maxSize < 10 || argc % 2 == 0)
+    {
+        printf("usage: primitivesBench [-r repetitions] [-n maxSize]\n");
+        return 1;
+    }
+    double *times = (double *)calloc((size_t)repetitions, sizeof(double));
+    if (!times)
+    {
+        return 1;
+    }
+    printf("%-28s %10s %12s %12s %10s\n", "primitive", "size", "median ms",
+           "operations", "ns/op");
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        runBench(&benches[i], maxSize, repetitions, times);
+    }
+    free(times);
+    return 0;
+}
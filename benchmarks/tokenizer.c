@@ -0,0 +1,176 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+ * compares the throughput of libxml2 and the tokenizer with each character
+ * scan implementation, the nodeset is read into memory first, only the raw
+ * SAX events are counted
+ * usage: tokenizerBench [-r repetitions] nodeset1.xml nodeset2.xml ...
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include "CharScan.h"
+#include "Parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct EventCount
+{
+    size_t elements;
+    size_t characters;
+};
+
+static void onStart(void *ctx, const char *localname, const char *prefix,
+                    const char *URI, int nb_namespaces, const char **namespaces,
+                    int nb_attributes, int nb_defaulted,
+                    const char **attributes)
+{
+    ((struct EventCount *)ctx)->elements++;
+}
+
+static void onEnd(void *ctx, const char *localname, const char *prefix,
+                  const char *URI)
+{
+}
+
+static void onChars(void *ctx, const char *ch, int len)
+{
+    ((struct EventCount *)ctx)->characters += (size_t)len;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+    return (d > 0) - (d < 0);
+}
+
+// returns the median time in ms, the parser is reused like in the loader
+static double run(const char *data, size_t size, int options, int repetitions,
+                  struct EventCount *count)
+{
+    double *times = (double *)calloc((size_t)repetitions, sizeof(double));
+    Parser *parser = Parser_new(count);
+    Parser_setOptions(parser, options);
+    for (int i = 0; i < repetitions; i++)
+    {
+        memset(count, 0, sizeof(*count));
+        double begin = now();
+        int status =
+            Parser_runBuffer(parser, data, size, onStart, onEnd, onChars);
+        times[i] = now() - begin;
+        if (status)
+        {
+            Parser_delete(parser);
+            free(times);
+            return -1;
+        }
+    }
+    Parser_delete(parser);
+    qsort(times, (size_t)repetitions, sizeof(double), cmpDouble);
+    double median = times[repetitions / 2];
+    free(times);
+    return median;
+}
+
+static char *readFile(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = len > 0 ? (char *)malloc((size_t)len) : NULL;
+    if (data && fread(data, 1, (size_t)len, f) != (size_t)len)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (size_t)len;
+    return data;
+}
+
+static void printResult(const char *engine, double ms, size_t size)
+{
+    printf("  %-20s %10.2f ms %10.1f MB/s\n", engine, ms,
+           (double)size / (ms * 1e3));
+}
+
+int main(int argc, char *argv[])
+{
+    int repetitions = 10;
+    int first = 1;
+    if (argc > 2 && !strcmp(argv[1], "-r"))
+    {
+        repetitions = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || repetitions <= 0)
+    {
+        printf("usage: tokenizerBench [-r repetitions] nodeset1.xml "
+               "nodeset2.xml ...\n");
+        return 1;
+    }
+    const CharScan_Implementation implementations[] = {
+        CHARSCAN_SCALAR, CHARSCAN_SSE2, CHARSCAN_AVX2};
+    for (int i = first; i < argc; i++)
+    {
+        size_t size;
+        char *data = readFile(argv[i], &size);
+        if (!data)
+        {
+            printf("%s: cannot read file\n", argv[i]);
+            return 1;
+        }
+        printf("%s (%zu bytes)\n", argv[i], size);
+        struct EventCount expected;
+        double t = run(data, size, NL_PARSER_OPTIONS_DEFAULT, repetitions,
+                       &expected);
+        if (t < 0)
+        {
+            printf("  parsing failed\n");
+            free(data);
+            return 1;
+        }
+        printResult("libxml2", t, size);
+        for (size_t j = 0;
+             j < sizeof(implementations) / sizeof(implementations[0]); j++)
+        {
+            if (!CharScan_select(implementations[j]))
+            {
+                continue;
+            }
+            struct EventCount count;
+            t = run(data, size,
+                    NL_PARSER_OPTIONS_DEFAULT | NL_PARSER_OPTION_FAST_TOKENIZER,
+                    repetitions, &count);
+            if (t < 0 || count.elements != expected.elements ||
+                count.characters != expected.characters)
+            {
+                printf("  %s: events differ\n",
+                       CharScan_name(implementations[j]));
+                free(data);
+                return 1;
+            }
+            char engine[32];
+            snprintf(engine, sizeof(engine), "tokenizer %s",
+                     CharScan_name(implementations[j]));
+            printResult(engine, t, size);
+        }
+        free(data);
+    }
+    return 0;
+}
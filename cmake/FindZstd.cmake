@@ -0,0 +1,15 @@
+# - Try to find libzstd
+#  Once done this will define
+#
+#  ZSTD_FOUND - system has libzstd
+#  ZSTD_INCLUDE_DIR - the zstd include directory
+#  ZSTD_LIBRARIES - zstd library
+
+FIND_PATH( ZSTD_INCLUDE_DIR zstd.h )
+FIND_LIBRARY( ZSTD_LIBRARIES NAMES zstd zstd_static )
+
+INCLUDE( FindPackageHandleStandardArgs )
+FIND_PACKAGE_HANDLE_STANDARD_ARGS( Zstd DEFAULT_MSG ZSTD_LIBRARIES ZSTD_INCLUDE_DIR )
+
+# Hide advanced variables from CMake GUIs
+MARK_AS_ADVANCED( ZSTD_INCLUDE_DIR ZSTD_LIBRARIES )
@@ -0,0 +1,25 @@
+# nodesetloader_embed(<target> <name> <nodeset> ...)
+# imports and sorts the nodesets at build time and links the image of the
+# nodes into the target, the generated header <name>.h declares the array
+# <name> and its size in bytes <name>Size for NodesetLoader_loadImageBuffer
+# the module and the nodesetEmbed tool are installed with the package, so
+# projects which use find_package(NodesetLoader) can call it as well
+# the image is only valid for the platform it was written on, when cross
+# compiling set NODESETLOADER_EMBED_TOOL to a nodesetEmbed built for a host
+# with the same byte order and word size as the target
+function(nodesetloader_embed target name)
+    set(dir ${CMAKE_CURRENT_BINARY_DIR}/nodesetEmbed)
+    if(NODESETLOADER_EMBED_TOOL)
+        set(tool ${NODESETLOADER_EMBED_TOOL})
+    else()
+        set(tool nodesetEmbed)
+    endif()
+    file(MAKE_DIRECTORY ${dir})
+    add_custom_command(OUTPUT ${dir}/${name}.c ${dir}/${name}.h
+        COMMAND ${tool} ${name} ${dir}/${name} ${ARGN}
+        DEPENDS ${tool} ${ARGN}
+        COMMENT "Embedding the nodeset image ${name}"
+        VERBATIM)
+    set_property(TARGET ${target} APPEND PROPERTY SOURCES ${dir}/${name}.c)
+    target_include_directories(${target} PRIVATE ${dir})
+endfunction()
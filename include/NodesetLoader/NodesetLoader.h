@@ -84,6 +84,11 @@ typedef struct NL_LocalizedText NL_LocalizedText;
 
 #define NL_NODE_INSTANCE_ATTRIBUTES NL_NodeId parentNodeId;
 
+// the typed members of the nodes hold the attribute strings of the node
+// decoded once when the node is created, arrayDimensionsSize is the number
+// of dimensions, only the first NL_MAX_ARRAY_DIMENSIONS are decoded
+#define NL_MAX_ARRAY_DIMENSIONS 4
+
 struct NL_Node
 {
     NL_NODE_ATTRIBUTES
@@ -103,6 +108,10 @@ struct NL_ObjectNode
     NL_NODE_INSTANCE_ATTRIBUTES
     char *eventNotifier;
     NL_Reference *refToTypeDef;
+    struct
+    {
+        uint8_t eventNotifier;
+    } typed;
 };
 typedef struct NL_ObjectNode NL_ObjectNode;
 
@@ -110,6 +119,10 @@ struct NL_ObjectTypeNode
 {
     NL_NODE_ATTRIBUTES
     char *isAbstract;
+    struct
+    {
+        bool isAbstract;
+    } typed;
 };
 typedef struct NL_ObjectTypeNode NL_ObjectTypeNode;
 
@@ -120,6 +133,13 @@ struct NL_VariableTypeNode
     NL_NodeId datatype;
     char *arrayDimensions;
     char *valueRank;
+    struct
+    {
+        bool isAbstract;
+        int32_t valueRank;
+        uint32_t arrayDimensionsSize;
+        uint32_t arrayDimensions[NL_MAX_ARRAY_DIMENSIONS];
+    } typed;
 };
 typedef struct NL_VariableTypeNode NL_VariableTypeNode;
 
@@ -180,6 +200,15 @@ struct NL_VariableNode
     char *historizing;
     NL_Value *value;
     NL_Reference *refToTypeDef;
+    struct
+    {
+        int32_t valueRank;
+        uint8_t accessLevel;
+        uint8_t userAccessLevel;
+        bool historizing;
+        uint32_t arrayDimensionsSize;
+        uint32_t arrayDimensions[NL_MAX_ARRAY_DIMENSIONS];
+    } typed;
 };
 typedef struct NL_VariableNode NL_VariableNode;
 
@@ -206,6 +235,10 @@ struct NL_DataTypeNode
     NL_NODE_ATTRIBUTES
     NL_DataTypeDefinition *definition;
     char *isAbstract;
+    struct
+    {
+        bool isAbstract;
+    } typed;
 };
 typedef struct NL_DataTypeNode NL_DataTypeNode;
 
@@ -215,6 +248,11 @@ struct NL_MethodNode
     NL_NODE_INSTANCE_ATTRIBUTES
     char *executable;
     char *userExecutable;
+    struct
+    {
+        bool executable;
+        bool userExecutable;
+    } typed;
 };
 typedef struct NL_MethodNode NL_MethodNode;
 
@@ -223,6 +261,10 @@ struct NL_ReferenceTypeNode
     NL_NODE_ATTRIBUTES
     NL_LocalizedText inverseName;
     char *symmetric;
+    struct
+    {
+        bool symmetric;
+    } typed;
 };
 typedef struct NL_ReferenceTypeNode NL_ReferenceTypeNode;
 
@@ -232,10 +274,53 @@ struct NL_ViewNode
     NL_NODE_INSTANCE_ATTRIBUTES
     char *containsNoLoops;
     char *eventNotifier;
+    struct
+    {
+        bool containsNoLoops;
+        uint8_t eventNotifier;
+    } typed;
 };
 typedef struct NL_ViewNode NL_ViewNode;
 
 typedef int (*NL_addNamespaceCallback)(void *userContext, const char *);
+// called when the start tag of a node is parsed, id and browseName already
+// have the namespace indices of the loader and are only valid during the call
+// returns false to skip the node with all of its content, references of other
+// nodes to it are kept
+// with parse threads it is called concurrently for the parts of a file
+typedef bool (*NL_nodeFilterCallback)(void *userContext,
+                                      NL_NodeClass nodeClass,
+                                      const NL_NodeId *id,
+                                      const NL_BrowseName *browseName);
+
+typedef enum
+{
+    NL_PROGRESS_PARSE,
+    NL_PROGRESS_SORT,
+    // the nodes are added by a backend, the loader itself never reports it
+    NL_PROGRESS_ADD
+} NL_ProgressPhase;
+
+struct NL_Progress
+{
+    NL_ProgressPhase phase;
+    // bytes of the current input which were handed to the parser, compressed
+    // input counts with its compressed size, 0 after the parse
+    size_t bytes;
+    // nodes of the loader (parse), sorted nodes (sort) or added nodes (add)
+    size_t nodes;
+};
+typedef struct NL_Progress NL_Progress;
+
+// called on the importing thread about every MiB of the input, at the end of
+// each file and about every 4096 nodes of NodesetLoader_sort, returns false
+// to cancel: the import or sort returns false and all nodes of the loader are
+// discarded, the loader is empty afterwards
+// nodes which are parsed by other threads are counted when their file is
+// finished, NL_PARSER_OPTION_FAST_TOKENIZER parses a file in one pass, it is
+// only reported at its end
+typedef bool (*NL_progressCallback)(void *userContext,
+                                    const NL_Progress *progress);
 
 struct NL_FileContext
 {
@@ -243,25 +328,265 @@ struct NL_FileContext
     const char *file;
     NL_addNamespaceCallback addNamespace;
     NodesetLoader_ExtensionInterface *extensionHandling;
+    // optional, all nodes are imported if NULL
+    NL_nodeFilterCallback filterNode;
+    // optional, NodesetLoader_sort uses the one of the last imported file
+    NL_progressCallback progress;
 };
 typedef struct NL_FileContext NL_FileContext;
 
+// reads up to size bytes of the nodeset into buffer, returns the number of
+// bytes read, 0 at the end of the input and a negative value on errors
+typedef long (*NL_readCallback)(void *streamContext, char *buffer,
+                                size_t size);
+
 struct NodesetLoader;
 typedef struct NodesetLoader NodesetLoader;
 
+// options for the xml parser, they can be combined
+// keep short text in the libxml2 node structures, only relevant for
+// extensions which build up a tree
+#define NL_PARSER_OPTION_COMPACT 0x1
+// lifts the hardcoded limits of libxml2, e.g. the size of text nodes
+#define NL_PARSER_OPTION_HUGE 0x2
+// substitute entities, off by default: nodesets don't need them
+#define NL_PARSER_OPTION_SUBSTITUTE_ENTITIES 0x4
+// parse uncompressed files and buffers with the tokenizer of the library
+// instead of libxml2, it only supports what nodesets need (utf-8, no document
+// type definitions) and leaves other documents to libxml2
+// ignored if the library is built without ENABLE_FAST_TOKENIZER or together
+// with NL_PARSER_OPTION_SUBSTITUTE_ENTITIES
+#define NL_PARSER_OPTION_FAST_TOKENIZER 0x8
+// read files on a separate thread into a ring of large buffers while the
+// previous buffer is parsed, instead of mapping them, useful for slow or
+// network file systems, NodesetLoader_getImportTimings shows the time spent
+// waiting for the input
+// without thread support the files are read in chunks on the calling thread
+#define NL_PARSER_OPTION_READ_AHEAD 0x10
+// only record the elements and text of each <Value> in one block of memory,
+// the NL_Data tree is built when NodesetLoader_getValue is called for the
+// node, until then value->data of a variable node is NULL
+// saves memory and parse time for nodesets with many values which are not
+// needed, e.g. because they are overwritten at runtime
+#define NL_PARSER_OPTION_LAZY_VALUES 0x20
+#define NL_PARSER_OPTIONS_DEFAULT NL_PARSER_OPTION_COMPACT
+
 LOADER_EXPORT NodesetLoader *NodesetLoader_new(NodesetLoader_Logger *logger,
                                                struct NL_ReferenceService *refService);
+// gzip and (if enabled) zstd compressed nodesets are decompressed on the fly,
+// this applies to all import functions
 LOADER_EXPORT bool NodesetLoader_importFile(NodesetLoader *loader,
                                             const NL_FileContext *fileContext);
+// imports a nodeset which is already in memory, fileContext->file is ignored,
+// the data is not copied and only has to be valid during the call
+LOADER_EXPORT bool NodesetLoader_importBuffer(NodesetLoader *loader,
+                                              const NL_FileContext *fileContext,
+                                              const char *data, size_t length);
+// imports a nodeset which is read chunk by chunk with the read callback,
+// fileContext->file is ignored
+LOADER_EXPORT bool NodesetLoader_importStream(NodesetLoader *loader,
+                                              const NL_FileContext *fileContext,
+                                              NL_readCallback read,
+                                              void *streamContext);
+// imports the files concurrently, the namespaces (addNamespace) and the nodes
+// are added in the given order of the files, the result is the same as with
+// a sequence of NodesetLoader_importFile
+// the threads are distributed to the files by their size, their number is
+// set with NodesetLoader_setParseThreads or else the number of processors
+// if a file cannot be imported, the files before it are imported and false is
+// returned
+LOADER_EXPORT bool NodesetLoader_importFiles(NodesetLoader *loader,
+                                             const NL_FileContext *fileContexts,
+                                             size_t count);
+// keeps images of the imported nodesets (see NodesetLoader_writeImage) in the
+// directory dir, which has to exist, NULL turns the cache off
+// NodesetLoader_importFile(s) then only hash the files, the key of an image
+// is the hash of the contents of all files imported so far, the parser
+// options they were imported with and the version of the loader
+// NodesetLoader_sort and NodesetLoader_forEachNode import the files: from
+// the image if there is one, otherwise from the xml files, and after a
+// successful sort the image is written on a separate thread
+// therefore errors in the files are reported by NodesetLoader_sort and the
+// user contexts of the files have to be valid until then, after such an
+// error NodesetLoader_sort keeps returning false and
+// NodesetLoader_forEachNode passes no node, the namespaces of an image are
+// added with the file context of the last file it contains
+// the cache is only used as long as all nodes of the loader come from
+// NodesetLoader_importFile(s) without extension handling or node filter and
+// never by a loader with a custom NL_ReferenceService
+LOADER_EXPORT void NodesetLoader_setCacheDir(NodesetLoader *loader,
+                                             const char *dir);
+// applies to all following imports of this loader
+LOADER_EXPORT void NodesetLoader_setParserOptions(NodesetLoader *loader,
+                                                  int options);
+// number of threads which parse the nodes of a single uncompressed file or
+// buffer, the merged result is the same as with the default of 1 (serial)
+// files with extension handling are always parsed serially
+// ignored if the library is built without ENABLE_THREADS
+LOADER_EXPORT void NodesetLoader_setParseThreads(NodesetLoader *loader,
+                                                 size_t threads);
+// where the time of an import went
+struct NL_ImportTiming
+{
+    // NULL for buffers and streams
+    const char *file;
+    size_t bytes;
+    // waiting for the input, only measured if the input is read in chunks,
+    // e.g. with NL_PARSER_OPTION_READ_AHEAD
+    double ioWaitMs;
+    // parsing, summed up over all threads which parsed the file
+    double parseMs;
+    // calls of xmlParseChunk, 0 if the file was parsed with the tokenizer
+    size_t parseChunks;
+};
+typedef struct NL_ImportTiming NL_ImportTiming;
+// the timings of all imports of this loader in the order of the files, valid
+// until the next import
+LOADER_EXPORT size_t NodesetLoader_getImportTimings(
+    const NodesetLoader *loader, const NL_ImportTiming **timings);
+// where the time and memory of a loader went, the timings are wall clock
+// milliseconds summed up over all calls
+struct NL_Stats
+{
+    // the import functions and NodesetLoader_loadImage(Buffer), including
+    // the files which NodesetLoader_sort imports for the cache
+    double importMs;
+    // the sums of the import timings, see NL_ImportTiming, alias and
+    // namespace resolution happen while parsing and are part of parseMs
+    double ioWaitMs;
+    double parseMs;
+    size_t bytes;
+    size_t parseChunks;
+    // resolving the unknown references of NodesetLoader_sort
+    double resolveMs;
+    double sortMs;
+    // NodesetLoader_forEachNode including the callbacks, e.g. adding the
+    // nodes to a server
+    double forEachNodeMs;
+    // the following counters are about the nodes which the loader holds or
+    // streamed, nodes of images are not counted
+    size_t nodes[NL_NODECLASS_COUNT];
+    // references of the nodes when they were parsed, unknown references
+    // have a reference type which was not known at that point
+    size_t hierarchicalRefs;
+    size_t nonHierarchicalRefs;
+    size_t unknownRefs;
+    // unknown references which NodesetLoader_sort resolved
+    size_t unknownRefsResolved;
+    // memory of the string arenas
+    size_t arenaBytes;
+    // the most nodes which waited for an unknown reference type at once
+    size_t peakUnknownRefNodes;
+    // the most nodes of the sort graph which were not sorted yet when a
+    // sort started
+    size_t peakSortNodes;
+    // the most bytes of the nodes which the node stream held back in memory
+    // at once, without their strings, see NodesetLoader_setMemoryBudget
+    size_t peakHeldBytes;
+    // held back nodes which were written to the temporary file
+    size_t spilledNodes;
+};
+typedef struct NL_Stats NL_Stats;
+LOADER_EXPORT void NodesetLoader_getStats(const NodesetLoader *loader,
+                                          NL_Stats *stats);
+// the memory of all loaders of the process, only counted if the library is
+// built with ENABLE_MEMORY_STATS
+typedef enum
+{
+    // node structs and data type definitions
+    NL_MEMORY_NODES,
+    NL_MEMORY_REFERENCES,
+    // NL_Value and the NL_Data trees
+    NL_MEMORY_VALUES,
+    // the regions of the string arenas and the tables of their string pools
+    NL_MEMORY_ARENA,
+    // the nodes and edges of the sort graph
+    NL_MEMORY_SORT,
+    // NodesetLoader_getBidirectionalRefs
+    NL_MEMORY_ENCODING_REFS,
+    NL_MEMORY_CATEGORY_COUNT
+} NL_MemoryCategory;
+LOADER_EXPORT extern const char *NL_MEMORY_CATEGORY_NAME[NL_MEMORY_CATEGORY_COUNT];
+struct NL_MemoryUsage
+{
+    // bytes since the start of the process or the last reset
+    size_t allocated;
+    // bytes which are not freed yet
+    size_t live;
+    // the most live bytes since the start or the last reset
+    size_t peak;
+};
+typedef struct NL_MemoryUsage NL_MemoryUsage;
+// fills in the usage per category, false (and zeros) if the library is
+// built without ENABLE_MEMORY_STATS
+LOADER_EXPORT bool
+NodesetLoader_getMemoryUsage(NL_MemoryUsage usage[NL_MEMORY_CATEGORY_COUNT]);
+// sets allocated to 0 and the peak to the live bytes of each category
+LOADER_EXPORT void NodesetLoader_resetMemoryUsage(void);
 LOADER_EXPORT void NodesetLoader_delete(NodesetLoader *loader);
 LOADER_EXPORT const NL_BiDirectionalReference *
 NodesetLoader_getBidirectionalRefs(const NodesetLoader *loader);
 LOADER_EXPORT bool NodesetLoader_sort(NodesetLoader *loader);
+// writes the sorted nodes of the loader into a binary image, which is
+// loaded much faster than the xml files, see NodesetLoader_loadImage
+// the image is only valid for the version of the library and the platform
+// it was written with, nodes with extensions cannot be written
+LOADER_EXPORT bool NodesetLoader_writeImage(const NodesetLoader *loader,
+                                            const char *path);
+// loads an image of NodesetLoader_writeImage into a loader without nodes,
+// fileContext->file is the image, the namespaces of the image are added with
+// fileContext->addNamespace like for an import
+// the nodes are sorted already, further nodesets can be imported on top and
+// are sorted with NodesetLoader_sort
+// if false is returned, the loader is still empty
+LOADER_EXPORT bool NodesetLoader_loadImage(NodesetLoader *loader,
+                                           const NL_FileContext *fileContext);
+// NodesetLoader_loadImage for an image in memory, e.g. one linked into the
+// binary with nodesetloader_embed, fileContext->file is only used for the
+// import timings and may be NULL
+// the data is not copied, it has to be aligned to 8 bytes and stay unchanged
+// until the loader is deleted
+LOADER_EXPORT bool NodesetLoader_loadImageBuffer(
+    NodesetLoader *loader, const NL_FileContext *fileContext, const void *data,
+    size_t size);
 typedef void (*NodesetLoader_forEachNode_Func)(void *context, NL_Node *node);
 LOADER_EXPORT size_t
 NodesetLoader_forEachNode(NodesetLoader *loader, NL_NodeClass nodeClass,
                           void *context, NodesetLoader_forEachNode_Func fn);
+// passes the nodes of the following imports to fn while they are parsed: a
+// node is passed as soon as all of its hierarchical predecessors were passed,
+// NodesetLoader_sort passes the nodes which are still blocked, fn is called
+// on the importing thread and NULL turns streaming off
+// the node is deleted when fn returns, it is neither returned by
+// NodesetLoader_forEachNode nor written by NodesetLoader_writeImage, its
+// strings stay valid until the loader is deleted
+// a predecessor in a namespace which is neither listed in the NamespaceUris
+// of an imported file nor has an imported node (e.g. namespace 0 for a
+// companion nodeset) is expected to exist already, a node whose predecessor
+// is in any other namespace is held back until the predecessor was passed or
+// until NodesetLoader_sort
+// a node with the NodeId of a node which was passed already is dropped, as
+// after NodesetLoader_sort, while a node still held back is replaced
+// nodes of images are not streamed and a streaming loader doesn't use the
+// cache, see NodesetLoader_setCacheDir
+LOADER_EXPORT bool NodesetLoader_setNodeStream(
+    NodesetLoader *loader, void *context, NodesetLoader_forEachNode_Func fn);
+// bounds the memory of the nodes which the node stream holds back to about
+// bytes, further held back nodes are written to a temporary file and read
+// back when they are ready, 0 (the default) keeps them in memory
+// only the node stream holds nodes back, so a budget needs one, false
+// without a stream, removing the stream removes the budget
+// the strings of a node which was read back are only valid during the
+// stream callback, reference types and nodes with extensions always stay in
+// memory, the sort graph and the strings of the parser are not bounded
+// false if the temporary file cannot be created
+LOADER_EXPORT bool NodesetLoader_setMemoryBudget(NodesetLoader *loader,
+                                                 size_t bytes);
 LOADER_EXPORT bool NodesetLoader_isInstanceNode (const NL_Node *baseNode);
+// the value of the variable node, with NL_PARSER_OPTION_LAZY_VALUES its data
+// is built on the first call, so the first call for a node must not run
+// concurrently with other calls for the same node
+LOADER_EXPORT NL_Value *NodesetLoader_getValue(const NL_VariableNode *node);
 #ifdef __cplusplus
 }
 #endif
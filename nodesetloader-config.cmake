@@ -1,2 +1,3 @@
 get_filename_component(SELF_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
-include(${SELF_DIR}/NodesetLoader.cmake)
\ No newline at end of file
+include(${SELF_DIR}/NodesetLoader.cmake)
+include(${SELF_DIR}/NodesetLoaderEmbed.cmake)
\ No newline at end of file
@@ -33,6 +33,18 @@ AliasList *AliasList_new()
     return list;
 }
 
+AliasList *AliasList_copy(const AliasList *list)
+{
+    AliasList *copy = AliasList_new();
+    if(!copy)
+    {
+        return NULL;
+    }
+    memcpy(copy->data, list->data, list->size * sizeof(Alias));
+    copy->size = list->size;
+    return copy;
+}
+
 Alias *AliasList_newAlias(AliasList *list, char *name)
 {
     if(list->size >= MAX_ALIAS)
@@ -62,6 +74,15 @@ const NL_NodeId *AliasList_getNodeId(const AliasList *list, const char *name)
     return NULL;
 }
 
+const Alias *AliasList_getAlias(const AliasList *list, size_t idx)
+{
+    if (idx >= list->size)
+    {
+        return NULL;
+    }
+    return &list->data[idx];
+}
+
 void AliasList_delete(AliasList *list)
 {
     free(list->data);
@@ -8,6 +8,7 @@
 #ifndef ALIASLIST_H
 #define ALIASLIST_H
 #include <NodesetLoader/NodeId.h>
+#include <stddef.h>
 
 struct Alias
 {
@@ -20,8 +21,12 @@ typedef struct Alias Alias;
 struct AliasList;
 typedef struct AliasList AliasList;
 AliasList *AliasList_new(void);
+// a list with the aliases of list, the names and ids are shared
+AliasList *AliasList_copy(const AliasList *list);
 Alias *AliasList_newAlias(AliasList *list, char *name);
 const NL_NodeId *AliasList_getNodeId(const AliasList *list, const char *alias);
+// NULL if idx is out of range
+const Alias *AliasList_getAlias(const AliasList *list, size_t idx);
 void AliasList_delete(AliasList *list);
 
 #endif
@@ -0,0 +1,76 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "AttributeToken.h"
+#include <string.h>
+
+// perfect hash over the length, the third and the last character like the
+// one of ElementToken, a collision is reported as overridden initializer
+#define ATTRIBUTE_TABLE_SIZE 64
+#define ATTRIBUTE_HASH(len, third, last)                                       \
+    (((len) + (unsigned)(third)*8u + (unsigned)(last)*2u) &                    \
+     (ATTRIBUTE_TABLE_SIZE - 1))
+#define ATTRIBUTE_ENTRY(name, third, last, token)                              \
+    [ATTRIBUTE_HASH(sizeof(name) - 1, third, last)] = {name, sizeof(name) - 1, \
+                                                       token}
+
+#define ATTRIBUTE_MIN_LENGTH 4
+#define ATTRIBUTE_MAX_LENGTH 15
+
+struct AttributeEntry
+{
+    const char *name;
+    size_t length;
+    AttributeToken token;
+};
+
+static const struct AttributeEntry attributeTable[ATTRIBUTE_TABLE_SIZE] = {
+    ATTRIBUTE_ENTRY("NodeId", 'd', 'd', ATTRIBUTE_NODEID),
+    ATTRIBUTE_ENTRY("BrowseName", 'o', 'e', ATTRIBUTE_BROWSENAME),
+    ATTRIBUTE_ENTRY("ParentNodeId", 'r', 'd', ATTRIBUTE_PARENTNODEID),
+    ATTRIBUTE_ENTRY("DataType", 't', 'e', ATTRIBUTE_DATATYPE),
+    ATTRIBUTE_ENTRY("ValueRank", 'l', 'k', ATTRIBUTE_VALUERANK),
+    ATTRIBUTE_ENTRY("ArrayDimensions", 'r', 's', ATTRIBUTE_ARRAYDIMENSIONS),
+    ATTRIBUTE_ENTRY("Historizing", 's', 'g', ATTRIBUTE_HISTORIZING),
+    ATTRIBUTE_ENTRY("EventNotifier", 'e', 'r', ATTRIBUTE_EVENTNOTIFIER),
+    ATTRIBUTE_ENTRY("IsAbstract", 'A', 't', ATTRIBUTE_ISABSTRACT),
+    ATTRIBUTE_ENTRY("ReferenceType", 'f', 'e', ATTRIBUTE_REFERENCETYPE),
+    ATTRIBUTE_ENTRY("IsForward", 'F', 'd', ATTRIBUTE_ISFORWARD),
+    ATTRIBUTE_ENTRY("Symmetric", 'm', 'c', ATTRIBUTE_SYMMETRIC),
+    ATTRIBUTE_ENTRY("Alias", 'i', 's', ATTRIBUTE_ALIAS),
+    ATTRIBUTE_ENTRY("ContainsNoLoops", 'n', 's', ATTRIBUTE_CONTAINSNOLOOPS),
+    ATTRIBUTE_ENTRY("Executable", 'e', 'e', ATTRIBUTE_EXECUTABLE),
+    ATTRIBUTE_ENTRY("UserExecutable", 'e', 'e', ATTRIBUTE_USEREXECUTABLE),
+    ATTRIBUTE_ENTRY("AccessLevel", 'c', 'l', ATTRIBUTE_ACCESSLEVEL),
+    ATTRIBUTE_ENTRY("UserAccessLevel", 'e', 'l', ATTRIBUTE_USERACCESSLEVEL),
+    ATTRIBUTE_ENTRY("IsUnion", 'U', 'n', ATTRIBUTE_ISUNION),
+    ATTRIBUTE_ENTRY("IsOptionSet", 'O', 't', ATTRIBUTE_ISOPTIONSET),
+    ATTRIBUTE_ENTRY("Name", 'm', 'e', ATTRIBUTE_NAME),
+    ATTRIBUTE_ENTRY("Value", 'l', 'e', ATTRIBUTE_VALUE),
+    ATTRIBUTE_ENTRY("IsOptional", 'O', 'l', ATTRIBUTE_ISOPTIONAL),
+    ATTRIBUTE_ENTRY("Locale", 'c', 'e', ATTRIBUTE_LOCALE)};
+
+AttributeToken AttributeToken_lookup(const char *localname)
+{
+    return AttributeToken_lookupLength(localname, strlen(localname));
+}
+
+AttributeToken AttributeToken_lookupLength(const char *localname, size_t len)
+{
+    if (len < ATTRIBUTE_MIN_LENGTH || len > ATTRIBUTE_MAX_LENGTH)
+    {
+        return ATTRIBUTE_UNKNOWN;
+    }
+    const struct AttributeEntry *entry =
+        &attributeTable[ATTRIBUTE_HASH(len, (unsigned char)localname[2],
+                                       (unsigned char)localname[len - 1])];
+    // one comparison is needed to reject unknown names, empty entries have
+    // the length 0
+    if (entry->length == len && !memcmp(entry->name, localname, len))
+    {
+        return entry->token;
+    }
+    return ATTRIBUTE_UNKNOWN;
+}
@@ -0,0 +1,46 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef ATTRIBUTETOKEN_H
+#define ATTRIBUTETOKEN_H
+#include <stddef.h>
+
+// the attribute names of a nodeset the loader is interested in, a token is
+// the slot of the attribute when the attributes of an element are collected
+typedef enum
+{
+    ATTRIBUTE_NODEID,
+    ATTRIBUTE_BROWSENAME,
+    ATTRIBUTE_PARENTNODEID,
+    ATTRIBUTE_DATATYPE,
+    ATTRIBUTE_VALUERANK,
+    ATTRIBUTE_ARRAYDIMENSIONS,
+    ATTRIBUTE_HISTORIZING,
+    ATTRIBUTE_EVENTNOTIFIER,
+    ATTRIBUTE_ISABSTRACT,
+    ATTRIBUTE_REFERENCETYPE,
+    ATTRIBUTE_ISFORWARD,
+    ATTRIBUTE_SYMMETRIC,
+    ATTRIBUTE_ALIAS,
+    ATTRIBUTE_CONTAINSNOLOOPS,
+    ATTRIBUTE_EXECUTABLE,
+    ATTRIBUTE_USEREXECUTABLE,
+    ATTRIBUTE_ACCESSLEVEL,
+    ATTRIBUTE_USERACCESSLEVEL,
+    ATTRIBUTE_ISUNION,
+    ATTRIBUTE_ISOPTIONSET,
+    ATTRIBUTE_NAME,
+    ATTRIBUTE_VALUE,
+    ATTRIBUTE_ISOPTIONAL,
+    ATTRIBUTE_LOCALE,
+    ATTRIBUTE_UNKNOWN,
+    ATTRIBUTE_COUNT = ATTRIBUTE_UNKNOWN
+} AttributeToken;
+
+// maps a local attribute name to its token, ATTRIBUTE_UNKNOWN for all other
+// names
+AttributeToken AttributeToken_lookup(const char *localname);
+AttributeToken AttributeToken_lookupLength(const char *localname, size_t len);
+#endif
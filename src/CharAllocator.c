@@ -6,6 +6,7 @@
  */
 
 #include <CharAllocator.h>
+#include "MemoryUsage.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -42,6 +43,7 @@ static struct Region *Region_new(size_t capacity)
     }
     region->capacity = capacity;
     region->userPtr = region->mem;
+    MEMORY_ALLOCATED(NL_MEMORY_ARENA, sizeof(struct Region) + capacity);
     return region;
 }
 
@@ -109,12 +111,36 @@ char *CharArenaAllocator_realloc(CharArenaAllocator *arena, size_t size)
     return arena->current->userPtr;
 }
 
+void CharArenaAllocator_shrink(CharArenaAllocator *arena, size_t size)
+{
+    arena->current->userSize -= size;
+    arena->current->size -= size;
+}
+
+void CharArenaAllocator_freeLast(CharArenaAllocator *arena)
+{
+    memset(arena->current->userPtr, 0, arena->current->userSize);
+    arena->current->size -= arena->current->userSize;
+    arena->current->userSize = 0;
+}
+
+size_t CharArenaAllocator_size(const CharArenaAllocator *arena)
+{
+    size_t size = 0;
+    for (const struct Region *r = arena->current; r; r = r->next)
+    {
+        size += r->capacity;
+    }
+    return size;
+}
+
 void CharArenaAllocator_delete(CharArenaAllocator *arena)
 {
     struct Region *r = arena->current;
     while (r)
     {
         struct Region *tmp = r->next;
+        MEMORY_FREED(NL_MEMORY_ARENA, sizeof(struct Region) + r->capacity);
         free(r->mem);
         free(r);
         r = tmp;
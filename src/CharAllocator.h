@@ -15,6 +15,12 @@ typedef struct CharArenaAllocator CharArenaAllocator;
 CharArenaAllocator *CharArenaAllocator_new(size_t initialSize);
 char *CharArenaAllocator_malloc(struct CharArenaAllocator *arena, size_t size);
 char *CharArenaAllocator_realloc(struct CharArenaAllocator *arena, size_t size);
+// gives back the last size bytes of the last allocation
+void CharArenaAllocator_shrink(struct CharArenaAllocator *arena, size_t size);
+// gives back the whole last allocation, its bytes are zeroed again
+void CharArenaAllocator_freeLast(struct CharArenaAllocator *arena);
+// bytes of all regions of the arena, used or not
+size_t CharArenaAllocator_size(const struct CharArenaAllocator *arena);
 void CharArenaAllocator_delete(struct CharArenaAllocator *arena);
 
 #endif
@@ -0,0 +1,265 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "CharScan.h"
+#include "Thread.h"
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHARSCAN_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// avx2 is compiled with a function attribute and selected at runtime, so the
+// library itself can be built for older cpus
+#if defined(CHARSCAN_HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define CHARSCAN_HAVE_AVX2 1
+#include <immintrin.h>
+#define CHARSCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+typedef const char *(*ScanText)(const char *p, const char *end);
+typedef const char *(*ScanAttribute)(const char *p, const char *end,
+                                     char quote);
+
+static const char *textScalar(const char *p, const char *end)
+{
+    for (; p < end; p++)
+    {
+        if (*p == '<' || *p == '&' || *p == '\r')
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+static const char *attributeScalar(const char *p, const char *end, char quote)
+{
+    for (; p < end; p++)
+    {
+        if (*p == quote || *p == '<' || *p == '&' ||
+            (unsigned char)*p < 0x20)
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+#ifdef CHARSCAN_HAVE_SSE2
+static unsigned firstBit(unsigned mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned bit = 0;
+    while (!(mask & 1u))
+    {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+static const char *textSse2(const char *p, const char *end)
+{
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i cr = _mm_set1_epi8('\r');
+    while (end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)p);
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, amp)),
+            _mm_cmpeq_epi8(v, cr));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask)
+        {
+            return p + firstBit(mask);
+        }
+        p += 16;
+    }
+    return textScalar(p, end);
+}
+
+static const char *attributeSse2(const char *p, const char *end, char quote)
+{
+    const __m128i q = _mm_set1_epi8(quote);
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i ctrl = _mm_set1_epi8(0x1f);
+    while (end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)p);
+        // unsigned v <= 0x1f
+        __m128i isCtrl = _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl);
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, q), _mm_cmpeq_epi8(v, lt)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, amp), isCtrl));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask)
+        {
+            return p + firstBit(mask);
+        }
+        p += 16;
+    }
+    return attributeScalar(p, end, quote);
+}
+#endif
+
+#ifdef CHARSCAN_HAVE_AVX2
+CHARSCAN_TARGET_AVX2
+static const char *textAvx2(const char *p, const char *end)
+{
+    const __m256i lt = _mm256_set1_epi8('<');
+    const __m256i amp = _mm256_set1_epi8('&');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    while (end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)p);
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, lt),
+                            _mm256_cmpeq_epi8(v, amp)),
+            _mm256_cmpeq_epi8(v, cr));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask)
+        {
+            return p + firstBit(mask);
+        }
+        p += 32;
+    }
+    return textSse2(p, end);
+}
+
+CHARSCAN_TARGET_AVX2
+static const char *attributeAvx2(const char *p, const char *end, char quote)
+{
+    const __m256i q = _mm256_set1_epi8(quote);
+    const __m256i lt = _mm256_set1_epi8('<');
+    const __m256i amp = _mm256_set1_epi8('&');
+    const __m256i ctrl = _mm256_set1_epi8(0x1f);
+    while (end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)p);
+        __m256i isCtrl = _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl), ctrl);
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, q), _mm256_cmpeq_epi8(v, lt)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, amp), isCtrl));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask)
+        {
+            return p + firstBit(mask);
+        }
+        p += 32;
+    }
+    return attributeSse2(p, end, quote);
+}
+#endif
+
+// an implementation was selected, by CharScan_select or CharScan_init
+static bool initialized = false;
+static Thread_Once initOnce = THREAD_ONCE_INIT;
+static CharScan_Implementation selected = CHARSCAN_SCALAR;
+static ScanText scanText = textScalar;
+static ScanAttribute scanAttribute = attributeScalar;
+
+static bool supported(CharScan_Implementation impl)
+{
+    switch (impl)
+    {
+    case CHARSCAN_SCALAR:
+        return true;
+    case CHARSCAN_SSE2:
+#ifdef CHARSCAN_HAVE_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case CHARSCAN_AVX2:
+#ifdef CHARSCAN_HAVE_AVX2
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+bool CharScan_select(CharScan_Implementation impl)
+{
+    if (!supported(impl))
+    {
+        return false;
+    }
+    switch (impl)
+    {
+    case CHARSCAN_SCALAR:
+        scanText = textScalar;
+        scanAttribute = attributeScalar;
+        break;
+    case CHARSCAN_SSE2:
+#ifdef CHARSCAN_HAVE_SSE2
+        scanText = textSse2;
+        scanAttribute = attributeSse2;
+#endif
+        break;
+    case CHARSCAN_AVX2:
+#ifdef CHARSCAN_HAVE_AVX2
+        scanText = textAvx2;
+        scanAttribute = attributeAvx2;
+#endif
+        break;
+    }
+    selected = impl;
+    initialized = true;
+    return true;
+}
+
+static void selectFastest(void)
+{
+    if (initialized)
+    {
+        return;
+    }
+    if (!CharScan_select(CHARSCAN_AVX2) && !CharScan_select(CHARSCAN_SSE2))
+    {
+        CharScan_select(CHARSCAN_SCALAR);
+    }
+}
+
+void CharScan_init(void)
+{
+    // the tokenizers of the parser threads call it concurrently
+    Thread_once(&initOnce, selectFastest);
+}
+
+CharScan_Implementation CharScan_selected(void) { return selected; }
+
+const char *CharScan_name(CharScan_Implementation impl)
+{
+    switch (impl)
+    {
+    case CHARSCAN_SCALAR:
+        return "scalar";
+    case CHARSCAN_SSE2:
+        return "sse2";
+    case CHARSCAN_AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+const char *CharScan_text(const char *p, const char *end)
+{
+    return scanText(p, end);
+}
+
+const char *CharScan_attribute(const char *p, const char *end, char quote)
+{
+    return scanAttribute(p, end, quote);
+}
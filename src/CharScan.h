@@ -0,0 +1,35 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef CHARSCAN_H
+#define CHARSCAN_H
+#include <stdbool.h>
+
+// searching for the characters which end text and attribute values, uses
+// SSE2 or AVX2 if available, the implementation is selected at runtime
+
+typedef enum
+{
+    CHARSCAN_SCALAR,
+    CHARSCAN_SSE2,
+    CHARSCAN_AVX2
+} CharScan_Implementation;
+
+// selects the fastest implementation supported by the cpu, unless an
+// implementation was selected before, it may be called by several threads
+void CharScan_init(void);
+// returns false if the implementation is not supported by the build or cpu,
+// for tests and benchmarks, it must not run concurrently with a scan or
+// another call of CharScan_select or CharScan_init
+bool CharScan_select(CharScan_Implementation impl);
+CharScan_Implementation CharScan_selected(void);
+const char *CharScan_name(CharScan_Implementation impl);
+
+// first '<', '&' or '\r' in [p, end), end if there is none
+const char *CharScan_text(const char *p, const char *end);
+// first quote, '<', '&' or control character (< 0x20) in [p, end), end if
+// there is none
+const char *CharScan_attribute(const char *p, const char *end, char quote);
+#endif
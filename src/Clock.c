@@ -0,0 +1,40 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 199309L
+#define CLOCK_POSIX 1
+#endif
+
+#include "Clock.h"
+
+#if defined(CLOCK_POSIX)
+#include <time.h>
+
+double Clock_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+#elif defined(_WIN32)
+#include <windows.h>
+
+double Clock_now(void)
+{
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e3 / (double)frequency.QuadPart;
+}
+#else
+#include <time.h>
+
+double Clock_now(void)
+{
+    return (double)clock() * 1e3 / (double)CLOCKS_PER_SEC;
+}
+#endif
@@ -0,0 +1,362 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "DocumentSplit.h"
+#include "ElementToken.h"
+#include <string.h>
+
+struct Scan
+{
+    const char *data;
+    size_t pos;
+    size_t end;
+};
+
+static bool isWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool isNameEnd(char c)
+{
+    return isWhitespace(c) || c == '>' || c == '/';
+}
+
+static bool startsWith(const struct Scan *s, const char *literal)
+{
+    size_t len = strlen(literal);
+    return s->end - s->pos >= len && !memcmp(s->data + s->pos, literal, len);
+}
+
+// moves behind the terminator
+static bool skipPast(struct Scan *s, const char *terminator)
+{
+    size_t len = strlen(terminator);
+    while (s->pos < s->end)
+    {
+        const char *hit = (const char *)memchr(
+            s->data + s->pos, terminator[0], s->end - s->pos);
+        if (!hit)
+        {
+            break;
+        }
+        s->pos = (size_t)(hit - s->data);
+        if (startsWith(s, terminator))
+        {
+            s->pos += len;
+            return true;
+        }
+        s->pos++;
+    }
+    return false;
+}
+
+static size_t nameLength(const struct Scan *s)
+{
+    size_t len = 0;
+    while (s->pos + len < s->end && !isNameEnd(s->data[s->pos + len]))
+    {
+        len++;
+    }
+    return len;
+}
+
+// moves behind the '>' of the start tag, attribute values may contain '>'
+static bool skipTag(struct Scan *s, bool *empty)
+{
+    while (s->pos < s->end)
+    {
+        char c = s->data[s->pos];
+        if (c == '"' || c == '\'')
+        {
+            const char *quote = (const char *)memchr(
+                s->data + s->pos + 1, c, s->end - s->pos - 1);
+            if (!quote)
+            {
+                return false;
+            }
+            s->pos = (size_t)(quote - s->data);
+        }
+        else if (c == '>')
+        {
+            *empty = s->data[s->pos - 1] == '/';
+            s->pos++;
+            return true;
+        }
+        s->pos++;
+    }
+    return false;
+}
+
+// comments, CDATA sections, processing instructions and document type
+// definitions
+static bool skipMarkup(struct Scan *s, bool *skipped)
+{
+    *skipped = true;
+    if (startsWith(s, "<!--"))
+    {
+        return skipPast(s, "-->");
+    }
+    if (startsWith(s, "<![CDATA["))
+    {
+        return skipPast(s, "]]>");
+    }
+    if (startsWith(s, "<?"))
+    {
+        return skipPast(s, "?>");
+    }
+    *skipped = false;
+    return true;
+}
+
+static bool isNodeElement(const char *name, size_t len)
+{
+    switch (ElementToken_lookupLength(name, len))
+    {
+    case TOKEN_UAOBJECT:
+    case TOKEN_UAVARIABLE:
+    case TOKEN_UAMETHOD:
+    case TOKEN_UAOBJECTTYPE:
+    case TOKEN_UAVARIABLETYPE:
+    case TOKEN_UADATATYPE:
+    case TOKEN_UAREFERENCETYPE:
+    case TOKEN_UAVIEW:
+        return true;
+    case TOKEN_UNKNOWN:
+    case TOKEN_UANODESET:
+    case TOKEN_NAMESPACEURIS:
+    case TOKEN_URI:
+    case TOKEN_ALIASES:
+    case TOKEN_ALIAS:
+    case TOKEN_DISPLAYNAME:
+    case TOKEN_DESCRIPTION:
+    case TOKEN_INVERSENAME:
+    case TOKEN_REFERENCES:
+    case TOKEN_REFERENCE:
+    case TOKEN_VALUE:
+    case TOKEN_DEFINITION:
+    case TOKEN_FIELD:
+    case TOKEN_EXTENSIONS:
+    case TOKEN_EXTENSION:
+    case TOKEN_EXTENSIONOBJECT:
+    case TOKEN_TYPEID:
+    case TOKEN_BODY:
+    case TOKEN_IDENTIFIER:
+    case TOKEN_COUNT:
+        return false;
+    }
+    return false;
+}
+
+// the end tag of the root element, comments and processing instructions may
+// follow it
+static bool findRootEnd(const char *data, size_t begin, size_t size,
+                        Parser_Range *content)
+{
+    size_t end = size;
+    for (;;)
+    {
+        while (end > begin && isWhitespace(data[end - 1]))
+        {
+            end--;
+        }
+        if (end - begin < 3 || data[end - 1] != '>')
+        {
+            return false;
+        }
+        const char *open;
+        if (data[end - 2] == '-' && data[end - 3] == '-')
+        {
+            open = "<!--";
+        }
+        else if (data[end - 2] == '?')
+        {
+            open = "<?";
+        }
+        else
+        {
+            break;
+        }
+        // the start of the comment or processing instruction
+        size_t len = strlen(open);
+        do
+        {
+            end--;
+        } while (end > begin &&
+                 (end - begin < len || memcmp(data + end - len, open, len)));
+        if (end == begin)
+        {
+            return false;
+        }
+        end -= len;
+    }
+    size_t endTagLength = content->rootNameLength + 2;
+    size_t tagStart = end - 1;
+    while (tagStart > begin && data[tagStart] != '<')
+    {
+        tagStart--;
+    }
+    if (end - tagStart < endTagLength + 1 || data[tagStart + 1] != '/' ||
+        memcmp(data + tagStart + 2, content->rootName,
+               content->rootNameLength) ||
+        !isNameEnd(data[tagStart + endTagLength]))
+    {
+        return false;
+    }
+    content->end = tagStart;
+    return true;
+}
+
+bool DocumentSplit_root(const char *data, size_t size, Parser_Range *content)
+{
+    struct Scan s = {data, 0, size};
+    memset(content, 0, sizeof(Parser_Range));
+    content->data = data;
+    if (startsWith(&s, "\xef\xbb\xbf"))
+    {
+        s.pos = 3;
+    }
+    for (;;)
+    {
+        while (s.pos < s.end && isWhitespace(data[s.pos]))
+        {
+            s.pos++;
+        }
+        bool skipped;
+        if (s.pos == s.end || data[s.pos] != '<' || !skipMarkup(&s, &skipped))
+        {
+            return false;
+        }
+        if (!skipped)
+        {
+            break;
+        }
+    }
+    if (startsWith(&s, "<!"))
+    {
+        // document type definition
+        return false;
+    }
+    s.pos++;
+    content->rootName = data + s.pos;
+    content->rootNameLength = nameLength(&s);
+    bool empty;
+    if (!content->rootNameLength || !skipTag(&s, &empty) || empty)
+    {
+        return false;
+    }
+    content->rootContent = s.pos;
+    content->begin = s.pos;
+    return findRootEnd(data, s.pos, size, content);
+}
+
+// exact scan, which tracks the nesting of the elements
+static size_t findFirstNode(const Parser_Range *content)
+{
+    struct Scan s = {content->data, content->begin, content->end};
+    size_t depth = 0;
+    while (s.pos < s.end)
+    {
+        const char *lt =
+            (const char *)memchr(s.data + s.pos, '<', s.end - s.pos);
+        if (!lt)
+        {
+            break;
+        }
+        s.pos = (size_t)(lt - s.data);
+        bool skipped;
+        if (!skipMarkup(&s, &skipped))
+        {
+            break;
+        }
+        if (skipped)
+        {
+            continue;
+        }
+        bool empty;
+        if (startsWith(&s, "</"))
+        {
+            if (!depth || !skipTag(&s, &empty))
+            {
+                break;
+            }
+            depth--;
+            continue;
+        }
+        size_t tagStart = s.pos;
+        s.pos++;
+        if (!depth && isNodeElement(s.data + s.pos, nameLength(&s)))
+        {
+            return tagStart;
+        }
+        if (!skipTag(&s, &empty))
+        {
+            break;
+        }
+        if (!empty)
+        {
+            depth++;
+        }
+    }
+    return content->end;
+}
+
+// the next start tag of a node element at or after pos
+static size_t findNode(const Parser_Range *content, size_t pos)
+{
+    struct Scan s = {content->data, pos, content->end};
+    while (s.pos < s.end)
+    {
+        const char *lt =
+            (const char *)memchr(s.data + s.pos, '<', s.end - s.pos);
+        if (!lt)
+        {
+            break;
+        }
+        s.pos = (size_t)(lt - s.data) + 1;
+        if (isNodeElement(s.data + s.pos, nameLength(&s)))
+        {
+            return s.pos - 1;
+        }
+    }
+    return content->end;
+}
+
+size_t DocumentSplit_nodes(const Parser_Range *content, size_t maxRanges,
+                           size_t minSize, size_t *bounds)
+{
+    bounds[0] = findFirstNode(content);
+    if (bounds[0] == content->end || !maxRanges)
+    {
+        return 0;
+    }
+    size_t size = content->end - bounds[0];
+    size_t count = minSize ? size / minSize : maxRanges;
+    if (count > maxRanges)
+    {
+        count = maxRanges;
+    }
+    if (count < 1)
+    {
+        count = 1;
+    }
+    size_t ranges = 1;
+    for (size_t i = 1; i < count; i++)
+    {
+        size_t target = bounds[0] + i * (size / count);
+        if (target <= bounds[ranges - 1])
+        {
+            target = bounds[ranges - 1] + 1;
+        }
+        size_t bound = findNode(content, target);
+        if (bound == content->end)
+        {
+            break;
+        }
+        bounds[ranges++] = bound;
+    }
+    bounds[ranges] = content->end;
+    return ranges;
+}
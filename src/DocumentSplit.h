@@ -0,0 +1,31 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef DOCUMENTSPLIT_H
+#define DOCUMENTSPLIT_H
+#include "Parser.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// splitting of a nodeset in memory at the node elements (UAObject,
+// UAVariable, ...) below the root element, so the parts can be parsed
+// independently
+
+// locates the content of the root element, returns false if the document
+// cannot be handled by the simple scan, e.g. it has a document type
+// definition
+bool DocumentSplit_root(const char *data, size_t size, Parser_Range *content);
+
+// bounds[0] is set to the first node element of the content, everything
+// before it (namespaces, aliases, ...) is the header of the document
+// [bounds[0], content->end) is then split into at most maxRanges ranges of at
+// least minSize bytes, range i is [bounds[i], bounds[i + 1])
+// the first node element is found exactly, the further bounds are guessed
+// by searching for the next node element, a wrong guess (e.g. inside a
+// comment) leads to a range which is not well formed
+// returns the number of ranges, 0 if there is no node element
+size_t DocumentSplit_nodes(const Parser_Range *content, size_t maxRanges,
+                           size_t minSize, size_t *bounds);
+#endif
@@ -0,0 +1,80 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ElementToken.h"
+#include <string.h>
+
+// perfect hash over the length, the third and the last character of the known
+// names, a new name which collides with an existing one is reported by the
+// compiler as overridden initializer (-Woverride-init), the factors have to
+// be adapted in this case
+// the characters are passed explicitly, indexing a string literal is no
+// constant expression
+#define TOKEN_TABLE_SIZE 64
+#define TOKEN_HASH(len, third, last)                                           \
+    (((len)*5u + (unsigned)(third)*3u + (unsigned)(last)*2u) &                 \
+     (TOKEN_TABLE_SIZE - 1))
+#define TOKEN_ENTRY(name, third, last, token)                                  \
+    [TOKEN_HASH(sizeof(name) - 1, third, last)] = {name, sizeof(name) - 1, token}
+
+#define TOKEN_MIN_LENGTH 3
+#define TOKEN_MAX_LENGTH 15
+
+struct TokenEntry
+{
+    const char *name;
+    size_t length;
+    ElementToken token;
+};
+
+static const struct TokenEntry tokenTable[TOKEN_TABLE_SIZE] = {
+    TOKEN_ENTRY("UANodeSet", 'N', 't', TOKEN_UANODESET),
+    TOKEN_ENTRY("NamespaceUris", 'm', 's', TOKEN_NAMESPACEURIS),
+    TOKEN_ENTRY("Uri", 'i', 'i', TOKEN_URI),
+    TOKEN_ENTRY("Aliases", 'i', 's', TOKEN_ALIASES),
+    TOKEN_ENTRY("Alias", 'i', 's', TOKEN_ALIAS),
+    TOKEN_ENTRY("UAObject", 'O', 't', TOKEN_UAOBJECT),
+    TOKEN_ENTRY("UAMethod", 'M', 'd', TOKEN_UAMETHOD),
+    TOKEN_ENTRY("UAObjectType", 'O', 'e', TOKEN_UAOBJECTTYPE),
+    TOKEN_ENTRY("UAVariable", 'V', 'e', TOKEN_UAVARIABLE),
+    TOKEN_ENTRY("UAVariableType", 'V', 'e', TOKEN_UAVARIABLETYPE),
+    TOKEN_ENTRY("UADataType", 'D', 'e', TOKEN_UADATATYPE),
+    TOKEN_ENTRY("UAReferenceType", 'R', 'e', TOKEN_UAREFERENCETYPE),
+    TOKEN_ENTRY("UAView", 'V', 'w', TOKEN_UAVIEW),
+    TOKEN_ENTRY("DisplayName", 's', 'e', TOKEN_DISPLAYNAME),
+    TOKEN_ENTRY("Description", 's', 'n', TOKEN_DESCRIPTION),
+    TOKEN_ENTRY("InverseName", 'v', 'e', TOKEN_INVERSENAME),
+    TOKEN_ENTRY("References", 'f', 's', TOKEN_REFERENCES),
+    TOKEN_ENTRY("Reference", 'f', 'e', TOKEN_REFERENCE),
+    TOKEN_ENTRY("Value", 'l', 'e', TOKEN_VALUE),
+    TOKEN_ENTRY("Definition", 'f', 'n', TOKEN_DEFINITION),
+    TOKEN_ENTRY("Field", 'e', 'd', TOKEN_FIELD),
+    TOKEN_ENTRY("Extensions", 't', 's', TOKEN_EXTENSIONS),
+    TOKEN_ENTRY("Extension", 't', 'n', TOKEN_EXTENSION),
+    TOKEN_ENTRY("ExtensionObject", 't', 't', TOKEN_EXTENSIONOBJECT),
+    TOKEN_ENTRY("TypeId", 'p', 'd', TOKEN_TYPEID),
+    TOKEN_ENTRY("Body", 'd', 'y', TOKEN_BODY),
+    TOKEN_ENTRY("Identifier", 'e', 'r', TOKEN_IDENTIFIER)};
+
+ElementToken ElementToken_lookup(const char *localname)
+{
+    return ElementToken_lookupLength(localname, strlen(localname));
+}
+
+ElementToken ElementToken_lookupLength(const char *localname, size_t len)
+{
+    if (len < TOKEN_MIN_LENGTH || len > TOKEN_MAX_LENGTH)
+    {
+        return TOKEN_UNKNOWN;
+    }
+    const struct TokenEntry *entry = &tokenTable[TOKEN_HASH(
+        len, (unsigned char)localname[2], (unsigned char)localname[len - 1])];
+    // one comparison is needed to reject unknown names
+    if (entry->length == len && !memcmp(entry->name, localname, len))
+    {
+        return entry->token;
+    }
+    return TOKEN_UNKNOWN;
+}
@@ -0,0 +1,48 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef ELEMENTTOKEN_H
+#define ELEMENTTOKEN_H
+#include <stddef.h>
+
+// the element names of a nodeset the loader is interested in
+typedef enum
+{
+    TOKEN_UNKNOWN,
+    TOKEN_UANODESET,
+    TOKEN_NAMESPACEURIS,
+    TOKEN_URI,
+    TOKEN_ALIASES,
+    TOKEN_ALIAS,
+    TOKEN_UAOBJECT,
+    TOKEN_UAMETHOD,
+    TOKEN_UAOBJECTTYPE,
+    TOKEN_UAVARIABLE,
+    TOKEN_UAVARIABLETYPE,
+    TOKEN_UADATATYPE,
+    TOKEN_UAREFERENCETYPE,
+    TOKEN_UAVIEW,
+    TOKEN_DISPLAYNAME,
+    TOKEN_DESCRIPTION,
+    TOKEN_INVERSENAME,
+    TOKEN_REFERENCES,
+    TOKEN_REFERENCE,
+    TOKEN_VALUE,
+    TOKEN_DEFINITION,
+    TOKEN_FIELD,
+    TOKEN_EXTENSIONS,
+    TOKEN_EXTENSION,
+    TOKEN_EXTENSIONOBJECT,
+    TOKEN_TYPEID,
+    TOKEN_BODY,
+    TOKEN_IDENTIFIER,
+    TOKEN_COUNT
+} ElementToken;
+
+// maps a local element name to its token, TOKEN_UNKNOWN for all other names
+ElementToken ElementToken_lookup(const char *localname);
+// for names which are not terminated, e.g. in the document itself
+ElementToken ElementToken_lookupLength(const char *localname, size_t len);
+#endif
@@ -0,0 +1,93 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define FILEMAPPING_MMAP 1
+#endif
+
+#include "FileMapping.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef FILEMAPPING_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FileMapping *FileMapping_new(FILE *file)
+{
+    struct stat st;
+    int fd = fileno(file);
+    if (fd < 0 || fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0)
+    {
+        return NULL;
+    }
+    void *mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mem == MAP_FAILED)
+    {
+        return NULL;
+    }
+    FileMapping *mapping = (FileMapping *)calloc(1, sizeof(FileMapping));
+    if (!mapping)
+    {
+        munmap(mem, (size_t)st.st_size);
+        return NULL;
+    }
+    mapping->data = (const char *)mem;
+    mapping->size = (size_t)st.st_size;
+    return mapping;
+}
+
+void FileMapping_adviseSequential(FileMapping *mapping)
+{
+    posix_madvise((void *)(uintptr_t)mapping->data, mapping->size,
+                  POSIX_MADV_SEQUENTIAL);
+}
+
+void FileMapping_release(FileMapping *mapping, size_t offset, size_t size)
+{
+    // offset has to be page aligned, the caller takes care of this
+    if (offset + size > mapping->size)
+    {
+        size = mapping->size - offset;
+    }
+    posix_madvise((void *)(uintptr_t)(mapping->data + offset), size,
+                  POSIX_MADV_DONTNEED);
+}
+
+void FileMapping_delete(FileMapping *mapping)
+{
+    if (!mapping)
+    {
+        return;
+    }
+    if (!mapping->borrowed)
+    {
+        munmap((void *)(uintptr_t)mapping->data, mapping->size);
+    }
+    free(mapping);
+}
+
+#else
+
+FileMapping *FileMapping_new(FILE *file) { return NULL; }
+void FileMapping_adviseSequential(FileMapping *mapping) {}
+void FileMapping_release(FileMapping *mapping, size_t offset, size_t size) {}
+void FileMapping_delete(FileMapping *mapping) { free(mapping); }
+
+#endif
+
+FileMapping *FileMapping_fromBuffer(const char *data, size_t size)
+{
+    FileMapping *mapping = (FileMapping *)calloc(1, sizeof(FileMapping));
+    if (mapping)
+    {
+        mapping->data = data;
+        mapping->size = size;
+        mapping->borrowed = true;
+    }
+    return mapping;
+}
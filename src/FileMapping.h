@@ -0,0 +1,32 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef FILEMAPPING_H
+#define FILEMAPPING_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+struct FileMapping
+{
+    const char *data;
+    size_t size;
+    // the data belongs to the caller, see FileMapping_fromBuffer
+    bool borrowed;
+};
+typedef struct FileMapping FileMapping;
+
+// maps the whole file read only into memory, returns NULL if the file is not
+// a regular file (e.g. a pipe) or mapping is not supported on this platform
+FileMapping *FileMapping_new(FILE *file);
+// a mapping of memory which stays valid as long as the mapping, it is not
+// freed by FileMapping_delete
+FileMapping *FileMapping_fromBuffer(const char *data, size_t size);
+// hint that the mapping will be read front to back
+void FileMapping_adviseSequential(FileMapping *mapping);
+// hint that [offset, offset + size) is not needed anymore
+void FileMapping_release(FileMapping *mapping, size_t offset, size_t size);
+void FileMapping_delete(FileMapping *mapping);
+#endif
@@ -0,0 +1,133 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "Hash.h"
+#include <string.h>
+
+#define PRIME1 0x9E3779B185EBCA87u
+#define PRIME2 0xC2B2AE3D27D4EB4Fu
+#define PRIME3 0x165667B19E3779F9u
+#define PRIME4 0x85EBCA77C2B2AE63u
+#define PRIME5 0x27D4EB2F165667C5u
+
+static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// the hash is only compared on the same host, so the words are read in host
+// byte order
+static uint64_t read64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t round64(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+static uint64_t mergeRound(uint64_t acc, uint64_t value)
+{
+    acc ^= round64(0, value);
+    return acc * PRIME1 + PRIME4;
+}
+
+static void consumeStripe(Hash *hash, const unsigned char *p)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        hash->acc[i] = round64(hash->acc[i], read64(p + 8 * i));
+    }
+}
+
+void Hash_init(Hash *hash, uint64_t seed)
+{
+    memset(hash, 0, sizeof(Hash));
+    hash->seed = seed;
+    hash->acc[0] = seed + PRIME1 + PRIME2;
+    hash->acc[1] = seed + PRIME2;
+    hash->acc[2] = seed;
+    hash->acc[3] = seed - PRIME1;
+}
+
+void Hash_update(Hash *hash, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    hash->total += size;
+    if (hash->bufferSize)
+    {
+        size_t fill = sizeof(hash->buffer) - hash->bufferSize;
+        if (size < fill)
+        {
+            memcpy(hash->buffer + hash->bufferSize, p, size);
+            hash->bufferSize += size;
+            return;
+        }
+        memcpy(hash->buffer + hash->bufferSize, p, fill);
+        consumeStripe(hash, hash->buffer);
+        hash->bufferSize = 0;
+        p += fill;
+        size -= fill;
+    }
+    for (; size >= sizeof(hash->buffer); p += 32, size -= 32)
+    {
+        consumeStripe(hash, p);
+    }
+    memcpy(hash->buffer, p, size);
+    hash->bufferSize = size;
+}
+
+uint64_t Hash_final(const Hash *hash)
+{
+    uint64_t h;
+    if (hash->total >= sizeof(hash->buffer))
+    {
+        h = rotl(hash->acc[0], 1) + rotl(hash->acc[1], 7) +
+            rotl(hash->acc[2], 12) + rotl(hash->acc[3], 18);
+        for (int i = 0; i < 4; i++)
+        {
+            h = mergeRound(h, hash->acc[i]);
+        }
+    }
+    else
+    {
+        h = hash->seed + PRIME5;
+    }
+    h += hash->total;
+    const unsigned char *p = hash->buffer;
+    size_t size = hash->bufferSize;
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        h ^= round64(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+    }
+    if (size >= 4)
+    {
+        h ^= (uint64_t)read32(p) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+        size -= 4;
+    }
+    for (; size; p++, size--)
+    {
+        h ^= *p * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+    }
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
@@ -0,0 +1,25 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+#include <stddef.h>
+#include <stdint.h>
+
+// streaming 64 bit hash (XXH64), the data can be passed in pieces of any size
+struct Hash
+{
+    uint64_t acc[4];
+    uint64_t total;
+    unsigned char buffer[32];
+    size_t bufferSize;
+    uint64_t seed;
+};
+typedef struct Hash Hash;
+
+void Hash_init(Hash *hash, uint64_t seed);
+void Hash_update(Hash *hash, const void *data, size_t size);
+uint64_t Hash_final(const Hash *hash);
+#endif
@@ -0,0 +1,126 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define IMAGECACHE_PID 1
+#endif
+
+#include "ImageCache.h"
+#include "Hash.h"
+#include "Thread.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef IMAGECACHE_PID
+#include <unistd.h>
+#endif
+
+#define IMAGECACHE_READ_SIZE (64 * 1024)
+// has to be increased whenever the loader creates other nodes from the same
+// file, so the images of older loaders are not found
+#define IMAGECACHE_LOADER_VERSION 1
+
+bool ImageCache_key(uint64_t previous, int options, FILE *file,
+                    uint64_t *key)
+{
+    char *buffer = (char *)malloc(IMAGECACHE_READ_SIZE);
+    if (!buffer)
+    {
+        return false;
+    }
+    Hash hash;
+    Hash_init(&hash, previous);
+    // an image of another layout or loader is not found
+    uint32_t versions[2] = {NodesetImage_version(), IMAGECACHE_LOADER_VERSION};
+    Hash_update(&hash, versions, sizeof(versions));
+    Hash_update(&hash, &options, sizeof(options));
+    size_t read;
+    while ((read = fread(buffer, 1, IMAGECACHE_READ_SIZE, file)) > 0)
+    {
+        Hash_update(&hash, buffer, read);
+    }
+    free(buffer);
+    *key = Hash_final(&hash);
+    return !ferror(file);
+}
+
+char *ImageCache_path(const char *dir, uint64_t key)
+{
+    size_t size = strlen(dir) + 32;
+    char *path = (char *)malloc(size);
+    if (path)
+    {
+        snprintf(path, size, "%s/%016llx.nlimage", dir,
+                 (unsigned long long)key);
+    }
+    return path;
+}
+
+struct ImageCacheWriter
+{
+    Thread thread;
+    NodesetImageBuffer *buffer;
+    char *path;
+    bool success;
+};
+
+static void writeImage(void *arg)
+{
+    ImageCacheWriter *writer = (ImageCacheWriter *)arg;
+    size_t size = strlen(writer->path) + 32;
+    char *tmpPath = (char *)malloc(size);
+    if (!tmpPath)
+    {
+        return;
+    }
+#ifdef IMAGECACHE_PID
+    snprintf(tmpPath, size, "%s.%ld.tmp", writer->path, (long)getpid());
+#else
+    snprintf(tmpPath, size, "%s.tmp", writer->path);
+#endif
+    FILE *f = fopen(tmpPath, "wb");
+    if (f)
+    {
+        bool success = NodesetImage_writeBuffer(writer->buffer, f);
+        success = !fclose(f) && success;
+        writer->success = success && !rename(tmpPath, writer->path);
+        if (!writer->success)
+        {
+            remove(tmpPath);
+        }
+    }
+    free(tmpPath);
+}
+
+ImageCacheWriter *ImageCacheWriter_start(NodesetImageBuffer *buffer,
+                                         char *path)
+{
+    ImageCacheWriter *writer =
+        (ImageCacheWriter *)calloc(1, sizeof(ImageCacheWriter));
+    if (!writer)
+    {
+        NodesetImage_deleteBuffer(buffer);
+        free(path);
+        return NULL;
+    }
+    writer->buffer = buffer;
+    writer->path = path;
+    Thread_start(&writer->thread, writeImage, writer);
+    return writer;
+}
+
+bool ImageCacheWriter_finish(ImageCacheWriter *writer)
+{
+    if (!writer)
+    {
+        return false;
+    }
+    Thread_join(&writer->thread);
+    bool success = writer->success;
+    NodesetImage_deleteBuffer(writer->buffer);
+    free(writer->path);
+    free(writer);
+    return success;
+}
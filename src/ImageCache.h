@@ -0,0 +1,35 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+#include "NodesetImage.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// nodeset images in a directory, an image is found by the content of the
+// files it was imported from
+
+// key of the nodes after importing the file with the parser options on top
+// of the nodes of the previous key (0 for an empty loader), the file is read
+// to its end, returns false on read errors
+bool ImageCache_key(uint64_t previous, int options, FILE *file,
+                    uint64_t *key);
+// path of the image for the key, has to be freed
+char *ImageCache_path(const char *dir, uint64_t key);
+
+struct ImageCacheWriter;
+typedef struct ImageCacheWriter ImageCacheWriter;
+
+// writes the image on a new thread (or the calling thread without thread
+// support) to a temporary file which is renamed to path, so other processes
+// either find the complete image or none, takes the buffer and the path
+ImageCacheWriter *ImageCacheWriter_start(NodesetImageBuffer *buffer,
+                                         char *path);
+// waits for the image and deletes the writer, returns false if the image
+// could not be written
+bool ImageCacheWriter_finish(ImageCacheWriter *writer);
+#endif
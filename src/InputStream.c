@@ -0,0 +1,350 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "InputStream.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef NODESETLOADER_GZIP
+#include <zlib.h>
+#endif
+#ifdef NODESETLOADER_ZSTD
+#include <zstd.h>
+#endif
+
+// compressed data which is read from the source at once
+#define INPUTSTREAM_IN_SIZE (64 * 1024)
+#define INPUTSTREAM_MAGIC_SIZE 4
+
+typedef enum
+{
+    INPUTSTREAM_PLAIN,
+    INPUTSTREAM_GZIP,
+    INPUTSTREAM_ZSTD
+} InputStream_Encoding;
+
+static const unsigned char gzipMagic[] = {0x1f, 0x8b};
+static const unsigned char zstdMagic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+struct InputStream
+{
+    NL_readCallback read;
+    void *context;
+    InputStream_Encoding encoding;
+    // the bytes read for detecting the encoding
+    char magic[INPUTSTREAM_MAGIC_SIZE];
+    size_t magicSize;
+    size_t magicPos;
+    // compressed input
+    char *in;
+    size_t inSize;
+    size_t inPos;
+    bool sourceEnd;
+    // true as long as a compressed frame is not complete
+    bool inFrame;
+#ifdef NODESETLOADER_GZIP
+    z_stream zs;
+#endif
+#ifdef NODESETLOADER_ZSTD
+    ZSTD_DStream *zstd;
+#endif
+};
+
+static bool hasMagic(const char *data, size_t size, const unsigned char *magic,
+                     size_t magicSize)
+{
+    return size >= magicSize && !memcmp(data, magic, magicSize);
+}
+
+static InputStream_Encoding detect(const char *data, size_t size)
+{
+    if (hasMagic(data, size, gzipMagic, sizeof(gzipMagic)))
+    {
+        return INPUTSTREAM_GZIP;
+    }
+    if (hasMagic(data, size, zstdMagic, sizeof(zstdMagic)))
+    {
+        return INPUTSTREAM_ZSTD;
+    }
+    return INPUTSTREAM_PLAIN;
+}
+
+bool InputStream_isCompressed(const char *data, size_t size)
+{
+    return detect(data, size) != INPUTSTREAM_PLAIN;
+}
+
+// reads from the source, the bytes used for the detection come first
+static long readSource(InputStream *stream, char *buffer, size_t size)
+{
+    if (stream->magicPos < stream->magicSize)
+    {
+        size_t len = stream->magicSize - stream->magicPos;
+        if (len > size)
+        {
+            len = size;
+        }
+        memcpy(buffer, stream->magic + stream->magicPos, len);
+        stream->magicPos += len;
+        return (long)len;
+    }
+    return stream->read(stream->context, buffer, size);
+}
+
+#if defined(NODESETLOADER_GZIP) || defined(NODESETLOADER_ZSTD)
+// refills the compressed input if it is consumed, returns false on errors
+static bool fillInput(InputStream *stream)
+{
+    if (stream->inPos < stream->inSize || stream->sourceEnd)
+    {
+        return true;
+    }
+    long res = readSource(stream, stream->in, INPUTSTREAM_IN_SIZE);
+    if (res < 0)
+    {
+        return false;
+    }
+    stream->sourceEnd = res == 0;
+    stream->inSize = (size_t)res;
+    stream->inPos = 0;
+    return true;
+}
+#endif
+
+#ifdef NODESETLOADER_GZIP
+static bool initGzip(InputStream *stream)
+{
+    // 15 + 32: maximum window size, detect the gzip or zlib header
+    return inflateInit2(&stream->zs, 15 + 32) == Z_OK;
+}
+
+static long readGzip(InputStream *stream, char *buffer, size_t size)
+{
+    z_stream *zs = &stream->zs;
+    zs->next_out = (Bytef *)buffer;
+    zs->avail_out = (uInt)(size > UINT_MAX ? UINT_MAX : size);
+    while (zs->avail_out > 0)
+    {
+        if (!fillInput(stream))
+        {
+            return -1;
+        }
+        // inflate may hold back output, even if all input is consumed
+        if (stream->inPos == stream->inSize && !stream->inFrame)
+        {
+            break;
+        }
+        zs->next_in = (Bytef *)(stream->in + stream->inPos);
+        zs->avail_in = (uInt)(stream->inSize - stream->inPos);
+        int ret = inflate(zs, Z_NO_FLUSH);
+        stream->inPos = stream->inSize - zs->avail_in;
+        if (ret == Z_STREAM_END)
+        {
+            // concatenated gzip members are allowed
+            stream->inFrame = false;
+            if (inflateReset(zs) != Z_OK)
+            {
+                return -1;
+            }
+        }
+        else if (ret == Z_OK)
+        {
+            stream->inFrame = true;
+        }
+        else
+        {
+            // Z_BUF_ERROR at the end of the source: the input is truncated
+            return -1;
+        }
+    }
+    return (long)((size_t)((char *)zs->next_out - buffer));
+}
+
+static void cleanupGzip(InputStream *stream) { inflateEnd(&stream->zs); }
+#endif
+
+#ifdef NODESETLOADER_ZSTD
+static bool initZstd(InputStream *stream)
+{
+    stream->zstd = ZSTD_createDStream();
+    return stream->zstd && !ZSTD_isError(ZSTD_initDStream(stream->zstd));
+}
+
+static long readZstd(InputStream *stream, char *buffer, size_t size)
+{
+    ZSTD_outBuffer out = {buffer, size, 0};
+    while (out.pos < out.size)
+    {
+        if (!fillInput(stream))
+        {
+            return -1;
+        }
+        if (stream->inPos == stream->inSize && !stream->inFrame)
+        {
+            break;
+        }
+        size_t outPos = out.pos;
+        ZSTD_inBuffer in = {stream->in, stream->inSize, stream->inPos};
+        size_t ret = ZSTD_decompressStream(stream->zstd, &out, &in);
+        if (ZSTD_isError(ret))
+        {
+            return -1;
+        }
+        if (stream->sourceEnd && out.pos == outPos)
+        {
+            // no progress at the end of the source: truncated input
+            return -1;
+        }
+        stream->inPos = in.pos;
+        // 0 means the frame is complete
+        stream->inFrame = ret != 0;
+    }
+    return (long)out.pos;
+}
+
+static void cleanupZstd(InputStream *stream)
+{
+    ZSTD_freeDStream(stream->zstd);
+}
+#endif
+
+static bool initDecoder(InputStream *stream)
+{
+    switch (stream->encoding)
+    {
+    case INPUTSTREAM_PLAIN:
+        return true;
+    case INPUTSTREAM_GZIP:
+#ifdef NODESETLOADER_GZIP
+        return initGzip(stream);
+#else
+        return false;
+#endif
+    case INPUTSTREAM_ZSTD:
+#ifdef NODESETLOADER_ZSTD
+        return initZstd(stream);
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+InputStream *InputStream_new(NL_readCallback read, void *context)
+{
+    if (!read)
+    {
+        return NULL;
+    }
+    InputStream *stream = (InputStream *)calloc(1, sizeof(InputStream));
+    if (!stream)
+    {
+        return NULL;
+    }
+    stream->read = read;
+    stream->context = context;
+    // a source may return less bytes than requested
+    while (stream->magicSize < INPUTSTREAM_MAGIC_SIZE)
+    {
+        long res = read(context, stream->magic + stream->magicSize,
+                        INPUTSTREAM_MAGIC_SIZE - stream->magicSize);
+        if (res < 0)
+        {
+            free(stream);
+            return NULL;
+        }
+        if (res == 0)
+        {
+            break;
+        }
+        stream->magicSize += (size_t)res;
+    }
+    stream->encoding = detect(stream->magic, stream->magicSize);
+    if (stream->encoding != INPUTSTREAM_PLAIN)
+    {
+        stream->in = (char *)malloc(INPUTSTREAM_IN_SIZE);
+        if (!stream->in)
+        {
+            free(stream);
+            return NULL;
+        }
+    }
+    if (!initDecoder(stream))
+    {
+        free(stream->in);
+        free(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+long InputStream_read(InputStream *stream, char *buffer, size_t size)
+{
+    switch (stream->encoding)
+    {
+    case INPUTSTREAM_PLAIN:
+        return readSource(stream, buffer, size);
+    case INPUTSTREAM_GZIP:
+#ifdef NODESETLOADER_GZIP
+        return readGzip(stream, buffer, size);
+#else
+        return -1;
+#endif
+    case INPUTSTREAM_ZSTD:
+#ifdef NODESETLOADER_ZSTD
+        return readZstd(stream, buffer, size);
+#else
+        return -1;
+#endif
+    }
+    return -1;
+}
+
+void InputStream_delete(InputStream *stream)
+{
+    if (!stream)
+    {
+        return;
+    }
+#ifdef NODESETLOADER_GZIP
+    if (stream->encoding == INPUTSTREAM_GZIP)
+    {
+        cleanupGzip(stream);
+    }
+#endif
+#ifdef NODESETLOADER_ZSTD
+    if (stream->encoding == INPUTSTREAM_ZSTD)
+    {
+        cleanupZstd(stream);
+    }
+#endif
+    free(stream->in);
+    free(stream);
+}
+
+long InputStream_readFile(void *file, char *buffer, size_t size)
+{
+    FILE *f = (FILE *)file;
+    size_t res = fread(buffer, 1, size, f);
+    if (!res && ferror(f))
+    {
+        return -1;
+    }
+    return (long)res;
+}
+
+long InputStream_readMemory(void *memory, char *buffer, size_t size)
+{
+    InputStream_Memory *mem = (InputStream_Memory *)memory;
+    size_t len = mem->size - mem->pos;
+    if (len > size)
+    {
+        len = size;
+    }
+    memcpy(buffer, mem->data + mem->pos, len);
+    mem->pos += len;
+    return (long)len;
+}
@@ -0,0 +1,39 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INPUTSTREAM_H
+#define INPUTSTREAM_H
+#include <NodesetLoader/NodesetLoader.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+struct InputStream;
+typedef struct InputStream InputStream;
+
+// detects the encoding of the source with the first bytes, compressed sources
+// are decompressed chunk by chunk, returns NULL if the encoding is not
+// supported by this build
+InputStream *InputStream_new(NL_readCallback read, void *context);
+// same as the read callback: bytes read, 0 at the end, negative on errors
+long InputStream_read(InputStream *stream, char *buffer, size_t size);
+void InputStream_delete(InputStream *stream);
+
+// true if data starts with the magic bytes of a compressed format
+bool InputStream_isCompressed(const char *data, size_t size);
+
+// read callback for a FILE*
+long InputStream_readFile(void *file, char *buffer, size_t size);
+
+struct InputStream_Memory
+{
+    const char *data;
+    size_t size;
+    size_t pos;
+};
+typedef struct InputStream_Memory InputStream_Memory;
+// read callback for a InputStream_Memory
+long InputStream_readMemory(void *memory, char *buffer, size_t size);
+#endif
@@ -34,6 +34,7 @@ NL_ReferenceTypeNode hierachicalRefs[MAX_HIERACHICAL_REFS] = {
         NULL,
         {NULL, NULL},
         NULL,
+        {false},
     },
     {NODECLASS_REFERENCETYPE,
      {0, "i=36"},
@@ -46,7 +47,8 @@ NL_ReferenceTypeNode hierachicalRefs[MAX_HIERACHICAL_REFS] = {
      NULL,
      NULL,
      {NULL, NULL},
-     NULL},
+     NULL,
+     {false}},
     {NODECLASS_REFERENCETYPE,
      {0, "i=48"},
      {0, "HasNotifier"},
@@ -58,7 +60,8 @@ NL_ReferenceTypeNode hierachicalRefs[MAX_HIERACHICAL_REFS] = {
      NULL,
      NULL,
      {NULL, NULL},
-     NULL},
+     NULL,
+     {false}},
     {NODECLASS_REFERENCETYPE,
      {0, "i=44"},
      {0, "Aggregates"},
@@ -70,7 +73,8 @@ NL_ReferenceTypeNode hierachicalRefs[MAX_HIERACHICAL_REFS] = {
      NULL,
      NULL,
      {NULL, NULL},
-     NULL},
+     NULL,
+     {false}},
     {NODECLASS_REFERENCETYPE,
      {0, "i=45"},
      {0, "HasSubtype"},
@@ -82,7 +86,8 @@ NL_ReferenceTypeNode hierachicalRefs[MAX_HIERACHICAL_REFS] = {
      NULL,
      NULL,
      {NULL, NULL},
-     NULL},
+     NULL,
+     {false}},
     {NODECLASS_REFERENCETYPE,
      {0, "i=47"},
      {0, "HasComponent"},
@@ -94,7 +99,8 @@ NL_ReferenceTypeNode hierachicalRefs[MAX_HIERACHICAL_REFS] = {
      NULL,
      NULL,
      {NULL, NULL},
-     NULL},
+     NULL,
+     {false}},
     {NODECLASS_REFERENCETYPE,
      {0, "i=46"},
      {0, "HasProperty"},
@@ -106,7 +112,8 @@ NL_ReferenceTypeNode hierachicalRefs[MAX_HIERACHICAL_REFS] = {
      NULL,
      NULL,
      {NULL, NULL},
-     NULL},
+     NULL,
+     {false}},
     {NODECLASS_REFERENCETYPE,
      {0, "i=47"},
      {0, "HasEncoding"},
@@ -118,7 +125,8 @@ NL_ReferenceTypeNode hierachicalRefs[MAX_HIERACHICAL_REFS] = {
      NULL,
      NULL,
      {NULL, NULL},
-     NULL},
+     NULL,
+     {false}},
     {NODECLASS_REFERENCETYPE,
      {0, "i=33"},
      {0, "HasEncoding"},
@@ -130,7 +138,8 @@ NL_ReferenceTypeNode hierachicalRefs[MAX_HIERACHICAL_REFS] = {
      NULL,
      NULL,
      {NULL, NULL},
-     NULL},
+     NULL,
+     {false}},
 };
 
 static bool isNonHierachicalRef(const InternalRefService *service,
@@ -0,0 +1,77 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "MemoryUsage.h"
+#include <string.h>
+
+const char *NL_MEMORY_CATEGORY_NAME[NL_MEMORY_CATEGORY_COUNT] = {
+    "nodes", "references", "values", "arena", "sort", "encoding references"};
+
+#ifdef NODESETLOADER_MEMORY_STATS
+// the counters are updated by the parser threads as well
+#if defined(__GNUC__) || defined(__clang__)
+#define ATOMIC_ADD(p, v) __atomic_add_fetch(p, v, __ATOMIC_RELAXED)
+#define ATOMIC_SUB(p, v) __atomic_sub_fetch(p, v, __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+#define ATOMIC_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELAXED)
+#define ATOMIC_CAS(p, expected, v)                                             \
+    __atomic_compare_exchange_n(p, expected, v, true, __ATOMIC_RELAXED,        \
+                                __ATOMIC_RELAXED)
+#else
+#define ATOMIC_ADD(p, v) (*(p) += (v))
+#define ATOMIC_SUB(p, v) (*(p) -= (v))
+#define ATOMIC_LOAD(p) (*(p))
+#define ATOMIC_STORE(p, v) (*(p) = (v))
+#define ATOMIC_CAS(p, expected, v) (*(p) = (v), true)
+#endif
+
+static NL_MemoryUsage usages[NL_MEMORY_CATEGORY_COUNT];
+
+void MemoryUsage_allocated(NL_MemoryCategory category, size_t bytes)
+{
+    NL_MemoryUsage *usage = &usages[category];
+    ATOMIC_ADD(&usage->allocated, bytes);
+    size_t live = ATOMIC_ADD(&usage->live, bytes);
+    size_t peak = ATOMIC_LOAD(&usage->peak);
+    while (live > peak && !ATOMIC_CAS(&usage->peak, &peak, live))
+    {
+    }
+}
+
+void MemoryUsage_freed(NL_MemoryCategory category, size_t bytes)
+{
+    ATOMIC_SUB(&usages[category].live, bytes);
+}
+
+bool NodesetLoader_getMemoryUsage(
+    NL_MemoryUsage usage[NL_MEMORY_CATEGORY_COUNT])
+{
+    for (size_t i = 0; i < NL_MEMORY_CATEGORY_COUNT; i++)
+    {
+        usage[i].allocated = ATOMIC_LOAD(&usages[i].allocated);
+        usage[i].live = ATOMIC_LOAD(&usages[i].live);
+        usage[i].peak = ATOMIC_LOAD(&usages[i].peak);
+    }
+    return true;
+}
+
+void NodesetLoader_resetMemoryUsage(void)
+{
+    for (size_t i = 0; i < NL_MEMORY_CATEGORY_COUNT; i++)
+    {
+        ATOMIC_STORE(&usages[i].allocated, 0);
+        ATOMIC_STORE(&usages[i].peak, ATOMIC_LOAD(&usages[i].live));
+    }
+}
+#else
+bool NodesetLoader_getMemoryUsage(
+    NL_MemoryUsage usage[NL_MEMORY_CATEGORY_COUNT])
+{
+    memset(usage, 0, NL_MEMORY_CATEGORY_COUNT * sizeof(NL_MemoryUsage));
+    return false;
+}
+
+void NodesetLoader_resetMemoryUsage(void) {}
+#endif
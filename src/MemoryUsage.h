@@ -0,0 +1,25 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+#include <NodesetLoader/NodesetLoader.h>
+#include <stddef.h>
+
+// counts the bytes of an allocation or a free of the category, see
+// NodesetLoader_getMemoryUsage
+// without NODESETLOADER_MEMORY_STATS the macros are empty and their
+// arguments are not evaluated
+#ifdef NODESETLOADER_MEMORY_STATS
+void MemoryUsage_allocated(NL_MemoryCategory category, size_t bytes);
+void MemoryUsage_freed(NL_MemoryCategory category, size_t bytes);
+#define MEMORY_ALLOCATED(category, bytes)                                      \
+    MemoryUsage_allocated(category, bytes)
+#define MEMORY_FREED(category, bytes) MemoryUsage_freed(category, bytes)
+#else
+#define MEMORY_ALLOCATED(category, bytes) ((void)0)
+#define MEMORY_FREED(category, bytes) ((void)0)
+#endif
+#endif
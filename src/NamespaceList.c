@@ -7,6 +7,7 @@
 
 #include "NamespaceList.h"
 #include <stdlib.h>
+#include <string.h>
 
 struct NamespaceList
 {
@@ -35,6 +36,25 @@ NamespaceList *NamespaceList_new(NL_addNamespaceCallback cb)
     return list;
 }
 
+NamespaceList *NamespaceList_copy(const NamespaceList *list)
+{
+    NamespaceList *copy = (NamespaceList *)calloc(1, sizeof(NamespaceList));
+    if(!copy)
+    {
+        return NULL;
+    }
+    copy->cb = list->cb;
+    copy->size = list->size;
+    copy->data = (Namespace *)malloc(sizeof(Namespace) * list->size);
+    if(!copy->data)
+    {
+        free(copy);
+        return NULL;
+    }
+    memcpy(copy->data, list->data, sizeof(Namespace) * list->size);
+    return copy;
+}
+
 void NamespaceList_delete(NamespaceList *list)
 {
     free(list->data);
@@ -22,6 +22,8 @@ struct Namespace
 };
 
 NamespaceList *NamespaceList_new(NL_addNamespaceCallback cb);
+// a list with the namespaces and the callback of list, the names are shared
+NamespaceList *NamespaceList_copy(const NamespaceList *list);
 Namespace *NamespaceList_newNamespace(NamespaceList *list, void *userContext,
                                       const char *uri);
 void NamespaceList_setUri(NamespaceList *list, Namespace *ns);
@@ -12,6 +12,11 @@ int NodesetLoader_NodeId_cmp(const NL_NodeId *id1, const NL_NodeId *id2)
 {
     if (id1->nsIdx == id2->nsIdx)
     {
+        // the ids of a nodeset are interned, equal ids share their string
+        if (id1->id == id2->id)
+        {
+            return 0;
+        }
         return strcmp(id1->id, id2->id);
     }
     if (id1->nsIdx < id2->nsIdx)
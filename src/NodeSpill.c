@@ -0,0 +1,603 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "NodeSpill.h"
+#include "MemoryUsage.h"
+#include "Value.h"
+#include "nodes/Node.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a record is its size followed by the attributes, integers are written in
+// the byte order of the host and strings as their size with the terminator,
+// 0 for NULL
+struct NodeSpill
+{
+    FILE *file;
+    // end of the last record
+    long end;
+    size_t count;
+    // the record which is written or was read last
+    char *buffer;
+    size_t size;
+    size_t capacity;
+    // read offset in the buffer
+    size_t offset;
+    bool failed;
+};
+
+NodeSpill *NodeSpill_new(void)
+{
+    NodeSpill *spill = (NodeSpill *)calloc(1, sizeof(NodeSpill));
+    if (!spill)
+    {
+        return NULL;
+    }
+    spill->file = tmpfile();
+    if (!spill->file)
+    {
+        free(spill);
+        return NULL;
+    }
+    return spill;
+}
+
+void NodeSpill_delete(NodeSpill *spill)
+{
+    if (!spill)
+    {
+        return;
+    }
+    fclose(spill->file);
+    free(spill->buffer);
+    free(spill);
+}
+
+size_t NodeSpill_count(const NodeSpill *spill)
+{
+    return spill->count;
+}
+
+static size_t referencesSize(const NL_Reference *ref)
+{
+    size_t size = 0;
+    for (; ref; ref = ref->next)
+    {
+        size += sizeof(NL_Reference);
+    }
+    return size;
+}
+
+static size_t dataSize(const NL_Data *data)
+{
+    size_t size = sizeof(NL_Data);
+    if (data->type == DATATYPE_COMPLEX)
+    {
+        size += data->val.complexData.membersSize * sizeof(NL_Data *);
+        for (size_t i = 0; i < data->val.complexData.membersSize; i++)
+        {
+            size += dataSize(data->val.complexData.members[i]);
+        }
+    }
+    return size;
+}
+
+size_t NodeSpill_nodeSize(const NL_Node *node)
+{
+    size_t size = Node_size(node->nodeClass) +
+                  referencesSize(node->hierachicalRefs) +
+                  referencesSize(node->nonHierachicalRefs) +
+                  referencesSize(node->unknownRefs);
+    const NodeLayout *layout = Node_layout(node->nodeClass);
+    if (layout->refToTypeDef)
+    {
+        size += referencesSize(*(NL_Reference *const *)(const void *)(
+            (const char *)node + layout->refToTypeDef));
+    }
+    if (node->nodeClass == NODECLASS_VARIABLE)
+    {
+        const NL_Value *value = ((const NL_VariableNode *)node)->value;
+        if (value)
+        {
+            size += sizeof(NL_Value) + sizeof(NL_ParserCtx);
+            size += value->data ? dataSize(value->data) : 0;
+        }
+    }
+    if (node->nodeClass == NODECLASS_DATATYPE)
+    {
+        const NL_DataTypeDefinition *definition =
+            ((const NL_DataTypeNode *)node)->definition;
+        if (definition)
+        {
+            size += sizeof(NL_DataTypeDefinition) +
+                    definition->fieldCnt * sizeof(NL_DataTypeDefinitionField);
+        }
+    }
+    return size;
+}
+
+static bool reserve(NodeSpill *spill, size_t size)
+{
+    if (size <= spill->capacity)
+    {
+        return true;
+    }
+    size_t capacity = spill->capacity ? spill->capacity : 256;
+    while (capacity < size)
+    {
+        capacity *= 2;
+    }
+    char *buffer = (char *)realloc(spill->buffer, capacity);
+    if (!buffer)
+    {
+        return false;
+    }
+    spill->buffer = buffer;
+    spill->capacity = capacity;
+    return true;
+}
+
+// writer
+
+static void put(NodeSpill *spill, const void *data, size_t size)
+{
+    if (!reserve(spill, spill->size + size))
+    {
+        spill->failed = true;
+        return;
+    }
+    memcpy(spill->buffer + spill->size, data, size);
+    spill->size += size;
+}
+
+static void putU32(NodeSpill *spill, uint32_t value)
+{
+    put(spill, &value, sizeof(value));
+}
+
+static void putString(NodeSpill *spill, const char *s)
+{
+    if (!s)
+    {
+        putU32(spill, 0);
+        return;
+    }
+    size_t size = strlen(s) + 1;
+    putU32(spill, (uint32_t)size);
+    put(spill, s, size);
+}
+
+static void putId(NodeSpill *spill, const NL_NodeId *id)
+{
+    int32_t nsIdx = id->nsIdx;
+    put(spill, &nsIdx, sizeof(nsIdx));
+    putString(spill, id->id);
+}
+
+static void putReferences(NodeSpill *spill, const NL_Reference *ref)
+{
+    uint32_t count = 0;
+    for (const NL_Reference *r = ref; r; r = r->next)
+    {
+        count++;
+    }
+    putU32(spill, count);
+    for (; ref; ref = ref->next)
+    {
+        putU32(spill, ref->isForward);
+        putId(spill, &ref->refType);
+        putId(spill, &ref->target);
+    }
+}
+
+static void putData(NodeSpill *spill, const NL_Data *data)
+{
+    putU32(spill, (uint32_t)data->type);
+    putString(spill, data->name);
+    if (data->type == DATATYPE_PRIMITIVE)
+    {
+        putString(spill, data->val.primitiveData.value);
+        return;
+    }
+    putU32(spill, (uint32_t)data->val.complexData.membersSize);
+    for (size_t i = 0; i < data->val.complexData.membersSize; i++)
+    {
+        putData(spill, data->val.complexData.members[i]);
+    }
+}
+
+static void putValue(NodeSpill *spill, const NL_Value *value)
+{
+    putU32(spill, value->isArray);
+    putU32(spill, value->isExtensionObject);
+    putString(spill, value->type);
+    putId(spill, &value->typeId);
+    putU32(spill, value->data != NULL);
+    if (value->data)
+    {
+        putData(spill, value->data);
+    }
+}
+
+static void putDefinition(NodeSpill *spill,
+                          const NL_DataTypeDefinition *definition)
+{
+    putU32(spill, definition->isEnum);
+    putU32(spill, definition->isUnion);
+    putU32(spill, definition->isOptionSet);
+    putU32(spill, (uint32_t)definition->fieldCnt);
+    for (size_t i = 0; i < definition->fieldCnt; i++)
+    {
+        const NL_DataTypeDefinitionField *field = &definition->fields[i];
+        putString(spill, field->name);
+        putId(spill, &field->dataType);
+        int32_t numbers[2] = {field->valueRank, field->value};
+        put(spill, numbers, sizeof(numbers));
+        putU32(spill, field->isOptional);
+    }
+}
+
+static void putNode(NodeSpill *spill, const NL_Node *node)
+{
+    const NodeLayout *layout = Node_layout(node->nodeClass);
+    const char *base = (const char *)node;
+    putU32(spill, (uint32_t)node->nodeClass);
+    putId(spill, &node->id);
+    putU32(spill, node->browseName.nsIdx);
+    putString(spill, node->browseName.name);
+    putString(spill, node->displayName.locale);
+    putString(spill, node->displayName.text);
+    putString(spill, node->description.locale);
+    putString(spill, node->description.text);
+    putString(spill, node->writeMask);
+    putReferences(spill, node->hierachicalRefs);
+    putReferences(spill, node->nonHierachicalRefs);
+    putReferences(spill, node->unknownRefs);
+    for (size_t i = 0; i < NODE_STRING_ATTRIBUTES && layout->strings[i]; i++)
+    {
+        putString(spill,
+                  *(char *const *)(const void *)(base + layout->strings[i]));
+    }
+    if (layout->parentNodeId)
+    {
+        putId(spill,
+              (const NL_NodeId *)(const void *)(base + layout->parentNodeId));
+    }
+    if (layout->dataType)
+    {
+        putId(spill,
+              (const NL_NodeId *)(const void *)(base + layout->dataType));
+    }
+    if (layout->refToTypeDef)
+    {
+        putReferences(spill, *(NL_Reference *const *)(const void *)(
+                                 base + layout->refToTypeDef));
+    }
+    if (node->nodeClass == NODECLASS_VARIABLE)
+    {
+        // recorded values are stored with their data
+        const NL_Value *value =
+            Value_decode(((const NL_VariableNode *)node)->value);
+        putU32(spill, value != NULL);
+        if (value)
+        {
+            putValue(spill, value);
+        }
+    }
+    if (node->nodeClass == NODECLASS_DATATYPE)
+    {
+        const NL_DataTypeDefinition *definition =
+            ((const NL_DataTypeNode *)node)->definition;
+        putU32(spill, definition != NULL);
+        if (definition)
+        {
+            putDefinition(spill, definition);
+        }
+    }
+}
+
+bool NodeSpill_write(NodeSpill *spill, const NL_Node *node, long *position)
+{
+    // the data of extensions is not known to the loader
+    if (node->extension)
+    {
+        return false;
+    }
+    spill->size = 0;
+    spill->failed = false;
+    // the size is filled in when the record is complete
+    putU32(spill, 0);
+    putNode(spill, node);
+    if (spill->failed || spill->size > UINT32_MAX)
+    {
+        return false;
+    }
+    uint32_t size = (uint32_t)(spill->size - sizeof(uint32_t));
+    memcpy(spill->buffer, &size, sizeof(size));
+    if (fseek(spill->file, spill->end, SEEK_SET) ||
+        fwrite(spill->buffer, 1, spill->size, spill->file) != spill->size)
+    {
+        return false;
+    }
+    *position = spill->end;
+    spill->end += (long)spill->size;
+    spill->count++;
+    return true;
+}
+
+// reader, a record which ends too early sets failed
+
+static const char *get(NodeSpill *spill, size_t size)
+{
+    if (spill->failed || spill->size - spill->offset < size)
+    {
+        spill->failed = true;
+        return NULL;
+    }
+    const char *data = spill->buffer + spill->offset;
+    spill->offset += size;
+    return data;
+}
+
+static uint32_t getU32(NodeSpill *spill)
+{
+    uint32_t value = 0;
+    const char *data = get(spill, sizeof(value));
+    if (data)
+    {
+        memcpy(&value, data, sizeof(value));
+    }
+    return value;
+}
+
+static int32_t getI32(NodeSpill *spill)
+{
+    int32_t value = 0;
+    const char *data = get(spill, sizeof(value));
+    if (data)
+    {
+        memcpy(&value, data, sizeof(value));
+    }
+    return value;
+}
+
+static char *getString(NodeSpill *spill)
+{
+    uint32_t size = getU32(spill);
+    if (!size)
+    {
+        return NULL;
+    }
+    const char *s = get(spill, size);
+    if (!s || s[size - 1])
+    {
+        spill->failed = true;
+        return NULL;
+    }
+    return spill->buffer + (s - spill->buffer);
+}
+
+static NL_NodeId getId(NodeSpill *spill)
+{
+    NL_NodeId id;
+    id.nsIdx = getI32(spill);
+    id.id = getString(spill);
+    return id;
+}
+
+// in the order of the record
+static NL_Reference *getReferences(NodeSpill *spill)
+{
+    uint32_t count = getU32(spill);
+    NL_Reference *first = NULL;
+    NL_Reference **last = &first;
+    for (uint32_t i = 0; i < count && !spill->failed; i++)
+    {
+        NL_Reference *ref = (NL_Reference *)calloc(1, sizeof(NL_Reference));
+        if (!ref)
+        {
+            spill->failed = true;
+            break;
+        }
+        MEMORY_ALLOCATED(NL_MEMORY_REFERENCES, sizeof(NL_Reference));
+        ref->isForward = getU32(spill) != 0;
+        ref->refType = getId(spill);
+        ref->target = getId(spill);
+        *last = ref;
+        last = &ref->next;
+    }
+    return first;
+}
+
+static NL_Data *getData(NodeSpill *spill, NL_Data *parent)
+{
+    NL_Data *data = (NL_Data *)calloc(1, sizeof(NL_Data));
+    if (!data)
+    {
+        spill->failed = true;
+        return NULL;
+    }
+    MEMORY_ALLOCATED(NL_MEMORY_VALUES, sizeof(NL_Data));
+    data->parent = parent;
+    data->type =
+        getU32(spill) == DATATYPE_COMPLEX ? DATATYPE_COMPLEX : DATATYPE_PRIMITIVE;
+    data->name = getString(spill);
+    if (data->type == DATATYPE_PRIMITIVE)
+    {
+        data->val.primitiveData.value = getString(spill);
+        return data;
+    }
+    uint32_t count = getU32(spill);
+    // every member takes at least its type
+    if (count > (spill->size - spill->offset) / sizeof(uint32_t))
+    {
+        spill->failed = true;
+        return data;
+    }
+    data->val.complexData.members =
+        (NL_Data **)calloc(count ? count : 1, sizeof(NL_Data *));
+    if (!data->val.complexData.members)
+    {
+        spill->failed = true;
+        return data;
+    }
+    for (uint32_t i = 0; i < count && !spill->failed; i++)
+    {
+        NL_Data *member = getData(spill, data);
+        if (member)
+        {
+            data->val.complexData.members[i] = member;
+            data->val.complexData.membersSize++;
+            MEMORY_ALLOCATED(NL_MEMORY_VALUES, sizeof(NL_Data *));
+        }
+    }
+    return data;
+}
+
+static NL_Value *getValue(NodeSpill *spill, const NL_Node *node)
+{
+    NL_Value *value = Value_new(node);
+    if (!value)
+    {
+        spill->failed = true;
+        return NULL;
+    }
+    value->isArray = getU32(spill) != 0;
+    value->isExtensionObject = getU32(spill) != 0;
+    value->type = getString(spill);
+    value->typeId = getId(spill);
+    if (getU32(spill))
+    {
+        value->data = getData(spill, NULL);
+    }
+    return value;
+}
+
+static NL_DataTypeDefinition *getDefinition(NodeSpill *spill)
+{
+    NL_DataTypeDefinition *definition =
+        (NL_DataTypeDefinition *)calloc(1, sizeof(NL_DataTypeDefinition));
+    if (!definition)
+    {
+        spill->failed = true;
+        return NULL;
+    }
+    MEMORY_ALLOCATED(NL_MEMORY_NODES, sizeof(NL_DataTypeDefinition));
+    definition->isEnum = getU32(spill) != 0;
+    definition->isUnion = getU32(spill) != 0;
+    definition->isOptionSet = getU32(spill) != 0;
+    uint32_t count = getU32(spill);
+    if (count > (spill->size - spill->offset) / sizeof(uint32_t))
+    {
+        spill->failed = true;
+        return definition;
+    }
+    definition->fields = (NL_DataTypeDefinitionField *)calloc(
+        count ? count : 1, sizeof(NL_DataTypeDefinitionField));
+    if (!definition->fields)
+    {
+        spill->failed = true;
+        return definition;
+    }
+    definition->fieldCnt = count;
+    MEMORY_ALLOCATED(NL_MEMORY_NODES,
+                     count * sizeof(NL_DataTypeDefinitionField));
+    for (uint32_t i = 0; i < count && !spill->failed; i++)
+    {
+        NL_DataTypeDefinitionField *field = &definition->fields[i];
+        field->name = getString(spill);
+        field->dataType = getId(spill);
+        field->valueRank = getI32(spill);
+        field->value = getI32(spill);
+        field->isOptional = getU32(spill) != 0;
+    }
+    return definition;
+}
+
+static NL_Node *getNode(NodeSpill *spill)
+{
+    uint32_t nodeClass = getU32(spill);
+    if (spill->failed || nodeClass >= NL_NODECLASS_COUNT)
+    {
+        return NULL;
+    }
+    NL_Node *node = Node_new((NL_NodeClass)nodeClass);
+    if (!node)
+    {
+        return NULL;
+    }
+    node->nodeClass = (NL_NodeClass)nodeClass;
+    const NodeLayout *layout = Node_layout(node->nodeClass);
+    char *base = (char *)node;
+    node->id = getId(spill);
+    node->browseName.nsIdx = (uint16_t)getU32(spill);
+    node->browseName.name = getString(spill);
+    node->displayName.locale = getString(spill);
+    node->displayName.text = getString(spill);
+    node->description.locale = getString(spill);
+    node->description.text = getString(spill);
+    node->writeMask = getString(spill);
+    node->hierachicalRefs = getReferences(spill);
+    node->nonHierachicalRefs = getReferences(spill);
+    node->unknownRefs = getReferences(spill);
+    for (size_t i = 0; i < NODE_STRING_ATTRIBUTES && layout->strings[i]; i++)
+    {
+        *(char **)(void *)(base + layout->strings[i]) = getString(spill);
+    }
+    if (layout->parentNodeId)
+    {
+        *(NL_NodeId *)(void *)(base + layout->parentNodeId) = getId(spill);
+    }
+    if (layout->dataType)
+    {
+        *(NL_NodeId *)(void *)(base + layout->dataType) = getId(spill);
+    }
+    if (layout->refToTypeDef)
+    {
+        *(NL_Reference **)(void *)(base + layout->refToTypeDef) =
+            getReferences(spill);
+    }
+    if (node->nodeClass == NODECLASS_VARIABLE && getU32(spill))
+    {
+        ((NL_VariableNode *)node)->value = getValue(spill, node);
+    }
+    if (node->nodeClass == NODECLASS_DATATYPE && getU32(spill))
+    {
+        ((NL_DataTypeNode *)node)->definition = getDefinition(spill);
+    }
+    Node_decodeAttributes(node);
+    return node;
+}
+
+NL_Node *NodeSpill_read(NodeSpill *spill, long position)
+{
+    uint32_t size = 0;
+    if (fseek(spill->file, position, SEEK_SET) ||
+        fread(&size, sizeof(size), 1, spill->file) != 1)
+    {
+        return NULL;
+    }
+    // the strings of the node point into the buffer
+    if (!reserve(spill, size))
+    {
+        return NULL;
+    }
+    if (fread(spill->buffer, 1, size, spill->file) != size)
+    {
+        return NULL;
+    }
+    spill->size = size;
+    spill->offset = 0;
+    spill->failed = false;
+    NL_Node *node = getNode(spill);
+    if (node && spill->failed)
+    {
+        Node_delete(node);
+        return NULL;
+    }
+    return node;
+}
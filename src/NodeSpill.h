@@ -0,0 +1,34 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef NODESPILL_H
+#define NODESPILL_H
+#include <NodesetLoader/NodesetLoader.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// nodes which are moved out of memory into a temporary file, see
+// NodesetLoader_setMemoryBudget
+// a record holds a node with its references, value and data type definition,
+// the strings are stored in the record with their terminator, so a node which
+// is read back points into the record buffer
+struct NodeSpill;
+typedef struct NodeSpill NodeSpill;
+
+// NULL if no temporary file can be created
+NodeSpill *NodeSpill_new(void);
+void NodeSpill_delete(NodeSpill *spill);
+// the memory of the node, its references, value and definition without the
+// strings
+size_t NodeSpill_nodeSize(const NL_Node *node);
+// appends the record of the node, false if the node cannot be written, e.g.
+// if it has an extension
+bool NodeSpill_write(NodeSpill *spill, const NL_Node *node, long *position);
+// builds up the node of the record at position, it is deleted with
+// Node_delete and its strings are valid until the next read
+NL_Node *NodeSpill_read(NodeSpill *spill, long position);
+// number of written records
+size_t NodeSpill_count(const NodeSpill *spill);
+#endif
@@ -7,8 +7,14 @@
 
 #include "Nodeset.h"
 #include "AliasList.h"
+#include "AttributeToken.h"
+#include "Clock.h"
+#include "MemoryUsage.h"
 #include "NamespaceList.h"
+#include "NodesetImage.h"
+#include "NodeSpill.h"
 #include "Sort.h"
+#include "StringPool.h"
 #include "nodes/DataTypeNode.h"
 #include "nodes/Node.h"
 #include "nodes/NodeContainer.h"
@@ -23,65 +29,88 @@ static NL_BrowseName translateBrowseName(const NamespaceList *namespaces,
                                          NL_BrowseName id);
 NL_BrowseName extractBrowseName(const NamespaceList *namespaces, char *s);
 
-// UANode
-#define ATTRIBUTE_NODEID "NodeId"
-#define ATTRIBUTE_BROWSENAME "BrowseName"
-// UAInstance
-#define ATTRIBUTE_PARENTNODEID "ParentNodeId"
-// UAVariable
-#define ATTRIBUTE_DATATYPE "DataType"
-#define ATTRIBUTE_VALUERANK "ValueRank"
-#define ATTRIBUTE_ARRAYDIMENSIONS "ArrayDimensions"
-#define ATTRIBUTE_HISTORIZING "Historizing"
-// UAObject
-#define ATTRIBUTE_EVENTNOTIFIER "EventNotifier"
-// UAObjectType
-#define ATTRIBUTE_ISABSTRACT "IsAbstract"
-// NL_Reference
-#define ATTRIBUTE_REFERENCETYPE "ReferenceType"
-#define ATTRIBUTE_ISFORWARD "IsForward"
-#define ATTRIBUTE_SYMMETRIC "Symmetric"
-#define ATTRIBUTE_ALIAS "Alias"
-// View
-#define ATTRIBUTE_CONTAINSNOLOOPS "ContainsNoLoops"
+#define ATTRIBUTE_BIT(token) (1u << (token))
+#define NODE_ATTRIBUTES                                                        \
+    (ATTRIBUTE_BIT(ATTRIBUTE_NODEID) | ATTRIBUTE_BIT(ATTRIBUTE_BROWSENAME))
+#define INSTANCE_ATTRIBUTES                                                    \
+    (NODE_ATTRIBUTES | ATTRIBUTE_BIT(ATTRIBUTE_PARENTNODEID))
+#define REFERENCE_ATTRIBUTES                                                   \
+    (ATTRIBUTE_BIT(ATTRIBUTE_REFERENCETYPE) |                                  \
+     ATTRIBUTE_BIT(ATTRIBUTE_ISFORWARD))
+#define DEFINITION_ATTRIBUTES                                                  \
+    (ATTRIBUTE_BIT(ATTRIBUTE_ISUNION) | ATTRIBUTE_BIT(ATTRIBUTE_ISOPTIONSET))
+#define FIELD_ATTRIBUTES                                                       \
+    (ATTRIBUTE_BIT(ATTRIBUTE_NAME) | ATTRIBUTE_BIT(ATTRIBUTE_VALUE) |          \
+     ATTRIBUTE_BIT(ATTRIBUTE_DATATYPE) | ATTRIBUTE_BIT(ATTRIBUTE_VALUERANK) |  \
+     ATTRIBUTE_BIT(ATTRIBUTE_ISOPTIONAL))
 
+// the attributes of one element, collected in one pass over them
 typedef struct
 {
-    const char *name;
-    char *defaultValue;
-} NodeAttribute;
-
-const NodeAttribute attrNodeId = {ATTRIBUTE_NODEID, NULL};
-const NodeAttribute attrBrowseName = {ATTRIBUTE_BROWSENAME, NULL};
-const NodeAttribute attrParentNodeId = {ATTRIBUTE_PARENTNODEID, NULL};
-const NodeAttribute attrEventNotifier = {ATTRIBUTE_EVENTNOTIFIER, "0"};
-const NodeAttribute attrDataType = {ATTRIBUTE_DATATYPE, "i=24"};
-const NodeAttribute attrValueRank = {ATTRIBUTE_VALUERANK, "-1"};
-const NodeAttribute attrArrayDimensions = {ATTRIBUTE_ARRAYDIMENSIONS, ""};
-const NodeAttribute attrIsAbstract = {ATTRIBUTE_ISABSTRACT, "false"};
-const NodeAttribute attrIsForward = {ATTRIBUTE_ISFORWARD, "true"};
-const NodeAttribute attrReferenceType = {ATTRIBUTE_REFERENCETYPE, NULL};
-const NodeAttribute attrAlias = {ATTRIBUTE_ALIAS, NULL};
-const NodeAttribute attrExecutable = {"Executable", "true"};
-const NodeAttribute attrUserExecutable = {"UserExecutable", "true"};
-const NodeAttribute attrAccessLevel = {"AccessLevel", "1"};
-const NodeAttribute attrUserAccessLevel = {"UserAccessLevel", "1"};
-const NodeAttribute attrSymmetric = {"Symmetric", "false"};
-const NodeAttribute dataTypeDefinition_IsUnion = {"IsUnion", "false"};
-const NodeAttribute dataTypeDefinition_IsOptionSet = {"IsOptionSet", "false"};
-const NodeAttribute dataTypeField_Name = {"Name", NULL};
-const NodeAttribute dataTypeField_DataType = {"DataType", "i=24"};
-const NodeAttribute dataTypeField_Value = {"Value", NULL};
-const NodeAttribute dataTypeField_IsOptional = {"IsOptional", "false"};
-const NodeAttribute attrLocale = {"Locale", NULL};
-const NodeAttribute attrHistorizing = {ATTRIBUTE_HISTORIZING, "false"};
-const NodeAttribute attrContainsNoLoops = {ATTRIBUTE_CONTAINSNOLOOPS, "false"};
+    // a bit per AttributeToken
+    uint32_t found;
+    const char *begin[ATTRIBUTE_COUNT];
+    const char *end[ATTRIBUTE_COUNT];
+} Attributes;
+
+// the value of a missing attribute, if NULL or not, the following code has
+// to cope with it
+static char *const attributeDefaults[ATTRIBUTE_COUNT] = {
+    [ATTRIBUTE_EVENTNOTIFIER] = "0",
+    [ATTRIBUTE_DATATYPE] = "i=24",
+    [ATTRIBUTE_VALUERANK] = "-1",
+    [ATTRIBUTE_ARRAYDIMENSIONS] = "",
+    [ATTRIBUTE_ISABSTRACT] = "false",
+    [ATTRIBUTE_ISFORWARD] = "true",
+    [ATTRIBUTE_EXECUTABLE] = "true",
+    [ATTRIBUTE_USEREXECUTABLE] = "true",
+    [ATTRIBUTE_ACCESSLEVEL] = "1",
+    [ATTRIBUTE_USERACCESSLEVEL] = "1",
+    [ATTRIBUTE_SYMMETRIC] = "false",
+    [ATTRIBUTE_ISUNION] = "false",
+    [ATTRIBUTE_ISOPTIONSET] = "false",
+    [ATTRIBUTE_ISOPTIONAL] = "false",
+    [ATTRIBUTE_HISTORIZING] = "false",
+    [ATTRIBUTE_CONTAINSNOLOOPS] = "false"};
+
+// the attributes which are collected for the nodes of a class
+static const uint32_t nodeClassAttributes[NL_NODECLASS_COUNT] = {
+    [NODECLASS_OBJECT] =
+        INSTANCE_ATTRIBUTES | ATTRIBUTE_BIT(ATTRIBUTE_EVENTNOTIFIER),
+    [NODECLASS_OBJECTTYPE] =
+        NODE_ATTRIBUTES | ATTRIBUTE_BIT(ATTRIBUTE_ISABSTRACT),
+    [NODECLASS_VARIABLE] =
+        INSTANCE_ATTRIBUTES | ATTRIBUTE_BIT(ATTRIBUTE_DATATYPE) |
+        ATTRIBUTE_BIT(ATTRIBUTE_VALUERANK) |
+        ATTRIBUTE_BIT(ATTRIBUTE_ARRAYDIMENSIONS) |
+        ATTRIBUTE_BIT(ATTRIBUTE_ACCESSLEVEL) |
+        ATTRIBUTE_BIT(ATTRIBUTE_USERACCESSLEVEL) |
+        ATTRIBUTE_BIT(ATTRIBUTE_HISTORIZING),
+    [NODECLASS_DATATYPE] =
+        NODE_ATTRIBUTES | ATTRIBUTE_BIT(ATTRIBUTE_ISABSTRACT),
+    [NODECLASS_METHOD] = INSTANCE_ATTRIBUTES |
+                         ATTRIBUTE_BIT(ATTRIBUTE_EXECUTABLE) |
+                         ATTRIBUTE_BIT(ATTRIBUTE_USEREXECUTABLE),
+    [NODECLASS_REFERENCETYPE] =
+        NODE_ATTRIBUTES | ATTRIBUTE_BIT(ATTRIBUTE_SYMMETRIC),
+    [NODECLASS_VARIABLETYPE] =
+        NODE_ATTRIBUTES | ATTRIBUTE_BIT(ATTRIBUTE_DATATYPE) |
+        ATTRIBUTE_BIT(ATTRIBUTE_VALUERANK) |
+        ATTRIBUTE_BIT(ATTRIBUTE_ARRAYDIMENSIONS) |
+        ATTRIBUTE_BIT(ATTRIBUTE_ISABSTRACT),
+    [NODECLASS_VIEW] = INSTANCE_ATTRIBUTES |
+                       ATTRIBUTE_BIT(ATTRIBUTE_CONTAINSNOLOOPS) |
+                       ATTRIBUTE_BIT(ATTRIBUTE_EVENTNOTIFIER)};
 
 NL_NodeId translateNodeId(const NamespaceList *namespaces, NL_NodeId id)
 {
     if (id.nsIdx > 0)
     {
-        id.nsIdx = (int)NamespaceList_getNamespace(namespaces, id.nsIdx)->idx;
+        const Namespace *ns = NamespaceList_getNamespace(namespaces, id.nsIdx);
+        if (ns != NULL)
+        {
+            id.nsIdx = (int)ns->idx;
+        }
         return id;
     }
     return id;
@@ -132,6 +161,11 @@ NL_BrowseName extractBrowseName(const NamespaceList *namespaces, char *s)
 {
     NL_BrowseName bn;
     bn.nsIdx = 0;
+    if (s == NULL)
+    {
+        bn.name = NULL;
+        return bn;
+    }
     char *bnName = strchr(s, ':');
     if (bnName == NULL)
     {
@@ -168,6 +202,7 @@ Nodeset *Nodeset_new(NL_addNamespaceCallback nsCallback,
     nodeset->aliasList = AliasList_new();
     nodeset->namespaces = NamespaceList_new(nsCallback);
     nodeset->charArena = CharArenaAllocator_new(1024 * 1024);
+    nodeset->strings = StringPool_new();
     nodeset->nodes[NODECLASS_OBJECT] = NodeContainer_new(10000, true);
     nodeset->nodes[NODECLASS_VARIABLE] = NodeContainer_new(10000, true);
     nodeset->nodes[NODECLASS_METHOD] = NodeContainer_new(1000, true);
@@ -178,17 +213,246 @@ Nodeset *Nodeset_new(NL_addNamespaceCallback nsCallback,
     nodeset->nodes[NODECLASS_VIEW] = NodeContainer_new(10, true);
     nodeset->nodesWithUnknownRefs = NodeContainer_new(100, false);
     nodeset->refTypesWithUnknownRefs = NodeContainer_new(100, false);
+    nodeset->replacedNodes = NodeContainer_new(10, true);
     nodeset->refService = refService;
     nodeset->sortCtx = Sort_init();
     nodeset->logger = logger;
     return nodeset;
 }
 
+Nodeset *Nodeset_newStaging(const Nodeset *parent)
+{
+    Nodeset *nodeset = (Nodeset *)calloc(1, sizeof(Nodeset));
+    if (!nodeset)
+    {
+        return NULL;
+    }
+    nodeset->staging = true;
+    nodeset->aliasList = parent->aliasList;
+    nodeset->namespaces = parent->namespaces;
+    nodeset->refService = parent->refService;
+    nodeset->logger = parent->logger;
+    nodeset->charArena = CharArenaAllocator_new(1024 * 1024);
+    nodeset->strings = StringPool_new();
+    nodeset->stagedNodes = NodeContainer_new(10000, false);
+    if (!nodeset->charArena || !nodeset->strings || !nodeset->stagedNodes)
+    {
+        Nodeset_cleanup(nodeset);
+        return NULL;
+    }
+    return nodeset;
+}
+
+Nodeset *Nodeset_newFileStaging(const Nodeset *parent,
+                                const Nodeset *previous)
+{
+    Nodeset *nodeset = Nodeset_newStaging(parent);
+    if (!nodeset)
+    {
+        return NULL;
+    }
+    nodeset->ownsLists = true;
+    nodeset->aliasList = AliasList_copy(previous->aliasList);
+    nodeset->namespaces = NamespaceList_copy(previous->namespaces);
+    if (!nodeset->aliasList || !nodeset->namespaces)
+    {
+        Nodeset_cleanup(nodeset);
+        return NULL;
+    }
+    return nodeset;
+}
+
+bool Nodeset_stagingSucceeded(const Nodeset *staging)
+{
+    return !staging->stagingFailed;
+}
+
+static void cleanupStaging(Nodeset *nodeset)
+{
+    if (nodeset->stagedNodes)
+    {
+        for (size_t i = 0; i < nodeset->stagedNodes->size; i++)
+        {
+            Node_delete(nodeset->stagedNodes->nodes[i]);
+        }
+        NodeContainer_delete(nodeset->stagedNodes);
+    }
+    if (nodeset->charArena)
+    {
+        CharArenaAllocator_delete(nodeset->charArena);
+    }
+    StringPool_delete(nodeset->strings);
+    if (nodeset->ownsLists && nodeset->aliasList)
+    {
+        AliasList_delete(nodeset->aliasList);
+    }
+    if (nodeset->ownsLists && nodeset->namespaces)
+    {
+        NamespaceList_delete(nodeset->namespaces);
+    }
+    free(nodeset);
+}
+
 static void Nodeset_addNode(Nodeset *nodeset, NL_Node *node)
 {
     NodeContainer_add(nodeset->nodes[node->nodeClass], node);
 }
 
+static void streamNode(Nodeset *nodeset, NL_Node *node)
+{
+    nodeset->streamCallback(nodeset->streamContext, node);
+    if (node->nodeClass == NODECLASS_REFERENCETYPE)
+    {
+        NodeContainer_add(nodeset->streamedRefTypes, node);
+        return;
+    }
+    Node_delete(node);
+}
+
+// passes the sorted node on and reports the progress of the sort
+static void reportSorted(Nodeset *nodeset, NL_Node *node)
+{
+    if (nodeset->streamCallback)
+    {
+        streamNode(nodeset, node);
+    }
+    else
+    {
+        Nodeset_addNode(nodeset, node);
+    }
+    nodeset->sortedNodes++;
+    if (nodeset->sortedNodes % NODESET_PROGRESS_INTERVAL == 0 &&
+        !nodeset->progress(nodeset->progressContext, nodeset->sortedNodes))
+    {
+        Sort_cancel(nodeset->sortCtx);
+    }
+}
+
+void Nodeset_setProgress(Nodeset *nodeset, Nodeset_progressCallback progress,
+                         void *context)
+{
+    nodeset->progress = progress;
+    nodeset->progressContext = context;
+}
+
+size_t Nodeset_nodeCount(const Nodeset *nodeset)
+{
+    return nodeset->staging ? nodeset->stagedNodes->size : nodeset->nodeCount;
+}
+
+void Nodeset_addStats(const Nodeset *nodeset, NL_Stats *stats)
+{
+    const NL_Stats *own = &nodeset->stats;
+    for (size_t i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        stats->nodes[i] += own->nodes[i];
+    }
+    stats->hierarchicalRefs += own->hierarchicalRefs;
+    stats->nonHierarchicalRefs += own->nonHierarchicalRefs;
+    stats->unknownRefs += own->unknownRefs;
+    stats->unknownRefsResolved += own->unknownRefsResolved;
+    stats->resolveMs += own->resolveMs;
+    stats->sortMs += own->sortMs;
+    if (own->peakUnknownRefNodes > stats->peakUnknownRefNodes)
+    {
+        stats->peakUnknownRefNodes = own->peakUnknownRefNodes;
+    }
+    if (nodeset->sortCtx &&
+        Sort_peakPending(nodeset->sortCtx) > stats->peakSortNodes)
+    {
+        stats->peakSortNodes = Sort_peakPending(nodeset->sortCtx);
+    }
+    if (nodeset->sortCtx &&
+        Sort_peakHeldBytes(nodeset->sortCtx) > stats->peakHeldBytes)
+    {
+        stats->peakHeldBytes = Sort_peakHeldBytes(nodeset->sortCtx);
+    }
+    if (nodeset->spill)
+    {
+        stats->spilledNodes += NodeSpill_count(nodeset->spill);
+    }
+    if (nodeset->charArena)
+    {
+        stats->arenaBytes += CharArenaAllocator_size(nodeset->charArena);
+    }
+    for (size_t i = 0; i < nodeset->mergedArenasSize; i++)
+    {
+        stats->arenaBytes += CharArenaAllocator_size(nodeset->mergedArenas[i]);
+    }
+}
+
+static size_t heldNodeSize(Nodeset *nodeset, const NL_Node *node)
+{
+    return NodeSpill_nodeSize(node);
+}
+
+static bool spillNode(Nodeset *nodeset, NL_Node *node, long *position)
+{
+    // the reference service refers to reference types
+    if (node->nodeClass == NODECLASS_REFERENCETYPE ||
+        !NodeSpill_write(nodeset->spill, node, position))
+    {
+        return false;
+    }
+    Node_delete(node);
+    return true;
+}
+
+static NL_Node *readSpilledNode(Nodeset *nodeset, long position)
+{
+    return NodeSpill_read(nodeset->spill, position);
+}
+
+bool Nodeset_setMemoryBudget(Nodeset *nodeset, size_t budget)
+{
+    // without a budget the held back nodes are only counted
+    Sort_Spill spill = {budget, heldNodeSize, NULL, NULL};
+    if (budget)
+    {
+        if (!nodeset->spill)
+        {
+            nodeset->spill = NodeSpill_new();
+            if (!nodeset->spill)
+            {
+                return false;
+            }
+        }
+        spill.write = spillNode;
+        spill.read = readSpilledNode;
+    }
+    Sort_setSpill(nodeset->sortCtx, &spill);
+    return true;
+}
+
+bool Nodeset_setStream(Nodeset *nodeset, void *context,
+                       NodesetLoader_forEachNode_Func fn)
+{
+    if (!nodeset->streamedRefTypes)
+    {
+        nodeset->streamedRefTypes = NodeContainer_new(100, true);
+        if (!nodeset->streamedRefTypes)
+        {
+            return false;
+        }
+    }
+    nodeset->streamCallback = fn;
+    nodeset->streamContext = context;
+    Sort_setStream(nodeset->sortCtx, nodeset, fn ? streamNode : NULL);
+    return true;
+}
+
+// a node with the NodeId of a pending node replaces it, a node with the
+// NodeId of a sorted or streamed node is dropped, e.g. when the namespace
+// indices of two files collide
+static void addToSort(Nodeset *nodeset, NL_Node *node)
+{
+    NL_Node *replaced = Sort_addNode(nodeset->sortCtx, node);
+    if (replaced)
+    {
+        NodeContainer_add(nodeset->replacedNodes, replaced);
+    }
+}
+
 static void insertElementAtFront(NL_Reference **toList, NL_Reference *elem)
 {
     elem->next = *toList;
@@ -205,6 +469,7 @@ static bool lookupUnknownReferences(Nodeset *nodeset, NL_Node *node)
         {
             insertElementAtFront(&node->hierachicalRefs, node->unknownRefs);
             node->unknownRefs = nextUnknown;
+            nodeset->stats.unknownRefsResolved++;
             continue;
         }
         if (nodeset->refService->isNonHierachicalRef(
@@ -212,6 +477,7 @@ static bool lookupUnknownReferences(Nodeset *nodeset, NL_Node *node)
         {
             insertElementAtFront(&node->nonHierachicalRefs, node->unknownRefs);
             node->unknownRefs = nextUnknown;
+            nodeset->stats.unknownRefsResolved++;
             continue;
         }
         return false;
@@ -234,13 +500,15 @@ static void lookupReferenceTypes(Nodeset *nodeset)
 
     for (size_t i = 0; i < nodeset->refTypesWithUnknownRefs->size; i++)
     {
-        Sort_addNode(nodeset->sortCtx,
-                     nodeset->refTypesWithUnknownRefs->nodes[i]);
+        addToSort(nodeset, nodeset->refTypesWithUnknownRefs->nodes[i]);
     }
+    // the nodes belong to the sort now
+    nodeset->refTypesWithUnknownRefs->size = 0;
 }
 
 bool Nodeset_sort(Nodeset *nodeset)
 {
+    double start = Clock_now();
     // first we have to figure out, if there are reference types, for which we
     // cannot state if they are hierachical or nonhierachical
     lookupReferenceTypes(nodeset);
@@ -257,144 +525,253 @@ bool Nodeset_sort(Nodeset *nodeset)
                 "node with unresolved reference(s): NodeId(%d, %s)",
                 nodeset->nodesWithUnknownRefs->nodes[i]->id.nsIdx,
                 nodeset->nodesWithUnknownRefs->nodes[i]->id.id);
+            nodeset->stats.resolveMs += Clock_now() - start;
             return false;
         }
-        Sort_addNode(nodeset->sortCtx, nodeset->nodesWithUnknownRefs->nodes[i]);
     }
+    for (size_t i = 0; i < nodeset->nodesWithUnknownRefs->size; i++)
+    {
+        addToSort(nodeset, nodeset->nodesWithUnknownRefs->nodes[i]);
+    }
+    nodeset->nodesWithUnknownRefs->size = 0;
+    double resolved = Clock_now();
+    nodeset->stats.resolveMs += resolved - start;
 
-    return Sort_start(nodeset->sortCtx, nodeset, Nodeset_addNode,
-                      nodeset->logger);
+    nodeset->sortedNodes = 0;
+    nodeset->sorted =
+        Sort_start(nodeset->sortCtx, nodeset,
+                   nodeset->progress ? reportSorted
+                   : nodeset->streamCallback ? streamNode
+                                             : Nodeset_addNode,
+                   nodeset->logger);
+    nodeset->stats.sortMs += Clock_now() - resolved;
+    if (nodeset->sorted && nodeset->progress &&
+        !nodeset->progress(nodeset->progressContext, nodeset->sortedNodes))
+    {
+        nodeset->sorted = false;
+    }
+    return nodeset->sorted;
 }
 
 void Nodeset_cleanup(Nodeset *nodeset)
 {
+    if (nodeset->staging)
+    {
+        cleanupStaging(nodeset);
+        return;
+    }
     CharArenaAllocator_delete(nodeset->charArena);
+    StringPool_delete(nodeset->strings);
+    for (size_t i = 0; i < nodeset->mergedArenasSize; i++)
+    {
+        CharArenaAllocator_delete(nodeset->mergedArenas[i]);
+    }
+    free(nodeset->mergedArenas);
     AliasList_delete(nodeset->aliasList);
     for (size_t cnt = 0; cnt < NL_NODECLASS_COUNT; cnt++)
     {
         NodeContainer_delete(nodeset->nodes[cnt]);
     }
+    // nodes which were never sorted, e.g. after a failed sort, belong to
+    // nobody else
+    Sort_forEachPending(nodeset->sortCtx, Node_delete);
+    for (size_t i = 0; i < nodeset->nodesWithUnknownRefs->size; i++)
+    {
+        Node_delete(nodeset->nodesWithUnknownRefs->nodes[i]);
+    }
+    for (size_t i = 0; i < nodeset->refTypesWithUnknownRefs->size; i++)
+    {
+        Node_delete(nodeset->refTypesWithUnknownRefs->nodes[i]);
+    }
     NodeContainer_delete(nodeset->nodesWithUnknownRefs);
     NodeContainer_delete(nodeset->refTypesWithUnknownRefs);
+    NodeContainer_delete(nodeset->replacedNodes);
+    if (nodeset->streamedRefTypes)
+    {
+        NodeContainer_delete(nodeset->streamedRefTypes);
+    }
+    NodeSpill_delete(nodeset->spill);
     NamespaceList_delete(nodeset->namespaces);
     Sort_cleanup(nodeset->sortCtx);
+    NodesetImage_delete(nodeset->image);
     NL_BiDirectionalReference *ref = nodeset->hasEncodingRefs;
     while (ref)
     {
         NL_BiDirectionalReference *tmp = ref->next;
         free(ref);
+        MEMORY_FREED(NL_MEMORY_ENCODING_REFS,
+                     sizeof(NL_BiDirectionalReference));
         ref = tmp;
     }
     free(nodeset);
 }
 
-static char *getAttributeValue(Nodeset *nodeset, const NodeAttribute *attr,
-                               const char **attributes, int nb_attributes)
+// maps each attribute name to its slot, only the wanted attributes are kept
+static void collectAttributes(Attributes *attrs, uint32_t wanted,
+                              const char **attributes, int nb_attributes)
 {
     const int fields = 5;
+    attrs->found = 0;
     for (int i = 0; i < nb_attributes; i++)
     {
-        const char *localname = attributes[i * fields + 0];
-        if (strcmp((const char *)localname, attr->name))
+        AttributeToken token = AttributeToken_lookup(attributes[i * fields]);
+        if (token == ATTRIBUTE_UNKNOWN || !(wanted & ATTRIBUTE_BIT(token)) ||
+            (attrs->found & ATTRIBUTE_BIT(token)))
+        {
             continue;
-        const char *value_start = attributes[i * fields + 3];
-        const char *value_end = attributes[i * fields + 4];
-        size_t size = (size_t)(value_end - value_start);
-        char *value = CharArenaAllocator_malloc(nodeset->charArena, size + 1);
-        memcpy(value, value_start, size);
-        return value;
+        }
+        attrs->found |= ATTRIBUTE_BIT(token);
+        attrs->begin[token] = attributes[i * fields + 3];
+        attrs->end[token] = attributes[i * fields + 4];
     }
-    // we return the defaultValue, if NULL or not, following code has to cope
-    // with it
-    return attr->defaultValue;
+}
+
+// the canonical copy of the attribute in the arena or its default value
+static char *getAttributeValue(Nodeset *nodeset, const Attributes *attrs,
+                               AttributeToken token)
+{
+    if (!(attrs->found & ATTRIBUTE_BIT(token)))
+    {
+        return attributeDefaults[token];
+    }
+    return StringPool_intern(
+        nodeset->strings, nodeset->charArena, attrs->begin[token],
+        (size_t)(attrs->end[token] - attrs->begin[token]));
+}
+
+// the attribute as a string in buffer or, if it doesn't fit, in *allocated
+static char *copyAttribute(const Attributes *attrs, AttributeToken token,
+                           char *buffer, size_t bufferSize, char **allocated)
+{
+    if (!(attrs->found & ATTRIBUTE_BIT(token)))
+    {
+        return NULL;
+    }
+    size_t size = (size_t)(attrs->end[token] - attrs->begin[token]);
+    char *value = buffer;
+    if (size >= bufferSize)
+    {
+        *allocated = (char *)malloc(size + 1);
+        value = *allocated;
+    }
+    if (value)
+    {
+        memcpy(value, attrs->begin[token], size);
+        value[size] = '\0';
+    }
+    return value;
+}
+
+bool Nodeset_filterNode(const Nodeset *nodeset, NL_NodeClass nodeClass,
+                        int attributeSize, const char **attributes,
+                        NL_nodeFilterCallback filter, void *userContext)
+{
+    char idBuffer[128];
+    char browseNameBuffer[128];
+    char *allocatedId = NULL;
+    char *allocatedBrowseName = NULL;
+    Attributes attrs;
+    collectAttributes(&attrs, NODE_ATTRIBUTES, attributes, attributeSize);
+    NL_NodeId id = extractNodedId(
+        nodeset->namespaces,
+        copyAttribute(&attrs, ATTRIBUTE_NODEID, idBuffer, sizeof(idBuffer),
+                      &allocatedId));
+    NL_BrowseName browseName = extractBrowseName(
+        nodeset->namespaces,
+        copyAttribute(&attrs, ATTRIBUTE_BROWSENAME, browseNameBuffer,
+                      sizeof(browseNameBuffer), &allocatedBrowseName));
+    bool accepted = filter(userContext, nodeClass, &id, &browseName);
+    free(allocatedId);
+    free(allocatedBrowseName);
+    return accepted;
 }
 
 static void extractAttributes(Nodeset *nodeset, const NamespaceList *namespaces,
                               NL_Node *node, int attributeSize,
                               const char **attributes)
 {
+    Attributes attrs;
+    collectAttributes(&attrs, nodeClassAttributes[node->nodeClass], attributes,
+                      attributeSize);
     node->id = extractNodedId(
-        namespaces,
-        getAttributeValue(nodeset, &attrNodeId, attributes, attributeSize));
+        namespaces, getAttributeValue(nodeset, &attrs, ATTRIBUTE_NODEID));
     node->browseName = extractBrowseName(
-        namespaces,
-        getAttributeValue(nodeset, &attrBrowseName, attributes, attributeSize));
+        namespaces, getAttributeValue(nodeset, &attrs, ATTRIBUTE_BROWSENAME));
     switch (node->nodeClass)
     {
     case NODECLASS_OBJECTTYPE: {
-        ((NL_ObjectTypeNode *)node)->isAbstract = getAttributeValue(
-            nodeset, &attrIsAbstract, attributes, attributeSize);
+        ((NL_ObjectTypeNode *)node)->isAbstract =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_ISABSTRACT);
         break;
     }
     case NODECLASS_OBJECT: {
         ((NL_ObjectNode *)node)->parentNodeId = extractNodedId(
-            namespaces, getAttributeValue(nodeset, &attrParentNodeId,
-                                          attributes, attributeSize));
-        ((NL_ObjectNode *)node)->eventNotifier = getAttributeValue(
-            nodeset, &attrEventNotifier, attributes, attributeSize);
+            namespaces,
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_PARENTNODEID));
+        ((NL_ObjectNode *)node)->eventNotifier =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_EVENTNOTIFIER);
         break;
     }
     case NODECLASS_VARIABLE: {
 
         ((NL_VariableNode *)node)->parentNodeId = extractNodedId(
-            namespaces, getAttributeValue(nodeset, &attrParentNodeId,
-                                          attributes, attributeSize));
-        char *datatype = getAttributeValue(nodeset, &attrDataType, attributes,
-                                           attributeSize);
+            namespaces,
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_PARENTNODEID));
+        char *datatype = getAttributeValue(nodeset, &attrs, ATTRIBUTE_DATATYPE);
         ((NL_VariableNode *)node)->datatype = alias2Id(nodeset, datatype);
-        ((NL_VariableNode *)node)->valueRank = getAttributeValue(
-            nodeset, &attrValueRank, attributes, attributeSize);
-        ((NL_VariableNode *)node)->arrayDimensions = getAttributeValue(
-            nodeset, &attrArrayDimensions, attributes, attributeSize);
-        ((NL_VariableNode *)node)->accessLevel = getAttributeValue(
-            nodeset, &attrAccessLevel, attributes, attributeSize);
-        ((NL_VariableNode *)node)->userAccessLevel = getAttributeValue(
-            nodeset, &attrUserAccessLevel, attributes, attributeSize);
-        ((NL_VariableNode *)node)->historizing = getAttributeValue(
-            nodeset, &attrHistorizing, attributes, attributeSize);
+        ((NL_VariableNode *)node)->valueRank =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_VALUERANK);
+        ((NL_VariableNode *)node)->arrayDimensions =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_ARRAYDIMENSIONS);
+        ((NL_VariableNode *)node)->accessLevel =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_ACCESSLEVEL);
+        ((NL_VariableNode *)node)->userAccessLevel =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_USERACCESSLEVEL);
+        ((NL_VariableNode *)node)->historizing =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_HISTORIZING);
         break;
     }
     case NODECLASS_VARIABLETYPE: {
 
-        ((NL_VariableTypeNode *)node)->valueRank = getAttributeValue(
-            nodeset, &attrValueRank, attributes, attributeSize);
-        char *datatype = getAttributeValue(nodeset, &attrDataType, attributes,
-                                           attributeSize);
+        ((NL_VariableTypeNode *)node)->valueRank =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_VALUERANK);
+        char *datatype = getAttributeValue(nodeset, &attrs, ATTRIBUTE_DATATYPE);
         ((NL_VariableTypeNode *)node)->datatype = alias2Id(nodeset, datatype);
-        ((NL_VariableTypeNode *)node)->arrayDimensions = getAttributeValue(
-            nodeset, &attrArrayDimensions, attributes, attributeSize);
-        ((NL_VariableTypeNode *)node)->isAbstract = getAttributeValue(
-            nodeset, &attrIsAbstract, attributes, attributeSize);
+        ((NL_VariableTypeNode *)node)->arrayDimensions =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_ARRAYDIMENSIONS);
+        ((NL_VariableTypeNode *)node)->isAbstract =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_ISABSTRACT);
         break;
     }
     case NODECLASS_DATATYPE:
-        ((NL_DataTypeNode *)node)->isAbstract = getAttributeValue(
-            nodeset, &attrIsAbstract, attributes, attributeSize);
+        ((NL_DataTypeNode *)node)->isAbstract =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_ISABSTRACT);
         break;
     case NODECLASS_METHOD:
         ((NL_MethodNode *)node)->parentNodeId = extractNodedId(
-            namespaces, getAttributeValue(nodeset, &attrParentNodeId,
-                                          attributes, attributeSize));
-        ((NL_MethodNode *)node)->executable = getAttributeValue(
-            nodeset, &attrExecutable, attributes, attributeSize);
-        ((NL_MethodNode *)node)->userExecutable = getAttributeValue(
-            nodeset, &attrUserExecutable, attributes, attributeSize);
+            namespaces,
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_PARENTNODEID));
+        ((NL_MethodNode *)node)->executable =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_EXECUTABLE);
+        ((NL_MethodNode *)node)->userExecutable =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_USEREXECUTABLE);
         break;
     case NODECLASS_REFERENCETYPE:
-        ((NL_ReferenceTypeNode *)node)->symmetric = getAttributeValue(
-            nodeset, &attrSymmetric, attributes, attributeSize);
+        ((NL_ReferenceTypeNode *)node)->symmetric =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_SYMMETRIC);
         break;
     case NODECLASS_VIEW:
         ((NL_ViewNode *)node)->parentNodeId = extractNodedId(
-            namespaces, getAttributeValue(nodeset, &attrParentNodeId,
-                                          attributes, attributeSize));
-        ((NL_ViewNode *)node)->containsNoLoops = getAttributeValue(
-            nodeset, &attrContainsNoLoops, attributes, attributeSize);
-        ((NL_ViewNode *)node)->eventNotifier = getAttributeValue(
-            nodeset, &attrEventNotifier, attributes, attributeSize);
+            namespaces,
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_PARENTNODEID));
+        ((NL_ViewNode *)node)->containsNoLoops =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_CONTAINSNOLOOPS);
+        ((NL_ViewNode *)node)->eventNotifier =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_EVENTNOTIFIER);
         break;
     default:;
     }
+    Node_decodeAttributes(node);
 }
 
 static void initNode(Nodeset *nodeset, const NamespaceList *namespaces,
@@ -411,33 +788,23 @@ NL_Node *Nodeset_newNode(Nodeset *nodeset, NL_NodeClass nodeClass,
     NL_Node *node = Node_new(nodeClass);
     initNode(nodeset, nodeset->namespaces, nodeClass, node, nb_attributes,
              attributes);
+    if (nodeset->staging)
+    {
+        // also unfinished nodes are deleted with the staging nodeset
+        NodeContainer_add(nodeset->stagedNodes, node);
+    }
     return node;
 }
 
-NL_Reference *Nodeset_newReference(Nodeset *nodeset, NL_Node *node,
-                                   int attributeSize, const char **attributes)
+// sorts the reference into the lists of the node
+static void addReference(Nodeset *nodeset, NL_Node *node, NL_Reference *newRef)
 {
-    NL_Reference *newRef = (NL_Reference *)calloc(1, sizeof(NL_Reference));
-    if (!strcmp("true", getAttributeValue(nodeset, &attrIsForward, attributes,
-                                          attributeSize)))
-    {
-        newRef->isForward = true;
-    }
-    else
-    {
-        newRef->isForward = false;
-    }
-    char *aliasIdString = getAttributeValue(nodeset, &attrReferenceType,
-                                            attributes, attributeSize);
-
-    newRef->refType = alias2Id(nodeset, aliasIdString);
-
     if (NODECLASS_VARIABLE == node->nodeClass &&
         nodeset->refService->isHasTypeDefRef(nodeset->refService->context,
                                              newRef))
     {
         ((NL_VariableNode *)node)->refToTypeDef = newRef;
-        return newRef;
+        return;
     }
 
     if (NODECLASS_OBJECT == node->nodeClass &&
@@ -445,7 +812,7 @@ NL_Reference *Nodeset_newReference(Nodeset *nodeset, NL_Node *node,
                                              newRef))
     {
         ((NL_ObjectNode *)node)->refToTypeDef = newRef;
-        return newRef;
+        return;
     }
 
     if (nodeset->refService->isHierachicalRef(nodeset->refService->context,
@@ -453,50 +820,132 @@ NL_Reference *Nodeset_newReference(Nodeset *nodeset, NL_Node *node,
     {
         newRef->next = node->hierachicalRefs;
         node->hierachicalRefs = newRef;
-        return newRef;
+        return;
     }
     if (nodeset->refService->isNonHierachicalRef(nodeset->refService->context,
                                                  newRef))
     {
         newRef->next = node->nonHierachicalRefs;
         node->nonHierachicalRefs = newRef;
-        return newRef;
+        return;
     }
 
     newRef->next = node->unknownRefs;
     node->unknownRefs = newRef;
+}
+
+NL_Reference *Nodeset_newReference(Nodeset *nodeset, NL_Node *node,
+                                   int attributeSize, const char **attributes)
+{
+    NL_Reference *newRef = (NL_Reference *)calloc(1, sizeof(NL_Reference));
+    MEMORY_ALLOCATED(NL_MEMORY_REFERENCES, sizeof(NL_Reference));
+    Attributes attrs;
+    collectAttributes(&attrs, REFERENCE_ATTRIBUTES, attributes, attributeSize);
+    if (!strcmp("true",
+                getAttributeValue(nodeset, &attrs, ATTRIBUTE_ISFORWARD)))
+    {
+        newRef->isForward = true;
+    }
+    else
+    {
+        newRef->isForward = false;
+    }
+    char *aliasIdString =
+        getAttributeValue(nodeset, &attrs, ATTRIBUTE_REFERENCETYPE);
+
+    newRef->refType = alias2Id(nodeset, aliasIdString);
+
+    if (nodeset->staging)
+    {
+        // the reference service is asked when the node is merged, the
+        // references are collected in reverse order
+        newRef->next = node->unknownRefs;
+        node->unknownRefs = newRef;
+        return newRef;
+    }
+    addReference(nodeset, node, newRef);
     return newRef;
 }
 
 Alias *Nodeset_newAlias(Nodeset *nodeset, int attributeSize,
                         const char **attributes)
 {
+    if (nodeset->staging && !nodeset->ownsLists)
+    {
+        // the alias list is shared with the other parser threads
+        nodeset->stagingFailed = true;
+        return NULL;
+    }
+    Attributes attrs;
+    collectAttributes(&attrs, ATTRIBUTE_BIT(ATTRIBUTE_ALIAS), attributes,
+                      attributeSize);
     return AliasList_newAlias(
         nodeset->aliasList,
-        getAttributeValue(nodeset, &attrAlias, attributes, attributeSize));
+        getAttributeValue(nodeset, &attrs, ATTRIBUTE_ALIAS));
 }
 
 void Nodeset_newAliasFinish(Nodeset *nodeset, Alias *alias, char *idString)
 {
+    if (!alias)
+    {
+        return;
+    }
     alias->id = extractNodedId(nodeset->namespaces, idString);
 }
 
 void Nodeset_newNamespaceFinish(Nodeset *nodeset, void *userContext,
                                 char *namespaceUri)
 {
-    NamespaceList_newNamespace(nodeset->namespaces, userContext, namespaceUri);
+    if (nodeset->staging && !nodeset->ownsLists)
+    {
+        nodeset->stagingFailed = true;
+        return;
+    }
+    const Namespace *ns = NamespaceList_newNamespace(
+        nodeset->namespaces, userContext, namespaceUri);
+    // the namespaces of a file staging nodeset are added when it is merged
+    if (ns && !nodeset->staging)
+    {
+        Sort_addNamespace(nodeset->sortCtx, ns->idx);
+    }
+}
+
+static size_t countRefs(const NL_Reference *ref)
+{
+    size_t count = 0;
+    for (; ref; ref = ref->next)
+    {
+        count++;
+    }
+    return count;
+}
+
+static void countNode(NL_Stats *stats, const NL_Node *node)
+{
+    stats->nodes[node->nodeClass]++;
+    stats->hierarchicalRefs += countRefs(node->hierachicalRefs);
+    stats->nonHierarchicalRefs += countRefs(node->nonHierachicalRefs);
+    stats->unknownRefs += countRefs(node->unknownRefs);
 }
 
 void Nodeset_newNodeFinish(Nodeset *nodeset, NL_Node *node)
 {
+    if (nodeset->staging)
+    {
+        return;
+    }
+    nodeset->sorted = false;
+    nodeset->nodeCount++;
+    countNode(&nodeset->stats, node);
     if (!node->unknownRefs)
     {
-        Sort_addNode(nodeset->sortCtx, node);
         if (node->nodeClass == NODECLASS_REFERENCETYPE)
         {
             nodeset->refService->addNewReferenceType(
                 nodeset->refService->context, (NL_ReferenceTypeNode *)node);
         }
+        // a streamed node may be deleted by the sort
+        addToSort(nodeset, node);
     }
     else
     {
@@ -508,20 +957,27 @@ void Nodeset_newNodeFinish(Nodeset *nodeset, NL_Node *node)
         {
             NodeContainer_add(nodeset->nodesWithUnknownRefs, node);
         }
+        size_t waiting = nodeset->refTypesWithUnknownRefs->size +
+                         nodeset->nodesWithUnknownRefs->size;
+        if (waiting > nodeset->stats.peakUnknownRefNodes)
+        {
+            nodeset->stats.peakUnknownRefNodes = waiting;
+        }
     }
 }
 
-void Nodeset_newReferenceFinish(Nodeset *nodeset, NL_Reference *ref,
-                                NL_Node *node, char *targetId)
+// handle hasEncoding in a special way
+static void addHasEncodingRef(Nodeset *nodeset, const NL_Reference *ref,
+                              const NL_Node *node)
 {
-    ref->target = alias2Id(nodeset, targetId);
-    // handle hasEncoding in a special way
     NL_NodeId hasEncodingRef = {0, "i=38"};
     if (!NodesetLoader_NodeId_cmp(&ref->refType, &hasEncodingRef) &&
         !strcmp(node->browseName.name, "Default Binary") && !ref->isForward)
     {
         NL_BiDirectionalReference *newRef = (NL_BiDirectionalReference *)calloc(
             1, sizeof(NL_BiDirectionalReference));
+        MEMORY_ALLOCATED(NL_MEMORY_ENCODING_REFS,
+                         sizeof(NL_BiDirectionalReference));
         newRef->source = ref->target;
         newRef->target = node->id;
         newRef->refType = ref->refType;
@@ -532,17 +988,91 @@ void Nodeset_newReferenceFinish(Nodeset *nodeset, NL_Reference *ref,
     }
 }
 
+void Nodeset_newReferenceFinish(Nodeset *nodeset, NL_Reference *ref,
+                                NL_Node *node, char *targetId)
+{
+    // many references have the same target, e.g. the type definitions
+    targetId =
+        StringPool_internLast(nodeset->strings, nodeset->charArena, targetId);
+    ref->target = alias2Id(nodeset, targetId);
+    if (!nodeset->staging)
+    {
+        addHasEncodingRef(nodeset, ref, node);
+    }
+}
+
+void Nodeset_merge(Nodeset *nodeset, Nodeset *staging)
+{
+    if (staging->ownsLists)
+    {
+        // namespace 0 is not declared by the file
+        const Namespace *ns;
+        for (int i = 1;
+             (ns = NamespaceList_getNamespace(staging->namespaces, i)); i++)
+        {
+            Sort_addNamespace(nodeset->sortCtx, ns->idx);
+        }
+    }
+    NodeContainer *staged = staging->stagedNodes;
+    for (size_t i = 0; i < staged->size; i++)
+    {
+        NL_Node *node = staged->nodes[i];
+        // back to document order
+        NL_Reference *refs = NULL;
+        while (node->unknownRefs)
+        {
+            NL_Reference *next = node->unknownRefs->next;
+            node->unknownRefs->next = refs;
+            refs = node->unknownRefs;
+            node->unknownRefs = next;
+        }
+        // the same steps as for a node parsed by this nodeset
+        while (refs)
+        {
+            NL_Reference *next = refs->next;
+            refs->next = NULL;
+            addReference(nodeset, node, refs);
+            addHasEncodingRef(nodeset, refs, node);
+            refs = next;
+        }
+        Nodeset_newNodeFinish(nodeset, node);
+    }
+    CharArenaAllocator **arenas = (CharArenaAllocator **)realloc(
+        nodeset->mergedArenas,
+        (nodeset->mergedArenasSize + 1) * sizeof(CharArenaAllocator *));
+    if (arenas)
+    {
+        nodeset->mergedArenas = arenas;
+        nodeset->mergedArenas[nodeset->mergedArenasSize++] =
+            staging->charArena;
+        staging->charArena = NULL;
+    }
+    // the nodes belong to the nodeset now
+    staged->size = 0;
+    if (staging->ownsLists)
+    {
+        // the following files are resolved with them
+        AliasList_delete(nodeset->aliasList);
+        NamespaceList_delete(nodeset->namespaces);
+        nodeset->aliasList = staging->aliasList;
+        nodeset->namespaces = staging->namespaces;
+        staging->aliasList = NULL;
+        staging->namespaces = NULL;
+    }
+    Nodeset_cleanup(staging);
+}
+
 void Nodeset_addDataTypeDefinition(Nodeset *nodeset, NL_Node *node,
                                    int attributeSize, const char **attributes)
 {
     NL_DataTypeNode *dataTypeNode = (NL_DataTypeNode *)node;
     NL_DataTypeDefinition *def = DataTypeDefinition_new(dataTypeNode);
-    def->isUnion =
-        !strcmp("true", getAttributeValue(nodeset, &dataTypeDefinition_IsUnion,
-                                          attributes, attributeSize));
+    Attributes attrs;
+    collectAttributes(&attrs, DEFINITION_ATTRIBUTES, attributes, attributeSize);
+    def->isUnion = !strcmp(
+        "true", getAttributeValue(nodeset, &attrs, ATTRIBUTE_ISUNION));
     def->isOptionSet = !strcmp(
-        "true", getAttributeValue(nodeset, &dataTypeDefinition_IsOptionSet,
-                                  attributes, attributeSize));
+        "true", getAttributeValue(nodeset, &attrs, ATTRIBUTE_ISOPTIONSET));
 }
 
 void Nodeset_addDataTypeField(Nodeset *nodeset, NL_Node *node,
@@ -556,11 +1086,11 @@ void Nodeset_addDataTypeField(Nodeset *nodeset, NL_Node *node,
 
     NL_DataTypeDefinitionField *newField =
         DataTypeNode_addDefinitionField(dataTypeNode->definition);
-    newField->name = getAttributeValue(nodeset, &dataTypeField_Name, attributes,
-                                       attributeSize);
+    Attributes attrs;
+    collectAttributes(&attrs, FIELD_ATTRIBUTES, attributes, attributeSize);
+    newField->name = getAttributeValue(nodeset, &attrs, ATTRIBUTE_NAME);
 
-    char *value = getAttributeValue(nodeset, &dataTypeField_Value, attributes,
-                                    attributeSize);
+    char *value = getAttributeValue(nodeset, &attrs, ATTRIBUTE_VALUE);
     if (value)
     {
         newField->value = atoi(value);
@@ -570,12 +1100,11 @@ void Nodeset_addDataTypeField(Nodeset *nodeset, NL_Node *node,
     else
     {
         newField->dataType = alias2Id(
-            nodeset, getAttributeValue(nodeset, &dataTypeField_DataType,
-                                       attributes, attributeSize));
-        newField->valueRank = atoi(getAttributeValue(
-            nodeset, &attrValueRank, attributes, attributeSize));
-        char *isOptional = getAttributeValue(nodeset, &dataTypeField_IsOptional,
-                                             attributes, attributeSize);
+            nodeset, getAttributeValue(nodeset, &attrs, ATTRIBUTE_DATATYPE));
+        newField->valueRank =
+            atoi(getAttributeValue(nodeset, &attrs, ATTRIBUTE_VALUERANK));
+        char *isOptional =
+            getAttributeValue(nodeset, &attrs, ATTRIBUTE_ISOPTIONAL);
         newField->isOptional = !strcmp("true", isOptional);
     }
 }
@@ -586,30 +1115,39 @@ Nodeset_getBiDirectionalRefs(const Nodeset *nodeset)
     return nodeset->hasEncodingRefs;
 }
 
+static char *getLocale(Nodeset *nodeset, const char **attributes,
+                       int attributeSize)
+{
+    Attributes attrs;
+    collectAttributes(&attrs, ATTRIBUTE_BIT(ATTRIBUTE_LOCALE), attributes,
+                      attributeSize);
+    return getAttributeValue(nodeset, &attrs, ATTRIBUTE_LOCALE);
+}
+
 void Nodeset_setDisplayName(Nodeset *nodeset, NL_Node *node, int attributeSize,
                             const char **attributes)
 {
     node->displayName.locale =
-        getAttributeValue(nodeset, &attrLocale, attributes, attributeSize);
+        getLocale(nodeset, attributes, attributeSize);
 }
 
-void Nodeset_DisplayNameFinish(const Nodeset *nodeset, NL_Node *node,
-                               char *text)
+void Nodeset_DisplayNameFinish(Nodeset *nodeset, NL_Node *node, char *text)
 {
-    node->displayName.text = text;
+    node->displayName.text =
+        StringPool_internLast(nodeset->strings, nodeset->charArena, text);
 }
 
 void Nodeset_setDescription(Nodeset *nodeset, NL_Node *node, int attributeSize,
                             const char **attributes)
 {
     node->description.locale =
-        getAttributeValue(nodeset, &attrLocale, attributes, attributeSize);
+        getLocale(nodeset, attributes, attributeSize);
 }
 
-void Nodeset_DescriptionFinish(const Nodeset *nodeset, NL_Node *node,
-                               char *text)
+void Nodeset_DescriptionFinish(Nodeset *nodeset, NL_Node *node, char *text)
 {
-    node->description.text = text;
+    node->description.text =
+        StringPool_internLast(nodeset->strings, nodeset->charArena, text);
 }
 
 void Nodeset_setInverseName(Nodeset *nodeset, NL_Node *node, int attributeSize,
@@ -618,15 +1156,15 @@ void Nodeset_setInverseName(Nodeset *nodeset, NL_Node *node, int attributeSize,
     if (node->nodeClass == NODECLASS_REFERENCETYPE)
     {
         ((NL_ReferenceTypeNode *)node)->inverseName.locale =
-            getAttributeValue(nodeset, &attrLocale, attributes, attributeSize);
+            getLocale(nodeset, attributes, attributeSize);
     }
 }
-void Nodeset_InverseNameFinish(const Nodeset *nodeset, NL_Node *node,
-                               char *text)
+void Nodeset_InverseNameFinish(Nodeset *nodeset, NL_Node *node, char *text)
 {
     if (node->nodeClass == NODECLASS_REFERENCETYPE)
     {
-        ((NL_ReferenceTypeNode *)node)->inverseName.text = text;
+        ((NL_ReferenceTypeNode *)node)->inverseName.text =
+            StringPool_internLast(nodeset->strings, nodeset->charArena, text);
     }
 }
 
@@ -12,6 +12,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#define NODESET_PROGRESS_INTERVAL 4096
+
 struct Nodeset;
 typedef struct Nodeset Nodeset;
 struct Alias;
@@ -20,12 +22,20 @@ typedef struct TParserCtx TParserCtx;
 
 struct NamespaceList;
 
+// sortedNodes is the number of nodes which were sorted, returns false to
+// cancel the sort
+typedef bool (*Nodeset_progressCallback)(void *context, size_t sortedNodes);
+
 struct NodeContainer;
 struct AliasList;
+struct StringPool;
 struct SortContext;
+struct NodesetImage;
 struct Nodeset
 {
     CharArenaAllocator *charArena;
+    // the canonical copies of the short strings in charArena
+    struct StringPool *strings;
     struct AliasList *aliasList;
     struct NodeContainer *nodes[NL_NODECLASS_COUNT];
     struct NamespaceList *namespaces;
@@ -35,11 +45,90 @@ struct Nodeset
     struct NodeContainer *nodesWithUnknownRefs;
     struct NodeContainer *refTypesWithUnknownRefs;
     NL_ReferenceService* refService;
+    // staging nodesets are filled by a parser thread, see Nodeset_newStaging
+    bool staging;
+    // the aliases and namespaces belong to the staging nodeset, see
+    // Nodeset_newFileStaging
+    bool ownsLists;
+    // a staging nodeset saw content which needs a serial parse
+    bool stagingFailed;
+    struct NodeContainer *stagedNodes;
+    // the arenas of merged staging nodesets, their strings are used by the
+    // nodes
+    CharArenaAllocator **mergedArenas;
+    size_t mergedArenasSize;
+    // all nodes are sorted into the node containers
+    bool sorted;
+    // the nodes and strings of a loaded image, see NodesetImage_load
+    struct NodesetImage *image;
+    // sorted nodes are passed to the stream callback instead of the node
+    // containers, see Nodeset_setStream
+    NodesetLoader_forEachNode_Func streamCallback;
+    void *streamContext;
+    // streamed reference types, the reference service refers to them
+    struct NodeContainer *streamedRefTypes;
+    // nodes which a node with the same NodeId replaced in the sort or which
+    // were dropped, the reference service may refer to them
+    struct NodeContainer *replacedNodes;
+    // held back nodes of the stream beyond the memory budget, see
+    // Nodeset_setMemoryBudget
+    struct NodeSpill *spill;
+    // finished nodes, see Nodeset_nodeCount
+    size_t nodeCount;
+    // see Nodeset_setProgress
+    Nodeset_progressCallback progress;
+    void *progressContext;
+    size_t sortedNodes;
+    // the counters of the finished nodes and the sort, see Nodeset_addStats
+    NL_Stats stats;
 };
 
 Nodeset *Nodeset_new(NL_addNamespaceCallback nsCallback, NodesetLoader_Logger* logger, NL_ReferenceService* refService);
 void Nodeset_cleanup(Nodeset *nodeset);
+// nodeset for parsing a part of a document on another thread, it shares the
+// aliases and namespaces of the parent (they are only read) and has its own
+// arena, the nodes are kept in document order and the reference service is
+// not used until they are merged
+Nodeset *Nodeset_newStaging(const Nodeset *parent);
+// staging nodeset for a whole file, it starts with copies of the aliases and
+// namespaces of previous (the parent or the staging nodeset of the previous
+// file), so the file resolves them like a file parsed by the parent after
+// the previous one, it has to be filled on the thread which owns the parent,
+// the nodes of other staging nodesets can be parsed with its lists
+Nodeset *Nodeset_newFileStaging(const Nodeset *parent,
+                                const Nodeset *previous);
+// false if the part contained aliases or namespaces and the lists are shared
+bool Nodeset_stagingSucceeded(const Nodeset *staging);
+// finishes the nodes of the staging nodeset as if they were parsed by the
+// nodeset itself and deletes the staging nodeset, all nodes of the staging
+// nodeset have to be finished, the nodeset takes the lists of a file staging
+// nodeset
+void Nodeset_merge(Nodeset *nodeset, Nodeset *staging);
 bool Nodeset_sort(Nodeset *nodeset);
+// called about every NODESET_PROGRESS_INTERVAL sorted nodes and at the end of
+// a sort, NULL turns it off
+void Nodeset_setProgress(Nodeset *nodeset, Nodeset_progressCallback progress,
+                         void *context);
+// nodes which were parsed (staging) or finished in the nodeset, including
+// the nodes of merged staging nodesets
+size_t Nodeset_nodeCount(const Nodeset *nodeset);
+// adds the counters of the nodes, the timings of the sort and the bytes of
+// the arenas to stats
+void Nodeset_addStats(const Nodeset *nodeset, NL_Stats *stats);
+// the nodes which are finished afterwards are passed to fn in the order of
+// Nodeset_sort as soon as they are ready and deleted afterwards, NULL turns
+// streaming off
+bool Nodeset_setStream(Nodeset *nodeset, void *context,
+                       NodesetLoader_forEachNode_Func fn);
+// the nodes which the stream holds back beyond budget bytes are written to a
+// temporary file, 0 keeps them in memory, both count the held back bytes,
+// false if the file can't be created
+bool Nodeset_setMemoryBudget(Nodeset *nodeset, size_t budget);
+// calls the filter with the id and browse name of the node start tag, nothing
+// is allocated in the nodeset, returns false if the node is skipped
+bool Nodeset_filterNode(const Nodeset *nodeset, NL_NodeClass nodeClass,
+                        int attributeSize, const char **attributes,
+                        NL_nodeFilterCallback filter, void *userContext);
 NL_Node *Nodeset_newNode(Nodeset *nodeset, NL_NodeClass nodeClass,
                        int attributeSize, const char **attributes);
 void Nodeset_newNodeFinish(Nodeset *nodeset, NL_Node *node);
@@ -59,13 +148,13 @@ void Nodeset_addDataTypeField(Nodeset *nodeset, NL_Node *node, int attributeSize
                               const char **attributes);
 void Nodeset_setDisplayName(Nodeset *nodeset, NL_Node *node, int attributeSize,
                             const char **attributes);
-void Nodeset_DisplayNameFinish(const Nodeset *nodeset, NL_Node *node, char *text);
+void Nodeset_DisplayNameFinish(Nodeset *nodeset, NL_Node *node, char *text);
 void Nodeset_setDescription(Nodeset *nodeset, NL_Node *node, int attributeSize,
                             const char **attributes);
-void Nodeset_DescriptionFinish(const Nodeset *nodeset, NL_Node *node, char *text);
+void Nodeset_DescriptionFinish(Nodeset *nodeset, NL_Node *node, char *text);
 void Nodeset_setInverseName(Nodeset *nodeset, NL_Node *node, int attributeSize,
                             const char **attributes);
-void Nodeset_InverseNameFinish(const Nodeset *nodeset, NL_Node *node, char *text);
+void Nodeset_InverseNameFinish(Nodeset *nodeset, NL_Node *node, char *text);
 const NL_BiDirectionalReference *
 Nodeset_getBiDirectionalRefs(const Nodeset *nodeset);
 size_t Nodeset_forEachNode(Nodeset *nodeset, NL_NodeClass nodeClass,
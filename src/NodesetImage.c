@@ -0,0 +1,1141 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "NodesetImage.h"
+#include "AliasList.h"
+#include "MemoryUsage.h"
+#include "NamespaceList.h"
+#include "StringTable.h"
+#include "Value.h"
+#include "nodes/Node.h"
+#include "nodes/NodeContainer.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IMAGE_MAGIC "NLIMAGE"
+#define IMAGE_VERSION 1
+// written in the byte order of the host, an image of another host is rejected
+#define IMAGE_BYTE_ORDER 0x01020304u
+// sections start at multiples of it
+#define IMAGE_ALIGNMENT 8
+#define IMAGE_STRING_ATTRIBUTES NODE_STRING_ATTRIBUTES
+
+typedef enum
+{
+    IMAGE_NODES,
+    IMAGE_REFERENCES,
+    IMAGE_VALUES,
+    IMAGE_DATA,
+    // indices of the members of complex data
+    IMAGE_MEMBERS,
+    IMAGE_DEFINITIONS,
+    IMAGE_FIELDS,
+    IMAGE_ALIASES,
+    IMAGE_NAMESPACES,
+    IMAGE_ENCODING_REFERENCES,
+    // zero terminated strings, a string is stored as its offset + 1, 0 is
+    // NULL
+    IMAGE_STRINGS,
+    IMAGE_SECTION_COUNT
+} ImageSection;
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t size;
+    uint32_t nodeCounts[NL_NODECLASS_COUNT];
+    // number of records, bytes for the strings
+    uint64_t counts[IMAGE_SECTION_COUNT];
+    uint64_t offsets[IMAGE_SECTION_COUNT];
+} ImageHeader;
+
+typedef struct
+{
+    int32_t nsIdx;
+    uint32_t id;
+} ImageNodeId;
+
+// the attributes which only some node classes have are 0 for the others
+typedef struct
+{
+    uint32_t nodeClass;
+    ImageNodeId id;
+    uint32_t browseNameNsIdx;
+    uint32_t browseName;
+    uint32_t displayNameLocale;
+    uint32_t displayNameText;
+    uint32_t descriptionLocale;
+    uint32_t descriptionText;
+    uint32_t writeMask;
+    // first index and number of references
+    uint32_t hierachicalRefs;
+    uint32_t hierachicalRefsSize;
+    uint32_t nonHierachicalRefs;
+    uint32_t nonHierachicalRefsSize;
+    // index + 1 of the reference, 0 for none
+    uint32_t refToTypeDef;
+    ImageNodeId parentNodeId;
+    ImageNodeId dataType;
+    uint32_t strings[IMAGE_STRING_ATTRIBUTES];
+    // index + 1, 0 for none
+    uint32_t value;
+    uint32_t definition;
+} ImageNode;
+
+typedef struct
+{
+    uint32_t isForward;
+    ImageNodeId refType;
+    ImageNodeId target;
+} ImageReference;
+
+typedef struct
+{
+    uint32_t isArray;
+    uint32_t isExtensionObject;
+    uint32_t type;
+    ImageNodeId typeId;
+    // index + 1, 0 for none
+    uint32_t data;
+} ImageValue;
+
+typedef struct
+{
+    uint32_t type;
+    uint32_t name;
+    // primitive data
+    uint32_t value;
+    // complex data, first index in IMAGE_MEMBERS
+    uint32_t members;
+    uint32_t membersSize;
+    // index + 1, 0 for the root
+    uint32_t parent;
+} ImageData;
+
+typedef struct
+{
+    uint32_t fields;
+    uint32_t fieldCnt;
+    uint32_t isEnum;
+    uint32_t isUnion;
+    uint32_t isOptionSet;
+} ImageDefinition;
+
+typedef struct
+{
+    uint32_t name;
+    ImageNodeId dataType;
+    int32_t valueRank;
+    int32_t value;
+    uint32_t isOptional;
+} ImageField;
+
+typedef struct
+{
+    uint32_t name;
+    ImageNodeId id;
+} ImageAlias;
+
+typedef struct
+{
+    // index which was assigned by the namespace callback
+    int32_t idx;
+    uint32_t uri;
+} ImageNamespace;
+
+typedef struct
+{
+    ImageNodeId source;
+    ImageNodeId target;
+    ImageNodeId refType;
+} ImageEncodingReference;
+
+static const size_t recordSizes[IMAGE_SECTION_COUNT] = {
+    sizeof(ImageNode),       sizeof(ImageReference),
+    sizeof(ImageValue),      sizeof(ImageData),
+    sizeof(uint32_t),        sizeof(ImageDefinition),
+    sizeof(ImageField),      sizeof(ImageAlias),
+    sizeof(ImageNamespace),  sizeof(ImageEncodingReference),
+    1};
+
+static size_t align(size_t size)
+{
+    return (size + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+}
+
+// writer
+
+struct Buffer
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+};
+
+typedef struct
+{
+    struct Buffer sections[IMAGE_SECTION_COUNT];
+    // the strings of the nodeset with their offset + 1 in IMAGE_STRINGS
+    StringTable strings;
+    bool failed;
+} ImageWriter;
+
+// appends a zeroed record to the section, returns its index
+static size_t append(ImageWriter *w, ImageSection section, size_t count)
+{
+    struct Buffer *buffer = &w->sections[section];
+    size_t size = count * recordSizes[section];
+    size_t idx = buffer->size / recordSizes[section];
+    if (buffer->size + size > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (capacity < buffer->size + size)
+        {
+            capacity *= 2;
+        }
+        char *data = (char *)realloc(buffer->data, capacity);
+        if (!data)
+        {
+            w->failed = true;
+            return idx;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    memset(buffer->data + buffer->size, 0, size);
+    buffer->size += size;
+    return idx;
+}
+
+// valid until the next append to the section
+static void *record(ImageWriter *w, ImageSection section, size_t idx)
+{
+    return w->sections[section].data + idx * recordSizes[section];
+}
+
+// equal strings are stored once
+static uint32_t writeString(ImageWriter *w, const char *s)
+{
+    if (!s)
+    {
+        return 0;
+    }
+    if (!StringTable_reserve(&w->strings))
+    {
+        w->failed = true;
+        return 0;
+    }
+    size_t length = strlen(s);
+    uint32_t hash = StringTable_hash(s, length);
+    StringTable_Slot *slot = StringTable_find(&w->strings, s, length, hash);
+    if (slot->s)
+    {
+        return slot->value;
+    }
+    size_t offset = append(w, IMAGE_STRINGS, length + 1);
+    if (w->failed || offset + 1 > UINT32_MAX)
+    {
+        w->failed = true;
+        return 0;
+    }
+    memcpy(record(w, IMAGE_STRINGS, offset), s, length + 1);
+    uint32_t value = (uint32_t)(offset + 1);
+    StringTable_add(&w->strings, slot, s, length, hash, value);
+    return value;
+}
+
+static ImageNodeId writeId(ImageWriter *w, const NL_NodeId *id)
+{
+    ImageNodeId imageId;
+    imageId.nsIdx = id->nsIdx;
+    imageId.id = writeString(w, id->id);
+    return imageId;
+}
+
+static uint32_t writeReference(ImageWriter *w, const NL_Reference *ref)
+{
+    ImageReference rec;
+    rec.isForward = ref->isForward;
+    rec.refType = writeId(w, &ref->refType);
+    rec.target = writeId(w, &ref->target);
+    size_t idx = append(w, IMAGE_REFERENCES, 1);
+    if (!w->failed)
+    {
+        memcpy(record(w, IMAGE_REFERENCES, idx), &rec, sizeof(rec));
+    }
+    return (uint32_t)idx;
+}
+
+// the references of a list are stored one after the other
+static void writeReferences(ImageWriter *w, const NL_Reference *ref,
+                            uint32_t *first, uint32_t *size)
+{
+    *first = (uint32_t)(w->sections[IMAGE_REFERENCES].size /
+                        sizeof(ImageReference));
+    *size = 0;
+    for (; ref; ref = ref->next)
+    {
+        writeReference(w, ref);
+        (*size)++;
+    }
+}
+
+static uint32_t writeData(ImageWriter *w, const NL_Data *data,
+                          uint32_t parent)
+{
+    ImageData rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.type = (uint32_t)data->type;
+    rec.name = writeString(w, data->name);
+    rec.parent = parent;
+    if (data->type == DATATYPE_PRIMITIVE)
+    {
+        rec.value = writeString(w, data->val.primitiveData.value);
+    }
+    else
+    {
+        rec.membersSize = (uint32_t)data->val.complexData.membersSize;
+        rec.members = (uint32_t)append(w, IMAGE_MEMBERS, rec.membersSize);
+    }
+    size_t idx = append(w, IMAGE_DATA, 1);
+    if (w->failed)
+    {
+        return 0;
+    }
+    memcpy(record(w, IMAGE_DATA, idx), &rec, sizeof(rec));
+    for (uint32_t i = 0; i < rec.membersSize; i++)
+    {
+        uint32_t member = writeData(w, data->val.complexData.members[i],
+                                    (uint32_t)idx + 1);
+        if (w->failed)
+        {
+            return 0;
+        }
+        *(uint32_t *)record(w, IMAGE_MEMBERS, rec.members + i) = member;
+    }
+    return (uint32_t)idx;
+}
+
+static uint32_t writeValue(ImageWriter *w, const NL_Value *value)
+{
+    ImageValue rec;
+    rec.isArray = value->isArray;
+    rec.isExtensionObject = value->isExtensionObject;
+    rec.type = writeString(w, value->type);
+    rec.typeId = writeId(w, &value->typeId);
+    rec.data = value->data ? writeData(w, value->data, 0) + 1 : 0;
+    size_t idx = append(w, IMAGE_VALUES, 1);
+    if (w->failed)
+    {
+        return 0;
+    }
+    memcpy(record(w, IMAGE_VALUES, idx), &rec, sizeof(rec));
+    return (uint32_t)idx + 1;
+}
+
+static uint32_t writeDefinition(ImageWriter *w,
+                                const NL_DataTypeDefinition *definition)
+{
+    ImageDefinition rec;
+    rec.fieldCnt = (uint32_t)definition->fieldCnt;
+    rec.isEnum = definition->isEnum;
+    rec.isUnion = definition->isUnion;
+    rec.isOptionSet = definition->isOptionSet;
+    rec.fields = (uint32_t)append(w, IMAGE_FIELDS, definition->fieldCnt);
+    for (size_t i = 0; i < definition->fieldCnt && !w->failed; i++)
+    {
+        const NL_DataTypeDefinitionField *field = &definition->fields[i];
+        ImageField fieldRec;
+        fieldRec.name = writeString(w, field->name);
+        fieldRec.dataType = writeId(w, &field->dataType);
+        fieldRec.valueRank = field->valueRank;
+        fieldRec.value = field->value;
+        fieldRec.isOptional = field->isOptional;
+        if (!w->failed)
+        {
+            memcpy(record(w, IMAGE_FIELDS, rec.fields + i), &fieldRec,
+                   sizeof(fieldRec));
+        }
+    }
+    size_t idx = append(w, IMAGE_DEFINITIONS, 1);
+    if (w->failed)
+    {
+        return 0;
+    }
+    memcpy(record(w, IMAGE_DEFINITIONS, idx), &rec, sizeof(rec));
+    return (uint32_t)idx + 1;
+}
+
+static void writeNode(ImageWriter *w, const NL_Node *node)
+{
+    // the data of extensions is not known to the loader
+    if (node->extension)
+    {
+        w->failed = true;
+        return;
+    }
+    const NodeLayout *layout = Node_layout(node->nodeClass);
+    const char *base = (const char *)node;
+    ImageNode rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.nodeClass = (uint32_t)node->nodeClass;
+    rec.id = writeId(w, &node->id);
+    rec.browseNameNsIdx = node->browseName.nsIdx;
+    rec.browseName = writeString(w, node->browseName.name);
+    rec.displayNameLocale = writeString(w, node->displayName.locale);
+    rec.displayNameText = writeString(w, node->displayName.text);
+    rec.descriptionLocale = writeString(w, node->description.locale);
+    rec.descriptionText = writeString(w, node->description.text);
+    rec.writeMask = writeString(w, node->writeMask);
+    writeReferences(w, node->hierachicalRefs, &rec.hierachicalRefs,
+                    &rec.hierachicalRefsSize);
+    writeReferences(w, node->nonHierachicalRefs, &rec.nonHierachicalRefs,
+                    &rec.nonHierachicalRefsSize);
+    for (size_t i = 0; i < IMAGE_STRING_ATTRIBUTES && layout->strings[i]; i++)
+    {
+        rec.strings[i] = writeString(
+            w, *(char *const *)(const void *)(base + layout->strings[i]));
+    }
+    if (layout->parentNodeId)
+    {
+        rec.parentNodeId = writeId(
+            w, (const NL_NodeId *)(const void *)(base + layout->parentNodeId));
+    }
+    if (layout->dataType)
+    {
+        rec.dataType = writeId(
+            w, (const NL_NodeId *)(const void *)(base + layout->dataType));
+    }
+    if (layout->refToTypeDef)
+    {
+        const NL_Reference *ref = *(NL_Reference *const *)(const void *)(
+            base + layout->refToTypeDef);
+        rec.refToTypeDef = ref ? writeReference(w, ref) + 1 : 0;
+    }
+    if (node->nodeClass == NODECLASS_VARIABLE &&
+        ((const NL_VariableNode *)node)->value)
+    {
+        // recorded values are stored with their data
+        rec.value = writeValue(
+            w, Value_decode(((const NL_VariableNode *)node)->value));
+    }
+    if (node->nodeClass == NODECLASS_DATATYPE &&
+        ((const NL_DataTypeNode *)node)->definition)
+    {
+        rec.definition =
+            writeDefinition(w, ((const NL_DataTypeNode *)node)->definition);
+    }
+    size_t idx = append(w, IMAGE_NODES, 1);
+    if (!w->failed)
+    {
+        memcpy(record(w, IMAGE_NODES, idx), &rec, sizeof(rec));
+    }
+}
+
+static void writeLists(ImageWriter *w, const Nodeset *nodeset)
+{
+    const Alias *alias;
+    for (size_t i = 0; (alias = AliasList_getAlias(nodeset->aliasList, i));
+         i++)
+    {
+        ImageAlias rec;
+        rec.name = writeString(w, alias->name);
+        rec.id = writeId(w, &alias->id);
+        size_t idx = append(w, IMAGE_ALIASES, 1);
+        if (!w->failed)
+        {
+            memcpy(record(w, IMAGE_ALIASES, idx), &rec, sizeof(rec));
+        }
+    }
+    // namespace 0 is part of every namespace list
+    const Namespace *ns;
+    for (int i = 1; (ns = NamespaceList_getNamespace(nodeset->namespaces, i));
+         i++)
+    {
+        ImageNamespace rec;
+        rec.idx = ns->idx;
+        rec.uri = writeString(w, ns->name);
+        size_t idx = append(w, IMAGE_NAMESPACES, 1);
+        if (!w->failed)
+        {
+            memcpy(record(w, IMAGE_NAMESPACES, idx), &rec, sizeof(rec));
+        }
+    }
+    for (const NL_BiDirectionalReference *ref = nodeset->hasEncodingRefs; ref;
+         ref = ref->next)
+    {
+        ImageEncodingReference rec;
+        rec.source = writeId(w, &ref->source);
+        rec.target = writeId(w, &ref->target);
+        rec.refType = writeId(w, &ref->refType);
+        size_t idx = append(w, IMAGE_ENCODING_REFERENCES, 1);
+        if (!w->failed)
+        {
+            memcpy(record(w, IMAGE_ENCODING_REFERENCES, idx), &rec,
+                   sizeof(rec));
+        }
+    }
+}
+
+struct NodesetImageBuffer
+{
+    ImageHeader header;
+    ImageWriter w;
+};
+
+static void deleteWriter(ImageWriter *w)
+{
+    for (int i = 0; i < IMAGE_SECTION_COUNT; i++)
+    {
+        free(w->sections[i].data);
+    }
+    StringTable_cleanup(&w->strings);
+}
+
+NodesetImageBuffer *NodesetImage_serialize(const Nodeset *nodeset)
+{
+    NodesetImageBuffer *buffer =
+        (NodesetImageBuffer *)calloc(1, sizeof(NodesetImageBuffer));
+    if (!buffer)
+    {
+        return NULL;
+    }
+    ImageWriter *w = &buffer->w;
+    ImageHeader *header = &buffer->header;
+    memcpy(header->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header->version = IMAGE_VERSION;
+    header->byteOrder = IMAGE_BYTE_ORDER;
+    w->failed = !StringTable_init(&w->strings, 4096);
+    for (int c = 0; c < NL_NODECLASS_COUNT && !w->failed; c++)
+    {
+        const NodeContainer *nodes = nodeset->nodes[c];
+        header->nodeCounts[c] = (uint32_t)nodes->size;
+        for (size_t i = 0; i < nodes->size && !w->failed; i++)
+        {
+            writeNode(w, nodes->nodes[i]);
+        }
+    }
+    if (!w->failed)
+    {
+        writeLists(w, nodeset);
+    }
+    size_t offset = align(sizeof(ImageHeader));
+    for (int i = 0; i < IMAGE_SECTION_COUNT; i++)
+    {
+        // the indices of the records are 32 bit
+        if (w->sections[i].size / recordSizes[i] > UINT32_MAX)
+        {
+            w->failed = true;
+        }
+        header->offsets[i] = offset;
+        header->counts[i] = w->sections[i].size / recordSizes[i];
+        offset = align(offset + w->sections[i].size);
+    }
+    header->size = offset;
+    // the strings are looked up while serializing only
+    StringTable_cleanup(&w->strings);
+    if (w->failed)
+    {
+        NodesetImage_deleteBuffer(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+bool NodesetImage_writeBuffer(const NodesetImageBuffer *buffer, FILE *file)
+{
+    static const char padding[IMAGE_ALIGNMENT] = {0};
+    size_t headerPad = align(sizeof(ImageHeader)) - sizeof(ImageHeader);
+    if (fwrite(&buffer->header, sizeof(ImageHeader), 1, file) != 1 ||
+        (headerPad && fwrite(padding, headerPad, 1, file) != 1))
+    {
+        return false;
+    }
+    for (int i = 0; i < IMAGE_SECTION_COUNT; i++)
+    {
+        const struct Buffer *section = &buffer->w.sections[i];
+        if (section->size && fwrite(section->data, section->size, 1, file) != 1)
+        {
+            return false;
+        }
+        size_t pad = align(section->size) - section->size;
+        if (pad && fwrite(padding, pad, 1, file) != 1)
+        {
+            return false;
+        }
+    }
+    return !fflush(file);
+}
+
+void NodesetImage_deleteBuffer(NodesetImageBuffer *buffer)
+{
+    if (!buffer)
+    {
+        return;
+    }
+    deleteWriter(&buffer->w);
+    free(buffer);
+}
+
+bool NodesetImage_write(const Nodeset *nodeset, FILE *file)
+{
+    NodesetImageBuffer *buffer = NodesetImage_serialize(nodeset);
+    bool success = buffer && NodesetImage_writeBuffer(buffer, file);
+    NodesetImage_deleteBuffer(buffer);
+    return success;
+}
+
+// loader
+
+struct NodesetImage
+{
+    FileMapping *mapping;
+    char *nodes[NL_NODECLASS_COUNT];
+    NL_Reference *refs;
+    NL_Value *values;
+    NL_Data *data;
+    NL_Data **members;
+    NL_DataTypeDefinition *definitions;
+    NL_DataTypeDefinitionField *fields;
+#ifdef NODESETLOADER_MEMORY_STATS
+    // bytes of the arrays per category, see MemoryUsage.h
+    size_t memory[NL_MEMORY_CATEGORY_COUNT];
+#endif
+};
+
+typedef struct
+{
+    const ImageHeader *header;
+    const char *sections[IMAGE_SECTION_COUNT];
+    NodesetImage *image;
+    // old and new indices of the namespaces
+    int *oldNsIdx;
+    int *newNsIdx;
+    size_t nsSize;
+    bool failed;
+} ImageReader;
+
+static const void *section(const ImageReader *r, ImageSection s, size_t idx)
+{
+    return r->sections[s] + idx * recordSizes[s];
+}
+
+// false if [first, first + size) is not in the section
+static bool inSection(ImageReader *r, ImageSection s, uint64_t first,
+                      uint64_t size)
+{
+    if (first > r->header->counts[s] || size > r->header->counts[s] - first)
+    {
+        r->failed = true;
+        return false;
+    }
+    return true;
+}
+
+static char *readString(ImageReader *r, uint32_t s)
+{
+    if (!s || !inSection(r, IMAGE_STRINGS, s - 1, 1))
+    {
+        return NULL;
+    }
+    // the strings are not modified, the mapping is read only
+    return (char *)(uintptr_t)(r->sections[IMAGE_STRINGS] + s - 1);
+}
+
+static int translateNs(const ImageReader *r, int nsIdx)
+{
+    if (!nsIdx)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < r->nsSize; i++)
+    {
+        if (r->oldNsIdx[i] == nsIdx)
+        {
+            return r->newNsIdx[i];
+        }
+    }
+    return nsIdx;
+}
+
+static NL_NodeId readId(ImageReader *r, const ImageNodeId *imageId)
+{
+    NL_NodeId id;
+    id.nsIdx = translateNs(r, imageId->nsIdx);
+    id.id = readString(r, imageId->id);
+    return id;
+}
+
+static void *allocate(ImageReader *r, ImageSection s, size_t size)
+{
+    if (!r->header->counts[s])
+    {
+        return NULL;
+    }
+    void *mem = calloc((size_t)r->header->counts[s], size);
+    if (!mem)
+    {
+        r->failed = true;
+    }
+    return mem;
+}
+
+// allocate for the arrays of the nodes, counted in category
+static void *allocateArray(ImageReader *r, ImageSection s, size_t size,
+                           NL_MemoryCategory category)
+{
+    void *mem = allocate(r, s, size);
+#ifdef NODESETLOADER_MEMORY_STATS
+    if (mem)
+    {
+        size_t bytes = (size_t)r->header->counts[s] * size;
+        r->image->memory[category] += bytes;
+        MEMORY_ALLOCATED(category, bytes);
+    }
+#endif
+    return mem;
+}
+
+static void readReference(ImageReader *r, NL_Reference *ref,
+                          const ImageReference *rec)
+{
+    ref->isForward = rec->isForward != 0;
+    ref->refType = readId(r, &rec->refType);
+    ref->target = readId(r, &rec->target);
+    ref->next = NULL;
+}
+
+static NL_Reference *linkReferences(ImageReader *r, uint32_t first,
+                                    uint32_t size)
+{
+    if (!size || !inSection(r, IMAGE_REFERENCES, first, size))
+    {
+        return NULL;
+    }
+    NL_Reference *refs = r->image->refs + first;
+    for (uint32_t i = 0; i + 1 < size; i++)
+    {
+        refs[i].next = &refs[i + 1];
+    }
+    refs[size - 1].next = NULL;
+    return refs;
+}
+
+static void readReferences(ImageReader *r)
+{
+    r->image->refs = (NL_Reference *)allocateArray(
+        r, IMAGE_REFERENCES, sizeof(NL_Reference), NL_MEMORY_REFERENCES);
+    for (size_t i = 0; i < r->header->counts[IMAGE_REFERENCES]; i++)
+    {
+        readReference(r, &r->image->refs[i],
+                      (const ImageReference *)section(r, IMAGE_REFERENCES, i));
+    }
+}
+
+static void readValues(ImageReader *r)
+{
+    NodesetImage *image = r->image;
+    image->data = (NL_Data *)allocateArray(r, IMAGE_DATA, sizeof(NL_Data),
+                                           NL_MEMORY_VALUES);
+    image->members = (NL_Data **)allocateArray(
+        r, IMAGE_MEMBERS, sizeof(NL_Data *), NL_MEMORY_VALUES);
+    image->values = (NL_Value *)allocateArray(r, IMAGE_VALUES, sizeof(NL_Value),
+                                              NL_MEMORY_VALUES);
+    if (r->failed)
+    {
+        return;
+    }
+    for (size_t i = 0; i < r->header->counts[IMAGE_MEMBERS]; i++)
+    {
+        uint32_t member = *(const uint32_t *)section(r, IMAGE_MEMBERS, i);
+        if (inSection(r, IMAGE_DATA, member, 1))
+        {
+            image->members[i] = &image->data[member];
+        }
+    }
+    for (size_t i = 0; i < r->header->counts[IMAGE_DATA]; i++)
+    {
+        const ImageData *rec = (const ImageData *)section(r, IMAGE_DATA, i);
+        NL_Data *data = &image->data[i];
+        data->name = readString(r, rec->name);
+        if (rec->parent && inSection(r, IMAGE_DATA, rec->parent - 1, 1))
+        {
+            data->parent = &image->data[rec->parent - 1];
+        }
+        if (rec->type == DATATYPE_PRIMITIVE)
+        {
+            data->type = DATATYPE_PRIMITIVE;
+            data->val.primitiveData.value = readString(r, rec->value);
+        }
+        else if (rec->type == DATATYPE_COMPLEX)
+        {
+            data->type = DATATYPE_COMPLEX;
+            data->val.complexData.membersSize = rec->membersSize;
+            if (rec->membersSize &&
+                inSection(r, IMAGE_MEMBERS, rec->members, rec->membersSize))
+            {
+                data->val.complexData.members = &image->members[rec->members];
+            }
+        }
+        else
+        {
+            r->failed = true;
+        }
+    }
+    for (size_t i = 0; i < r->header->counts[IMAGE_VALUES]; i++)
+    {
+        const ImageValue *rec = (const ImageValue *)section(r, IMAGE_VALUES, i);
+        NL_Value *value = &image->values[i];
+        value->isArray = rec->isArray != 0;
+        value->isExtensionObject = rec->isExtensionObject != 0;
+        value->type = readString(r, rec->type);
+        value->typeId = readId(r, &rec->typeId);
+        if (rec->data && inSection(r, IMAGE_DATA, rec->data - 1, 1))
+        {
+            value->data = &image->data[rec->data - 1];
+        }
+    }
+}
+
+static void readDefinitions(ImageReader *r)
+{
+    NodesetImage *image = r->image;
+    image->fields = (NL_DataTypeDefinitionField *)allocateArray(
+        r, IMAGE_FIELDS, sizeof(NL_DataTypeDefinitionField), NL_MEMORY_NODES);
+    image->definitions = (NL_DataTypeDefinition *)allocateArray(
+        r, IMAGE_DEFINITIONS, sizeof(NL_DataTypeDefinition), NL_MEMORY_NODES);
+    if (r->failed)
+    {
+        return;
+    }
+    for (size_t i = 0; i < r->header->counts[IMAGE_FIELDS]; i++)
+    {
+        const ImageField *rec = (const ImageField *)section(r, IMAGE_FIELDS, i);
+        NL_DataTypeDefinitionField *field = &image->fields[i];
+        field->name = readString(r, rec->name);
+        field->dataType = readId(r, &rec->dataType);
+        field->valueRank = rec->valueRank;
+        field->value = rec->value;
+        field->isOptional = rec->isOptional != 0;
+    }
+    for (size_t i = 0; i < r->header->counts[IMAGE_DEFINITIONS]; i++)
+    {
+        const ImageDefinition *rec =
+            (const ImageDefinition *)section(r, IMAGE_DEFINITIONS, i);
+        NL_DataTypeDefinition *definition = &image->definitions[i];
+        definition->fieldCnt = rec->fieldCnt;
+        definition->isEnum = rec->isEnum != 0;
+        definition->isUnion = rec->isUnion != 0;
+        definition->isOptionSet = rec->isOptionSet != 0;
+        if (rec->fieldCnt &&
+            inSection(r, IMAGE_FIELDS, rec->fields, rec->fieldCnt))
+        {
+            definition->fields = &image->fields[rec->fields];
+        }
+    }
+}
+
+static void readNode(ImageReader *r, NL_Node *node, const ImageNode *rec)
+{
+    const NodeLayout *layout = Node_layout((NL_NodeClass)rec->nodeClass);
+    char *base = (char *)node;
+    node->nodeClass = (NL_NodeClass)rec->nodeClass;
+    node->id = readId(r, &rec->id);
+    node->browseName.nsIdx =
+        (uint16_t)translateNs(r, (int)rec->browseNameNsIdx);
+    node->browseName.name = readString(r, rec->browseName);
+    node->displayName.locale = readString(r, rec->displayNameLocale);
+    node->displayName.text = readString(r, rec->displayNameText);
+    node->description.locale = readString(r, rec->descriptionLocale);
+    node->description.text = readString(r, rec->descriptionText);
+    node->writeMask = readString(r, rec->writeMask);
+    node->hierachicalRefs =
+        linkReferences(r, rec->hierachicalRefs, rec->hierachicalRefsSize);
+    node->nonHierachicalRefs = linkReferences(r, rec->nonHierachicalRefs,
+                                              rec->nonHierachicalRefsSize);
+    for (size_t i = 0; i < IMAGE_STRING_ATTRIBUTES && layout->strings[i]; i++)
+    {
+        *(char **)(void *)(base + layout->strings[i]) =
+            readString(r, rec->strings[i]);
+    }
+    if (layout->parentNodeId)
+    {
+        *(NL_NodeId *)(void *)(base + layout->parentNodeId) =
+            readId(r, &rec->parentNodeId);
+    }
+    if (layout->dataType)
+    {
+        *(NL_NodeId *)(void *)(base + layout->dataType) =
+            readId(r, &rec->dataType);
+    }
+    if (layout->refToTypeDef && rec->refToTypeDef)
+    {
+        *(NL_Reference **)(void *)(base + layout->refToTypeDef) =
+            linkReferences(r, rec->refToTypeDef - 1, 1);
+    }
+    if (node->nodeClass == NODECLASS_VARIABLE && rec->value &&
+        inSection(r, IMAGE_VALUES, rec->value - 1, 1))
+    {
+        ((NL_VariableNode *)node)->value = &r->image->values[rec->value - 1];
+    }
+    if (node->nodeClass == NODECLASS_DATATYPE && rec->definition &&
+        inSection(r, IMAGE_DEFINITIONS, rec->definition - 1, 1))
+    {
+        ((NL_DataTypeNode *)node)->definition =
+            &r->image->definitions[rec->definition - 1];
+    }
+    Node_decodeAttributes(node);
+}
+
+static void readNodes(ImageReader *r)
+{
+    size_t counts[NL_NODECLASS_COUNT] = {0};
+    for (int c = 0; c < NL_NODECLASS_COUNT && !r->failed; c++)
+    {
+        size_t count = r->header->nodeCounts[c];
+        if (count)
+        {
+            r->image->nodes[c] =
+                (char *)calloc(count, Node_size((NL_NodeClass)c));
+            r->failed = !r->image->nodes[c];
+#ifdef NODESETLOADER_MEMORY_STATS
+            if (!r->failed)
+            {
+                size_t bytes = count * Node_size((NL_NodeClass)c);
+                r->image->memory[NL_MEMORY_NODES] += bytes;
+                MEMORY_ALLOCATED(NL_MEMORY_NODES, bytes);
+            }
+#endif
+        }
+    }
+    for (size_t i = 0; i < r->header->counts[IMAGE_NODES] && !r->failed; i++)
+    {
+        const ImageNode *rec = (const ImageNode *)section(r, IMAGE_NODES, i);
+        if (rec->nodeClass >= NL_NODECLASS_COUNT ||
+            counts[rec->nodeClass] >= r->header->nodeCounts[rec->nodeClass])
+        {
+            r->failed = true;
+            break;
+        }
+        NL_NodeClass nodeClass = (NL_NodeClass)rec->nodeClass;
+        NL_Node *node =
+            (NL_Node *)(void *)(r->image->nodes[nodeClass] +
+                                counts[nodeClass]++ * Node_size(nodeClass));
+        readNode(r, node, rec);
+    }
+}
+
+// the namespaces are added first, all node ids are translated to the new
+// indices
+static void readNamespaces(ImageReader *r, Nodeset *nodeset, void *userContext)
+{
+    size_t size = (size_t)r->header->counts[IMAGE_NAMESPACES];
+    r->oldNsIdx = (int *)allocate(r, IMAGE_NAMESPACES, sizeof(int));
+    r->newNsIdx = (int *)allocate(r, IMAGE_NAMESPACES, sizeof(int));
+    for (size_t i = 0; i < size && !r->failed; i++)
+    {
+        const ImageNamespace *rec =
+            (const ImageNamespace *)section(r, IMAGE_NAMESPACES, i);
+        // the uri is NULL if it was not text in the nodeset
+        const Namespace *ns = NamespaceList_newNamespace(
+            nodeset->namespaces, userContext, readString(r, rec->uri));
+        if (!ns)
+        {
+            r->failed = true;
+            break;
+        }
+        r->oldNsIdx[r->nsSize] = rec->idx;
+        r->newNsIdx[r->nsSize] = ns->idx;
+        r->nsSize++;
+    }
+}
+
+static void readAliases(ImageReader *r, Nodeset *nodeset)
+{
+    for (size_t i = 0; i < r->header->counts[IMAGE_ALIASES] && !r->failed; i++)
+    {
+        const ImageAlias *rec =
+            (const ImageAlias *)section(r, IMAGE_ALIASES, i);
+        Alias *alias =
+            AliasList_newAlias(nodeset->aliasList, readString(r, rec->name));
+        if (!alias || !alias->name)
+        {
+            r->failed = true;
+            break;
+        }
+        alias->id = readId(r, &rec->id);
+    }
+}
+
+static void readEncodingRefs(ImageReader *r, Nodeset *nodeset)
+{
+    NL_BiDirectionalReference **last = &nodeset->hasEncodingRefs;
+    for (size_t i = 0;
+         i < r->header->counts[IMAGE_ENCODING_REFERENCES] && !r->failed; i++)
+    {
+        const ImageEncodingReference *rec =
+            (const ImageEncodingReference *)section(
+                r, IMAGE_ENCODING_REFERENCES, i);
+        // freed with the other references of the nodeset
+        NL_BiDirectionalReference *ref = (NL_BiDirectionalReference *)calloc(
+            1, sizeof(NL_BiDirectionalReference));
+        if (!ref)
+        {
+            r->failed = true;
+            break;
+        }
+        MEMORY_ALLOCATED(NL_MEMORY_ENCODING_REFS,
+                         sizeof(NL_BiDirectionalReference));
+        ref->source = readId(r, &rec->source);
+        ref->target = readId(r, &rec->target);
+        ref->refType = readId(r, &rec->refType);
+        *last = ref;
+        last = &ref->next;
+    }
+}
+
+static bool checkHeader(ImageReader *r, const FileMapping *mapping)
+{
+    const ImageHeader *header = (const ImageHeader *)(const void *)mapping->data;
+    if (mapping->size < sizeof(ImageHeader) ||
+        memcmp(header->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) ||
+        header->version != IMAGE_VERSION ||
+        header->byteOrder != IMAGE_BYTE_ORDER || header->size != mapping->size)
+    {
+        return false;
+    }
+    uint64_t nodes = 0;
+    for (int c = 0; c < NL_NODECLASS_COUNT; c++)
+    {
+        nodes += header->nodeCounts[c];
+    }
+    if (nodes != header->counts[IMAGE_NODES])
+    {
+        return false;
+    }
+    for (int i = 0; i < IMAGE_SECTION_COUNT; i++)
+    {
+        uint64_t offset = header->offsets[i];
+        if (offset % IMAGE_ALIGNMENT || offset > mapping->size ||
+            header->counts[i] > (mapping->size - offset) / recordSizes[i])
+        {
+            return false;
+        }
+        r->sections[i] = mapping->data + offset;
+    }
+    // every string ends within the section
+    uint64_t stringsSize = header->counts[IMAGE_STRINGS];
+    if (stringsSize && r->sections[IMAGE_STRINGS][stringsSize - 1])
+    {
+        return false;
+    }
+    r->header = header;
+    return true;
+}
+
+// the nodes are sorted already, they are added in the order of the image
+static void addNodes(const NodesetImage *image, const ImageHeader *header,
+                     Nodeset *nodeset)
+{
+    for (int c = 0; c < NL_NODECLASS_COUNT; c++)
+    {
+        size_t size = Node_size((NL_NodeClass)c);
+        NodeContainer *container = nodeset->nodes[c];
+        for (size_t i = 0; i < header->nodeCounts[c]; i++)
+        {
+            NL_Node *node = (NL_Node *)(void *)(image->nodes[c] + i * size);
+            NodeContainer_add(container, node);
+            if (c == NODECLASS_REFERENCETYPE)
+            {
+                nodeset->refService->addNewReferenceType(
+                    nodeset->refService->context,
+                    (NL_ReferenceTypeNode *)node);
+            }
+        }
+        container->borrowed = container->size;
+    }
+}
+
+NodesetImage *NodesetImage_load(Nodeset *nodeset, FileMapping *mapping,
+                                void *userContext)
+{
+    ImageReader r;
+    memset(&r, 0, sizeof(r));
+    r.image = (NodesetImage *)calloc(1, sizeof(NodesetImage));
+    if (!r.image)
+    {
+        FileMapping_delete(mapping);
+        return NULL;
+    }
+    r.image->mapping = mapping;
+    if (!checkHeader(&r, mapping))
+    {
+        NodesetImage_delete(r.image);
+        return NULL;
+    }
+    readNamespaces(&r, nodeset, userContext);
+    if (!r.failed)
+    {
+        readReferences(&r);
+    }
+    if (!r.failed)
+    {
+        readValues(&r);
+    }
+    if (!r.failed)
+    {
+        readDefinitions(&r);
+    }
+    if (!r.failed)
+    {
+        readNodes(&r);
+    }
+    readAliases(&r, nodeset);
+    readEncodingRefs(&r, nodeset);
+    free(r.oldNsIdx);
+    free(r.newNsIdx);
+    if (r.failed)
+    {
+        NodesetImage_delete(r.image);
+        return NULL;
+    }
+    addNodes(r.image, r.header, nodeset);
+    return r.image;
+}
+
+void NodesetImage_delete(NodesetImage *image)
+{
+    if (!image)
+    {
+        return;
+    }
+    for (int c = 0; c < NL_NODECLASS_COUNT; c++)
+    {
+        free(image->nodes[c]);
+    }
+    free(image->refs);
+    free(image->values);
+    free(image->data);
+    free(image->members);
+    free(image->definitions);
+    free(image->fields);
+    FileMapping_delete(image->mapping);
+#ifdef NODESETLOADER_MEMORY_STATS
+    for (int c = 0; c < NL_MEMORY_CATEGORY_COUNT; c++)
+    {
+        MEMORY_FREED((NL_MemoryCategory)c, image->memory[c]);
+    }
+#endif
+    free(image);
+}
+
+uint32_t NodesetImage_version(void)
+{
+    return IMAGE_VERSION;
+}
@@ -0,0 +1,47 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef NODESETIMAGE_H
+#define NODESETIMAGE_H
+#include "FileMapping.h"
+#include "Nodeset.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// a sorted nodeset in a flat binary file, all pointers are stored as offsets
+// or indices, so the file can be mapped and the nodes are built up without
+// parsing any xml
+// the image is only valid for the byte order and the image version it was
+// written with
+struct NodesetImage;
+typedef struct NodesetImage NodesetImage;
+
+// the image of a nodeset in memory, it doesn't refer to the nodeset
+struct NodesetImageBuffer;
+typedef struct NodesetImageBuffer NodesetImageBuffer;
+
+// writes the nodes, references, values, aliases, namespaces and hasEncoding
+// references of a sorted nodeset
+bool NodesetImage_write(const Nodeset *nodeset, FILE *file);
+// NodesetImage_write in two steps, the buffer can be written on another
+// thread while the nodeset is changed, returns NULL if the nodeset cannot be
+// written
+NodesetImageBuffer *NodesetImage_serialize(const Nodeset *nodeset);
+bool NodesetImage_writeBuffer(const NodesetImageBuffer *buffer, FILE *file);
+void NodesetImage_deleteBuffer(NodesetImageBuffer *buffer);
+// builds up the nodes of the image in an empty nodeset, the namespaces of the
+// image are added with the namespace callback of the nodeset and the node ids
+// are translated to the new indices
+// the image takes the mapping, the strings of the nodes point into it
+// returns NULL and deletes the mapping if the image is not valid, the
+// nodeset has to be cleaned up in this case
+NodesetImage *NodesetImage_load(Nodeset *nodeset, FileMapping *mapping,
+                                void *userContext);
+// frees the nodes of the image, called by Nodeset_cleanup
+void NodesetImage_delete(NodesetImage *image);
+// changes with the layout of the image, part of the keys of cached images
+uint32_t NodesetImage_version(void);
+#endif
@@ -5,44 +5,36 @@
  *    Copyright 2019 (c) Matthias Konnerth
  */
 
+#include "Clock.h"
+#include "DocumentSplit.h"
+#include "ElementToken.h"
+#include "FileMapping.h"
+#include "ImageCache.h"
+#include "InputStream.h"
 #include "InternalLogger.h"
 #include "InternalRefService.h"
 #include "Nodeset.h"
+#include "NodesetImage.h"
 #include "Parser.h"
+#include "Thread.h"
 #include "Value.h"
+#include "nodes/Node.h"
 #include <CharAllocator.h>
 #include <NodesetLoader/Logger.h>
 #include <NodesetLoader/NodesetLoader.h>
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define OBJECT "UAObject"
-#define METHOD "UAMethod"
-#define OBJECTTYPE "UAObjectType"
-#define VARIABLE "UAVariable"
-#define VARIABLETYPE "UAVariableType"
-#define DATATYPE "UADataType"
-#define REFERENCETYPE "UAReferenceType"
-#define VIEW "UAView"
-#define DISPLAYNAME "DisplayName"
-#define REFERENCES "References"
-#define REFERENCE "Reference"
-#define DESCRIPTION "Description"
-#define ALIAS "Alias"
-#define NAMESPACEURIS "NamespaceUris"
-#define NAMESPACEURI "Uri"
-#define VALUE "Value"
-#define EXTENSIONS "Extensions"
-#define EXTENSION "Extension"
-#define INVERSENAME "InverseName"
-
 const char *NL_NODECLASS_NAME[NL_NODECLASS_COUNT] = {
     "Object", "ObjectType",    "Variable",    "DataType",
     "Method", "ReferenceType", "VariableType", "View"};
 
 typedef enum
 {
+    // first entry: missing entries of the transition tables skip the element
+    PARSER_STATE_UNKNOWN,
     PARSER_STATE_INIT,
     PARSER_STATE_NODE,
     PARSER_STATE_DISPLAYNAME,
@@ -51,14 +43,14 @@ typedef enum
     PARSER_STATE_DESCRIPTION,
     PARSER_STATE_INVERSENAME,
     PARSER_STATE_ALIAS,
-    PARSER_STATE_UNKNOWN,
     PARSER_STATE_NAMESPACEURIS,
     PARSER_STATE_URI,
     PARSER_STATE_VALUE,
     PARSER_STATE_EXTENSION,
     PARSER_STATE_EXTENSIONS,
     PARSER_STATE_DATATYPE_DEFINITION,
-    PARSER_STATE_DATATYPE_DEFINITION_FIELD
+    PARSER_STATE_DATATYPE_DEFINITION_FIELD,
+    PARSER_STATE_COUNT
 } TParserState;
 
 struct TParserCtx
@@ -73,10 +65,16 @@ struct TParserCtx
     char *onCharacters;
     size_t onCharLength;
     NL_Value *val;
+    // NL_PARSER_OPTION_LAZY_VALUES
+    bool lazyValues;
     void *extensionData;
     NodesetLoader_ExtensionInterface *extIf;
+    NL_nodeFilterCallback filterNode;
     NL_Reference *ref;
     Nodeset *nodeset;
+    // only set for the parse on the importing thread
+    NodesetLoader *loader;
+    NL_progressCallback progress;
 };
 
 struct NodesetLoader
@@ -86,7 +84,58 @@ struct NodesetLoader
     bool internalLogger;
     NL_ReferenceService *refService;
     bool internalRefService;
+    // reused for all files of this loader
+    Parser *parser;
+    int parserOptions;
+    size_t parseThreads;
+    NL_ImportTiming *timings;
+    size_t timingsSize;
+    // NodesetLoader_setCacheDir
+    char *cacheDir;
+    // all nodes come from files of NodesetLoader_importFile(s), cacheKey is
+    // the key of their image
+    bool cacheable;
+    uint64_t cacheKey;
+    // files were parsed, their image is written after sorting
+    bool cacheMiss;
+    struct PendingFile *pending;
+    size_t pendingSize;
+    size_t importCalls;
+    // a pending file could not be imported, the nodes of the loader are
+    // incomplete
+    bool pendingFailed;
+    ImageCacheWriter *cacheWriter;
+    // NodesetLoader_setNodeStream
+    NodesetLoader_forEachNode_Func streamCallback;
+    void *streamContext;
+    // NodesetLoader_setMemoryBudget
+    size_t memoryBudget;
+    // the progress callback of the last imported file, used for the sort
+    NL_progressCallback progress;
+    void *progressContext;
+    // the progress callback returned false, see discardNodes
+    bool cancelled;
+    // the timings of the loader, see NodesetLoader_getStats
+    NL_Stats stats;
+};
+
+// a file which is hashed but not imported yet, see loadPending
+struct PendingFile
+{
+    // the file is a copy
+    NL_FileContext context;
+    // key of the nodes up to this file
+    uint64_t key;
+    // the files of one NodesetLoader_importFiles call are imported together
+    size_t call;
 };
+typedef struct PendingFile PendingFile;
+
+static bool loadPending(NodesetLoader *loader);
+static void clearPending(NodesetLoader *loader);
+
+// smaller parts are not worth a thread
+#define PARALLEL_MIN_RANGE_SIZE (256 * 1024)
 
 static void enterUnknownState(TParserCtx *ctx)
 {
@@ -95,6 +144,245 @@ static void enterUnknownState(TParserCtx *ctx)
     ctx->unknown_depth = 1;
 }
 
+typedef void (*StartAction)(TParserCtx *ctx, int nb_attributes,
+                            const char **attributes);
+typedef void (*EndAction)(TParserCtx *ctx);
+
+struct StartTransition
+{
+    TParserState next;
+    StartAction action;
+    // only used for transitions to PARSER_STATE_NODE
+    NL_NodeClass nodeClass;
+};
+
+struct EndTransition
+{
+    TParserState next;
+    EndAction action;
+};
+
+static void startNode(TParserCtx *ctx, int nb_attributes,
+                      const char **attributes);
+static void startAlias(TParserCtx *ctx, int nb_attributes,
+                       const char **attributes);
+static void startDisplayName(TParserCtx *ctx, int nb_attributes,
+                             const char **attributes);
+static void startDescription(TParserCtx *ctx, int nb_attributes,
+                             const char **attributes);
+static void startInverseName(TParserCtx *ctx, int nb_attributes,
+                             const char **attributes);
+static void startValue(TParserCtx *ctx, int nb_attributes,
+                       const char **attributes);
+static void startDefinition(TParserCtx *ctx, int nb_attributes,
+                            const char **attributes);
+static void startField(TParserCtx *ctx, int nb_attributes,
+                       const char **attributes);
+static void startExtension(TParserCtx *ctx, int nb_attributes,
+                           const char **attributes);
+static void startReference(TParserCtx *ctx, int nb_attributes,
+                           const char **attributes);
+static void finishAlias(TParserCtx *ctx);
+static void finishNamespace(TParserCtx *ctx);
+static void finishNode(TParserCtx *ctx);
+static void finishDisplayName(TParserCtx *ctx);
+static void finishReference(TParserCtx *ctx);
+static void finishDescription(TParserCtx *ctx);
+static void finishInverseName(TParserCtx *ctx);
+
+#define NODE_TRANSITION(nodeClass)                                             \
+    {                                                                          \
+        PARSER_STATE_NODE, startNode, nodeClass                               \
+    }
+#define START_TRANSITION(state, action)                                        \
+    {                                                                          \
+        state, action, NODECLASS_OBJECT                                        \
+    }
+
+// (state, element) -> next state, all other elements are skipped
+static const struct StartTransition
+    startTransitions[PARSER_STATE_COUNT][TOKEN_COUNT] = {
+        [PARSER_STATE_INIT] =
+            {
+                [TOKEN_UAVARIABLE] = NODE_TRANSITION(NODECLASS_VARIABLE),
+                [TOKEN_UAOBJECT] = NODE_TRANSITION(NODECLASS_OBJECT),
+                [TOKEN_UAOBJECTTYPE] = NODE_TRANSITION(NODECLASS_OBJECTTYPE),
+                [TOKEN_UADATATYPE] = NODE_TRANSITION(NODECLASS_DATATYPE),
+                [TOKEN_UAMETHOD] = NODE_TRANSITION(NODECLASS_METHOD),
+                [TOKEN_UAREFERENCETYPE] =
+                    NODE_TRANSITION(NODECLASS_REFERENCETYPE),
+                [TOKEN_UAVARIABLETYPE] =
+                    NODE_TRANSITION(NODECLASS_VARIABLETYPE),
+                [TOKEN_UAVIEW] = NODE_TRANSITION(NODECLASS_VIEW),
+                [TOKEN_NAMESPACEURIS] =
+                    START_TRANSITION(PARSER_STATE_NAMESPACEURIS, NULL),
+                [TOKEN_ALIAS] = START_TRANSITION(PARSER_STATE_ALIAS, startAlias),
+                [TOKEN_UANODESET] = START_TRANSITION(PARSER_STATE_INIT, NULL),
+                [TOKEN_ALIASES] = START_TRANSITION(PARSER_STATE_INIT, NULL),
+                [TOKEN_EXTENSIONS] = START_TRANSITION(PARSER_STATE_INIT, NULL),
+            },
+        [PARSER_STATE_NAMESPACEURIS] =
+            {
+                [TOKEN_URI] = START_TRANSITION(PARSER_STATE_URI, NULL),
+            },
+        [PARSER_STATE_NODE] =
+            {
+                [TOKEN_DISPLAYNAME] = START_TRANSITION(
+                    PARSER_STATE_DISPLAYNAME, startDisplayName),
+                [TOKEN_REFERENCES] =
+                    START_TRANSITION(PARSER_STATE_REFERENCES, NULL),
+                [TOKEN_DESCRIPTION] = START_TRANSITION(
+                    PARSER_STATE_DESCRIPTION, startDescription),
+                [TOKEN_VALUE] =
+                    START_TRANSITION(PARSER_STATE_VALUE, startValue),
+                [TOKEN_EXTENSIONS] =
+                    START_TRANSITION(PARSER_STATE_EXTENSIONS, NULL),
+                [TOKEN_DEFINITION] = START_TRANSITION(
+                    PARSER_STATE_DATATYPE_DEFINITION, startDefinition),
+                [TOKEN_INVERSENAME] = START_TRANSITION(
+                    PARSER_STATE_INVERSENAME, startInverseName),
+            },
+        [PARSER_STATE_DATATYPE_DEFINITION] =
+            {
+                [TOKEN_FIELD] = START_TRANSITION(
+                    PARSER_STATE_DATATYPE_DEFINITION_FIELD, startField),
+            },
+        [PARSER_STATE_EXTENSIONS] =
+            {
+                [TOKEN_EXTENSION] =
+                    START_TRANSITION(PARSER_STATE_EXTENSION, startExtension),
+            },
+        [PARSER_STATE_REFERENCES] =
+            {
+                [TOKEN_REFERENCE] =
+                    START_TRANSITION(PARSER_STATE_REFERENCE, startReference),
+            },
+};
+
+// the end of an element only depends on the state, value, extension and
+// unknown elements are handled separately
+static const struct EndTransition endTransitions[PARSER_STATE_COUNT] = {
+    [PARSER_STATE_INIT] = {PARSER_STATE_INIT, NULL},
+    [PARSER_STATE_ALIAS] = {PARSER_STATE_INIT, finishAlias},
+    [PARSER_STATE_URI] = {PARSER_STATE_NAMESPACEURIS, finishNamespace},
+    [PARSER_STATE_NAMESPACEURIS] = {PARSER_STATE_INIT, NULL},
+    [PARSER_STATE_NODE] = {PARSER_STATE_INIT, finishNode},
+    [PARSER_STATE_DISPLAYNAME] = {PARSER_STATE_NODE, finishDisplayName},
+    [PARSER_STATE_REFERENCES] = {PARSER_STATE_NODE, NULL},
+    [PARSER_STATE_REFERENCE] = {PARSER_STATE_REFERENCES, finishReference},
+    [PARSER_STATE_EXTENSIONS] = {PARSER_STATE_NODE, NULL},
+    [PARSER_STATE_DESCRIPTION] = {PARSER_STATE_NODE, finishDescription},
+    [PARSER_STATE_INVERSENAME] = {PARSER_STATE_NODE, finishInverseName},
+    [PARSER_STATE_DATATYPE_DEFINITION] = {PARSER_STATE_NODE, NULL},
+    [PARSER_STATE_DATATYPE_DEFINITION_FIELD] = {
+        PARSER_STATE_DATATYPE_DEFINITION, NULL},
+};
+
+static void startNode(TParserCtx *ctx, int nb_attributes,
+                      const char **attributes)
+{
+    ctx->node = Nodeset_newNode(ctx->nodeset, ctx->nodeClass, nb_attributes,
+                                attributes);
+}
+
+static void startAlias(TParserCtx *ctx, int nb_attributes,
+                       const char **attributes)
+{
+    ctx->node = NULL;
+    ctx->alias = Nodeset_newAlias(ctx->nodeset, nb_attributes, attributes);
+}
+
+static void startDisplayName(TParserCtx *ctx, int nb_attributes,
+                             const char **attributes)
+{
+    Nodeset_setDisplayName(ctx->nodeset, ctx->node, nb_attributes, attributes);
+}
+
+static void startDescription(TParserCtx *ctx, int nb_attributes,
+                             const char **attributes)
+{
+    Nodeset_setDescription(ctx->nodeset, ctx->node, nb_attributes, attributes);
+}
+
+static void startInverseName(TParserCtx *ctx, int nb_attributes,
+                             const char **attributes)
+{
+    Nodeset_setInverseName(ctx->nodeset, ctx->node, nb_attributes, attributes);
+}
+
+static void startValue(TParserCtx *ctx, int nb_attributes,
+                       const char **attributes)
+{
+    ctx->val = Value_new(ctx->node);
+}
+
+static void startDefinition(TParserCtx *ctx, int nb_attributes,
+                            const char **attributes)
+{
+    Nodeset_addDataTypeDefinition(ctx->nodeset, ctx->node, nb_attributes,
+                                  attributes);
+}
+
+static void startField(TParserCtx *ctx, int nb_attributes,
+                       const char **attributes)
+{
+    Nodeset_addDataTypeField(ctx->nodeset, ctx->node, nb_attributes,
+                             attributes);
+}
+
+static void startExtension(TParserCtx *ctx, int nb_attributes,
+                           const char **attributes)
+{
+    if (ctx->extIf)
+    {
+        ctx->extensionData = ctx->extIf->newExtension();
+    }
+}
+
+static void startReference(TParserCtx *ctx, int nb_attributes,
+                           const char **attributes)
+{
+    ctx->ref =
+        Nodeset_newReference(ctx->nodeset, ctx->node, nb_attributes, attributes);
+}
+
+static void finishAlias(TParserCtx *ctx)
+{
+    Nodeset_newAliasFinish(ctx->nodeset, ctx->alias, ctx->onCharacters);
+}
+
+static void finishNamespace(TParserCtx *ctx)
+{
+    Nodeset_newNamespaceFinish(ctx->nodeset, ctx->userContext,
+                               ctx->onCharacters);
+}
+
+static void finishNode(TParserCtx *ctx)
+{
+    Nodeset_newNodeFinish(ctx->nodeset, ctx->node);
+}
+
+static void finishDisplayName(TParserCtx *ctx)
+{
+    Nodeset_DisplayNameFinish(ctx->nodeset, ctx->node, ctx->onCharacters);
+}
+
+static void finishReference(TParserCtx *ctx)
+{
+    Nodeset_newReferenceFinish(ctx->nodeset, ctx->ref, ctx->node,
+                               ctx->onCharacters);
+}
+
+static void finishDescription(TParserCtx *ctx)
+{
+    Nodeset_DescriptionFinish(ctx->nodeset, ctx->node, ctx->onCharacters);
+}
+
+static void finishInverseName(TParserCtx *ctx)
+{
+    Nodeset_InverseNameFinish(ctx->nodeset, ctx->node, ctx->onCharacters);
+}
+
 static void OnStartElementNs(void *ctx, const char *localname,
                              const char *prefix, const char *URI,
                              int nb_namespaces, const char **namespaces,
@@ -102,223 +390,60 @@ static void OnStartElementNs(void *ctx, const char *localname,
                              const char **attributes)
 {
     TParserCtx *pctx = (TParserCtx *)ctx;
-    switch (pctx->state)
+    if (pctx->state == PARSER_STATE_UNKNOWN)
     {
-    case PARSER_STATE_INIT:
-        if (!strcmp(localname, VARIABLE))
-        {
-            pctx->nodeClass = NODECLASS_VARIABLE;
-            pctx->node = Nodeset_newNode(pctx->nodeset, pctx->nodeClass,
-                                         nb_attributes, attributes);
-            pctx->state = PARSER_STATE_NODE;
-        }
-        else if (!strcmp(localname, OBJECT))
-        {
-            pctx->nodeClass = NODECLASS_OBJECT;
-            pctx->node = Nodeset_newNode(pctx->nodeset, pctx->nodeClass,
-                                         nb_attributes, attributes);
-            pctx->state = PARSER_STATE_NODE;
-        }
-        else if (!strcmp(localname, OBJECTTYPE))
-        {
-            pctx->nodeClass = NODECLASS_OBJECTTYPE;
-            pctx->node = Nodeset_newNode(pctx->nodeset, pctx->nodeClass,
-                                         nb_attributes, attributes);
-            pctx->state = PARSER_STATE_NODE;
-        }
-        else if (!strcmp(localname, DATATYPE))
-        {
-            pctx->nodeClass = NODECLASS_DATATYPE;
-            pctx->node = Nodeset_newNode(pctx->nodeset, pctx->nodeClass,
-                                         nb_attributes, attributes);
-            pctx->state = PARSER_STATE_NODE;
-        }
-        else if (!strcmp(localname, METHOD))
-        {
-            pctx->nodeClass = NODECLASS_METHOD;
-            pctx->node = Nodeset_newNode(pctx->nodeset, pctx->nodeClass,
-                                         nb_attributes, attributes);
-            pctx->state = PARSER_STATE_NODE;
-        }
-        else if (!strcmp(localname, REFERENCETYPE))
-        {
-            pctx->nodeClass = NODECLASS_REFERENCETYPE;
-            pctx->node = Nodeset_newNode(pctx->nodeset, pctx->nodeClass,
-                                         nb_attributes, attributes);
-            pctx->state = PARSER_STATE_NODE;
-        }
-        else if (!strcmp(localname, VARIABLETYPE))
-        {
-            pctx->nodeClass = NODECLASS_VARIABLETYPE;
-            pctx->node = Nodeset_newNode(pctx->nodeset, pctx->nodeClass,
-                                         nb_attributes, attributes);
-            pctx->state = PARSER_STATE_NODE;
-        }
-        else if (!strcmp(localname, VIEW))
-        {
-            pctx->nodeClass = NODECLASS_VIEW;
-            pctx->node = Nodeset_newNode(pctx->nodeset, pctx->nodeClass,
-                                         nb_attributes, attributes);
-            pctx->state = PARSER_STATE_NODE;
-        }
-        else if (!strcmp(localname, NAMESPACEURIS))
-        {
-            pctx->state = PARSER_STATE_NAMESPACEURIS;
-        }
-        else if (!strcmp(localname, ALIAS))
-        {
-            pctx->state = PARSER_STATE_ALIAS;
-            pctx->node = NULL;
-            pctx->alias =
-                Nodeset_newAlias(pctx->nodeset, nb_attributes, attributes);
-            pctx->state = PARSER_STATE_ALIAS;
-        }
-        else if (!strcmp(localname, "UANodeSet") ||
-                 !strcmp(localname, "Aliases") ||
-                 !strcmp(localname, "Extensions"))
-        {
-            pctx->state = PARSER_STATE_INIT;
-        }
-        else
-        {
-            enterUnknownState(pctx);
-        }
-        break;
-    case PARSER_STATE_NAMESPACEURIS:
-        if (!strcmp(localname, NAMESPACEURI))
-        {
-            pctx->state = PARSER_STATE_URI;
-        }
-        else
-        {
-            enterUnknownState(pctx);
-        }
-        break;
-    case PARSER_STATE_URI:
-        enterUnknownState(pctx);
-        break;
-    case PARSER_STATE_NODE:
-        if (!strcmp(localname, DISPLAYNAME))
-        {
-            Nodeset_setDisplayName(pctx->nodeset, pctx->node, nb_attributes,
-                                   attributes);
-            pctx->state = PARSER_STATE_DISPLAYNAME;
-        }
-        else if (!strcmp(localname, REFERENCES))
-        {
-            pctx->state = PARSER_STATE_REFERENCES;
-        }
-        else if (!strcmp(localname, DESCRIPTION))
-        {
-            pctx->state = PARSER_STATE_DESCRIPTION;
-            Nodeset_setDescription(pctx->nodeset, pctx->node, nb_attributes,
-                                   attributes);
-        }
-        else if (!strcmp(localname, VALUE))
-        {
-            pctx->val = Value_new(pctx->node);
-            pctx->state = PARSER_STATE_VALUE;
-        }
-        else if (!strcmp(localname, EXTENSIONS))
-        {
-            pctx->state = PARSER_STATE_EXTENSIONS;
-        }
-        else if (!strcmp(localname, "Definition"))
-        {
-            Nodeset_addDataTypeDefinition(pctx->nodeset, pctx->node, nb_attributes,
-                                     attributes);
-            pctx->state = PARSER_STATE_DATATYPE_DEFINITION;
-        }
-        else if (!strcmp(localname, INVERSENAME))
-        {
-            pctx->state = PARSER_STATE_INVERSENAME;
-            Nodeset_setInverseName(pctx->nodeset, pctx->node, nb_attributes,
-                                   attributes);
-        }
-        else
-        {
-            enterUnknownState(pctx);
-        }
-        break;
-    case PARSER_STATE_DATATYPE_DEFINITION:
-        if (!strcmp(localname, "Field"))
+        pctx->unknown_depth++;
+    }
+    else if (pctx->state == PARSER_STATE_VALUE)
+    {
+        if (pctx->lazyValues)
         {
-            Nodeset_addDataTypeField(pctx->nodeset, pctx->node, nb_attributes,
-                                     attributes);
-            pctx->state = PARSER_STATE_DATATYPE_DEFINITION_FIELD;
+            Value_recordStart(pctx->val, pctx->nodeset->charArena, localname);
         }
         else
         {
-            enterUnknownState(pctx);
-        }
-        break;
-    case PARSER_STATE_DATATYPE_DEFINITION_FIELD:
-        enterUnknownState(pctx);
-        break;
-
-    case PARSER_STATE_VALUE:
-        // copy the name
-        {
+            // copy the name
             size_t len = strlen(localname);
             char *localNameCopy =
                 CharArenaAllocator_malloc(pctx->nodeset->charArena, len + 1);
             memcpy(localNameCopy, localname, len);
             Value_start(pctx->val, localNameCopy);
-            pctx->unknown_depth++;
-        }
-        break;
-
-    case PARSER_STATE_EXTENSIONS:
-        if (!strcmp(localname, EXTENSION))
-        {
-            if (pctx->extIf)
-            {
-                pctx->extensionData = pctx->extIf->newExtension();
-            }
-            pctx->state = PARSER_STATE_EXTENSION;
-        }
-        else
-        {
-            enterUnknownState(pctx);
         }
-        break;
-    case PARSER_STATE_EXTENSION:
+        pctx->unknown_depth++;
+    }
+    else if (pctx->state == PARSER_STATE_EXTENSION)
+    {
         if (pctx->extIf)
         {
-            pctx->extIf->start(pctx->extensionData, localname, nb_attributes, attributes);
+            pctx->extIf->start(pctx->extensionData, localname, nb_attributes,
+                               attributes);
         }
-        break;
-
-    case PARSER_STATE_REFERENCES:
-        if (!strcmp(localname, REFERENCE))
+    }
+    else
+    {
+        const struct StartTransition *t =
+            &startTransitions[pctx->state][ElementToken_lookup(localname)];
+        if (t->next == PARSER_STATE_UNKNOWN ||
+            (t->next == PARSER_STATE_NODE && pctx->filterNode &&
+             !Nodeset_filterNode(pctx->nodeset, t->nodeClass, nb_attributes,
+                                 attributes, pctx->filterNode,
+                                 pctx->userContext)))
         {
-            pctx->state = PARSER_STATE_REFERENCE;
-            pctx->ref = Nodeset_newReference(pctx->nodeset, pctx->node,
-                                             nb_attributes, attributes);
+            // also skipped nodes only pass through the unknown state
+            enterUnknownState(pctx);
         }
         else
         {
-            enterUnknownState(pctx);
+            if (t->next == PARSER_STATE_NODE)
+            {
+                pctx->nodeClass = t->nodeClass;
+            }
+            if (t->action)
+            {
+                t->action(pctx, nb_attributes, attributes);
+            }
+            pctx->state = t->next;
         }
-        break;
-    case PARSER_STATE_DESCRIPTION:
-        enterUnknownState(pctx);
-        break;
-    case PARSER_STATE_ALIAS:
-        enterUnknownState(pctx);
-        break;
-    case PARSER_STATE_DISPLAYNAME:
-        enterUnknownState(pctx);
-        break;
-    case PARSER_STATE_REFERENCE:
-        enterUnknownState(pctx);
-        break;
-    case PARSER_STATE_INVERSENAME:
-        enterUnknownState(pctx);
-        break;
-    case PARSER_STATE_UNKNOWN:
-        pctx->unknown_depth++;
-        break;    
     }
     pctx->onCharacters = NULL;
     pctx->onCharLength = 0;
@@ -328,57 +453,40 @@ static void OnEndElementNs(void *ctx, const char *localname, const char *prefix,
                            const char *URI)
 {
     TParserCtx *pctx = (TParserCtx *)ctx;
-    switch (pctx->state)
-    {
-    case PARSER_STATE_INIT:
-        break;
-    case PARSER_STATE_ALIAS:
-        Nodeset_newAliasFinish(pctx->nodeset, pctx->alias, pctx->onCharacters);
-        pctx->state = PARSER_STATE_INIT;
-        break;
-    case PARSER_STATE_URI:
-    {
-        Nodeset_newNamespaceFinish(pctx->nodeset, pctx->userContext,
-                                   pctx->onCharacters);
-        pctx->state = PARSER_STATE_NAMESPACEURIS;
-    }
-    break;
-    case PARSER_STATE_NAMESPACEURIS:
-        pctx->state = PARSER_STATE_INIT;
-        break;
-    case PARSER_STATE_NODE:
-        Nodeset_newNodeFinish(pctx->nodeset, pctx->node);
-        pctx->state = PARSER_STATE_INIT;
-        break;
-    case PARSER_STATE_DISPLAYNAME:
-        Nodeset_DisplayNameFinish(pctx->nodeset, pctx->node,
-                                  pctx->onCharacters);
-        pctx->state = PARSER_STATE_NODE;
-        break;
-    case PARSER_STATE_REFERENCES:
-        pctx->state = PARSER_STATE_NODE;
-        break;
-    case PARSER_STATE_REFERENCE:
-    {
-        Nodeset_newReferenceFinish(pctx->nodeset, pctx->ref, pctx->node,
-                                   pctx->onCharacters);
-        pctx->state = PARSER_STATE_REFERENCES;
-    }
-    break;
-    case PARSER_STATE_VALUE:
-        if (!strcmp(localname, VALUE) && pctx->unknown_depth == 0)
+    if (pctx->state == PARSER_STATE_UNKNOWN)
+    {
+        pctx->unknown_depth--;
+        if (pctx->unknown_depth == 0)
+        {
+            pctx->state = pctx->prev_state;
+        }
+    }
+    else if (pctx->state == PARSER_STATE_VALUE)
+    {
+        if (pctx->unknown_depth == 0 &&
+            ElementToken_lookup(localname) == TOKEN_VALUE)
         {
+            if (pctx->lazyValues)
+            {
+                Value_recordFinish(pctx->val, pctx->nodeset->charArena);
+            }
             ((NL_VariableNode *)pctx->node)->value = pctx->val;
             pctx->state = PARSER_STATE_NODE;
         }
+        else if (pctx->lazyValues)
+        {
+            Value_recordEnd(pctx->val, pctx->nodeset->charArena, localname);
+            pctx->unknown_depth--;
+        }
         else
         {
             Value_end(pctx->val, localname, pctx->onCharacters);
             pctx->unknown_depth--;
         }
-        break;
-    case PARSER_STATE_EXTENSION:
-        if (!strcmp(localname, EXTENSION))
+    }
+    else if (pctx->state == PARSER_STATE_EXTENSION)
+    {
+        if (ElementToken_lookup(localname) == TOKEN_EXTENSION)
         {
             if (pctx->extIf)
             {
@@ -387,40 +495,20 @@ static void OnEndElementNs(void *ctx, const char *localname, const char *prefix,
             }
             pctx->state = PARSER_STATE_EXTENSIONS;
         }
-        else
+        else if (pctx->extIf)
         {
-            if (pctx->extIf)
-            {
-                pctx->extIf->end(pctx->extensionData, localname,
-                                 pctx->onCharacters);
-            }
+            pctx->extIf->end(pctx->extensionData, localname,
+                             pctx->onCharacters);
         }
-        break;
-    case PARSER_STATE_EXTENSIONS:
-        pctx->state = PARSER_STATE_NODE;
-        break;
-    case PARSER_STATE_DESCRIPTION:
-        Nodeset_DescriptionFinish(pctx->nodeset, pctx->node,
-                                  pctx->onCharacters);
-        pctx->state = PARSER_STATE_NODE;
-        break;
-    case PARSER_STATE_INVERSENAME:
-        Nodeset_InverseNameFinish(pctx->nodeset, pctx->node,
-                                  pctx->onCharacters);
-        pctx->state = PARSER_STATE_NODE;
-        break;
-    case PARSER_STATE_DATATYPE_DEFINITION:
-        pctx->state = PARSER_STATE_NODE;
-        break;
-    case PARSER_STATE_DATATYPE_DEFINITION_FIELD:
-        pctx->state = PARSER_STATE_DATATYPE_DEFINITION;
-        break;
-    case PARSER_STATE_UNKNOWN:
-        pctx->unknown_depth--;
-        if (pctx->unknown_depth == 0)
+    }
+    else
+    {
+        const struct EndTransition *t = &endTransitions[pctx->state];
+        if (t->action)
         {
-            pctx->state = pctx->prev_state;
+            t->action(pctx);
         }
+        pctx->state = t->next;
     }
     pctx->onCharacters = NULL;
     pctx->onCharLength = 0;
@@ -429,6 +517,17 @@ static void OnEndElementNs(void *ctx, const char *localname, const char *prefix,
 static void OnCharacters(void *ctx, const char *ch, int len)
 {
     TParserCtx *pctx = (TParserCtx *)ctx;
+    // the text of skipped elements is never used
+    if (pctx->state == PARSER_STATE_UNKNOWN)
+    {
+        return;
+    }
+    if (pctx->lazyValues && pctx->state == PARSER_STATE_VALUE)
+    {
+        Value_recordCharacters(pctx->val, pctx->nodeset->charArena, ch,
+                               (size_t)len);
+        return;
+    }
     if (pctx->onCharacters == NULL)
     {
         char *newValue = CharArenaAllocator_malloc(pctx->nodeset->charArena,
@@ -444,8 +543,8 @@ static void OnCharacters(void *ctx, const char *ch, int len)
     pctx->onCharLength += (size_t)len;
 }
 
-bool NodesetLoader_importFile(NodesetLoader *loader,
-                              const NL_FileContext *fileHandler)
+static bool checkFileContext(NodesetLoader *loader,
+                             const NL_FileContext *fileHandler)
 {
     if (fileHandler == NULL)
     {
@@ -461,81 +560,1104 @@ bool NodesetLoader_importFile(NodesetLoader *loader,
                             "NodesetLoader: fileHandler->addNamespace missing");
         return false;
     }
-    bool status = true;
     if (!loader->nodeset)
     {
         loader->nodeset = Nodeset_new(fileHandler->addNamespace, loader->logger,
                                       loader->refService);
+        if (loader->nodeset &&
+            ((loader->streamCallback &&
+              !Nodeset_setStream(loader->nodeset, loader->streamContext,
+                                 loader->streamCallback)) ||
+             !Nodeset_setMemoryBudget(loader->nodeset, loader->memoryBudget)))
+        {
+            Nodeset_cleanup(loader->nodeset);
+            loader->nodeset = NULL;
+        }
     }
+    loader->progress = fileHandler->progress;
+    loader->progressContext = fileHandler->userContext;
+    return loader->nodeset != NULL;
+}
 
-    TParserCtx *ctx = NULL;
-    FILE *f = fopen(fileHandler->file, "r");
-
-    if (!f)
+// false if the callback cancels the import
+static bool report(NodesetLoader *loader, NL_progressCallback progress,
+                   void *userContext, NL_ProgressPhase phase, size_t bytes,
+                   size_t nodes)
+{
+    NL_Progress state = {phase, bytes, nodes};
+    if (!loader->cancelled && !progress(userContext, &state))
     {
-        loader->logger->log(loader->logger->context,
-                            NODESETLOADER_LOGLEVEL_ERROR,
-                            "NodesetLoader: file open error");
-        status = false;
-        goto cleanup;
+        loader->cancelled = true;
     }
+    return !loader->cancelled;
+}
 
-    ctx = (TParserCtx *)calloc(1, sizeof(TParserCtx));
-    if (!ctx)
+static bool reportParse(void *context, size_t bytes)
+{
+    TParserCtx *ctx = (TParserCtx *)context;
+    if (!ctx->progress)
     {
-        status = false;
-        goto cleanup;
+        return true;
     }
-    ctx->nodeset = loader->nodeset;
-    ctx->state = PARSER_STATE_INIT;
-    ctx->prev_state = PARSER_STATE_INIT;
-    ctx->unknown_depth = 0;
-    ctx->onCharacters = NULL;
-    ctx->onCharLength = 0;
-    ctx->userContext = fileHandler->userContext;
-    ctx->extIf = fileHandler->extensionHandling;
-
-    Parser *parser = Parser_new(ctx);
-    if (Parser_run(parser, f, OnStartElementNs, OnEndElementNs, OnCharacters))
+    // the nodes of a file staging nodeset are merged at the end of the file
+    size_t nodes = Nodeset_nodeCount(ctx->nodeset);
+    if (ctx->nodeset != ctx->loader->nodeset)
     {
-        loader->logger->log(loader->logger->context,
-                            NODESETLOADER_LOGLEVEL_ERROR, "xml parsing error");
-        status = false;
+        nodes += Nodeset_nodeCount(ctx->loader->nodeset);
     }
-    Parser_delete(parser);
+    return report(ctx->loader, ctx->progress, ctx->userContext,
+                  NL_PROGRESS_PARSE, bytes, nodes);
+}
 
-cleanup:
-    free(ctx);
-    if (f)
+// the end of a file, false if the import is cancelled
+static bool reportFile(NodesetLoader *loader,
+                       const NL_FileContext *fileHandler)
+{
+    if (loader->cancelled)
     {
-        fclose(f);
+        return false;
     }
-    return status;
+    return !fileHandler->progress ||
+           report(loader, fileHandler->progress, fileHandler->userContext,
+                  NL_PROGRESS_PARSE, 0, Nodeset_nodeCount(loader->nodeset));
 }
 
-bool NodesetLoader_sort(NodesetLoader *loader)
+static bool reportSort(void *context, size_t sortedNodes)
 {
-    return Nodeset_sort(loader->nodeset);
+    NodesetLoader *loader = (NodesetLoader *)context;
+    return report(loader, loader->progress, loader->progressContext,
+                  NL_PROGRESS_SORT, 0, sortedNodes);
 }
 
-NodesetLoader *NodesetLoader_new(NodesetLoader_Logger *logger,
-                                 NL_ReferenceService *refService)
+// the node (and its value) which was parsed when the parser stopped, it
+// was not added to the nodeset yet
+static void deleteUnfinished(TParserCtx *ctx)
 {
-    NodesetLoader *loader = (NodesetLoader *)calloc(1, sizeof(NodesetLoader));
-    if(!loader)
+    TParserState state = ctx->state == PARSER_STATE_UNKNOWN
+                             ? ctx->prev_state
+                             : ctx->state;
+    if (state == PARSER_STATE_VALUE)
     {
-        return NULL;
+        Value_delete(ctx->val);
     }
-    if (!logger)
+    // the staged nodes are deleted with the staging nodeset
+    if (state != PARSER_STATE_INIT && state != PARSER_STATE_ALIAS &&
+        state != PARSER_STATE_NAMESPACEURIS && state != PARSER_STATE_URI &&
+        !ctx->nodeset->staging)
     {
-        loader->logger = InternalLogger_new();
-        loader->internalLogger = true;
+        Node_delete(ctx->node);
     }
-    else
+}
+
+// after a cancelled import or sort all nodes of the loader are released,
+// the loader starts over like a new one
+static void discardNodes(NodesetLoader *loader)
+{
+    if (loader->nodeset)
     {
-        loader->logger = logger;
+        Nodeset_cleanup(loader->nodeset);
+        loader->nodeset = NULL;
     }
-    if (!refService)
+    // it refers to the discarded reference types
+    if (loader->internalRefService)
+    {
+        InternalRefService_delete(loader->refService);
+        loader->refService = InternalRefService_new();
+    }
+    clearPending(loader);
+    loader->cacheable = false;
+    loader->cacheMiss = false;
+    loader->pendingFailed = false;
+    loader->cancelled = false;
+}
+
+// exactly one of the members describes the input
+struct ImportSource
+{
+    FILE *file;
+    const char *data;
+    size_t length;
+    NL_readCallback read;
+    void *streamContext;
+};
+typedef struct ImportSource ImportSource;
+
+static int runParser(Parser *parser, const ImportSource *source)
+{
+    if (source->file)
+    {
+        return Parser_run(parser, source->file, OnStartElementNs,
+                          OnEndElementNs, OnCharacters);
+    }
+    if (source->read)
+    {
+        return Parser_runStream(parser, source->read, source->streamContext,
+                                OnStartElementNs, OnEndElementNs,
+                                OnCharacters);
+    }
+    return Parser_runBuffer(parser, source->data, source->length,
+                            OnStartElementNs, OnEndElementNs, OnCharacters);
+}
+
+// adds the last run of the parser
+static void addParserTiming(NL_ImportTiming *timing, const Parser *parser)
+{
+    const Parser_Timing *run = Parser_getTiming(parser);
+    timing->bytes += run->bytes;
+    timing->ioWaitMs += run->ioWait;
+    timing->parseMs += run->total - run->ioWait;
+    timing->parseChunks += run->chunks;
+}
+
+static void addImportTiming(NodesetLoader *loader, const char *file,
+                            const NL_ImportTiming *timing)
+{
+    loader->stats.ioWaitMs += timing->ioWaitMs;
+    loader->stats.parseMs += timing->parseMs;
+    loader->stats.bytes += timing->bytes;
+    loader->stats.parseChunks += timing->parseChunks;
+    NL_ImportTiming *timings = (NL_ImportTiming *)realloc(
+        loader->timings, (loader->timingsSize + 1) * sizeof(NL_ImportTiming));
+    if (!timings)
+    {
+        return;
+    }
+    loader->timings = timings;
+    NL_ImportTiming *entry = &timings[loader->timingsSize++];
+    *entry = *timing;
+    entry->file = NULL;
+    if (file)
+    {
+        size_t length = strlen(file) + 1;
+        char *copy = (char *)malloc(length);
+        if (copy)
+        {
+            memcpy(copy, file, length);
+        }
+        entry->file = copy;
+    }
+}
+
+static void initContext(TParserCtx *ctx, Nodeset *nodeset,
+                        const NL_FileContext *fileHandler, int options)
+{
+    ctx->nodeset = nodeset;
+    ctx->state = PARSER_STATE_INIT;
+    ctx->prev_state = PARSER_STATE_INIT;
+    ctx->unknown_depth = 0;
+    ctx->onCharacters = NULL;
+    ctx->onCharLength = 0;
+    ctx->userContext = fileHandler->userContext;
+    ctx->extIf = fileHandler->extensionHandling;
+    ctx->filterNode = fileHandler->filterNode;
+    ctx->lazyValues = (options & NL_PARSER_OPTION_LAZY_VALUES) != 0;
+}
+
+// a part of the nodes of a document, parsed on its own thread
+struct ParseJob
+{
+    Parser *parser;
+    TParserCtx ctx;
+    Parser_Range range;
+    int status;
+    Thread thread;
+};
+typedef struct ParseJob ParseJob;
+
+static void runJob(void *arg)
+{
+    ParseJob *job = (ParseJob *)arg;
+    job->status = Parser_runRange(job->parser, &job->range, OnStartElementNs,
+                                  OnEndElementNs, OnCharacters);
+}
+
+// starts a job for each range, the staging nodesets share the aliases and
+// namespaces of parent, returns the number of started jobs
+static size_t startJobs(const NodesetLoader *loader,
+                        const NL_FileContext *fileHandler,
+                        const Nodeset *parent, const Parser_Range *content,
+                        const size_t *bounds, size_t ranges, ParseJob *jobs)
+{
+    size_t started = 0;
+    for (; started < ranges; started++)
+    {
+        ParseJob *job = &jobs[started];
+        Nodeset *staging = Nodeset_newStaging(parent);
+        if (!staging)
+        {
+            break;
+        }
+        initContext(&job->ctx, staging, fileHandler, loader->parserOptions);
+        job->parser = Parser_new(&job->ctx);
+        Parser_setOptions(job->parser, loader->parserOptions);
+        job->range = *content;
+        job->range.begin = bounds[started];
+        job->range.end = bounds[started + 1];
+        job->range.quiet = true;
+        Thread_start(&job->thread, runJob, job);
+    }
+    return started;
+}
+
+// returns false if one of the ranges is not well formed (the split was
+// guessed) or needs the serial parse
+static bool joinJobs(ParseJob *jobs, size_t count, NL_ImportTiming *timing)
+{
+    bool success = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        Thread_join(&jobs[i].thread);
+        addParserTiming(timing, jobs[i].parser);
+        success = success && !jobs[i].status &&
+                  jobs[i].ctx.state == PARSER_STATE_INIT &&
+                  Nodeset_stagingSucceeded(jobs[i].ctx.nodeset);
+    }
+    return success;
+}
+
+// merges the staging nodesets in document order, so the result is the same
+// as for the serial parse, or discards them
+static void finishJobs(Nodeset *nodeset, ParseJob *jobs, size_t count,
+                       bool merge)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (merge)
+        {
+            Nodeset_merge(nodeset, jobs[i].ctx.nodeset);
+        }
+        else
+        {
+            // the range may end within a value
+            if (jobs[i].ctx.state == PARSER_STATE_VALUE)
+            {
+                Value_delete(jobs[i].ctx.val);
+            }
+            Nodeset_cleanup(jobs[i].ctx.nodeset);
+        }
+        Parser_delete(jobs[i].parser);
+    }
+}
+
+// parses the ranges of the nodes in parallel, returns false if the serial
+// parse is needed, in this case nothing was added to the nodeset
+static bool runJobs(NodesetLoader *loader, const NL_FileContext *fileHandler,
+                    const Parser_Range *content, const size_t *bounds,
+                    size_t ranges, NL_ImportTiming *timing)
+{
+    ParseJob *jobs = (ParseJob *)calloc(ranges, sizeof(ParseJob));
+    if (!jobs)
+    {
+        return false;
+    }
+    size_t started = startJobs(loader, fileHandler, loader->nodeset, content,
+                               bounds, ranges, jobs);
+    bool success = joinJobs(jobs, started, timing) && started == ranges;
+    finishJobs(loader->nodeset, jobs, started, success);
+    free(jobs);
+    return success;
+}
+
+// the header (namespaces, aliases) is parsed first, the nodes are then split
+// into ranges which are parsed in parallel
+static int runParallel(NodesetLoader *loader, const NL_FileContext *fileHandler,
+                       const ImportSource *source, NL_ImportTiming *timing)
+{
+    Parser_Range content;
+    size_t *bounds =
+        (size_t *)calloc(loader->parseThreads + 1, sizeof(size_t));
+    size_t ranges = 0;
+    if (bounds && !InputStream_isCompressed(source->data, source->length) &&
+        DocumentSplit_root(source->data, source->length, &content))
+    {
+        ranges = DocumentSplit_nodes(&content, loader->parseThreads,
+                                     PARALLEL_MIN_RANGE_SIZE, bounds);
+    }
+    if (ranges < 2)
+    {
+        free(bounds);
+        int status = runParser(loader->parser, source);
+        addParserTiming(timing, loader->parser);
+        return status;
+    }
+    Parser_Range header = content;
+    header.end = bounds[0];
+    int status = Parser_runRange(loader->parser, &header, OnStartElementNs,
+                                 OnEndElementNs, OnCharacters);
+    addParserTiming(timing, loader->parser);
+    if (!status &&
+        !runJobs(loader, fileHandler, &content, bounds, ranges, timing))
+    {
+        Parser_Range body = content;
+        body.begin = bounds[0];
+        status = Parser_runRange(loader->parser, &body, OnStartElementNs,
+                                 OnEndElementNs, OnCharacters);
+        addParserTiming(timing, loader->parser);
+    }
+    free(bounds);
+    return status;
+}
+
+static bool import(NodesetLoader *loader, const NL_FileContext *fileHandler,
+                   const char *file, const ImportSource *source)
+{
+    TParserCtx *ctx = (TParserCtx *)calloc(1, sizeof(TParserCtx));
+    if (!ctx)
+    {
+        return false;
+    }
+    initContext(ctx, loader->nodeset, fileHandler, loader->parserOptions);
+    ctx->loader = loader;
+    ctx->progress = fileHandler->progress;
+
+    bool status = true;
+    Parser_setContext(loader->parser, ctx);
+    // extensions are called from the parser threads, so they are always
+    // parsed serially
+    bool parallel = loader->parseThreads > 1 && source->data &&
+                    !fileHandler->extensionHandling;
+    NL_ImportTiming timing = {NULL, 0, 0, 0, 0};
+    int res;
+    if (parallel)
+    {
+        res = runParallel(loader, fileHandler, source, &timing);
+    }
+    else
+    {
+        res = runParser(loader->parser, source);
+        addParserTiming(&timing, loader->parser);
+    }
+    if (source->data)
+    {
+        // the ranges may have been parsed twice
+        timing.bytes = source->length;
+    }
+    addImportTiming(loader, file, &timing);
+    if (loader->cancelled)
+    {
+        deleteUnfinished(ctx);
+    }
+    else if (res)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR, "xml parsing error");
+        status = false;
+    }
+    Parser_setContext(loader->parser, NULL);
+    free(ctx);
+    if (!reportFile(loader, fileHandler))
+    {
+        discardNodes(loader);
+        return false;
+    }
+    return status;
+}
+
+static bool importFile(NodesetLoader *loader,
+                       const NL_FileContext *fileHandler)
+{
+    if (!checkFileContext(loader, fileHandler))
+    {
+        return false;
+    }
+    FILE *f = fopen(fileHandler->file, "rb");
+    if (!f)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: file open error");
+        return false;
+    }
+    ImportSource source = {f, NULL, 0, NULL, NULL};
+    // the parser threads need the whole file in memory, unless it is read
+    // ahead on purpose
+    FileMapping *mapping =
+        loader->parseThreads > 1 &&
+                !(loader->parserOptions & NL_PARSER_OPTION_READ_AHEAD)
+            ? FileMapping_new(f)
+            : NULL;
+    if (mapping)
+    {
+        source.file = NULL;
+        source.data = mapping->data;
+        source.length = mapping->size;
+    }
+    bool status = import(loader, fileHandler, fileHandler->file, &source);
+    FileMapping_delete(mapping);
+    fclose(f);
+    return status;
+}
+
+// a file of NodesetLoader_importFiles
+struct FileImport
+{
+    const NL_FileContext *fileHandler;
+    FILE *file;
+    FileMapping *mapping;
+    // the aliases and namespaces of the file, the nodes if the file is not
+    // split
+    Nodeset *nodeset;
+    TParserCtx ctx;
+    Parser_Range content;
+    size_t *bounds;
+    ParseJob *jobs;
+    size_t ranges;
+    size_t started;
+    bool jobsSucceeded;
+    NL_ImportTiming timing;
+};
+typedef struct FileImport FileImport;
+
+// splits the nodes of the file into about ranges parts, returns 0 if the
+// file is parsed as a whole
+static size_t splitFile(FileImport *fi, size_t ranges)
+{
+    if (!fi->mapping || fi->fileHandler->extensionHandling ||
+        InputStream_isCompressed(fi->mapping->data, fi->mapping->size) ||
+        !DocumentSplit_root(fi->mapping->data, fi->mapping->size,
+                            &fi->content))
+    {
+        return 0;
+    }
+    fi->bounds = (size_t *)calloc(ranges + 1, sizeof(size_t));
+    fi->jobs = (ParseJob *)calloc(ranges, sizeof(ParseJob));
+    if (!fi->bounds || !fi->jobs)
+    {
+        return 0;
+    }
+    return DocumentSplit_nodes(&fi->content, ranges, PARALLEL_MIN_RANGE_SIZE,
+                               fi->bounds);
+}
+
+// parses the header of the file and starts the jobs for its nodes, files
+// which cannot be split are parsed completely
+// the namespaces are added on the calling thread and the file starts with
+// the aliases and namespaces of the previous file, so the namespace indices
+// are the same as with a sequence of NodesetLoader_importFile
+static bool startFile(NodesetLoader *loader, FileImport *fi,
+                      const Nodeset *previous, size_t ranges)
+{
+    if (!fi->file)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: file open error");
+        return false;
+    }
+    fi->nodeset = Nodeset_newFileStaging(loader->nodeset, previous);
+    if (!fi->nodeset)
+    {
+        return false;
+    }
+    initContext(&fi->ctx, fi->nodeset, fi->fileHandler,
+                loader->parserOptions);
+    fi->ctx.loader = loader;
+    fi->ctx.progress = fi->fileHandler->progress;
+    Parser_setContext(loader->parser, &fi->ctx);
+    fi->ranges = splitFile(fi, ranges);
+    int status;
+    if (!fi->ranges)
+    {
+        ImportSource source = {fi->file, NULL, 0, NULL, NULL};
+        if (fi->mapping)
+        {
+            source.file = NULL;
+            source.data = fi->mapping->data;
+            source.length = fi->mapping->size;
+        }
+        status = runParser(loader->parser, &source);
+        addParserTiming(&fi->timing, loader->parser);
+    }
+    else
+    {
+        Parser_Range header = fi->content;
+        header.end = fi->bounds[0];
+        status = Parser_runRange(loader->parser, &header, OnStartElementNs,
+                                 OnEndElementNs, OnCharacters);
+        addParserTiming(&fi->timing, loader->parser);
+        if (!status)
+        {
+            fi->started =
+                startJobs(loader, fi->fileHandler, fi->nodeset, &fi->content,
+                          fi->bounds, fi->ranges, fi->jobs);
+        }
+    }
+    Parser_setContext(loader->parser, NULL);
+    if (loader->cancelled)
+    {
+        deleteUnfinished(&fi->ctx);
+        return false;
+    }
+    if (status)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR, "xml parsing error");
+        return false;
+    }
+    return true;
+}
+
+// adds the nodes of the file to the nodeset, the nodes of a file which was
+// split but could not be parsed in parallel are parsed now
+static bool finishFile(NodesetLoader *loader, FileImport *fi)
+{
+    bool success = fi->jobsSucceeded && fi->started == fi->ranges;
+    finishJobs(loader->nodeset, fi->jobs, fi->started, success);
+    fi->started = 0;
+    if (fi->ranges && !success)
+    {
+        Parser_Range body = fi->content;
+        body.begin = fi->bounds[0];
+        Parser_setContext(loader->parser, &fi->ctx);
+        int status = Parser_runRange(loader->parser, &body, OnStartElementNs,
+                                     OnEndElementNs, OnCharacters);
+        addParserTiming(&fi->timing, loader->parser);
+        Parser_setContext(loader->parser, NULL);
+        if (loader->cancelled)
+        {
+            deleteUnfinished(&fi->ctx);
+            return false;
+        }
+        if (status)
+        {
+            loader->logger->log(loader->logger->context,
+                                NODESETLOADER_LOGLEVEL_ERROR,
+                                "xml parsing error");
+            return false;
+        }
+    }
+    Nodeset_merge(loader->nodeset, fi->nodeset);
+    fi->nodeset = NULL;
+    return reportFile(loader, fi->fileHandler);
+}
+
+static void cleanupFile(FileImport *fi)
+{
+    finishJobs(NULL, fi->jobs, fi->started, false);
+    if (fi->nodeset)
+    {
+        Nodeset_cleanup(fi->nodeset);
+    }
+    free(fi->jobs);
+    free(fi->bounds);
+    FileMapping_delete(fi->mapping);
+    if (fi->file)
+    {
+        fclose(fi->file);
+    }
+}
+
+static bool importFiles(NodesetLoader *loader,
+                        const NL_FileContext *fileHandlers, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!checkFileContext(loader, &fileHandlers[i]))
+        {
+            return false;
+        }
+    }
+    FileImport *files = (FileImport *)calloc(count, sizeof(FileImport));
+    if (!files)
+    {
+        return false;
+    }
+    size_t totalSize = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        files[i].fileHandler = &fileHandlers[i];
+        files[i].file = fopen(fileHandlers[i].file, "rb");
+        files[i].mapping = files[i].file ? FileMapping_new(files[i].file) : NULL;
+        totalSize += files[i].mapping ? files[i].mapping->size : 0;
+    }
+    // the threads are distributed according to the size of the files
+    size_t threads =
+        loader->parseThreads > 1 ? loader->parseThreads : Thread_cpuCount();
+    size_t failed = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t size = files[i].mapping ? files[i].mapping->size : 0;
+        size_t ranges = (size_t)((double)threads * (double)size /
+                                     (double)(totalSize ? totalSize : 1) +
+                                 0.5);
+        const Nodeset *previous = i ? files[i - 1].nodeset : loader->nodeset;
+        if (!startFile(loader, &files[i], previous, ranges ? ranges : 1))
+        {
+            failed = i;
+            break;
+        }
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        files[i].jobsSucceeded =
+            joinJobs(files[i].jobs, files[i].started, &files[i].timing);
+    }
+    // like a sequence of NodesetLoader_importFile, the files before the
+    // first failing one are imported
+    size_t parsed = failed < count ? failed + 1 : count;
+    for (size_t i = 0; i < failed; i++)
+    {
+        if (!finishFile(loader, &files[i]))
+        {
+            failed = i;
+        }
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i < parsed && files[i].file)
+        {
+            if (files[i].mapping)
+            {
+                files[i].timing.bytes = files[i].mapping->size;
+            }
+            addImportTiming(loader, fileHandlers[i].file, &files[i].timing);
+        }
+        cleanupFile(&files[i]);
+    }
+    free(files);
+    if (loader->cancelled)
+    {
+        discardNodes(loader);
+        return false;
+    }
+    return failed == count;
+}
+
+bool NodesetLoader_importBuffer(NodesetLoader *loader,
+                                const NL_FileContext *fileHandler,
+                                const char *data, size_t length)
+{
+    if (!checkFileContext(loader, fileHandler))
+    {
+        return false;
+    }
+    if (!data || !length)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: empty buffer - abort");
+        return false;
+    }
+    bool status = loadPending(loader);
+    loader->cacheable = false;
+    ImportSource source = {NULL, data, length, NULL, NULL};
+    double start = Clock_now();
+    bool imported = import(loader, fileHandler, NULL, &source);
+    loader->stats.importMs += Clock_now() - start;
+    return imported && status;
+}
+
+bool NodesetLoader_importStream(NodesetLoader *loader,
+                                const NL_FileContext *fileHandler,
+                                NL_readCallback read, void *streamContext)
+{
+    if (!checkFileContext(loader, fileHandler))
+    {
+        return false;
+    }
+    if (!read)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: no read callback - abort");
+        return false;
+    }
+    bool status = loadPending(loader);
+    loader->cacheable = false;
+    ImportSource source = {NULL, NULL, 0, read, streamContext};
+    double start = Clock_now();
+    bool imported = import(loader, fileHandler, NULL, &source);
+    loader->stats.importMs += Clock_now() - start;
+    return imported && status;
+}
+
+// the image is written in the background, the nodes can be changed
+static void writeCache(NodesetLoader *loader)
+{
+    ImageCacheWriter_finish(loader->cacheWriter);
+    loader->cacheWriter = NULL;
+    loader->cacheMiss = false;
+    NodesetImageBuffer *buffer = NodesetImage_serialize(loader->nodeset);
+    char *path = ImageCache_path(loader->cacheDir, loader->cacheKey);
+    if (!buffer || !path)
+    {
+        NodesetImage_deleteBuffer(buffer);
+        free(path);
+        return;
+    }
+    loader->cacheWriter = ImageCacheWriter_start(buffer, path);
+}
+
+bool NodesetLoader_sort(NodesetLoader *loader)
+{
+    bool status = loadPending(loader) && !loader->pendingFailed;
+    if (!loader->nodeset)
+    {
+        // no file could be imported
+        return status;
+    }
+    Nodeset_setProgress(loader->nodeset, loader->progress ? reportSort : NULL,
+                        loader);
+    status = Nodeset_sort(loader->nodeset) && status;
+    if (loader->cancelled)
+    {
+        discardNodes(loader);
+        return false;
+    }
+    if (status && loader->cacheDir && loader->cacheable && loader->cacheMiss)
+    {
+        writeCache(loader);
+    }
+    return status;
+}
+
+bool NodesetLoader_writeImage(const NodesetLoader *loader, const char *path)
+{
+    if (!loader->nodeset || !loader->nodeset->sorted)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: image needs a sorted nodeset");
+        return false;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: file open error");
+        return false;
+    }
+    bool status = NodesetImage_write(loader->nodeset, f);
+    status = !fclose(f) && status;
+    if (!status)
+    {
+        remove(path);
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: image could not be written");
+    }
+    return status;
+}
+
+// loads the image into the empty loader, the loader stays empty on errors
+// the mapping is taken, start is the time the load began
+static bool loadMapping(NodesetLoader *loader,
+                        const NL_FileContext *fileHandler,
+                        FileMapping *mapping, double start)
+{
+    if (!checkFileContext(loader, fileHandler))
+    {
+        FileMapping_delete(mapping);
+        return false;
+    }
+    NodesetImage *image = NodesetImage_load(loader->nodeset, mapping,
+                                            fileHandler->userContext);
+    if (!image)
+    {
+        // the loader can still import the xml files
+        Nodeset_cleanup(loader->nodeset);
+        loader->nodeset = NULL;
+        return false;
+    }
+    loader->nodeset->image = image;
+    loader->nodeset->sorted = true;
+    NL_ImportTiming timing = {NULL, mapping->size, 0, Clock_now() - start,
+                              0};
+    addImportTiming(loader, fileHandler->file, &timing);
+    loader->stats.importMs += timing.parseMs;
+    return true;
+}
+
+static bool loadImage(NodesetLoader *loader, const NL_FileContext *fileHandler)
+{
+    if (!fileHandler || !fileHandler->file)
+    {
+        return false;
+    }
+    double start = Clock_now();
+    FILE *f = fopen(fileHandler->file, "rb");
+    // the mapping stays valid after the file is closed
+    FileMapping *mapping = f ? FileMapping_new(f) : NULL;
+    if (f)
+    {
+        fclose(f);
+    }
+    return mapping && loadMapping(loader, fileHandler, mapping, start);
+}
+
+// the checks and error messages of the public image functions, the image is
+// loaded from the file of the context or from the buffer if data is set
+static bool loadPublicImage(NodesetLoader *loader,
+                            const NL_FileContext *fileHandler,
+                            const void *data, size_t size)
+{
+    bool status = loadPending(loader);
+    loader->cacheable = false;
+    if (loader->nodeset)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: image needs an empty loader");
+        return false;
+    }
+    bool loaded = false;
+    if (data)
+    {
+        double start = Clock_now();
+        FileMapping *mapping =
+            FileMapping_fromBuffer((const char *)data, size);
+        loaded = mapping && loadMapping(loader, fileHandler, mapping, start);
+    }
+    else
+    {
+        loaded = loadImage(loader, fileHandler);
+    }
+    if (!loaded)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: image could not be loaded");
+        return false;
+    }
+    return status;
+}
+
+bool NodesetLoader_loadImage(NodesetLoader *loader,
+                             const NL_FileContext *fileHandler)
+{
+    return loadPublicImage(loader, fileHandler, NULL, 0);
+}
+
+bool NodesetLoader_loadImageBuffer(NodesetLoader *loader,
+                                   const NL_FileContext *fileHandler,
+                                   const void *data, size_t size)
+{
+    if (!data)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: empty image - abort");
+        return false;
+    }
+    return loadPublicImage(loader, fileHandler, data, size);
+}
+
+// the files are only hashed, so the loader finds out if there is an image of
+// all files before it parses any of them
+static bool useCache(NodesetLoader *loader, const NL_FileContext *fileHandlers,
+                     size_t count)
+{
+    if (!loader->cacheDir || !loader->cacheable)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        // the data of extensions is not part of the image, the nodes of a
+        // filter are not part of the key
+        if (!fileHandlers || !fileHandlers[i].addNamespace ||
+            fileHandlers[i].extensionHandling || fileHandlers[i].filterNode)
+        {
+            loader->cacheable = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool addPending(NodesetLoader *loader,
+                       const NL_FileContext *fileHandlers, size_t count)
+{
+    PendingFile *pending = (PendingFile *)realloc(
+        loader->pending, (loader->pendingSize + count) * sizeof(PendingFile));
+    if (!pending)
+    {
+        return false;
+    }
+    loader->pending = pending;
+    loader->importCalls++;
+    for (size_t i = 0; i < count; i++)
+    {
+        FILE *f = fopen(fileHandlers[i].file, "rb");
+        uint64_t key;
+        bool status = f && ImageCache_key(loader->cacheKey,
+                                          loader->parserOptions, f, &key);
+        if (f)
+        {
+            fclose(f);
+        }
+        size_t length = strlen(fileHandlers[i].file) + 1;
+        char *file = status ? (char *)malloc(length) : NULL;
+        if (!file)
+        {
+            loader->logger->log(loader->logger->context,
+                                NODESETLOADER_LOGLEVEL_ERROR,
+                                "NodesetLoader: file open error");
+            return false;
+        }
+        memcpy(file, fileHandlers[i].file, length);
+        PendingFile *entry = &loader->pending[loader->pendingSize++];
+        entry->context = fileHandlers[i];
+        entry->context.file = file;
+        entry->key = key;
+        entry->call = loader->importCalls;
+        loader->cacheKey = key;
+    }
+    return true;
+}
+
+static void clearPending(NodesetLoader *loader)
+{
+    for (size_t i = 0; i < loader->pendingSize; i++)
+    {
+        free((void *)(uintptr_t)loader->pending[i].context.file);
+    }
+    free(loader->pending);
+    loader->pending = NULL;
+    loader->pendingSize = 0;
+}
+
+// imports the pending files, from the image of the most files there is and
+// the xml of the remaining ones, returns false if a file cannot be imported
+static bool loadPending(NodesetLoader *loader)
+{
+    if (!loader->pendingSize)
+    {
+        return true;
+    }
+    size_t loaded = 0;
+    for (size_t i = loader->pendingSize; i > 0 && !loader->nodeset; i--)
+    {
+        // the context of the last file of the image
+        NL_FileContext context = loader->pending[i - 1].context;
+        char *path =
+            ImageCache_path(loader->cacheDir, loader->pending[i - 1].key);
+        context.file = path;
+        if (path && loadImage(loader, &context))
+        {
+            loaded = i;
+        }
+        free(path);
+    }
+    NL_FileContext *contexts = (NL_FileContext *)calloc(
+        loader->pendingSize, sizeof(NL_FileContext));
+    bool status = contexts != NULL;
+    for (size_t i = loaded; i < loader->pendingSize && status;)
+    {
+        size_t count = 0;
+        for (; i + count < loader->pendingSize &&
+               loader->pending[i + count].call == loader->pending[i].call;
+             count++)
+        {
+            contexts[count] = loader->pending[i + count].context;
+        }
+        double start = Clock_now();
+        status = count > 1 ? importFiles(loader, contexts, count)
+                           : importFile(loader, contexts);
+        loader->stats.importMs += Clock_now() - start;
+        loader->cacheMiss = true;
+        i += count;
+    }
+    free(contexts);
+    clearPending(loader);
+    // the image of the loader would not match the key
+    loader->cacheable = loader->cacheable && status;
+    loader->pendingFailed = loader->pendingFailed || !status;
+    return status;
+}
+
+bool NodesetLoader_importFile(NodesetLoader *loader,
+                              const NL_FileContext *fileHandler)
+{
+    if (useCache(loader, fileHandler, 1))
+    {
+        return addPending(loader, fileHandler, 1);
+    }
+    bool status = loadPending(loader);
+    loader->cacheable = false;
+    double start = Clock_now();
+    bool imported = importFile(loader, fileHandler);
+    loader->stats.importMs += Clock_now() - start;
+    return imported && status;
+}
+
+bool NodesetLoader_importFiles(NodesetLoader *loader,
+                               const NL_FileContext *fileHandlers,
+                               size_t count)
+{
+    if (useCache(loader, fileHandlers, count))
+    {
+        return addPending(loader, fileHandlers, count);
+    }
+    bool status = loadPending(loader);
+    loader->cacheable = false;
+    double start = Clock_now();
+    bool imported = importFiles(loader, fileHandlers, count);
+    loader->stats.importMs += Clock_now() - start;
+    return imported && status;
+}
+
+void NodesetLoader_setCacheDir(NodesetLoader *loader, const char *dir)
+{
+    free(loader->cacheDir);
+    loader->cacheDir = NULL;
+    if (dir)
+    {
+        size_t length = strlen(dir) + 1;
+        loader->cacheDir = (char *)malloc(length);
+        if (loader->cacheDir)
+        {
+            memcpy(loader->cacheDir, dir, length);
+        }
+    }
+}
+
+bool NodesetLoader_setNodeStream(NodesetLoader *loader, void *context,
+                                 NodesetLoader_forEachNode_Func fn)
+{
+    // the image of the cache would lack the streamed nodes
+    loader->cacheable = false;
+    loader->streamCallback = fn;
+    loader->streamContext = context;
+    if (!fn)
+    {
+        loader->memoryBudget = 0;
+    }
+    return !loader->nodeset ||
+           Nodeset_setStream(loader->nodeset, context, fn);
+}
+
+bool NodesetLoader_setMemoryBudget(NodesetLoader *loader, size_t bytes)
+{
+    // the sort without a stream holds every node until it is sorted
+    if (bytes && !loader->streamCallback)
+    {
+        return false;
+    }
+    loader->memoryBudget = bytes;
+    return !loader->nodeset ||
+           Nodeset_setMemoryBudget(loader->nodeset, bytes);
+}
+
+NodesetLoader *NodesetLoader_new(NodesetLoader_Logger *logger,
+                                 NL_ReferenceService *refService)
+{
+    NodesetLoader *loader = (NodesetLoader *)calloc(1, sizeof(NodesetLoader));
+    if(!loader)
+    {
+        return NULL;
+    }
+    if (!logger)
+    {
+        loader->logger = InternalLogger_new();
+        loader->internalLogger = true;
+    }
+    else
+    {
+        loader->logger = logger;
+    }
+    if (!refService)
     {
         loader->refService = InternalRefService_new();
         loader->internalRefService = true;
@@ -544,12 +1666,39 @@ NodesetLoader *NodesetLoader_new(NodesetLoader_Logger *logger,
     {
         loader->refService = refService;
     }
+    loader->parser = Parser_new(NULL);
+    Parser_setProgress(loader->parser, reportParse);
+    loader->parserOptions = NL_PARSER_OPTIONS_DEFAULT;
+    loader->parseThreads = 1;
+    // the reference types of a custom service are not part of the key
+    loader->cacheable = loader->internalRefService;
     return loader;
 }
 
+void NodesetLoader_setParserOptions(NodesetLoader *loader, int options)
+{
+    loader->parserOptions = options;
+    Parser_setOptions(loader->parser, options);
+}
+
+void NodesetLoader_setParseThreads(NodesetLoader *loader, size_t threads)
+{
+#ifdef NODESETLOADER_THREADS
+    loader->parseThreads = threads ? threads : 1;
+#else
+    loader->parseThreads = 1;
+#endif
+}
+
 void NodesetLoader_delete(NodesetLoader *loader)
 {
-    Nodeset_cleanup(loader->nodeset);
+    ImageCacheWriter_finish(loader->cacheWriter);
+    clearPending(loader);
+    free(loader->cacheDir);
+    if (loader->nodeset)
+    {
+        Nodeset_cleanup(loader->nodeset);
+    }
     if (loader->internalLogger)
     {
         free(loader->logger);
@@ -558,9 +1707,31 @@ void NodesetLoader_delete(NodesetLoader *loader)
     {
         InternalRefService_delete(loader->refService);
     }
+    Parser_delete(loader->parser);
+    for (size_t i = 0; i < loader->timingsSize; i++)
+    {
+        free((void *)(uintptr_t)loader->timings[i].file);
+    }
+    free(loader->timings);
     free(loader);
 }
 
+size_t NodesetLoader_getImportTimings(const NodesetLoader *loader,
+                                      const NL_ImportTiming **timings)
+{
+    *timings = loader->timings;
+    return loader->timingsSize;
+}
+
+void NodesetLoader_getStats(const NodesetLoader *loader, NL_Stats *stats)
+{
+    *stats = loader->stats;
+    if (loader->nodeset)
+    {
+        Nodeset_addStats(loader->nodeset, stats);
+    }
+}
+
 const NL_BiDirectionalReference *
 NodesetLoader_getBidirectionalRefs(const NodesetLoader *loader)
 {
@@ -571,5 +1742,20 @@ size_t NodesetLoader_forEachNode(NodesetLoader *loader, NL_NodeClass nodeClass,
                                void *context,
                                NodesetLoader_forEachNode_Func fn)
 {
-    return Nodeset_forEachNode(loader->nodeset, nodeClass, context, fn);
+    loadPending(loader);
+    if (loader->pendingFailed)
+    {
+        loader->logger->log(loader->logger->context,
+                            NODESETLOADER_LOGLEVEL_ERROR,
+                            "NodesetLoader: the imported files are incomplete");
+        return 0;
+    }
+    if (!loader->nodeset)
+    {
+        return 0;
+    }
+    double start = Clock_now();
+    size_t count = Nodeset_forEachNode(loader->nodeset, nodeClass, context, fn);
+    loader->stats.forEachNodeMs += Clock_now() - start;
+    return count;
 }
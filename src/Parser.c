@@ -6,56 +6,552 @@
  */
 
 #include "Parser.h"
+#include "Clock.h"
+#include "FileMapping.h"
+#include "InputStream.h"
+#include "ReadAhead.h"
+#ifdef NODESETLOADER_TOKENIZER
+#include "Tokenizer.h"
+#endif
 #include <assert.h>
 #include <libxml/SAX.h>
+#include <libxml/parser.h>
 #include <stdlib.h>
 #include <string.h>
 
+// size of the windows of in memory data (e.g. a mapped file) which are handed
+// over to libxml2, has to stay well below XML_MAX_LOOKUP_LIMIT
+#define PARSER_WINDOW_SIZE (1024 * 1024)
+// chunk size for streams and files which cannot be mapped, e.g. pipes
+#define PARSER_READ_CHUNK_SIZE (64 * 1024)
+// bytes between two calls of the progress callback
+#define PARSER_PROGRESS_INTERVAL PARSER_WINDOW_SIZE
+
 struct Parser
 {
     void *context;
+    Parser_InputMode inputMode;
+    int xmlOptions;
+    // the context is kept between the runs, so its dictionary interns the
+    // element and attribute names once for all files
+    xmlParserCtxtPtr ctxt;
+    Parser_Timing timing;
+    Parser_callbackProgress progress;
+    // bytes of the run at the last call of progress
+    size_t reported;
+    // the progress callback stopped the run
+    bool stopped;
+#ifdef NODESETLOADER_TOKENIZER
+    bool useTokenizer;
+    // created with the first run which uses it
+    Tokenizer *tokenizer;
+#endif
 };
 
+static int toXmlOptions(int options)
+{
+    int xmlOptions = XML_PARSE_NONET;
+    if (options & NL_PARSER_OPTION_COMPACT)
+    {
+        xmlOptions |= XML_PARSE_COMPACT;
+    }
+    if (options & NL_PARSER_OPTION_HUGE)
+    {
+        xmlOptions |= XML_PARSE_HUGE;
+    }
+    if (options & NL_PARSER_OPTION_SUBSTITUTE_ENTITIES)
+    {
+        xmlOptions |= XML_PARSE_NOENT;
+    }
+    return xmlOptions;
+}
+
 Parser *Parser_new(void *context)
 {
     Parser *parser = (Parser *)calloc(1, sizeof(Parser));
     assert(parser);
+    xmlInitParser();
     parser->context = context;
+    parser->inputMode = PARSER_INPUT_AUTO;
+    parser->xmlOptions = toXmlOptions(NL_PARSER_OPTIONS_DEFAULT);
     return parser;
 }
 
-int Parser_run(Parser *parser, FILE *file, Parser_callbackStart start,
-               Parser_callbackEnd end, Parser_callbackChar onChars)
+void Parser_setContext(Parser *parser, void *context)
 {
-    char chars[1024];
-    int res = (int)fread(chars, 1, 4, file);
-    if (res <= 0)
+    parser->context = context;
+}
+
+void Parser_setInputMode(Parser *parser, Parser_InputMode mode)
+{
+    parser->inputMode = mode;
+}
+
+void Parser_setOptions(Parser *parser, int options)
+{
+    parser->xmlOptions = toXmlOptions(options);
+    if (options & NL_PARSER_OPTION_READ_AHEAD)
     {
-        return 1;
+        parser->inputMode = PARSER_INPUT_READAHEAD;
+    }
+    else if (parser->inputMode == PARSER_INPUT_READAHEAD)
+    {
+        parser->inputMode = PARSER_INPUT_AUTO;
     }
+#ifdef NODESETLOADER_TOKENIZER
+    // the tokenizer gives the same results as libxml2 without substitution
+    parser->useTokenizer = (options & NL_PARSER_OPTION_FAST_TOKENIZER) &&
+                           !(options & NL_PARSER_OPTION_SUBSTITUTE_ENTITIES);
+#endif
+}
 
-    xmlSAXHandler hdl;
-    memset(&hdl, 0, sizeof(xmlSAXHandler));
-    hdl.initialized = XML_SAX2_MAGIC;
+void Parser_setProgress(Parser *parser, Parser_callbackProgress progress)
+{
+    parser->progress = progress;
+}
+
+static xmlParserCtxtPtr createContext(Parser *parser,
+                                      Parser_callbackStart start,
+                                      Parser_callbackEnd end,
+                                      Parser_callbackChar onChars,
+                                      const char *chunk, int size)
+{
+    xmlParserCtxtPtr ctxt = parser->ctxt;
+    if (!ctxt)
+    {
+        xmlSAXHandler hdl;
+        memset(&hdl, 0, sizeof(xmlSAXHandler));
+        hdl.initialized = XML_SAX2_MAGIC;
+        // libxml2 keeps a copy of the handler
+        ctxt = xmlCreatePushParserCtxt(&hdl, parser->context, chunk, size,
+                                       NULL);
+        if (!ctxt)
+        {
+            return NULL;
+        }
+        parser->ctxt = ctxt;
+    }
+    else if (xmlCtxtResetPush(ctxt, chunk, size, NULL, NULL))
+    {
+        return NULL;
+    }
+    ctxt->userData = parser->context;
     // nodesets are encoded with UTF-8
     // this code does no transformation on the encoded text or interprets it
     // so it should be safe to cast xmlChar* to char*
-    hdl.startElementNs = (startElementNsSAX2Func)start;
-    hdl.endElementNs = (endElementNsSAX2Func)end;
-    hdl.characters = (charactersSAXFunc)onChars;
+    ctxt->sax->startElementNs = (startElementNsSAX2Func)start;
+    ctxt->sax->endElementNs = (endElementNsSAX2Func)end;
+    ctxt->sax->characters = (charactersSAXFunc)onChars;
+    ctxt->sax->serror = NULL;
+    xmlCtxtUseOptions(ctxt, parser->xmlOptions);
+    return ctxt;
+}
+
+static int finish(xmlParserCtxtPtr ctxt, int status, bool report)
+{
+    if (!status && xmlParseChunk(ctxt, NULL, 0, 1))
+    {
+        if (report)
+        {
+            xmlParserError(ctxt, "xmlParseChunk");
+        }
+        status = 1;
+    }
+    // releases the input buffers, the dictionary is kept for the next run
+    xmlCtxtReset(ctxt);
+    return status;
+}
+
+// hands the data over to libxml2 and counts the call
+static int parseChunk(Parser *parser, xmlParserCtxtPtr ctxt, const char *data,
+                      size_t length)
+{
+    parser->timing.chunks++;
+    return xmlParseChunk(ctxt, data, (int)length, 0);
+}
+
+static double startTiming(Parser *parser)
+{
+    memset(&parser->timing, 0, sizeof(Parser_Timing));
+    parser->reported = 0;
+    parser->stopped = false;
+    return Clock_now();
+}
+
+// false if the progress callback stops the run, libxml2 is stopped as well
+static bool reportProgress(Parser *parser, xmlParserCtxtPtr ctxt,
+                           size_t bytes)
+{
+    if (!parser->progress ||
+        bytes - parser->reported < PARSER_PROGRESS_INTERVAL)
+    {
+        return true;
+    }
+    parser->reported = bytes;
+    if (!parser->progress(parser->context, bytes))
+    {
+        xmlStopParser(ctxt);
+        parser->stopped = true;
+        return false;
+    }
+    return true;
+}
+
+static int stopTiming(Parser *parser, double begin, int status)
+{
+    parser->timing.total = Clock_now() - begin;
+    return status;
+}
+
+// hands the data over to libxml2 in windows, libxml2 only keeps the part of
+// the data which is not parsed yet, so the memory overhead is bounded by the
+// window size
+static int runWindows(Parser *parser, const char *data, size_t size,
+                      FileMapping *mapping, Parser_callbackStart start,
+                      Parser_callbackEnd end, Parser_callbackChar onChars)
+{
+    if (!data || !size)
+    {
+        return 1;
+    }
+#ifdef NODESETLOADER_TOKENIZER
+    if (parser->useTokenizer)
+    {
+        if (!parser->tokenizer)
+        {
+            parser->tokenizer = Tokenizer_new();
+        }
+        Tokenizer_Status status =
+            parser->tokenizer
+                ? Tokenizer_run(parser->tokenizer, data, size, parser->context,
+                                start, end, onChars)
+                : TOKENIZER_UNSUPPORTED;
+        // e.g. other encodings than utf-8 are left to libxml2
+        if (status != TOKENIZER_UNSUPPORTED)
+        {
+            return status == TOKENIZER_OK ? 0 : 1;
+        }
+    }
+#endif
+    // the first bytes are used by libxml2 to detect the encoding
+    size_t offset = size < 4 ? size : 4;
     xmlParserCtxtPtr ctxt =
-        xmlCreatePushParserCtxt(&hdl, parser->context, chars, res, NULL);
-    while ((res = (int)fread(chars, 1, sizeof(chars), file)) > 0)
+        createContext(parser, start, end, onChars, data, (int)offset);
+    if (!ctxt)
+    {
+        return 1;
+    }
+    size_t windowStart = 0;
+    while (offset < size)
     {
-        if (xmlParseChunk(ctxt, chars, res, 0))
+        // a mapping is page aligned, the windows are page aligned as well
+        size_t windowEnd = windowStart + PARSER_WINDOW_SIZE;
+        if (windowEnd > size)
+        {
+            windowEnd = size;
+        }
+        if (parseChunk(parser, ctxt, data + offset, windowEnd - offset))
         {
             xmlParserError(ctxt, "xmlParseChunk");
+            return finish(ctxt, 1, true);
+        }
+        if (mapping)
+        {
+            // libxml2 holds its own copy of the data, the pages can be
+            // dropped
+            FileMapping_release(mapping, windowStart, windowEnd - windowStart);
+        }
+        offset = windowEnd;
+        windowStart = windowEnd;
+        if (!reportProgress(parser, ctxt, offset))
+        {
+            return finish(ctxt, 1, false);
+        }
+    }
+    return finish(ctxt, 0, true);
+}
+
+static void ignoreError(void *userData, xmlErrorPtr error) {}
+
+// hands [begin, end) over to libxml2 in windows
+static int pushWindows(Parser *parser, xmlParserCtxtPtr ctxt, const char *data,
+                       size_t begin, size_t end)
+{
+    size_t start = begin;
+    while (begin < end)
+    {
+        size_t len = end - begin;
+        if (len > PARSER_WINDOW_SIZE)
+        {
+            len = PARSER_WINDOW_SIZE;
+        }
+        if (parseChunk(parser, ctxt, data + begin, len))
+        {
+            return 1;
+        }
+        begin += len;
+        if (!reportProgress(parser, ctxt, begin - start))
+        {
             return 1;
         }
     }
-    xmlParseChunk(ctxt, chars, 0, 1);
-    xmlFreeParserCtxt(ctxt);
-    xmlCleanupParser();
     return 0;
 }
-void Parser_delete(Parser *parser) { free(parser); }
+
+static int runRangeXml(Parser *parser, const Parser_Range *range,
+                       Parser_callbackStart start, Parser_callbackEnd end,
+                       Parser_callbackChar onChars)
+{
+    size_t endTagLength = range->rootNameLength + 3;
+    char *endTag = (char *)malloc(endTagLength);
+    if (!endTag)
+    {
+        return 1;
+    }
+    endTag[0] = '<';
+    endTag[1] = '/';
+    memcpy(endTag + 2, range->rootName, range->rootNameLength);
+    endTag[endTagLength - 1] = '>';
+
+    size_t offset = range->rootContent < 4 ? range->rootContent : 4;
+    xmlParserCtxtPtr ctxt =
+        createContext(parser, start, end, onChars, range->data, (int)offset);
+    if (!ctxt)
+    {
+        free(endTag);
+        return 1;
+    }
+    if (range->quiet)
+    {
+        ctxt->sax->serror = ignoreError;
+    }
+    int status =
+        pushWindows(parser, ctxt, range->data, offset, range->rootContent) ||
+        pushWindows(parser, ctxt, range->data, range->begin, range->end) ||
+        parseChunk(parser, ctxt, endTag, endTagLength);
+    if (status && !range->quiet && !parser->stopped)
+    {
+        xmlParserError(ctxt, "xmlParseChunk");
+    }
+    free(endTag);
+    return finish(ctxt, status, !range->quiet && !parser->stopped);
+}
+
+static int runRange(Parser *parser, const Parser_Range *range,
+                    Parser_callbackStart start, Parser_callbackEnd end,
+                    Parser_callbackChar onChars)
+{
+    if (!range->rootContent || range->begin < range->rootContent ||
+        range->end < range->begin)
+    {
+        return 1;
+    }
+#ifdef NODESETLOADER_TOKENIZER
+    if (parser->useTokenizer)
+    {
+        if (!parser->tokenizer)
+        {
+            parser->tokenizer = Tokenizer_new();
+        }
+        Tokenizer_Status status =
+            parser->tokenizer
+                ? Tokenizer_runRange(parser->tokenizer, range,
+                                     parser->context, start, end, onChars)
+                : TOKENIZER_UNSUPPORTED;
+        if (status != TOKENIZER_UNSUPPORTED)
+        {
+            return status == TOKENIZER_OK ? 0 : 1;
+        }
+    }
+#endif
+    return runRangeXml(parser, range, start, end, onChars);
+}
+
+int Parser_runRange(Parser *parser, const Parser_Range *range,
+                    Parser_callbackStart start, Parser_callbackEnd end,
+                    Parser_callbackChar onChars)
+{
+    double begin = startTiming(parser);
+    parser->timing.bytes =
+        range->end > range->begin ? range->end - range->begin : 0;
+    return stopTiming(parser, begin, runRange(parser, range, start, end, onChars));
+}
+
+// the stream is read and parsed chunk by chunk, compressed streams are
+// decompressed on the fly without an intermediate copy of the whole data
+static int runStream(Parser *parser, InputStream *stream,
+                     Parser_callbackStart start, Parser_callbackEnd end,
+                     Parser_callbackChar onChars)
+{
+    char *chars = (char *)malloc(PARSER_READ_CHUNK_SIZE);
+    if (!chars)
+    {
+        return 1;
+    }
+    long res = InputStream_read(stream, chars, 4);
+    if (res <= 0)
+    {
+        free(chars);
+        return 1;
+    }
+
+    xmlParserCtxtPtr ctxt =
+        createContext(parser, start, end, onChars, chars, (int)res);
+    if (!ctxt)
+    {
+        free(chars);
+        return 1;
+    }
+    int status = 0;
+    while ((res = InputStream_read(stream, chars, PARSER_READ_CHUNK_SIZE)) > 0)
+    {
+        if (parseChunk(parser, ctxt, chars, (size_t)res))
+        {
+            xmlParserError(ctxt, "xmlParseChunk");
+            status = 1;
+            break;
+        }
+        if (!reportProgress(parser, ctxt, parser->timing.bytes))
+        {
+            free(chars);
+            return finish(ctxt, 1, false);
+        }
+    }
+    if (res < 0)
+    {
+        status = 1;
+    }
+    free(chars);
+    return finish(ctxt, status, true);
+}
+
+struct TimedRead
+{
+    NL_readCallback read;
+    void *context;
+    Parser_Timing *timing;
+};
+
+// the time spent in the read callback is the time waiting for the input
+static long timedRead(void *context, char *buffer, size_t size)
+{
+    struct TimedRead *timed = (struct TimedRead *)context;
+    double begin = Clock_now();
+    long res = timed->read(timed->context, buffer, size);
+    timed->timing->ioWait += Clock_now() - begin;
+    if (res > 0)
+    {
+        timed->timing->bytes += (size_t)res;
+    }
+    return res;
+}
+
+static int runTimedStream(Parser *parser, NL_readCallback read,
+                          void *context, Parser_callbackStart start,
+                          Parser_callbackEnd end, Parser_callbackChar onChars)
+{
+    struct TimedRead timed = {read, context, &parser->timing};
+    InputStream *stream = InputStream_new(timedRead, &timed);
+    if (!stream)
+    {
+        return 1;
+    }
+    int status = runStream(parser, stream, start, end, onChars);
+    InputStream_delete(stream);
+    return status;
+}
+
+int Parser_runStream(Parser *parser, NL_readCallback read, void *context,
+                     Parser_callbackStart start, Parser_callbackEnd end,
+                     Parser_callbackChar onChars)
+{
+    double begin = startTiming(parser);
+    return stopTiming(
+        parser, begin,
+        runTimedStream(parser, read, context, start, end, onChars));
+}
+
+int Parser_runBuffer(Parser *parser, const char *data, size_t length,
+                     Parser_callbackStart start, Parser_callbackEnd end,
+                     Parser_callbackChar onChars)
+{
+    double begin = startTiming(parser);
+    if (data && InputStream_isCompressed(data, length))
+    {
+        InputStream_Memory memory = {data, length, 0};
+        return stopTiming(parser, begin,
+                          runTimedStream(parser, InputStream_readMemory,
+                                         &memory, start, end, onChars));
+    }
+    parser->timing.bytes = length;
+    return stopTiming(
+        parser, begin,
+        runWindows(parser, data, length, NULL, start, end, onChars));
+}
+
+// the reader thread fills the next buffers while the current one is parsed
+static int runReadAhead(Parser *parser, FILE *file, Parser_callbackStart start,
+                        Parser_callbackEnd end, Parser_callbackChar onChars)
+{
+    ReadAhead *readAhead = ReadAhead_new(file);
+    if (!readAhead)
+    {
+        return runTimedStream(parser, InputStream_readFile, file, start, end,
+                              onChars);
+    }
+    int status = runTimedStream(parser, ReadAhead_read, readAhead, start, end,
+                                onChars);
+    ReadAhead_delete(readAhead);
+    return status;
+}
+
+static int runFile(Parser *parser, FILE *file, Parser_callbackStart start,
+                   Parser_callbackEnd end, Parser_callbackChar onChars)
+{
+    if (parser->inputMode == PARSER_INPUT_READAHEAD)
+    {
+        return runReadAhead(parser, file, start, end, onChars);
+    }
+    if (parser->inputMode == PARSER_INPUT_AUTO)
+    {
+        FileMapping *mapping = FileMapping_new(file);
+        // compressed files are small, they are read like any other stream
+        if (mapping && !InputStream_isCompressed(mapping->data, mapping->size))
+        {
+            FileMapping_adviseSequential(mapping);
+            parser->timing.bytes = mapping->size;
+            int status = runWindows(parser, mapping->data, mapping->size,
+                                    mapping, start, end, onChars);
+            FileMapping_delete(mapping);
+            return status;
+        }
+        FileMapping_delete(mapping);
+    }
+    return runTimedStream(parser, InputStream_readFile, file, start, end,
+                          onChars);
+}
+
+int Parser_run(Parser *parser, FILE *file, Parser_callbackStart start,
+               Parser_callbackEnd end, Parser_callbackChar onChars)
+{
+    double begin = startTiming(parser);
+    return stopTiming(parser, begin,
+                      runFile(parser, file, start, end, onChars));
+}
+
+const Parser_Timing *Parser_getTiming(const Parser *parser)
+{
+    return &parser->timing;
+}
+
+void Parser_delete(Parser *parser)
+{
+    if (parser->ctxt)
+    {
+        xmlFreeParserCtxt(parser->ctxt);
+    }
+#ifdef NODESETLOADER_TOKENIZER
+    Tokenizer_delete(parser->tokenizer);
+#endif
+    free(parser);
+}
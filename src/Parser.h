@@ -7,6 +7,8 @@
 
 #ifndef PARSER_H
 #define PARSER_H
+#include <NodesetLoader/NodesetLoader.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 struct Parser;
@@ -23,8 +25,77 @@ typedef void (*Parser_callbackEnd)(void *ctx, const char *localname,
 
 typedef void (*Parser_callbackChar)(void *ctx, const char *ch, int len);
 
+// bytes of the current run which were handed to libxml2, returns false to
+// stop the run, it fails then
+typedef bool (*Parser_callbackProgress)(void *ctx, size_t bytes);
+
+typedef enum
+{
+    // regular uncompressed files are memory mapped, everything else is read
+    // in chunks
+    PARSER_INPUT_AUTO,
+    // always read the file in chunks
+    PARSER_INPUT_BUFFERED,
+    // read the file in chunks on a separate thread while parsing
+    PARSER_INPUT_READAHEAD
+} Parser_InputMode;
+
+// measured for the last run
+typedef struct
+{
+    // bytes of the input, compressed input counts with its compressed size
+    size_t bytes;
+    // milliseconds spent waiting for the read callback (or the read ahead
+    // thread), 0 for mapped files and data in memory
+    double ioWait;
+    // milliseconds of the whole run, including ioWait
+    double total;
+    // calls of xmlParseChunk with data, 0 for the tokenizer
+    size_t chunks;
+} Parser_Timing;
+
+// the content [begin, end) of the root element of a document in memory
+typedef struct
+{
+    const char *data;
+    // offset right after the start tag of the root element
+    size_t rootContent;
+    // qualified name of the root element
+    const char *rootName;
+    size_t rootNameLength;
+    size_t begin;
+    size_t end;
+    // errors are expected, e.g. if the range was guessed, they are not
+    // reported
+    bool quiet;
+} Parser_Range;
+
+// the parser can be used for several runs, libxml2 state is kept between them
 Parser *Parser_new(void *context);
+// context which is passed to the callbacks
+void Parser_setContext(Parser *parser, void *context);
+void Parser_setInputMode(Parser *parser, Parser_InputMode mode);
+// combination of NL_PARSER_OPTION_*, NL_PARSER_OPTION_READ_AHEAD selects
+// PARSER_INPUT_READAHEAD
+void Parser_setOptions(Parser *parser, int options);
+// called with the context about every MiB of the input, not for runs of the
+// tokenizer
+void Parser_setProgress(Parser *parser, Parser_callbackProgress progress);
 int Parser_run(Parser *parser, FILE *file, Parser_callbackStart start,
                Parser_callbackEnd end, Parser_callbackChar onChars);
+// parses a nodeset which is already in memory, the data is not copied
+int Parser_runBuffer(Parser *parser, const char *data, size_t length,
+                     Parser_callbackStart start, Parser_callbackEnd end,
+                     Parser_callbackChar onChars);
+// parses the start tag of the root element and then only the range, the end
+// tag of the root element is added, so the callbacks see a complete document
+// with a part of the content, the range has to consist of complete elements
+int Parser_runRange(Parser *parser, const Parser_Range *range,
+                    Parser_callbackStart start, Parser_callbackEnd end,
+                    Parser_callbackChar onChars);
+int Parser_runStream(Parser *parser, NL_readCallback read, void *context,
+                     Parser_callbackStart start, Parser_callbackEnd end,
+                     Parser_callbackChar onChars);
+const Parser_Timing *Parser_getTiming(const Parser *parser);
 void Parser_delete(Parser *parser);
 #endif
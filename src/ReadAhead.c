@@ -0,0 +1,245 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define READAHEAD_FADVISE 1
+#endif
+
+#include "ReadAhead.h"
+#include "Thread.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef READAHEAD_FADVISE
+#include <fcntl.h>
+#endif
+
+#define READAHEAD_BUFFER_COUNT 4
+#define READAHEAD_BUFFER_SIZE (1024 * 1024)
+
+struct Buffer
+{
+    char *data;
+    // 0 for an empty buffer
+    size_t size;
+};
+
+struct ReadAhead
+{
+    FILE *file;
+    struct Buffer buffers[READAHEAD_BUFFER_COUNT];
+    // buffer which is read by the parser and the position in it
+    size_t readIndex;
+    size_t readPos;
+    // buffer which is filled next by the reader thread
+    size_t writeIndex;
+    // offset in the file of the next read
+    long offset;
+    bool end;
+    bool failed;
+    bool stop;
+    Thread thread;
+    bool threaded;
+#ifdef NODESETLOADER_THREADS
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+#endif
+};
+
+static void advise(const ReadAhead *ra, int advice, long offset, long size)
+{
+#if defined(READAHEAD_FADVISE) && defined(POSIX_FADV_WILLNEED)
+    int fd = fileno(ra->file);
+    if (fd >= 0 && offset >= 0)
+    {
+        posix_fadvise(fd, (off_t)offset, (off_t)size, advice);
+    }
+#endif
+}
+
+// reads the next buffer, returns the number of bytes read
+static size_t fill(ReadAhead *ra, char *data)
+{
+#if defined(READAHEAD_FADVISE) && defined(POSIX_FADV_WILLNEED)
+    // the buffer after this one, the ring is read by then
+    advise(ra, POSIX_FADV_WILLNEED, ra->offset + READAHEAD_BUFFER_SIZE,
+           READAHEAD_BUFFER_SIZE);
+#endif
+    size_t size = fread(data, 1, READAHEAD_BUFFER_SIZE, ra->file);
+    ra->offset += (long)size;
+    if (size < READAHEAD_BUFFER_SIZE)
+    {
+        ra->failed = ferror(ra->file) != 0;
+    }
+    return size;
+}
+
+#ifdef NODESETLOADER_THREADS
+static void runReader(void *arg)
+{
+    ReadAhead *ra = (ReadAhead *)arg;
+    pthread_mutex_lock(&ra->mutex);
+    while (!ra->stop && !ra->end)
+    {
+        struct Buffer *buffer = &ra->buffers[ra->writeIndex];
+        if (buffer->size)
+        {
+            // all buffers are filled, wait for the parser
+            pthread_cond_wait(&ra->changed, &ra->mutex);
+            continue;
+        }
+        // an empty buffer is not touched by the parser
+        pthread_mutex_unlock(&ra->mutex);
+        size_t size = fill(ra, buffer->data);
+        pthread_mutex_lock(&ra->mutex);
+        buffer->size = size;
+        ra->end = size < READAHEAD_BUFFER_SIZE;
+        ra->writeIndex = (ra->writeIndex + 1) % READAHEAD_BUFFER_COUNT;
+        pthread_cond_signal(&ra->changed);
+    }
+    pthread_mutex_unlock(&ra->mutex);
+}
+#endif
+
+ReadAhead *ReadAhead_new(FILE *file)
+{
+    ReadAhead *ra = (ReadAhead *)calloc(1, sizeof(ReadAhead));
+    if (!ra)
+    {
+        return NULL;
+    }
+    ra->file = file;
+    ra->offset = ftell(file);
+    for (size_t i = 0; i < READAHEAD_BUFFER_COUNT; i++)
+    {
+        ra->buffers[i].data = (char *)malloc(READAHEAD_BUFFER_SIZE);
+        if (!ra->buffers[i].data)
+        {
+            ReadAhead_delete(ra);
+            return NULL;
+        }
+    }
+#if defined(READAHEAD_FADVISE) && defined(POSIX_FADV_SEQUENTIAL)
+    advise(ra, POSIX_FADV_SEQUENTIAL, ra->offset, 0);
+#endif
+#ifdef NODESETLOADER_THREADS
+    if (pthread_mutex_init(&ra->mutex, NULL))
+    {
+        return ra;
+    }
+    if (pthread_cond_init(&ra->changed, NULL))
+    {
+        pthread_mutex_destroy(&ra->mutex);
+        return ra;
+    }
+    ra->threaded = Thread_create(&ra->thread, runReader, ra);
+    if (!ra->threaded)
+    {
+        pthread_cond_destroy(&ra->changed);
+        pthread_mutex_destroy(&ra->mutex);
+    }
+#endif
+    return ra;
+}
+
+// the next buffer with data, NULL at the end
+static struct Buffer *nextBuffer(ReadAhead *ra)
+{
+    struct Buffer *buffer = &ra->buffers[ra->readIndex];
+#ifdef NODESETLOADER_THREADS
+    if (ra->threaded)
+    {
+        pthread_mutex_lock(&ra->mutex);
+        while (!buffer->size && !ra->end)
+        {
+            pthread_cond_wait(&ra->changed, &ra->mutex);
+        }
+        pthread_mutex_unlock(&ra->mutex);
+        return buffer->size ? buffer : NULL;
+    }
+#endif
+    if (!buffer->size && !ra->end)
+    {
+        buffer->size = fill(ra, buffer->data);
+        ra->end = buffer->size < READAHEAD_BUFFER_SIZE;
+    }
+    return buffer->size ? buffer : NULL;
+}
+
+static void releaseBuffer(ReadAhead *ra, struct Buffer *buffer)
+{
+#ifdef NODESETLOADER_THREADS
+    if (ra->threaded)
+    {
+        pthread_mutex_lock(&ra->mutex);
+        buffer->size = 0;
+        pthread_cond_signal(&ra->changed);
+        pthread_mutex_unlock(&ra->mutex);
+    }
+    else
+#endif
+    {
+        buffer->size = 0;
+    }
+    ra->readIndex = (ra->readIndex + 1) % READAHEAD_BUFFER_COUNT;
+    ra->readPos = 0;
+}
+
+long ReadAhead_read(void *readAhead, char *buffer, size_t size)
+{
+    ReadAhead *ra = (ReadAhead *)readAhead;
+    size_t copied = 0;
+    while (copied < size)
+    {
+        struct Buffer *next = nextBuffer(ra);
+        if (!next)
+        {
+            break;
+        }
+        size_t len = next->size - ra->readPos;
+        if (len > size - copied)
+        {
+            len = size - copied;
+        }
+        memcpy(buffer + copied, next->data + ra->readPos, len);
+        copied += len;
+        ra->readPos += len;
+        if (ra->readPos == next->size)
+        {
+            releaseBuffer(ra, next);
+        }
+    }
+    if (!copied && ra->failed)
+    {
+        return -1;
+    }
+    return (long)copied;
+}
+
+void ReadAhead_delete(ReadAhead *ra)
+{
+    if (!ra)
+    {
+        return;
+    }
+#ifdef NODESETLOADER_THREADS
+    if (ra->threaded)
+    {
+        pthread_mutex_lock(&ra->mutex);
+        ra->stop = true;
+        pthread_cond_signal(&ra->changed);
+        pthread_mutex_unlock(&ra->mutex);
+        Thread_join(&ra->thread);
+        pthread_cond_destroy(&ra->changed);
+        pthread_mutex_destroy(&ra->mutex);
+    }
+#endif
+    for (size_t i = 0; i < READAHEAD_BUFFER_COUNT; i++)
+    {
+        free(ra->buffers[i].data);
+    }
+    free(ra);
+}
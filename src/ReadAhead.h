@@ -0,0 +1,24 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef READAHEAD_H
+#define READAHEAD_H
+#include <stddef.h>
+#include <stdio.h>
+
+// reads a file on a separate thread into a ring of large buffers, so reading
+// and parsing overlap, the kernel is asked to prefetch the next buffers
+// without threads the file is read on the calling thread
+struct ReadAhead;
+typedef struct ReadAhead ReadAhead;
+
+// starts reading at the current position of the file
+ReadAhead *ReadAhead_new(FILE *file);
+// read callback (NL_readCallback) for a ReadAhead, blocks until the reader
+// thread has filled the next buffer
+long ReadAhead_read(void *readAhead, char *buffer, size_t size);
+// stops the reader thread, the file can be closed afterwards
+void ReadAhead_delete(ReadAhead *readAhead);
+#endif
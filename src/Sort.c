@@ -6,6 +6,7 @@
  */
 
 #include "Sort.h"
+#include "MemoryUsage.h"
 #include <NodesetLoader/NodesetLoader.h>
 #include <assert.h>
 #include <stdbool.h>
@@ -24,13 +25,21 @@ typedef struct edge edge;
 
 struct node
 {
-    const NL_NodeId *id;
+    // a copy, the strings of the ids outlive streamed nodes
+    NL_NodeId id;
     struct node *left, *right;
     int balance;
     struct node *qlink;
     struct edge *edges;
     size_t edgeCount;
     NL_Node *data;
+    // passed to the callback (or known without data) in a sort
+    bool emitted;
+    // held back by a stream and counted for the spill budget
+    bool held;
+    // the data was written to the spill at position
+    bool spilled;
+    long position;
 };
 
 typedef struct node node;
@@ -41,6 +50,22 @@ struct SortContext
     node *zeros;
     node *root1;
     size_t keyCnt;
+    // ready nodes are passed to the stream callback while they are added,
+    // see Sort_setStream
+    Sort_SortedNodeCallback streamCallback;
+    struct Nodeset *streamNodeset;
+    // the namespaces of added nodes, indexed by nsIdx
+    bool *namespaces;
+    size_t namespacesSize;
+    // see Sort_setSpill, size is NULL if nothing is counted
+    Sort_Spill spill;
+    size_t heldBytes;
+    size_t peakHeldBytes;
+    bool spillFailed;
+    // see Sort_cancel
+    bool cancelled;
+    // see Sort_peakPending
+    size_t peakPending;
 };
 
 static node *new_node(const NL_NodeId *id)
@@ -50,8 +75,12 @@ static node *new_node(const NL_NodeId *id)
     {
         return NULL;
     }
+    MEMORY_ALLOCATED(NL_MEMORY_SORT, sizeof(node));
 
-    k->id = id;
+    if (id)
+    {
+        k->id = *id;
+    }
     k->left = k->right = NULL;
     k->balance = 0;
 
@@ -78,7 +107,7 @@ static node *search_node(node *rootNode, const NL_NodeId *nodeId)
 
     while (true)
     {
-        int a = NodesetLoader_NodeId_cmp(nodeId, p->id);
+        int a = NodesetLoader_NodeId_cmp(nodeId, &p->id);
         if (a == 0)
             return p;
 
@@ -96,8 +125,8 @@ static node *search_node(node *rootNode, const NL_NodeId *nodeId)
             else
                 p->right = q;
 
-            assert(NodesetLoader_NodeId_cmp(nodeId, s->id));
-            if (NodesetLoader_NodeId_cmp(nodeId, s->id) < 0)
+            assert(NodesetLoader_NodeId_cmp(nodeId, &s->id));
+            if (NodesetLoader_NodeId_cmp(nodeId, &s->id) < 0)
             {
                 r = p = s->left;
                 a = -1;
@@ -110,8 +139,8 @@ static node *search_node(node *rootNode, const NL_NodeId *nodeId)
 
             while (p != q)
             {
-                assert(NodesetLoader_NodeId_cmp(nodeId, p->id));
-                if (NodesetLoader_NodeId_cmp(nodeId, p->id) < 0)
+                assert(NodesetLoader_NodeId_cmp(nodeId, &p->id));
+                if (NodesetLoader_NodeId_cmp(nodeId, &p->id) < 0)
                 {
                     p->balance = -1;
                     p = p->left;
@@ -192,7 +221,12 @@ static node *search_node(node *rootNode, const NL_NodeId *nodeId)
 
 static void record_relation(node *from, node *to)
 {
-    if (NodesetLoader_NodeId_cmp(from->id, to->id))
+    // an edge to or from an emitted node can't change the order anymore
+    if (from->emitted || to->emitted)
+    {
+        return;
+    }
+    if (NodesetLoader_NodeId_cmp(&from->id, &to->id))
     {
         to->edgeCount++;
         struct edge *e;
@@ -201,21 +235,25 @@ static void record_relation(node *from, node *to)
         {
             return;
         }
+        MEMORY_ALLOCATED(NL_MEMORY_SORT, sizeof(edge));
         e->dest = to;
         e->next = from->edges;
         from->edges = e;
     }
 }
 
-static bool count_items(SortContext *ctx, node *unused)
+static bool count_items(SortContext *ctx, node *k)
 {
-    ctx->keyCnt++;
+    if (!k->emitted)
+    {
+        ctx->keyCnt++;
+    }
     return false;
 }
 
 static bool scan_zeros(SortContext *ctx, node *k)
 {
-    if (k->edgeCount == 0 && k->id)
+    if (k->edgeCount == 0 && !k->emitted)
     {
         if (ctx->head == NULL)
             ctx->head = k;
@@ -269,6 +307,7 @@ static void cleanupEdges(edge *e)
     {
         edge *next = tmp->next;
         free(tmp);
+        MEMORY_FREED(NL_MEMORY_SORT, sizeof(edge));
         tmp = next;
     }
 }
@@ -283,6 +322,33 @@ static void cleanupSubtree(node *n)
     cleanupSubtree(n->right);
     cleanupEdges(n->edges);
     free(n);
+    MEMORY_FREED(NL_MEMORY_SORT, sizeof(node));
+}
+
+static void forEachPending(node *n, void (*fn)(NL_Node *node))
+{
+    if (!n)
+    {
+        return;
+    }
+    forEachPending(n->left, fn);
+    forEachPending(n->right, fn);
+    if (n->data && !n->emitted)
+    {
+        NL_Node *data = n->data;
+        n->data = NULL;
+        fn(data);
+    }
+}
+
+void Sort_forEachPending(SortContext *ctx, void (*fn)(struct NL_Node *node))
+{
+    forEachPending(ctx->root1, fn);
+}
+
+void Sort_cancel(SortContext *ctx)
+{
+    ctx->cancelled = true;
 }
 
 void Sort_cleanup(SortContext *ctx)
@@ -291,15 +357,159 @@ void Sort_cleanup(SortContext *ctx)
     {
         cleanupSubtree(ctx->root1);
     }
+    free(ctx->namespaces);
     free(ctx);
 }
 
-void Sort_addNode(SortContext *ctx, NL_Node *data)
+void Sort_setStream(SortContext *ctx, struct Nodeset *nodeset,
+                    Sort_SortedNodeCallback callback)
+{
+    ctx->streamCallback = callback;
+    ctx->streamNodeset = nodeset;
+}
+
+void Sort_setSpill(SortContext *ctx, const Sort_Spill *spill)
+{
+    if (spill)
+    {
+        ctx->spill = *spill;
+    }
+    else
+    {
+        memset(&ctx->spill, 0, sizeof(Sort_Spill));
+    }
+}
+
+void Sort_addNamespace(SortContext *ctx, int nsIdx)
+{
+    if (nsIdx < 0)
+    {
+        return;
+    }
+    if ((size_t)nsIdx >= ctx->namespacesSize)
+    {
+        size_t size = (size_t)nsIdx + 1;
+        bool *namespaces =
+            (bool *)realloc(ctx->namespaces, size * sizeof(bool));
+        if (!namespaces)
+        {
+            return;
+        }
+        memset(namespaces + ctx->namespacesSize, 0,
+               (size - ctx->namespacesSize) * sizeof(bool));
+        ctx->namespaces = namespaces;
+        ctx->namespacesSize = size;
+    }
+    ctx->namespaces[nsIdx] = true;
+}
+
+// a predecessor which is neither added nor in a namespace of the imported
+// files is expected to exist before the import
+static bool isExternal(const SortContext *ctx, const node *k)
+{
+    return !k->data && !k->spilled && (k->id.nsIdx < 0 ||
+                        (size_t)k->id.nsIdx >= ctx->namespacesSize ||
+                        !ctx->namespaces[k->id.nsIdx]);
+}
+
+// a node which is held back by a stream, it is spilled if the held back nodes
+// in memory exceed the budget
+static void hold(SortContext *ctx, node *k)
+{
+    if (!ctx->spill.size || k->held || k->spilled)
+    {
+        return;
+    }
+    size_t size = ctx->spill.size(ctx->streamNodeset, k->data);
+    if (ctx->spill.write && ctx->heldBytes + size > ctx->spill.budget &&
+        ctx->spill.write(ctx->streamNodeset, k->data, &k->position))
+    {
+        k->data = NULL;
+        k->spilled = true;
+        return;
+    }
+    ctx->heldBytes += size;
+    if (ctx->heldBytes > ctx->peakHeldBytes)
+    {
+        ctx->peakHeldBytes = ctx->heldBytes;
+    }
+    k->held = true;
+}
+
+// the data of the node, read back from the spill if it was spilled
+static NL_Node *takeData(SortContext *ctx, node *k)
+{
+    NL_Node *data = k->data;
+    if (k->spilled)
+    {
+        data = ctx->spill.read(ctx->streamNodeset, k->position);
+        ctx->spillFailed = ctx->spillFailed || !data;
+        k->spilled = false;
+    }
+    else if (k->held)
+    {
+        ctx->heldBytes -= ctx->spill.size(ctx->streamNodeset, data);
+        k->held = false;
+    }
+    return data;
+}
+
+// passes the node and all nodes which become ready by it to the stream
+// callback, in the order of Sort_start
+static void emit(SortContext *ctx, node *ready)
+{
+    node *head = ready;
+    node *tail = ready;
+    ready->qlink = NULL;
+    while (head)
+    {
+        NL_Node *data = takeData(ctx, head);
+        edge *e = head->edges;
+        head->data = NULL;
+        head->edges = NULL;
+        head->emitted = true;
+        if (data)
+        {
+            ctx->streamCallback(ctx->streamNodeset, data);
+        }
+        while (e)
+        {
+            node *dest = e->dest;
+            dest->edgeCount--;
+            if (dest->edgeCount == 0 && (dest->data || dest->spilled))
+            {
+                dest->qlink = NULL;
+                tail->qlink = dest;
+                tail = dest;
+            }
+            edge *next = e->next;
+            free(e);
+            MEMORY_FREED(NL_MEMORY_SORT, sizeof(edge));
+            e = next;
+        }
+        head = head->qlink;
+    }
+}
+
+NL_Node *Sort_addNode(SortContext *ctx, NL_Node *data)
 {
     node *j = NULL;
     // add node, no matter if there are references on it
     j = search_node(ctx->root1, &data->id);
+    // the node with this NodeId was passed already, the order of its
+    // successors can't change anymore
+    if (j->emitted)
+    {
+        return data;
+    }
+    // the added node replaces a pending node with its NodeId, which is
+    // neither held back nor spilled anymore
+    NL_Node *replaced = takeData(ctx, j);
     j->data = data;
+    if (ctx->streamCallback)
+    {
+        Sort_addNamespace(ctx, data->id.nsIdx);
+    }
     NL_Reference *hierachicalRef = data->hierachicalRefs;
     if (hierachicalRef)
     {
@@ -309,7 +519,10 @@ void Sort_addNode(SortContext *ctx, NL_Node *data)
             {
 
                 node *k = search_node(ctx->root1, &hierachicalRef->target);
-                record_relation(k, j);
+                if (!ctx->streamCallback || !isExternal(ctx, k))
+                {
+                    record_relation(k, j);
+                }
             }
             else
             {
@@ -339,6 +552,8 @@ void Sort_addNode(SortContext *ctx, NL_Node *data)
                         {
                             NL_Reference *newRef =
                                 (NL_Reference *)calloc(1, sizeof(NL_Reference));
+                            MEMORY_ALLOCATED(NL_MEMORY_REFERENCES,
+                                             sizeof(NL_Reference));
                             newRef->isForward = !r->isForward;
                             newRef->target = k->data->id;
                             newRef->refType = r->refType;
@@ -351,12 +566,25 @@ void Sort_addNode(SortContext *ctx, NL_Node *data)
             }
         }
     }
+    if (ctx->streamCallback && j->edgeCount == 0)
+    {
+        emit(ctx, j);
+    }
+    else if (ctx->streamCallback)
+    {
+        hold(ctx, j);
+    }
+    return replaced;
 }
 
 bool Sort_start(SortContext *ctx, struct Nodeset *nodeset,
                 Sort_SortedNodeCallback callback, NodesetLoader_Logger *logger)
 {
     walk_tree(ctx, ctx->root1, count_items);
+    if (ctx->keyCnt > ctx->peakPending)
+    {
+        ctx->peakPending = ctx->keyCnt;
+    }
 
     while (ctx->keyCnt > 0)
     {
@@ -366,12 +594,17 @@ bool Sort_start(SortContext *ctx, struct Nodeset *nodeset,
         {
             edge *e = ctx->head->edges;
 
-            if (ctx->head->data != NULL)
+            NL_Node *data = takeData(ctx, ctx->head);
+            if (data != NULL)
+            {
+                callback(nodeset, data);
+            }
+            if (ctx->streamCallback)
             {
-                callback(nodeset, ctx->head->data);
+                ctx->head->data = NULL;
             }
 
-            ctx->head->id = NULL;
+            ctx->head->emitted = true;
             ctx->keyCnt--;
 
             while (e)
@@ -385,6 +618,20 @@ bool Sort_start(SortContext *ctx, struct Nodeset *nodeset,
                 e = e->next;
             }
             ctx->head = ctx->head->qlink;
+            if (ctx->cancelled)
+            {
+                ctx->cancelled = false;
+                return false;
+            }
+        }
+        if (ctx->spillFailed)
+        {
+            if (logger)
+            {
+                logger->log(logger->context, NODESETLOADER_LOGLEVEL_ERROR,
+                            "spilled node could not be read, abort");
+            }
+            return false;
         }
         if (ctx->keyCnt > 0)
         {
@@ -398,3 +645,13 @@ bool Sort_start(SortContext *ctx, struct Nodeset *nodeset,
     }
     return true;
 }
+
+size_t Sort_peakPending(const SortContext *ctx)
+{
+    return ctx->peakPending;
+}
+
+size_t Sort_peakHeldBytes(const SortContext *ctx)
+{
+    return ctx->peakHeldBytes;
+}
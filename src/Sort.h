@@ -8,6 +8,7 @@
 #ifndef SORT_H
 #define SORT_H
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,9 +21,47 @@ struct NodesetLoader_Logger;
 typedef struct SortContext SortContext;
 SortContext* Sort_init(void);
 void Sort_cleanup(SortContext * ctx);
-void Sort_addNode(SortContext* ctx, struct NL_Node *node);
+// returns the node which is dropped: the pending node with the same NodeId,
+// read back if it was spilled, which the added node replaces, or the added
+// node if a node with its NodeId was passed already, NULL if there was none
+struct NL_Node *Sort_addNode(SortContext* ctx, struct NL_Node *node);
 typedef void (*Sort_SortedNodeCallback)(struct Nodeset *nodeset, struct NL_Node *node);
 bool Sort_start(SortContext* ctx, struct Nodeset *nodeset, Sort_SortedNodeCallback callback, struct NodesetLoader_Logger* logger);
+// Sort_addNode passes the added node and the nodes which become ready by it to
+// the callback as soon as their predecessors were passed, Sort_start passes
+// the remaining nodes, the passed nodes are not used by the context anymore
+void Sort_setStream(SortContext *ctx, struct Nodeset *nodeset,
+                    Sort_SortedNodeCallback callback);
+// a namespace which the imported files declare or which has added nodes, a
+// stream holds a node back while a predecessor in such a namespace is
+// missing, the predecessors in all other namespaces are expected to exist
+void Sort_addNamespace(SortContext *ctx, int nsIdx);
+// counts the nodes which a stream holds back and moves them out of memory
+typedef struct
+{
+    // bytes of the held back nodes which are kept in memory
+    size_t budget;
+    size_t (*size)(struct Nodeset *nodeset, const struct NL_Node *node);
+    // writes and deletes the node, false if it has to stay in memory, NULL
+    // only counts the held back nodes
+    bool (*write)(struct Nodeset *nodeset, struct NL_Node *node,
+                  long *position);
+    // NULL if the node cannot be read back
+    struct NL_Node *(*read)(struct Nodeset *nodeset, long position);
+} Sort_Spill;
+// only used with a stream, NULL neither counts nor spills the held back nodes
+void Sort_setSpill(SortContext *ctx, const Sort_Spill *spill);
+// called by the callback of Sort_start, the sort returns false after the
+// current node
+void Sort_cancel(SortContext *ctx);
+// passes the nodes which were added but never passed to a callback, e.g.
+// because the sort failed, and forgets them
+void Sort_forEachPending(SortContext *ctx, void (*fn)(struct NL_Node *node));
+// the most nodes of the graph which were not passed yet when a sort started,
+// including the referenced nodes which were never added
+size_t Sort_peakPending(const SortContext *ctx);
+// the most bytes of held back nodes which were in memory at once
+size_t Sort_peakHeldBytes(const SortContext *ctx);
 
 #ifdef __cplusplus
 }
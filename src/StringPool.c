@@ -0,0 +1,122 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "StringPool.h"
+#include "MemoryUsage.h"
+#include "StringTable.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct StringPool
+{
+    StringTable table;
+};
+
+// makes room for one more string, false if the pool is full
+static bool reserve(StringPool *pool)
+{
+    size_t size = pool->table.size;
+    if (!StringTable_reserve(&pool->table))
+    {
+        return false;
+    }
+    if (pool->table.size != size)
+    {
+        MEMORY_FREED(NL_MEMORY_ARENA, size * sizeof(StringTable_Slot));
+        MEMORY_ALLOCATED(NL_MEMORY_ARENA,
+                         pool->table.size * sizeof(StringTable_Slot));
+    }
+    return true;
+}
+
+StringPool *StringPool_new(void)
+{
+    StringPool *pool = (StringPool *)calloc(1, sizeof(StringPool));
+    if (!pool)
+    {
+        return NULL;
+    }
+    if (!StringTable_init(&pool->table, 1024))
+    {
+        free(pool);
+        return NULL;
+    }
+    MEMORY_ALLOCATED(NL_MEMORY_ARENA,
+                     pool->table.size * sizeof(StringTable_Slot));
+    return pool;
+}
+
+static char *copyString(CharArenaAllocator *arena, const char *s, size_t len)
+{
+    char *copy = CharArenaAllocator_malloc(arena, len + 1);
+    if (copy)
+    {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+char *StringPool_intern(StringPool *pool, CharArenaAllocator *arena,
+                        const char *s, size_t len)
+{
+    if (len > STRINGPOOL_MAX_LENGTH || !reserve(pool))
+    {
+        return copyString(arena, s, len);
+    }
+    uint32_t hash = StringTable_hash(s, len);
+    StringTable_Slot *slot = StringTable_find(&pool->table, s, len, hash);
+    if (!slot->s)
+    {
+        char *copy = copyString(arena, s, len);
+        if (!copy)
+        {
+            return NULL;
+        }
+        StringTable_add(&pool->table, slot, copy, len, hash, 0);
+    }
+    // the strings of the pool are allocated in the arena
+    return (char *)(uintptr_t)slot->s;
+}
+
+char *StringPool_internLast(StringPool *pool, CharArenaAllocator *arena,
+                            char *text)
+{
+    if (!text)
+    {
+        return NULL;
+    }
+    size_t len = strlen(text);
+    if (len > STRINGPOOL_MAX_LENGTH || !reserve(pool))
+    {
+        return text;
+    }
+    uint32_t hash = StringTable_hash(text, len);
+    StringTable_Slot *slot = StringTable_find(&pool->table, text, len, hash);
+    if (slot->s)
+    {
+        CharArenaAllocator_freeLast(arena);
+        return (char *)(uintptr_t)slot->s;
+    }
+    StringTable_add(&pool->table, slot, text, len, hash, 0);
+    return text;
+}
+
+size_t StringPool_size(const StringPool *pool)
+{
+    return pool->table.count;
+}
+
+void StringPool_delete(StringPool *pool)
+{
+    if (!pool)
+    {
+        return;
+    }
+    MEMORY_FREED(NL_MEMORY_ARENA, pool->table.size * sizeof(StringTable_Slot));
+    StringTable_cleanup(&pool->table);
+    free(pool);
+}
@@ -0,0 +1,31 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+#include <CharAllocator.h>
+#include <stddef.h>
+
+// longer strings are rarely repeated, they are copied each time
+#define STRINGPOOL_MAX_LENGTH 64
+
+// canonical copies of the short strings of a nodeset, equal strings share one
+// copy in the arena, the pool only knows the strings, they belong to the arena
+struct StringPool;
+typedef struct StringPool StringPool;
+
+StringPool *StringPool_new(void);
+// the canonical copy of the len bytes at s, it is allocated in the arena if
+// the pool doesn't know the string yet, NULL if the allocation failed
+char *StringPool_intern(StringPool *pool, CharArenaAllocator *arena,
+                        const char *s, size_t len);
+// text has to be the last allocation of the arena, it is given back if the
+// pool knows the string already, otherwise text becomes the canonical copy
+char *StringPool_internLast(StringPool *pool, CharArenaAllocator *arena,
+                            char *text);
+// number of distinct strings in the pool
+size_t StringPool_size(const StringPool *pool);
+void StringPool_delete(StringPool *pool);
+#endif
@@ -0,0 +1,94 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "StringTable.h"
+#include <stdlib.h>
+#include <string.h>
+
+uint32_t StringTable_hash(const char *s, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ (unsigned char)s[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool StringTable_init(StringTable *table, size_t size)
+{
+    table->slots = (StringTable_Slot *)calloc(size, sizeof(StringTable_Slot));
+    table->size = table->slots ? size : 0;
+    table->count = 0;
+    return table->slots != NULL;
+}
+
+void StringTable_cleanup(StringTable *table)
+{
+    free(table->slots);
+    table->slots = NULL;
+    table->size = 0;
+    table->count = 0;
+}
+
+bool StringTable_reserve(StringTable *table)
+{
+    if (2 * (table->count + 1) <= table->size)
+    {
+        return true;
+    }
+    size_t size = table->size ? table->size * 2 : 16;
+    StringTable_Slot *slots =
+        (StringTable_Slot *)calloc(size, sizeof(StringTable_Slot));
+    if (!slots)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < table->size; i++)
+    {
+        if (!table->slots[i].s)
+        {
+            continue;
+        }
+        size_t slot = table->slots[i].hash & (size - 1);
+        while (slots[slot].s)
+        {
+            slot = (slot + 1) & (size - 1);
+        }
+        slots[slot] = table->slots[i];
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->size = size;
+    return true;
+}
+
+StringTable_Slot *StringTable_find(const StringTable *table, const char *s,
+                                   size_t len, uint32_t hash)
+{
+    size_t mask = table->size - 1;
+    size_t slot = hash & mask;
+    while (table->slots[slot].s)
+    {
+        const StringTable_Slot *candidate = &table->slots[slot];
+        if (candidate->hash == hash && candidate->length == len &&
+            !memcmp(candidate->s, s, len))
+        {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return &table->slots[slot];
+}
+
+void StringTable_add(StringTable *table, StringTable_Slot *slot, const char *s,
+                     size_t len, uint32_t hash, uint32_t value)
+{
+    slot->s = s;
+    slot->length = len;
+    slot->hash = hash;
+    slot->value = value;
+    table->count++;
+}
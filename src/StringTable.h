@@ -0,0 +1,49 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef STRINGTABLE_H
+#define STRINGTABLE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// strings of a known length with a value each, open addressing with linear
+// probing, at most half of the slots are used
+// the table only refers to the strings, they have to outlive it
+struct StringTable_Slot
+{
+    // NULL for an empty slot
+    const char *s;
+    size_t length;
+    uint32_t hash;
+    uint32_t value;
+};
+typedef struct StringTable_Slot StringTable_Slot;
+
+struct StringTable
+{
+    StringTable_Slot *slots;
+    // a power of 2
+    size_t size;
+    size_t count;
+};
+typedef struct StringTable StringTable;
+
+// FNV-1a
+uint32_t StringTable_hash(const char *s, size_t len);
+// size is a power of 2, false if the slots cannot be allocated
+bool StringTable_init(StringTable *table, size_t size);
+void StringTable_cleanup(StringTable *table);
+// doubles the slots if they are half full, so there is room for one more
+// string, false if the slots cannot be allocated
+bool StringTable_reserve(StringTable *table);
+// the slot of the string, or the empty slot it belongs to if the table
+// doesn't know it yet, there has to be an empty slot
+StringTable_Slot *StringTable_find(const StringTable *table, const char *s,
+                                   size_t len, uint32_t hash);
+// s becomes the string of the empty slot which StringTable_find returned
+void StringTable_add(StringTable *table, StringTable_Slot *slot, const char *s,
+                     size_t len, uint32_t hash, uint32_t value);
+#endif
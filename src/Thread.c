@@ -0,0 +1,97 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define THREAD_SYSCONF 1
+#endif
+
+#include "Thread.h"
+#include <stdlib.h>
+#if defined(NODESETLOADER_THREADS) && defined(THREAD_SYSCONF)
+#include <unistd.h>
+#endif
+
+#ifdef NODESETLOADER_THREADS
+struct ThreadStart
+{
+    Thread_func fn;
+    void *arg;
+};
+
+static void *run(void *arg)
+{
+    struct ThreadStart start = *(struct ThreadStart *)arg;
+    free(arg);
+    start.fn(start.arg);
+    return NULL;
+}
+#endif
+
+bool Thread_create(Thread *thread, Thread_func fn, void *arg)
+{
+    thread->started = false;
+#ifdef NODESETLOADER_THREADS
+    struct ThreadStart *start =
+        (struct ThreadStart *)malloc(sizeof(struct ThreadStart));
+    if (start)
+    {
+        start->fn = fn;
+        start->arg = arg;
+        if (!pthread_create(&thread->handle, NULL, run, start))
+        {
+            thread->started = true;
+            return true;
+        }
+        free(start);
+    }
+#endif
+    return false;
+}
+
+void Thread_once(Thread_Once *once, void (*fn)(void))
+{
+#ifdef NODESETLOADER_THREADS
+    pthread_once(&once->once, fn);
+#else
+    if (!once->done)
+    {
+        once->done = true;
+        fn();
+    }
+#endif
+}
+
+void Thread_start(Thread *thread, Thread_func fn, void *arg)
+{
+    if (!Thread_create(thread, fn, arg))
+    {
+        fn(arg);
+    }
+}
+
+void Thread_join(Thread *thread)
+{
+#ifdef NODESETLOADER_THREADS
+    if (thread->started)
+    {
+        pthread_join(thread->handle, NULL);
+    }
+#endif
+    thread->started = false;
+}
+
+size_t Thread_cpuCount(void)
+{
+#if defined(NODESETLOADER_THREADS) && defined(THREAD_SYSCONF) &&               \
+    defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0)
+    {
+        return (size_t)count;
+    }
+#endif
+    return 1;
+}
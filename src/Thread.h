@@ -0,0 +1,57 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+#include <stdbool.h>
+#include <stddef.h>
+#ifdef NODESETLOADER_THREADS
+#include <pthread.h>
+#endif
+
+typedef void (*Thread_func)(void *arg);
+
+struct Thread
+{
+#ifdef NODESETLOADER_THREADS
+    pthread_t handle;
+#endif
+    // false if the function already ran on the calling thread
+    bool started;
+};
+typedef struct Thread Thread;
+
+// runs fn(arg) on a new thread, returns false if the library is built without
+// threads or the thread cannot be created, fn is not run in this case
+bool Thread_create(Thread *thread, Thread_func fn, void *arg);
+// runs fn(arg) on a new thread, if the library is built without threads or
+// the thread cannot be created, fn runs on the calling thread before
+// Thread_start returns
+void Thread_start(Thread *thread, Thread_func fn, void *arg);
+// waits until fn returned
+void Thread_join(Thread *thread);
+// number of processors which are online, 1 if it is unknown or the library
+// is built without threads
+size_t Thread_cpuCount(void);
+
+// runs a function once per process, initialized with THREAD_ONCE_INIT
+struct Thread_Once
+{
+#ifdef NODESETLOADER_THREADS
+    pthread_once_t once;
+#else
+    bool done;
+#endif
+};
+typedef struct Thread_Once Thread_Once;
+#ifdef NODESETLOADER_THREADS
+#define THREAD_ONCE_INIT {PTHREAD_ONCE_INIT}
+#else
+#define THREAD_ONCE_INIT {false}
+#endif
+// runs fn on the first call for once, the other calls return after fn
+// returned, without threads the calls must not run concurrently
+void Thread_once(Thread_Once *once, void (*fn)(void));
+#endif
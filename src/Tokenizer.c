@@ -0,0 +1,1096 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "Tokenizer.h"
+#include "CharScan.h"
+#include "StringTable.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define XML_NAMESPACE "http://www.w3.org/XML/1998/namespace"
+#define NAMETABLE_INITIAL_SIZE 256
+#define NAMEBLOCK_SIZE 4096
+
+struct NameBlock
+{
+    struct NameBlock *next;
+    size_t used;
+    size_t size;
+};
+
+// interned names, the equivalent of the libxml2 dictionary
+struct NameTable
+{
+    StringTable strings;
+    struct NameBlock *blocks;
+};
+
+struct NsDecl
+{
+    // NULL for the default namespace
+    const char *prefix;
+    const char *uri;
+};
+
+struct Element
+{
+    // qualified name in the document, for matching the end tag
+    const char *qname;
+    size_t qnameLen;
+    const char *localname;
+    const char *prefix;
+    const char *uri;
+    // namespace declarations of this element start here
+    size_t nsMark;
+};
+
+struct RawAttribute
+{
+    const char *qname;
+    size_t qnameLen;
+    // decoded values are stored in the scratch buffer, which may be
+    // reallocated while the attributes are parsed
+    const char *value;
+    size_t scratchOffset;
+    size_t valueLen;
+    bool isNamespace;
+};
+
+struct Tokenizer
+{
+    struct NameTable names;
+    const char *xmlPrefix;
+    const char *xmlUri;
+    char *scratch;
+    size_t scratchSize;
+    size_t scratchCap;
+    struct RawAttribute *raw;
+    size_t rawCap;
+    // 5 pointers for each attribute, like libxml2
+    const char **attributes;
+    size_t attributesCap;
+    // prefix and uri for each namespace declaration of an element
+    const char **namespaces;
+    size_t namespacesCap;
+    struct NsDecl *ns;
+    size_t nsSize;
+    size_t nsCap;
+    struct Element *elements;
+    size_t depth;
+    size_t elementsCap;
+
+    const char *p;
+    const char *end;
+    void *context;
+    Parser_callbackStart onStart;
+    Parser_callbackEnd onEnd;
+    Parser_callbackChar onChars;
+};
+
+// characters which end a name
+static const bool nameEnd[256] = {
+    [' '] = true, ['\t'] = true, ['\n'] = true, ['\r'] = true, ['/'] = true,
+    ['>'] = true, ['='] = true,  ['<'] = true,  ['"'] = true,  ['\''] = true,
+    ['&'] = true};
+
+// NULL is returned only if the allocation fails, so empty arrays are allocated
+// as well
+static void *growArray(void *array, size_t *cap, size_t needed,
+                       size_t elemSize)
+{
+    if (needed <= *cap && array)
+    {
+        return array;
+    }
+    size_t newCap = *cap ? *cap : 16;
+    if (needed == 0)
+    {
+        needed = 1;
+    }
+    while (newCap < needed)
+    {
+        newCap *= 2;
+    }
+    void *newArray = realloc(array, newCap * elemSize);
+    if (newArray)
+    {
+        *cap = newCap;
+    }
+    return newArray;
+}
+
+static char *allocName(struct NameTable *nt, size_t size)
+{
+    struct NameBlock *block = nt->blocks;
+    if (!block || block->size - block->used < size)
+    {
+        size_t blockSize = size > NAMEBLOCK_SIZE ? size : NAMEBLOCK_SIZE;
+        block = (struct NameBlock *)malloc(sizeof(struct NameBlock) +
+                                           blockSize);
+        if (!block)
+        {
+            return NULL;
+        }
+        block->size = blockSize;
+        block->used = 0;
+        block->next = nt->blocks;
+        nt->blocks = block;
+    }
+    char *mem = (char *)(block + 1) + block->used;
+    block->used += size;
+    return mem;
+}
+
+static const char *intern(Tokenizer *t, const char *s, size_t len)
+{
+    struct NameTable *nt = &t->names;
+    if (!StringTable_reserve(&nt->strings))
+    {
+        return NULL;
+    }
+    uint32_t hash = StringTable_hash(s, len);
+    StringTable_Slot *slot = StringTable_find(&nt->strings, s, len, hash);
+    if (slot->s)
+    {
+        return slot->s;
+    }
+    char *copy = allocName(nt, len + 1);
+    if (!copy)
+    {
+        return NULL;
+    }
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    StringTable_add(&nt->strings, slot, copy, len, hash, 0);
+    return copy;
+}
+
+Tokenizer *Tokenizer_new(void)
+{
+    Tokenizer *t = (Tokenizer *)calloc(1, sizeof(Tokenizer));
+    if (!t)
+    {
+        return NULL;
+    }
+    CharScan_init();
+    if (!StringTable_init(&t->names.strings, NAMETABLE_INITIAL_SIZE))
+    {
+        free(t);
+        return NULL;
+    }
+    t->xmlPrefix = intern(t, "xml", 3);
+    t->xmlUri = intern(t, XML_NAMESPACE, strlen(XML_NAMESPACE));
+    if (!t->xmlPrefix || !t->xmlUri)
+    {
+        Tokenizer_delete(t);
+        return NULL;
+    }
+    return t;
+}
+
+void Tokenizer_delete(Tokenizer *t)
+{
+    if (!t)
+    {
+        return;
+    }
+    struct NameBlock *block = t->names.blocks;
+    while (block)
+    {
+        struct NameBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    StringTable_cleanup(&t->names.strings);
+    free(t->scratch);
+    free(t->raw);
+    free(t->attributes);
+    free(t->namespaces);
+    free(t->ns);
+    free(t->elements);
+    free(t);
+}
+
+static bool appendScratch(Tokenizer *t, const char *s, size_t len)
+{
+    void *scratch = growArray(t->scratch, &t->scratchCap,
+                              t->scratchSize + len, sizeof(char));
+    if (!scratch)
+    {
+        return false;
+    }
+    t->scratch = (char *)scratch;
+    memcpy(t->scratch + t->scratchSize, s, len);
+    t->scratchSize += len;
+    return true;
+}
+
+static bool appendUtf8(Tokenizer *t, uint32_t cp)
+{
+    char buf[4];
+    size_t len;
+    if (cp < 0x80)
+    {
+        buf[0] = (char)cp;
+        len = 1;
+    }
+    else if (cp < 0x800)
+    {
+        buf[0] = (char)(0xC0 | (cp >> 6));
+        buf[1] = (char)(0x80 | (cp & 0x3F));
+        len = 2;
+    }
+    else if (cp < 0x10000)
+    {
+        buf[0] = (char)(0xE0 | (cp >> 12));
+        buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (cp & 0x3F));
+        len = 3;
+    }
+    else
+    {
+        buf[0] = (char)(0xF0 | (cp >> 18));
+        buf[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = (char)(0x80 | (cp & 0x3F));
+        len = 4;
+    }
+    return appendScratch(t, buf, len);
+}
+
+static bool startsWith(const Tokenizer *t, const char *literal, size_t len)
+{
+    return (size_t)(t->end - t->p) >= len && !memcmp(t->p, literal, len);
+}
+
+static bool isWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// returns true if at least one whitespace was skipped
+static bool skipWhitespace(Tokenizer *t)
+{
+    const char *begin = t->p;
+    while (t->p < t->end && isWhitespace(*t->p))
+    {
+        t->p++;
+    }
+    return t->p != begin;
+}
+
+static size_t scanName(Tokenizer *t)
+{
+    const char *begin = t->p;
+    while (t->p < t->end && !nameEnd[(unsigned char)*t->p])
+    {
+        t->p++;
+    }
+    return (size_t)(t->p - begin);
+}
+
+// skips to the character after the terminator, false if it is missing
+static bool skipPast(Tokenizer *t, const char *terminator, size_t len)
+{
+    while (t->p < t->end)
+    {
+        const char *hit = (const char *)memchr(t->p, terminator[0],
+                                               (size_t)(t->end - t->p));
+        if (!hit)
+        {
+            break;
+        }
+        t->p = hit;
+        if (startsWith(t, terminator, len))
+        {
+            t->p += len;
+            return true;
+        }
+        t->p++;
+    }
+    t->p = t->end;
+    return false;
+}
+
+// decodes the reference at t->p ('&') into the scratch buffer
+// like libxml2 without entity substitution, '&' is kept as "&#38;" in
+// attribute values
+static bool decodeReference(Tokenizer *t, bool inAttribute)
+{
+    const char *semicolon =
+        (const char *)memchr(t->p, ';', (size_t)(t->end - t->p));
+    if (!semicolon)
+    {
+        return false;
+    }
+    const char *name = t->p + 1;
+    size_t len = (size_t)(semicolon - name);
+    t->p = semicolon + 1;
+    if (len >= 2 && name[0] == '#')
+    {
+        uint32_t cp = 0;
+        bool hex = name[1] == 'x';
+        size_t i = hex ? 2 : 1;
+        if (i == len)
+        {
+            return false;
+        }
+        for (; i < len; i++)
+        {
+            char c = name[i];
+            uint32_t digit;
+            if (c >= '0' && c <= '9')
+            {
+                digit = (uint32_t)(c - '0');
+            }
+            else if (hex && c >= 'a' && c <= 'f')
+            {
+                digit = (uint32_t)(c - 'a' + 10);
+            }
+            else if (hex && c >= 'A' && c <= 'F')
+            {
+                digit = (uint32_t)(c - 'A' + 10);
+            }
+            else
+            {
+                return false;
+            }
+            cp = cp * (hex ? 16u : 10u) + digit;
+            if (cp > 0x10FFFF)
+            {
+                return false;
+            }
+        }
+        // only characters which are allowed in xml
+        if ((cp < 0x20 && cp != 0x9 && cp != 0xA && cp != 0xD) ||
+            (cp >= 0xD800 && cp <= 0xDFFF) || cp == 0xFFFE || cp == 0xFFFF)
+        {
+            return false;
+        }
+        if (cp == '&' && inAttribute)
+        {
+            return appendScratch(t, "&#38;", 5);
+        }
+        return appendUtf8(t, cp);
+    }
+    if (len == 2 && !memcmp(name, "lt", 2))
+    {
+        return appendScratch(t, "<", 1);
+    }
+    if (len == 2 && !memcmp(name, "gt", 2))
+    {
+        return appendScratch(t, ">", 1);
+    }
+    if (len == 3 && !memcmp(name, "amp", 3))
+    {
+        return inAttribute ? appendScratch(t, "&#38;", 5)
+                           : appendScratch(t, "&", 1);
+    }
+    if (len == 4 && !memcmp(name, "apos", 4))
+    {
+        return appendScratch(t, "'", 1);
+    }
+    if (len == 4 && !memcmp(name, "quot", 4))
+    {
+        return appendScratch(t, "\"", 1);
+    }
+    // other entities need a document type definition
+    return false;
+}
+
+static void emitCharacters(Tokenizer *t, const char *ch, size_t len)
+{
+    while (len > 0)
+    {
+        int chunk = len > INT_MAX ? INT_MAX : (int)len;
+        t->onChars(t->context, ch, chunk);
+        ch += chunk;
+        len -= (size_t)chunk;
+    }
+}
+
+// text up to the next '<', line breaks are normalized to '\n'
+static bool parseText(Tokenizer *t)
+{
+    const char *begin = t->p;
+    const char *stop = CharScan_text(begin, t->end);
+    if (stop == t->end || *stop == '<')
+    {
+        emitCharacters(t, begin, (size_t)(stop - begin));
+        t->p = stop;
+        return true;
+    }
+    t->scratchSize = 0;
+    if (!appendScratch(t, begin, (size_t)(stop - begin)))
+    {
+        return false;
+    }
+    t->p = stop;
+    while (t->p < t->end && *t->p != '<')
+    {
+        if (*t->p == '&')
+        {
+            if (!decodeReference(t, false))
+            {
+                return false;
+            }
+        }
+        else if (*t->p == '\r')
+        {
+            if (!appendScratch(t, "\n", 1))
+            {
+                return false;
+            }
+            t->p++;
+            if (t->p < t->end && *t->p == '\n')
+            {
+                t->p++;
+            }
+        }
+        stop = CharScan_text(t->p, t->end);
+        if (!appendScratch(t, t->p, (size_t)(stop - t->p)))
+        {
+            return false;
+        }
+        t->p = stop;
+    }
+    emitCharacters(t, t->scratch, t->scratchSize);
+    return true;
+}
+
+// the libxml2 push parser hands over the content of CDATA sections without
+// normalizing line breaks, it is done the same way here
+static bool parseCData(Tokenizer *t)
+{
+    t->p += strlen("<![CDATA[");
+    const char *begin = t->p;
+    if (!skipPast(t, "]]>", 3))
+    {
+        return false;
+    }
+    emitCharacters(t, begin, (size_t)(t->p - 3 - begin));
+    return true;
+}
+
+// attribute value after the opening quote, whitespace is normalized to ' '
+static bool parseAttributeValue(Tokenizer *t, char quote,
+                                struct RawAttribute *attr)
+{
+    const char *begin = t->p;
+    const char *stop = CharScan_attribute(begin, t->end, quote);
+    if (stop < t->end && *stop == quote)
+    {
+        attr->value = begin;
+        attr->valueLen = (size_t)(stop - begin);
+        t->p = stop + 1;
+        return true;
+    }
+    attr->value = NULL;
+    attr->scratchOffset = t->scratchSize;
+    if (!appendScratch(t, begin, (size_t)(stop - begin)))
+    {
+        return false;
+    }
+    t->p = stop;
+    while (t->p < t->end && *t->p != quote)
+    {
+        char c = *t->p;
+        if (c == '&')
+        {
+            if (!decodeReference(t, true))
+            {
+                return false;
+            }
+        }
+        else if (c == '\t' || c == '\n' || c == '\r')
+        {
+            if (!appendScratch(t, " ", 1))
+            {
+                return false;
+            }
+            t->p++;
+            if (c == '\r' && t->p < t->end && *t->p == '\n')
+            {
+                t->p++;
+            }
+        }
+        else
+        {
+            // '<' or a control character
+            return false;
+        }
+        stop = CharScan_attribute(t->p, t->end, quote);
+        if (!appendScratch(t, t->p, (size_t)(stop - t->p)))
+        {
+            return false;
+        }
+        t->p = stop;
+    }
+    if (t->p == t->end)
+    {
+        return false;
+    }
+    t->p++;
+    attr->valueLen = t->scratchSize - attr->scratchOffset;
+    return true;
+}
+
+// like libxml2, an undeclared prefix is not fatal, the name has no namespace
+static const char *lookupNamespace(const Tokenizer *t, const char *prefix)
+{
+    if (prefix == t->xmlPrefix)
+    {
+        return t->xmlUri;
+    }
+    for (size_t i = t->nsSize; i > 0; i--)
+    {
+        if (t->ns[i - 1].prefix == prefix)
+        {
+            const char *uri = t->ns[i - 1].uri;
+            // xmlns="" removes the default namespace
+            return *uri ? uri : NULL;
+        }
+    }
+    return NULL;
+}
+
+// splits the qualified name into interned prefix and localname
+static bool splitName(Tokenizer *t, const char *qname, size_t len,
+                      const char **prefix, const char **localname)
+{
+    const char *colon = (const char *)memchr(qname, ':', len);
+    if (!colon)
+    {
+        *prefix = NULL;
+        *localname = intern(t, qname, len);
+        return *localname != NULL;
+    }
+    size_t prefixLen = (size_t)(colon - qname);
+    if (!prefixLen || prefixLen + 1 == len)
+    {
+        return false;
+    }
+    *prefix = intern(t, qname, prefixLen);
+    *localname = intern(t, colon + 1, len - prefixLen - 1);
+    return *prefix && *localname;
+}
+
+static bool pushNamespace(Tokenizer *t, const char *prefix, const char *uri)
+{
+    void *ns = growArray(t->ns, &t->nsCap, t->nsSize + 1,
+                         sizeof(struct NsDecl));
+    if (!ns)
+    {
+        return false;
+    }
+    t->ns = (struct NsDecl *)ns;
+    t->ns[t->nsSize].prefix = prefix;
+    t->ns[t->nsSize].uri = uri;
+    t->nsSize++;
+    return true;
+}
+
+static bool declareNamespaces(Tokenizer *t, size_t rawCount, int *nbNs)
+{
+    *nbNs = 0;
+    for (size_t i = 0; i < rawCount; i++)
+    {
+        struct RawAttribute *attr = &t->raw[i];
+        attr->isNamespace =
+            (attr->qnameLen == 5 && !memcmp(attr->qname, "xmlns", 5)) ||
+            (attr->qnameLen > 6 && !memcmp(attr->qname, "xmlns:", 6));
+        if (!attr->isNamespace)
+        {
+            continue;
+        }
+        const char *prefix = NULL;
+        if (attr->qnameLen > 5)
+        {
+            prefix = intern(t, attr->qname + 6, attr->qnameLen - 6);
+            if (!prefix)
+            {
+                return false;
+            }
+        }
+        const char *uri = intern(t, attr->value, attr->valueLen);
+        if (!uri || !pushNamespace(t, prefix, uri))
+        {
+            return false;
+        }
+        void *namespaces =
+            growArray((void *)t->namespaces, &t->namespacesCap,
+                      2 * (size_t)(*nbNs + 1), sizeof(const char *));
+        if (!namespaces)
+        {
+            return false;
+        }
+        t->namespaces = (const char **)namespaces;
+        t->namespaces[2 * *nbNs] = prefix;
+        t->namespaces[2 * *nbNs + 1] = uri;
+        (*nbNs)++;
+    }
+    return true;
+}
+
+static bool resolveAttributes(Tokenizer *t, size_t rawCount, int *nbAttributes)
+{
+    void *attributes = growArray((void *)t->attributes, &t->attributesCap,
+                                 5 * rawCount, sizeof(const char *));
+    if (!attributes)
+    {
+        return false;
+    }
+    t->attributes = (const char **)attributes;
+    size_t count = 0;
+    for (size_t i = 0; i < rawCount; i++)
+    {
+        const struct RawAttribute *attr = &t->raw[i];
+        if (attr->isNamespace)
+        {
+            continue;
+        }
+        const char **a = &t->attributes[5 * count];
+        if (!splitName(t, attr->qname, attr->qnameLen, &a[1], &a[0]))
+        {
+            return false;
+        }
+        // unprefixed attributes have no namespace
+        a[2] = a[1] ? lookupNamespace(t, a[1]) : NULL;
+        a[3] = attr->value;
+        a[4] = attr->value + attr->valueLen;
+        for (size_t j = 0; j < count; j++)
+        {
+            if (t->attributes[5 * j] == a[0] && t->attributes[5 * j + 2] == a[2])
+            {
+                // duplicate attribute
+                return false;
+            }
+        }
+        count++;
+    }
+    *nbAttributes = (int)count;
+    return true;
+}
+
+// start tag after '<'
+static bool parseStartTag(Tokenizer *t)
+{
+    const char *qname = t->p;
+    size_t qnameLen = scanName(t);
+    if (!qnameLen)
+    {
+        return false;
+    }
+    t->scratchSize = 0;
+    size_t rawCount = 0;
+    bool empty = false;
+    for (;;)
+    {
+        bool separated = skipWhitespace(t);
+        if (t->p == t->end)
+        {
+            return false;
+        }
+        if (*t->p == '>')
+        {
+            t->p++;
+            break;
+        }
+        if (*t->p == '/')
+        {
+            if (t->p + 1 == t->end || t->p[1] != '>')
+            {
+                return false;
+            }
+            t->p += 2;
+            empty = true;
+            break;
+        }
+        if (!separated)
+        {
+            return false;
+        }
+        void *raw = growArray(t->raw, &t->rawCap, rawCount + 1,
+                              sizeof(struct RawAttribute));
+        if (!raw)
+        {
+            return false;
+        }
+        t->raw = (struct RawAttribute *)raw;
+        struct RawAttribute *attr = &t->raw[rawCount];
+        attr->qname = t->p;
+        attr->qnameLen = scanName(t);
+        if (!attr->qnameLen)
+        {
+            return false;
+        }
+        skipWhitespace(t);
+        if (t->p == t->end || *t->p != '=')
+        {
+            return false;
+        }
+        t->p++;
+        skipWhitespace(t);
+        if (t->p == t->end || (*t->p != '"' && *t->p != '\''))
+        {
+            return false;
+        }
+        char quote = *t->p;
+        t->p++;
+        if (!parseAttributeValue(t, quote, attr))
+        {
+            return false;
+        }
+        rawCount++;
+    }
+    // the scratch buffer is complete, decoded values can be resolved
+    for (size_t i = 0; i < rawCount; i++)
+    {
+        if (!t->raw[i].value)
+        {
+            t->raw[i].value = t->scratch + t->raw[i].scratchOffset;
+        }
+    }
+
+    size_t nsMark = t->nsSize;
+    int nbNs;
+    int nbAttributes;
+    const char *prefix;
+    const char *localname;
+    if (!declareNamespaces(t, rawCount, &nbNs) ||
+        !splitName(t, qname, qnameLen, &prefix, &localname))
+    {
+        return false;
+    }
+    const char *uri = lookupNamespace(t, prefix);
+    if (!resolveAttributes(t, rawCount, &nbAttributes))
+    {
+        return false;
+    }
+
+    void *elements = growArray(t->elements, &t->elementsCap, t->depth + 1,
+                               sizeof(struct Element));
+    if (!elements)
+    {
+        return false;
+    }
+    t->elements = (struct Element *)elements;
+    struct Element *el = &t->elements[t->depth];
+    el->qname = qname;
+    el->qnameLen = qnameLen;
+    el->localname = localname;
+    el->prefix = prefix;
+    el->uri = uri;
+    el->nsMark = nsMark;
+    t->depth++;
+
+    t->onStart(t->context, localname, prefix, uri, nbNs, t->namespaces,
+               nbAttributes, 0, t->attributes);
+    if (empty)
+    {
+        t->onEnd(t->context, localname, prefix, uri);
+        t->nsSize = nsMark;
+        t->depth--;
+    }
+    return true;
+}
+
+// end tag after "</"
+static bool parseEndTag(Tokenizer *t)
+{
+    const char *qname = t->p;
+    size_t qnameLen = scanName(t);
+    skipWhitespace(t);
+    if (t->p == t->end || *t->p != '>' || !t->depth)
+    {
+        return false;
+    }
+    t->p++;
+    const struct Element *el = &t->elements[t->depth - 1];
+    if (qnameLen != el->qnameLen || memcmp(qname, el->qname, qnameLen))
+    {
+        return false;
+    }
+    t->onEnd(t->context, el->localname, el->prefix, el->uri);
+    t->nsSize = el->nsMark;
+    t->depth--;
+    return true;
+}
+
+static bool asciiCaseEqual(const char *a, size_t len, const char *b)
+{
+    if (len != strlen(b))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = a[i];
+        if (c >= 'a' && c <= 'z')
+        {
+            c = (char)(c - 'a' + 'A');
+        }
+        if (c != b[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// only utf-8 is supported
+static Tokenizer_Status parseDeclaration(Tokenizer *t)
+{
+    const char *begin = t->p;
+    if (!skipPast(t, "?>", 2))
+    {
+        return TOKENIZER_ERROR;
+    }
+    const char *declEnd = t->p;
+    const char *enc = begin;
+    const size_t encLen = strlen("encoding");
+    while ((size_t)(declEnd - enc) > encLen && memcmp(enc, "encoding", encLen))
+    {
+        enc++;
+    }
+    if ((size_t)(declEnd - enc) <= encLen)
+    {
+        return TOKENIZER_OK;
+    }
+    enc += encLen;
+    while (enc < declEnd && (isWhitespace(*enc) || *enc == '='))
+    {
+        enc++;
+    }
+    if (enc == declEnd || (*enc != '"' && *enc != '\''))
+    {
+        return TOKENIZER_ERROR;
+    }
+    const char *value = enc + 1;
+    const char *valueEnd = (const char *)memchr(
+        value, *enc, (size_t)(declEnd - value));
+    if (!valueEnd)
+    {
+        return TOKENIZER_ERROR;
+    }
+    size_t len = (size_t)(valueEnd - value);
+    if (asciiCaseEqual(value, len, "UTF-8") ||
+        asciiCaseEqual(value, len, "UTF8"))
+    {
+        return TOKENIZER_OK;
+    }
+    return TOKENIZER_UNSUPPORTED;
+}
+
+// everything before the root element, no callbacks are called here
+static Tokenizer_Status parseProlog(Tokenizer *t)
+{
+    size_t size = (size_t)(t->end - t->p);
+    const unsigned char *u = (const unsigned char *)t->p;
+    if (size >= 3 && u[0] == 0xEF && u[1] == 0xBB && u[2] == 0xBF)
+    {
+        t->p += 3;
+    }
+    else if (size >= 2 && ((u[0] == 0xFE && u[1] == 0xFF) ||
+                           (u[0] == 0xFF && u[1] == 0xFE)))
+    {
+        return TOKENIZER_UNSUPPORTED;
+    }
+    else if (size >= 2 && (u[0] == 0 || u[1] == 0))
+    {
+        // utf-16 or utf-32 without byte order mark
+        return TOKENIZER_UNSUPPORTED;
+    }
+    if (startsWith(t, "<?xml", 5) && t->end - t->p > 5 &&
+        isWhitespace(t->p[5]))
+    {
+        Tokenizer_Status status = parseDeclaration(t);
+        if (status != TOKENIZER_OK)
+        {
+            return status;
+        }
+    }
+    for (;;)
+    {
+        skipWhitespace(t);
+        if (startsWith(t, "<!--", 4))
+        {
+            if (!skipPast(t, "-->", 3))
+            {
+                return TOKENIZER_ERROR;
+            }
+        }
+        else if (startsWith(t, "<!DOCTYPE", 9))
+        {
+            return TOKENIZER_UNSUPPORTED;
+        }
+        else if (startsWith(t, "<?", 2))
+        {
+            if (!skipPast(t, "?>", 2))
+            {
+                return TOKENIZER_ERROR;
+            }
+        }
+        else if (startsWith(t, "<", 1) && t->end - t->p > 1 &&
+                 !nameEnd[(unsigned char)t->p[1]] && t->p[1] != '!' &&
+                 t->p[1] != '?')
+        {
+            return TOKENIZER_OK;
+        }
+        else
+        {
+            return TOKENIZER_ERROR;
+        }
+    }
+}
+
+// one start tag, end tag, text, comment, CDATA section or processing
+// instruction in the content of an element
+static bool parseItem(Tokenizer *t)
+{
+    if (*t->p != '<')
+    {
+        return parseText(t);
+    }
+    if (startsWith(t, "</", 2))
+    {
+        t->p += 2;
+        return parseEndTag(t);
+    }
+    if (startsWith(t, "<!--", 4))
+    {
+        return skipPast(t, "-->", 3);
+    }
+    if (startsWith(t, "<![CDATA[", 9))
+    {
+        return parseCData(t);
+    }
+    if (startsWith(t, "<?", 2))
+    {
+        return skipPast(t, "?>", 2);
+    }
+    if (startsWith(t, "<!", 2))
+    {
+        return false;
+    }
+    t->p++;
+    return parseStartTag(t);
+}
+
+// the root element and its content
+static bool parseContent(Tokenizer *t)
+{
+    do
+    {
+        if (t->p == t->end || !parseItem(t))
+        {
+            return false;
+        }
+    } while (t->depth > 0);
+    return true;
+}
+
+// only comments, processing instructions and whitespace may follow
+static bool parseEpilog(Tokenizer *t)
+{
+    for (;;)
+    {
+        skipWhitespace(t);
+        if (t->p == t->end)
+        {
+            return true;
+        }
+        if (startsWith(t, "<!--", 4))
+        {
+            if (!skipPast(t, "-->", 3))
+            {
+                return false;
+            }
+        }
+        else if (startsWith(t, "<?", 2))
+        {
+            if (!skipPast(t, "?>", 2))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+}
+
+static void begin(Tokenizer *t, const char *data, size_t size, void *context,
+                  Parser_callbackStart start, Parser_callbackEnd end,
+                  Parser_callbackChar onChars)
+{
+    t->p = data;
+    t->end = data + size;
+    t->context = context;
+    t->onStart = start;
+    t->onEnd = end;
+    t->onChars = onChars;
+    t->depth = 0;
+    t->nsSize = 0;
+}
+
+Tokenizer_Status Tokenizer_runRange(Tokenizer *t, const Parser_Range *range,
+                                    void *context, Parser_callbackStart start,
+                                    Parser_callbackEnd end,
+                                    Parser_callbackChar onChars)
+{
+    begin(t, range->data, range->rootContent, context, start, end, onChars);
+    Tokenizer_Status status = parseProlog(t);
+    if (status != TOKENIZER_OK)
+    {
+        return status;
+    }
+    // the start tag of the root element has to end at rootContent
+    if (!parseItem(t) || t->depth != 1 || t->p != t->end)
+    {
+        return TOKENIZER_ERROR;
+    }
+    t->p = range->data + range->begin;
+    t->end = range->data + range->end;
+    while (t->p < t->end)
+    {
+        // the root element must not be closed in the range
+        if (!parseItem(t) || t->depth == 0)
+        {
+            return TOKENIZER_ERROR;
+        }
+    }
+    if (t->depth != 1)
+    {
+        return TOKENIZER_ERROR;
+    }
+    const struct Element *root = &t->elements[0];
+    t->onEnd(t->context, root->localname, root->prefix, root->uri);
+    t->depth = 0;
+    t->nsSize = 0;
+    return TOKENIZER_OK;
+}
+
+Tokenizer_Status Tokenizer_run(Tokenizer *t, const char *data, size_t size,
+                               void *context, Parser_callbackStart start,
+                               Parser_callbackEnd end,
+                               Parser_callbackChar onChars)
+{
+    begin(t, data, size, context, start, end, onChars);
+    Tokenizer_Status status = parseProlog(t);
+    if (status != TOKENIZER_OK)
+    {
+        return status;
+    }
+    if (!parseContent(t) || !parseEpilog(t))
+    {
+        return TOKENIZER_ERROR;
+    }
+    return TOKENIZER_OK;
+}
@@ -0,0 +1,43 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+#include "Parser.h"
+#include <stddef.h>
+
+// xml tokenizer which is specialized for nodesets: utf-8 only, no document
+// type definitions, only the predefined and character entities
+// it calls the same callbacks with the same arguments as the libxml2 SAX2
+// interface, names are interned and valid as long as the tokenizer
+
+typedef enum
+{
+    TOKENIZER_OK,
+    // the document is not well formed
+    TOKENIZER_ERROR,
+    // the document uses features which are not supported, this is reported
+    // before any callback is called, so the document can be handed over to
+    // another parser
+    TOKENIZER_UNSUPPORTED
+} Tokenizer_Status;
+
+struct Tokenizer;
+typedef struct Tokenizer Tokenizer;
+
+Tokenizer *Tokenizer_new(void);
+Tokenizer_Status Tokenizer_run(Tokenizer *tokenizer, const char *data,
+                               size_t size, void *context,
+                               Parser_callbackStart start,
+                               Parser_callbackEnd end,
+                               Parser_callbackChar onChars);
+// see Parser_runRange
+Tokenizer_Status Tokenizer_runRange(Tokenizer *tokenizer,
+                                    const Parser_Range *range, void *context,
+                                    Parser_callbackStart start,
+                                    Parser_callbackEnd end,
+                                    Parser_callbackChar onChars);
+void Tokenizer_delete(Tokenizer *tokenizer);
+#endif
@@ -6,7 +6,10 @@
  */
 
 #include "Value.h"
+#include "ElementToken.h"
+#include "MemoryUsage.h"
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 
 NL_Value *Value_new(const NL_Node *node)
@@ -14,12 +17,14 @@ NL_Value *Value_new(const NL_Node *node)
     NL_Value *newValue = (NL_Value *)calloc(1, sizeof(NL_Value));
     newValue->ctx = (NL_ParserCtx *)calloc(1, sizeof(NL_ParserCtx));
     newValue->ctx->state = PARSERSTATE_INIT;
+    MEMORY_ALLOCATED(NL_MEMORY_VALUES, sizeof(NL_Value) + sizeof(NL_ParserCtx));
     return newValue;
 }
 
 static NL_Data *newData(const char *name, NL_DataType type)
 {
     NL_Data *newData = (NL_Data *)calloc(1, sizeof(NL_Data));
+    MEMORY_ALLOCATED(NL_MEMORY_VALUES, sizeof(NL_Data));
     newData->type = type;
     newData->name = name;
     return newData;
@@ -33,6 +38,7 @@ static NL_Data *addNewMember(NL_Data *parent, const char *name)
         (parent->val.complexData.membersSize + 1) * sizeof(NL_Data *));
 
     NL_Data *newData = (NL_Data *)calloc(1, sizeof(NL_Data));
+    MEMORY_ALLOCATED(NL_MEMORY_VALUES, sizeof(NL_Data *) + sizeof(NL_Data));
     parent->val.complexData.members[parent->val.complexData.membersSize] =
         newData;
 
@@ -55,7 +61,7 @@ void Value_start(NL_Value *val, const char *name)
             val->data = newData(name, DATATYPE_COMPLEX);
             val->ctx->currentData = val->data;
         }
-        else if (!strcmp(name, "ExtensionObject"))
+        else if (ElementToken_lookup(name) == TOKEN_EXTENSIONOBJECT)
         {
             val->ctx->state = PARSERSTATE_EXTENSIONOBJECT;
             val->isExtensionObject = true;
@@ -70,7 +76,7 @@ void Value_start(NL_Value *val, const char *name)
         break;
 
     case PARSERSTATE_LISTOF:
-        if (!strcmp(name, "ExtensionObject"))
+        if (ElementToken_lookup(name) == TOKEN_EXTENSIONOBJECT)
         {
             val->ctx->state = PARSERSTATE_EXTENSIONOBJECT;
             val->isExtensionObject = true;
@@ -86,16 +92,18 @@ void Value_start(NL_Value *val, const char *name)
         break;
 
     case PARSERSTATE_EXTENSIONOBJECT:
-        if (!strcmp(name, "TypeId"))
+    {
+        ElementToken token = ElementToken_lookup(name);
+        if (token == TOKEN_TYPEID)
         {
             val->ctx->state = PARSERSTATE_EXTENSIONOBJECT_TYPEID;
-            break;
         }
-        if (!strcmp(name, "Body"))
+        else if (token == TOKEN_BODY)
         {
             val->ctx->state = PARSERSTATE_EXTENSIONOBJECT_BODY;
         }
-        break;
+    }
+    break;
     case PARSERSTATE_EXTENSIONOBJECT_BODY:
         val->ctx->state = PARSERSTATE_DATA;
         if (!val->ctx->currentData)
@@ -157,18 +165,21 @@ void Value_end(NL_Value *val, const char *name, const char *value)
         break;
 
     case PARSERSTATE_EXTENSIONOBJECT_TYPEID:
-        if (!strcmp(name, "Identifier"))
+    {
+        ElementToken token = ElementToken_lookup(name);
+        if (token == TOKEN_IDENTIFIER)
         {
             val->type = value;
         }
-        if (!strcmp(name, "TypeId"))
+        else if (token == TOKEN_TYPEID)
         {
             val->ctx->state = PARSERSTATE_EXTENSIONOBJECT;
         }
-        break;
+    }
+    break;
 
     case PARSERSTATE_EXTENSIONOBJECT:
-        if (!strcmp(name, "ExtensionObject"))
+        if (ElementToken_lookup(name) == TOKEN_EXTENSIONOBJECT)
         {
             val->ctx->state = PARSERSTATE_INIT;
         }
@@ -211,6 +222,114 @@ void Value_end(NL_Value *val, const char *name, const char *value)
         break;
     }
 }
+// the recording is a sequence of the characters since the last element and
+// the element itself ('<' or '>' and the name), all terminated by '\0', and
+// ends with the characters and an empty element
+
+static void append(NL_Value *val, CharArenaAllocator *arena, const char *s,
+                   size_t len)
+{
+    NL_ParserCtx *ctx = val->ctx;
+    char *recording = ctx->recording
+                          ? CharArenaAllocator_realloc(arena, len)
+                          : CharArenaAllocator_malloc(arena, len);
+    if (!recording)
+    {
+        return;
+    }
+    memcpy(recording + ctx->recordingSize, s, len);
+    ctx->recording = recording;
+    ctx->recordingSize += len;
+}
+
+static void recordElement(NL_Value *val, CharArenaAllocator *arena, char kind,
+                          const char *name)
+{
+    NL_ParserCtx *ctx = val->ctx;
+    // whitespace between the elements is dropped, Value_end ignores it
+    size_t textLength = ctx->recordingSize - ctx->recordingText;
+    size_t i = 0;
+    while (i < textLength &&
+           isspace((unsigned char)ctx->recording[ctx->recordingText + i]))
+    {
+        i++;
+    }
+    if (textLength && i == textLength)
+    {
+        CharArenaAllocator_shrink(arena, textLength);
+        ctx->recordingSize = ctx->recordingText;
+    }
+    append(val, arena, "", 1);
+    if (name)
+    {
+        append(val, arena, &kind, 1);
+        append(val, arena, name, strlen(name));
+    }
+    append(val, arena, "", 1);
+    ctx->recordingText = ctx->recordingSize;
+}
+
+void Value_recordStart(NL_Value *val, CharArenaAllocator *arena,
+                       const char *name)
+{
+    recordElement(val, arena, '<', name);
+}
+
+void Value_recordEnd(NL_Value *val, CharArenaAllocator *arena,
+                     const char *name)
+{
+    recordElement(val, arena, '>', name);
+}
+
+void Value_recordCharacters(NL_Value *val, CharArenaAllocator *arena,
+                            const char *ch, size_t len)
+{
+    append(val, arena, ch, len);
+}
+
+void Value_recordFinish(NL_Value *val, CharArenaAllocator *arena)
+{
+    if (val->ctx->recording)
+    {
+        recordElement(val, arena, 0, NULL);
+    }
+}
+
+NL_Value *Value_decode(NL_Value *val)
+{
+    if (!val || !val->ctx || !val->ctx->recording)
+    {
+        return val;
+    }
+    const char *p = val->ctx->recording;
+    val->ctx->recording = NULL;
+    for (;;)
+    {
+        const char *text = p;
+        p += strlen(p) + 1;
+        const char *element = p;
+        if (!*element)
+        {
+            break;
+        }
+        p += strlen(p) + 1;
+        if (*element == '<')
+        {
+            Value_start(val, element + 1);
+        }
+        else
+        {
+            Value_end(val, element + 1, *text ? text : NULL);
+        }
+    }
+    return val;
+}
+
+NL_Value *NodesetLoader_getValue(const NL_VariableNode *node)
+{
+    return Value_decode(node->value);
+}
+
 static void Data_clear(NL_Data *data);
 
 static void PrimitiveData_clear(NL_Data *data)
@@ -224,6 +343,8 @@ static void ComplexData_clear(NL_Data *data)
     {
         Data_clear(data->val.complexData.members[cnt]);
     }
+    MEMORY_FREED(NL_MEMORY_VALUES,
+                 data->val.complexData.membersSize * sizeof(NL_Data *));
     free(data->val.complexData.members);
 }
 
@@ -237,12 +358,18 @@ static void Data_clear(NL_Data *data)
     {
         ComplexData_clear(data);
     }
+    MEMORY_FREED(NL_MEMORY_VALUES, sizeof(NL_Data));
     free(data);
 }
 
 void Value_delete(NL_Value *val)
 {
-    Data_clear(val->data);
+    // values without elements and recorded values have no data
+    if (val->data)
+    {
+        Data_clear(val->data);
+    }
+    MEMORY_FREED(NL_MEMORY_VALUES, sizeof(NL_Value) + sizeof(NL_ParserCtx));
     free(val->ctx);
     free(val);
 }
@@ -7,6 +7,7 @@
 
 #include <NodesetLoader/NodesetLoader.h>
 #include <NodesetLoader/NodeId.h>
+#include "CharAllocator.h"
 #include <stdbool.h>
 #include <stddef.h>
 
@@ -26,6 +27,11 @@ struct NL_ParserCtx
 {
     ParserState state;
     NL_Data *currentData;
+    // the recorded elements of the value, see Value_record*
+    const char *recording;
+    size_t recordingSize;
+    // offset of the characters since the last element
+    size_t recordingText;
 };
 typedef struct NL_ParserCtx NL_ParserCtx;
 
@@ -33,3 +39,19 @@ NL_Value *Value_new(const NL_Node *node);
 void Value_start(NL_Value *val, const char *name);
 void Value_end(NL_Value *val, const char *name, const char *value);
 void Value_delete(NL_Value *val);
+
+// NL_PARSER_OPTION_LAZY_VALUES: instead of Value_start/Value_end the elements
+// and characters of the value are only appended to one allocation of the
+// arena, the data is built up from it by Value_decode
+// the recording has to be the last allocation of the arena until
+// Value_recordFinish
+void Value_recordStart(NL_Value *val, CharArenaAllocator *arena,
+                       const char *name);
+void Value_recordEnd(NL_Value *val, CharArenaAllocator *arena,
+                     const char *name);
+void Value_recordCharacters(NL_Value *val, CharArenaAllocator *arena,
+                            const char *ch, size_t len);
+void Value_recordFinish(NL_Value *val, CharArenaAllocator *arena);
+// builds up the data of a recorded value, the names and text of the data
+// point into the recording, returns val
+NL_Value *Value_decode(NL_Value *val);
@@ -6,7 +6,9 @@
  */
 
 #include "DataTypeNode.h"
+#include "../MemoryUsage.h"
 #include <stdlib.h>
+#include <string.h>
 
 static NL_DataTypeDefinitionField *getNewField(NL_DataTypeDefinition *definition)
 {
@@ -18,7 +20,12 @@ static NL_DataTypeDefinitionField *getNewField(NL_DataTypeDefinition *definition
     {
         return NULL;
     }
-    return &definition->fields[definition->fieldCnt - 1];
+    MEMORY_ALLOCATED(NL_MEMORY_NODES, sizeof(NL_DataTypeDefinitionField));
+    // enum fields only have a name and a value
+    NL_DataTypeDefinitionField *field =
+        &definition->fields[definition->fieldCnt - 1];
+    memset(field, 0, sizeof(NL_DataTypeDefinitionField));
+    return field;
 }
 
 NL_DataTypeDefinition* DataTypeDefinition_new(NL_DataTypeNode* node)
@@ -29,6 +36,7 @@ NL_DataTypeDefinition* DataTypeDefinition_new(NL_DataTypeNode* node)
     {
         return NULL;
     }
+    MEMORY_ALLOCATED(NL_MEMORY_NODES, sizeof(NL_DataTypeDefinition));
     return node->definition;
 }
 
@@ -41,6 +49,10 @@ void DataTypeNode_clear(NL_DataTypeNode *node)
 {
     if (node->definition)
     {
+        MEMORY_FREED(NL_MEMORY_NODES,
+                     sizeof(NL_DataTypeDefinition) +
+                         node->definition->fieldCnt *
+                             sizeof(NL_DataTypeDefinitionField));
         free(node->definition->fields);
     }
     free(node->definition);
@@ -7,52 +7,202 @@
 
 #include "Node.h"
 #include "DataTypeNode.h"
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#include "../MemoryUsage.h"
 #include "../Value.h"
 
-NL_Node *Node_new(NL_NodeClass nodeClass)
+// in the order of NL_NodeClass
+static const NodeLayout layouts[NL_NODECLASS_COUNT] = {
+    // object
+    {{offsetof(NL_ObjectNode, eventNotifier), 0, 0, 0, 0},
+     offsetof(NL_ObjectNode, parentNodeId),
+     0,
+     offsetof(NL_ObjectNode, refToTypeDef)},
+    // object type
+    {{offsetof(NL_ObjectTypeNode, isAbstract), 0, 0, 0, 0}, 0, 0, 0},
+    // variable
+    {{offsetof(NL_VariableNode, arrayDimensions),
+      offsetof(NL_VariableNode, valueRank),
+      offsetof(NL_VariableNode, accessLevel),
+      offsetof(NL_VariableNode, userAccessLevel),
+      offsetof(NL_VariableNode, historizing)},
+     offsetof(NL_VariableNode, parentNodeId),
+     offsetof(NL_VariableNode, datatype),
+     offsetof(NL_VariableNode, refToTypeDef)},
+    // data type
+    {{offsetof(NL_DataTypeNode, isAbstract), 0, 0, 0, 0}, 0, 0, 0},
+    // method
+    {{offsetof(NL_MethodNode, executable),
+      offsetof(NL_MethodNode, userExecutable), 0, 0, 0},
+     offsetof(NL_MethodNode, parentNodeId),
+     0,
+     0},
+    // reference type
+    {{offsetof(NL_ReferenceTypeNode, inverseName.locale),
+      offsetof(NL_ReferenceTypeNode, inverseName.text),
+      offsetof(NL_ReferenceTypeNode, symmetric), 0, 0},
+     0,
+     0,
+     0},
+    // variable type
+    {{offsetof(NL_VariableTypeNode, isAbstract),
+      offsetof(NL_VariableTypeNode, arrayDimensions),
+      offsetof(NL_VariableTypeNode, valueRank), 0, 0},
+     0,
+     offsetof(NL_VariableTypeNode, datatype),
+     0},
+    // view
+    {{offsetof(NL_ViewNode, containsNoLoops),
+      offsetof(NL_ViewNode, eventNotifier), 0, 0, 0},
+     offsetof(NL_ViewNode, parentNodeId),
+     0,
+     0}};
+
+size_t Node_size(NL_NodeClass nodeClass)
 {
-    NL_Node *node = NULL;
     switch (nodeClass)
     {
     case NODECLASS_VARIABLE:
-        node = (NL_Node *)calloc(1, sizeof(NL_VariableNode));
-        break;
+        return sizeof(NL_VariableNode);
     case NODECLASS_OBJECT:
-        node = (NL_Node *)calloc(1, sizeof(NL_ObjectNode));
-        break;
+        return sizeof(NL_ObjectNode);
     case NODECLASS_OBJECTTYPE:
-        node = (NL_Node *)calloc(1, sizeof(NL_ObjectTypeNode));
-        break;
+        return sizeof(NL_ObjectTypeNode);
     case NODECLASS_REFERENCETYPE:
-        node = (NL_Node *)calloc(1, sizeof(NL_ReferenceTypeNode));
-        break;
+        return sizeof(NL_ReferenceTypeNode);
     case NODECLASS_VARIABLETYPE:
-        node = (NL_Node *)calloc(1, sizeof(NL_VariableTypeNode));
-        break;
+        return sizeof(NL_VariableTypeNode);
     case NODECLASS_DATATYPE:
-        node = (NL_Node *)calloc(1, sizeof(NL_DataTypeNode));
-        break;
+        return sizeof(NL_DataTypeNode);
     case NODECLASS_METHOD:
-        node = (NL_Node *)calloc(1, sizeof(NL_MethodNode));
-        break;
+        return sizeof(NL_MethodNode);
     case NODECLASS_VIEW:
-        node = (NL_Node *)calloc(1, sizeof(NL_ViewNode));
-        break;
+        return sizeof(NL_ViewNode);
     }
-    if(!node)
+    return 0;
+}
+
+const NodeLayout *Node_layout(NL_NodeClass nodeClass)
+{
+    return &layouts[nodeClass];
+}
+
+NL_Node *Node_new(NL_NodeClass nodeClass)
+{
+    size_t size = Node_size(nodeClass);
+    if (!size)
     {
         return NULL;
     }
+    NL_Node *node = (NL_Node *)calloc(1, size);
+    if (node)
+    {
+        MEMORY_ALLOCATED(NL_MEMORY_NODES, size);
+    }
     return node;
 }
 
+// a missing attribute is decoded like its default of the nodeset schema,
+// the strings of a parsed node have these defaults already
+static bool decodeBool(const char *s, bool missing)
+{
+    return s ? !strcmp(s, "true") : missing;
+}
+
+static int32_t decodeInt(const char *s, int32_t missing)
+{
+    return s ? (int32_t)strtol(s, NULL, 10) : missing;
+}
+
+// comma separated list, e.g. "2,3"
+static uint32_t decodeArrayDimensions(const char *s,
+                                      uint32_t dims[NL_MAX_ARRAY_DIMENSIONS])
+{
+    uint32_t size = 0;
+    while (s && *s)
+    {
+        char *end = NULL;
+        unsigned long dim = strtoul(s, &end, 10);
+        if (size < NL_MAX_ARRAY_DIMENSIONS)
+        {
+            dims[size] = (uint32_t)dim;
+        }
+        size++;
+        s = strchr(end, ',');
+        if (s)
+        {
+            s++;
+        }
+    }
+    return size;
+}
+
+void Node_decodeAttributes(NL_Node *node)
+{
+    switch (node->nodeClass)
+    {
+    case NODECLASS_OBJECT: {
+        NL_ObjectNode *n = (NL_ObjectNode *)node;
+        n->typed.eventNotifier = (uint8_t)decodeInt(n->eventNotifier, 0);
+        break;
+    }
+    case NODECLASS_OBJECTTYPE: {
+        NL_ObjectTypeNode *n = (NL_ObjectTypeNode *)node;
+        n->typed.isAbstract = decodeBool(n->isAbstract, false);
+        break;
+    }
+    case NODECLASS_VARIABLE: {
+        NL_VariableNode *n = (NL_VariableNode *)node;
+        n->typed.valueRank = decodeInt(n->valueRank, -1);
+        n->typed.accessLevel = (uint8_t)decodeInt(n->accessLevel, 1);
+        n->typed.userAccessLevel = (uint8_t)decodeInt(n->userAccessLevel, 1);
+        n->typed.historizing = decodeBool(n->historizing, false);
+        n->typed.arrayDimensionsSize =
+            decodeArrayDimensions(n->arrayDimensions, n->typed.arrayDimensions);
+        break;
+    }
+    case NODECLASS_DATATYPE: {
+        NL_DataTypeNode *n = (NL_DataTypeNode *)node;
+        n->typed.isAbstract = decodeBool(n->isAbstract, false);
+        break;
+    }
+    case NODECLASS_METHOD: {
+        NL_MethodNode *n = (NL_MethodNode *)node;
+        n->typed.executable = decodeBool(n->executable, true);
+        n->typed.userExecutable = decodeBool(n->userExecutable, true);
+        break;
+    }
+    case NODECLASS_REFERENCETYPE: {
+        NL_ReferenceTypeNode *n = (NL_ReferenceTypeNode *)node;
+        n->typed.symmetric = decodeBool(n->symmetric, false);
+        break;
+    }
+    case NODECLASS_VARIABLETYPE: {
+        NL_VariableTypeNode *n = (NL_VariableTypeNode *)node;
+        n->typed.isAbstract = decodeBool(n->isAbstract, false);
+        n->typed.valueRank = decodeInt(n->valueRank, -1);
+        n->typed.arrayDimensionsSize =
+            decodeArrayDimensions(n->arrayDimensions, n->typed.arrayDimensions);
+        break;
+    }
+    case NODECLASS_VIEW: {
+        NL_ViewNode *n = (NL_ViewNode *)node;
+        n->typed.containsNoLoops = decodeBool(n->containsNoLoops, false);
+        n->typed.eventNotifier = (uint8_t)decodeInt(n->eventNotifier, 0);
+        break;
+    }
+    }
+}
+
 static void deleteRef(NL_Reference *ref)
 {
     while (ref)
     {
         NL_Reference *tmp = ref->next;
         free(ref);
+        MEMORY_FREED(NL_MEMORY_REFERENCES, sizeof(NL_Reference));
         ref = tmp;
     }
 }
@@ -61,6 +211,7 @@ void Node_delete(NL_Node *node)
 {
     deleteRef(node->hierachicalRefs);
     deleteRef(node->nonHierachicalRefs);
+    deleteRef(node->unknownRefs);
     if (node->nodeClass == NODECLASS_DATATYPE)
     {
         DataTypeNode_clear((NL_DataTypeNode *)node);
@@ -68,7 +219,7 @@ void Node_delete(NL_Node *node)
     if(node->nodeClass == NODECLASS_VARIABLE)
     {
         NL_VariableNode* varNode = (NL_VariableNode*)node;
-        free(varNode->refToTypeDef);
+        deleteRef(varNode->refToTypeDef);
         if(varNode->value)
         {
             Value_delete(varNode->value);
@@ -77,7 +228,8 @@ void Node_delete(NL_Node *node)
     if(node->nodeClass==NODECLASS_OBJECT)
     {
         NL_ObjectNode *objNode = (NL_ObjectNode *)node;
-        free(objNode->refToTypeDef);
+        deleteRef(objNode->refToTypeDef);
     }
+    MEMORY_FREED(NL_MEMORY_NODES, Node_size(node->nodeClass));
     free(node);
 }
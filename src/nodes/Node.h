@@ -9,7 +9,25 @@
 #define NODE_H
 #include <NodesetLoader/NodesetLoader.h>
 
+#define NODE_STRING_ATTRIBUTES 5
+
+// where the attributes of a node class are, 0 if the class doesn't have the
+// attribute
+typedef struct
+{
+    // the string attributes besides those of all nodes, 0 terminated
+    size_t strings[NODE_STRING_ATTRIBUTES];
+    size_t parentNodeId;
+    size_t dataType;
+    size_t refToTypeDef;
+} NodeLayout;
+
+// size of the struct of the node class
+size_t Node_size(NL_NodeClass nodeClass);
+const NodeLayout *Node_layout(NL_NodeClass nodeClass);
 NL_Node *Node_new(NL_NodeClass nodeClass);
+// fills the typed members of the node from its attribute strings
+void Node_decodeAttributes(NL_Node *node);
 void Node_delete(NL_Node *node);
 
 #endif
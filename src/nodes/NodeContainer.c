@@ -52,7 +52,7 @@ void NodeContainer_delete(NodeContainer *container)
 {
     if (container->owner)
     {
-        for (size_t i = 0; i < container->size; i++)
+        for (size_t i = container->borrowed; i < container->size; i++)
         {
             Node_delete(container->nodes[i]);
         }
@@ -16,6 +16,8 @@ struct NodeContainer
     size_t capacity;
     size_t incrementSize;
     bool owner;
+    // the first nodes belong to a nodeset image, they are not deleted
+    size_t borrowed;
 };
 typedef struct NodeContainer NodeContainer;
 
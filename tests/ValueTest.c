@@ -308,6 +308,60 @@ START_TEST(EnumValueType)
 }
 END_TEST
 
+START_TEST(RecordedValue)
+{
+    /*
+    <Value>
+      <LocalizedText>
+        <Locale>en</Locale>
+        <Text> some &amp; text </Text>
+      </LocalizedText>
+    </Value>
+    */
+    CharArenaAllocator *arena = CharArenaAllocator_new(16);
+    NL_Value *val = Value_new(NULL);
+    Value_recordCharacters(val, arena, "\n      ", 7);
+    Value_recordStart(val, arena, "LocalizedText");
+    Value_recordCharacters(val, arena, "\n        ", 9);
+    Value_recordStart(val, arena, "Locale");
+    Value_recordCharacters(val, arena, "en", 2);
+    Value_recordEnd(val, arena, "Locale");
+    Value_recordStart(val, arena, "Text");
+    Value_recordCharacters(val, arena, " some ", 6);
+    Value_recordCharacters(val, arena, "&", 1);
+    Value_recordCharacters(val, arena, " text ", 6);
+    Value_recordEnd(val, arena, "Text");
+    Value_recordCharacters(val, arena, "\n      ", 7);
+    Value_recordEnd(val, arena, "LocalizedText");
+    Value_recordCharacters(val, arena, "\n    ", 5);
+    Value_recordFinish(val, arena);
+    ck_assert(!val->data);
+
+    ck_assert(Value_decode(val) == val);
+    ck_assert(val->data->type == DATATYPE_COMPLEX);
+    ck_assert(!strcmp(val->data->name, "LocalizedText"));
+    ck_assert(!strcmp(val->type, "LocalizedText"));
+    ck_assert(val->data->val.complexData.membersSize == 2);
+    ck_assert(!strcmp(
+        val->data->val.complexData.members[0]->val.primitiveData.value, "en"));
+    ck_assert(
+        !strcmp(val->data->val.complexData.members[1]->val.primitiveData.value,
+                " some & text "));
+    // decoded only once
+    NL_Data *data = val->data;
+    ck_assert(Value_decode(val)->data == data);
+    Value_delete(val);
+
+    // a value without elements has no data
+    val = Value_new(NULL);
+    Value_recordCharacters(val, arena, "\n", 1);
+    Value_recordFinish(val, arena);
+    ck_assert(!Value_decode(val)->data);
+    Value_delete(val);
+    CharArenaAllocator_delete(arena);
+}
+END_TEST
+
 int main(void)
 {
     Suite *s = suite_create("Sort tests");
@@ -318,6 +372,7 @@ int main(void)
     tcase_add_test(tc, ListOfExtensionObject);
     tcase_add_test(tc, LocalizedText);
     tcase_add_test(tc, EnumValueType);
+    tcase_add_test(tc, RecordedValue);
     suite_add_tcase(s, tc);
 
     SRunner *sr = srunner_create(s);
@@ -1,4 +1,6 @@
 #include "CharAllocator.h"
+#include "StringPool.h"
+#include <stdio.h>
 #include <check.h>
 
 START_TEST(simpleMalloc)
@@ -53,6 +55,90 @@ START_TEST(overcommit)
 }
 END_TEST
 
+START_TEST(freeLast)
+{
+    CharArenaAllocator *a = CharArenaAllocator_new(100);
+    char *val = CharArenaAllocator_malloc(a, 10);
+    memcpy(val, "123", 3);
+    CharArenaAllocator_realloc(a, 10);
+    CharArenaAllocator_freeLast(a);
+    char *val2 = CharArenaAllocator_malloc(a, 20);
+    ck_assert(val == val2);
+    for (int i = 0; i < 20; i++)
+    {
+        ck_assert_int_eq(val2[i], 0);
+    }
+    CharArenaAllocator_delete(a);
+}
+END_TEST
+
+START_TEST(internStrings)
+{
+    CharArenaAllocator *a = CharArenaAllocator_new(100);
+    StringPool *pool = StringPool_new();
+    char *s1 = StringPool_intern(pool, a, "i=47xyz", 4);
+    char *s2 = StringPool_intern(pool, a, "i=47", 4);
+    char *s3 = StringPool_intern(pool, a, "i=46", 4);
+    ck_assert_str_eq(s1, "i=47");
+    ck_assert(s1 == s2);
+    ck_assert(s1 != s3);
+    ck_assert_uint_eq(StringPool_size(pool), 2);
+    char longString[STRINGPOOL_MAX_LENGTH + 2];
+    memset(longString, 'a', sizeof(longString) - 1);
+    longString[sizeof(longString) - 1] = '\0';
+    char *l1 = StringPool_intern(pool, a, longString, strlen(longString));
+    char *l2 = StringPool_intern(pool, a, longString, strlen(longString));
+    ck_assert_str_eq(l1, longString);
+    ck_assert(l1 != l2);
+    ck_assert_uint_eq(StringPool_size(pool), 2);
+    StringPool_delete(pool);
+    CharArenaAllocator_delete(a);
+}
+END_TEST
+
+START_TEST(internLast)
+{
+    CharArenaAllocator *a = CharArenaAllocator_new(100);
+    StringPool *pool = StringPool_new();
+    char *s1 = StringPool_intern(pool, a, "en", 2);
+    char *text = CharArenaAllocator_malloc(a, 3);
+    memcpy(text, "en", 2);
+    ck_assert(StringPool_internLast(pool, a, text) == s1);
+    // the text was given back
+    ck_assert(CharArenaAllocator_malloc(a, 3) == text);
+    char *other = CharArenaAllocator_malloc(a, 3);
+    memcpy(other, "de", 2);
+    ck_assert(StringPool_internLast(pool, a, other) == other);
+    ck_assert(StringPool_intern(pool, a, "de", 2) == other);
+    ck_assert(StringPool_internLast(pool, a, NULL) == NULL);
+    StringPool_delete(pool);
+    CharArenaAllocator_delete(a);
+}
+END_TEST
+
+START_TEST(internMany)
+{
+    CharArenaAllocator *a = CharArenaAllocator_new(1024);
+    StringPool *pool = StringPool_new();
+    char *first[5000];
+    char id[16];
+    for (int i = 0; i < 5000; i++)
+    {
+        snprintf(id, sizeof(id), "i=%d", i);
+        first[i] = StringPool_intern(pool, a, id, strlen(id));
+    }
+    for (int i = 0; i < 5000; i++)
+    {
+        snprintf(id, sizeof(id), "i=%d", i);
+        ck_assert(StringPool_intern(pool, a, id, strlen(id)) == first[i]);
+        ck_assert_str_eq(first[i], id);
+    }
+    ck_assert_uint_eq(StringPool_size(pool), 5000);
+    StringPool_delete(pool);
+    CharArenaAllocator_delete(a);
+}
+END_TEST
+
 int main(void)
 {
     Suite *s = suite_create("Sort tests");
@@ -62,6 +148,10 @@ int main(void)
     tcase_add_test(tc, simpleRealloc);
     tcase_add_test(tc, simpleRealloc2);
     tcase_add_test(tc, overcommit);
+    tcase_add_test(tc, freeLast);
+    tcase_add_test(tc, internStrings);
+    tcase_add_test(tc, internLast);
+    tcase_add_test(tc, internMany);
     suite_add_tcase(s, tc);
 
     SRunner *sr = srunner_create(s);
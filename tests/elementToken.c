@@ -0,0 +1,129 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "AttributeToken.h"
+#include "ElementToken.h"
+#include <check.h>
+#include <stdlib.h>
+
+static const char *names[TOKEN_COUNT] = {
+    [TOKEN_UANODESET] = "UANodeSet",
+    [TOKEN_NAMESPACEURIS] = "NamespaceUris",
+    [TOKEN_URI] = "Uri",
+    [TOKEN_ALIASES] = "Aliases",
+    [TOKEN_ALIAS] = "Alias",
+    [TOKEN_UAOBJECT] = "UAObject",
+    [TOKEN_UAMETHOD] = "UAMethod",
+    [TOKEN_UAOBJECTTYPE] = "UAObjectType",
+    [TOKEN_UAVARIABLE] = "UAVariable",
+    [TOKEN_UAVARIABLETYPE] = "UAVariableType",
+    [TOKEN_UADATATYPE] = "UADataType",
+    [TOKEN_UAREFERENCETYPE] = "UAReferenceType",
+    [TOKEN_UAVIEW] = "UAView",
+    [TOKEN_DISPLAYNAME] = "DisplayName",
+    [TOKEN_DESCRIPTION] = "Description",
+    [TOKEN_INVERSENAME] = "InverseName",
+    [TOKEN_REFERENCES] = "References",
+    [TOKEN_REFERENCE] = "Reference",
+    [TOKEN_VALUE] = "Value",
+    [TOKEN_DEFINITION] = "Definition",
+    [TOKEN_FIELD] = "Field",
+    [TOKEN_EXTENSIONS] = "Extensions",
+    [TOKEN_EXTENSION] = "Extension",
+    [TOKEN_EXTENSIONOBJECT] = "ExtensionObject",
+    [TOKEN_TYPEID] = "TypeId",
+    [TOKEN_BODY] = "Body",
+    [TOKEN_IDENTIFIER] = "Identifier"};
+
+static const char *attributeNames[ATTRIBUTE_COUNT] = {
+    [ATTRIBUTE_NODEID] = "NodeId",
+    [ATTRIBUTE_BROWSENAME] = "BrowseName",
+    [ATTRIBUTE_PARENTNODEID] = "ParentNodeId",
+    [ATTRIBUTE_DATATYPE] = "DataType",
+    [ATTRIBUTE_VALUERANK] = "ValueRank",
+    [ATTRIBUTE_ARRAYDIMENSIONS] = "ArrayDimensions",
+    [ATTRIBUTE_HISTORIZING] = "Historizing",
+    [ATTRIBUTE_EVENTNOTIFIER] = "EventNotifier",
+    [ATTRIBUTE_ISABSTRACT] = "IsAbstract",
+    [ATTRIBUTE_REFERENCETYPE] = "ReferenceType",
+    [ATTRIBUTE_ISFORWARD] = "IsForward",
+    [ATTRIBUTE_SYMMETRIC] = "Symmetric",
+    [ATTRIBUTE_ALIAS] = "Alias",
+    [ATTRIBUTE_CONTAINSNOLOOPS] = "ContainsNoLoops",
+    [ATTRIBUTE_EXECUTABLE] = "Executable",
+    [ATTRIBUTE_USEREXECUTABLE] = "UserExecutable",
+    [ATTRIBUTE_ACCESSLEVEL] = "AccessLevel",
+    [ATTRIBUTE_USERACCESSLEVEL] = "UserAccessLevel",
+    [ATTRIBUTE_ISUNION] = "IsUnion",
+    [ATTRIBUTE_ISOPTIONSET] = "IsOptionSet",
+    [ATTRIBUTE_NAME] = "Name",
+    [ATTRIBUTE_VALUE] = "Value",
+    [ATTRIBUTE_ISOPTIONAL] = "IsOptional",
+    [ATTRIBUTE_LOCALE] = "Locale"};
+
+START_TEST(knownNames)
+{
+    for (int i = TOKEN_UNKNOWN + 1; i < TOKEN_COUNT; i++)
+    {
+        ck_assert_ptr_ne(names[i], NULL);
+        ck_assert_int_eq(ElementToken_lookup(names[i]), i);
+    }
+}
+END_TEST
+
+START_TEST(unknownNames)
+{
+    ck_assert_int_eq(ElementToken_lookup(""), TOKEN_UNKNOWN);
+    ck_assert_int_eq(ElementToken_lookup("Ui"), TOKEN_UNKNOWN);
+    ck_assert_int_eq(ElementToken_lookup("Int32"), TOKEN_UNKNOWN);
+    ck_assert_int_eq(ElementToken_lookup("Valuf"), TOKEN_UNKNOWN);
+    ck_assert_int_eq(ElementToken_lookup("value"), TOKEN_UNKNOWN);
+    ck_assert_int_eq(ElementToken_lookup("UAVariablf"), TOKEN_UNKNOWN);
+    ck_assert_int_eq(ElementToken_lookup("ListOfExtensionObject"),
+                     TOKEN_UNKNOWN);
+}
+END_TEST
+
+START_TEST(knownAttributes)
+{
+    for (int i = 0; i < ATTRIBUTE_COUNT; i++)
+    {
+        ck_assert_ptr_ne(attributeNames[i], NULL);
+        ck_assert_int_eq(AttributeToken_lookup(attributeNames[i]), i);
+    }
+}
+END_TEST
+
+START_TEST(unknownAttributes)
+{
+    ck_assert_int_eq(AttributeToken_lookup(""), ATTRIBUTE_UNKNOWN);
+    ck_assert_int_eq(AttributeToken_lookup("Uri"), ATTRIBUTE_UNKNOWN);
+    ck_assert_int_eq(AttributeToken_lookup("nodeId"), ATTRIBUTE_UNKNOWN);
+    ck_assert_int_eq(AttributeToken_lookup("NodeIf"), ATTRIBUTE_UNKNOWN);
+    ck_assert_int_eq(AttributeToken_lookup("MinimumSamplingInterval"),
+                     ATTRIBUTE_UNKNOWN);
+    ck_assert_int_eq(AttributeToken_lookup("SymbolicName"),
+                     ATTRIBUTE_UNKNOWN);
+    ck_assert_int_eq(AttributeToken_lookup("ParentNodeI"), ATTRIBUTE_UNKNOWN);
+}
+END_TEST
+
+int main(void)
+{
+    Suite *s = suite_create("ElementToken tests");
+    TCase *tc = tcase_create("test cases");
+    tcase_add_test(tc, knownNames);
+    tcase_add_test(tc, unknownNames);
+    tcase_add_test(tc, knownAttributes);
+    tcase_add_test(tc, unknownAttributes);
+    suite_add_tcase(s, tc);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? 0 : -1;
+}
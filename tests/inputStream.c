@@ -0,0 +1,162 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "InputStream.h"
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define TEXT_SIZE 200000
+
+static char *text = NULL;
+
+// returns the data in pieces of at most 3 bytes to hit every boundary
+static long readSlowly(void *memory, char *buffer, size_t size)
+{
+    return InputStream_readMemory(memory, buffer, size > 3 ? 3 : size);
+}
+
+static unsigned char *gzipCompress(const char *data, size_t size,
+                                   size_t *compressedSize)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(z_stream));
+    // 15 + 16: gzip header
+    ck_assert(deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                           Z_DEFAULT_STRATEGY) == Z_OK);
+    size_t bound = deflateBound(&zs, (uLong)size);
+    unsigned char *out = (unsigned char *)malloc(bound);
+    zs.next_in = (Bytef *)(uintptr_t)data;
+    zs.avail_in = (uInt)size;
+    zs.next_out = out;
+    zs.avail_out = (uInt)bound;
+    ck_assert(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+    *compressedSize = bound - zs.avail_out;
+    deflateEnd(&zs);
+    return out;
+}
+
+static char *readAll(NL_readCallback read, InputStream_Memory *memory,
+                     size_t *size, bool *error)
+{
+    InputStream *stream = InputStream_new(read, memory);
+    ck_assert(stream);
+    size_t capacity = 2 * TEXT_SIZE;
+    char *out = (char *)malloc(capacity);
+    *size = 0;
+    *error = false;
+    long res;
+    while ((res = InputStream_read(stream, out + *size, 1000)) > 0)
+    {
+        *size += (size_t)res;
+        ck_assert(*size + 1000 <= capacity);
+    }
+    *error = res < 0;
+    InputStream_delete(stream);
+    return out;
+}
+
+static void setup(void)
+{
+    text = (char *)malloc(TEXT_SIZE);
+    for (size_t i = 0; i < TEXT_SIZE; i++)
+    {
+        text[i] = (char)('a' + (i * 7 + i / 13) % 26);
+    }
+}
+
+static void teardown(void) { free(text); }
+
+START_TEST(plain)
+{
+    InputStream_Memory memory = {text, TEXT_SIZE, 0};
+    ck_assert(!InputStream_isCompressed(text, TEXT_SIZE));
+    size_t size;
+    bool error;
+    char *out = readAll(readSlowly, &memory, &size, &error);
+    ck_assert(!error);
+    ck_assert_uint_eq(size, TEXT_SIZE);
+    ck_assert(!memcmp(out, text, TEXT_SIZE));
+    free(out);
+}
+END_TEST
+
+START_TEST(gzip)
+{
+    size_t compressedSize;
+    unsigned char *compressed =
+        gzipCompress(text, TEXT_SIZE, &compressedSize);
+    ck_assert(InputStream_isCompressed((char *)compressed, compressedSize));
+    InputStream_Memory memory = {(char *)compressed, compressedSize, 0};
+    size_t size;
+    bool error;
+    char *out = readAll(readSlowly, &memory, &size, &error);
+    ck_assert(!error);
+    ck_assert_uint_eq(size, TEXT_SIZE);
+    ck_assert(!memcmp(out, text, TEXT_SIZE));
+    free(out);
+    free(compressed);
+}
+END_TEST
+
+START_TEST(gzipConcatenatedMembers)
+{
+    size_t firstSize;
+    size_t secondSize;
+    unsigned char *first = gzipCompress(text, 1000, &firstSize);
+    unsigned char *second =
+        gzipCompress(text + 1000, TEXT_SIZE - 1000, &secondSize);
+    char *both = (char *)malloc(firstSize + secondSize);
+    memcpy(both, first, firstSize);
+    memcpy(both + firstSize, second, secondSize);
+    InputStream_Memory memory = {both, firstSize + secondSize, 0};
+    size_t size;
+    bool error;
+    char *out = readAll(InputStream_readMemory, &memory, &size, &error);
+    ck_assert(!error);
+    ck_assert_uint_eq(size, TEXT_SIZE);
+    ck_assert(!memcmp(out, text, TEXT_SIZE));
+    free(out);
+    free(both);
+    free(first);
+    free(second);
+}
+END_TEST
+
+START_TEST(gzipTruncated)
+{
+    size_t compressedSize;
+    unsigned char *compressed =
+        gzipCompress(text, TEXT_SIZE, &compressedSize);
+    InputStream_Memory memory = {(char *)compressed, compressedSize / 2, 0};
+    size_t size;
+    bool error;
+    char *out = readAll(InputStream_readMemory, &memory, &size, &error);
+    ck_assert(error);
+    free(out);
+    free(compressed);
+}
+END_TEST
+
+int main(void)
+{
+    Suite *s = suite_create("InputStream tests");
+    TCase *tc = tcase_create("test cases");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, plain);
+    tcase_add_test(tc, gzip);
+    tcase_add_test(tc, gzipConcatenatedMembers);
+    tcase_add_test(tc, gzipTruncated);
+    suite_add_tcase(s, tc);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? 0 : -1;
+}
@@ -4,47 +4,1552 @@
 
 #include <check.h>
 #include <NodesetLoader/NodesetLoader.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "basicNodeClassesImage.h"
 
 int addNamespace(void *userContext, const char *uri) { return 1; }
 
-void addNode(void *userContext, const NL_Node *node)
+void addNode(void *userContext, const NL_Node *node)
+{
+    (*((int*)userContext))++;
+}
+
+char *nodesetPath = NULL;
+// large enough to be split into several parts
+char *largeNodesetPath = NULL;
+// depends on the large nodeset and has its own namespace
+char *companionNodesetPath = NULL;
+// written by nodesetGen with GENERATED_NODES nodes, depends on the large
+// nodeset
+char *generatedNodesetPath = NULL;
+// depends on the large and the companion nodeset
+char *dependentNodesetPath = NULL;
+
+static void setup(void)
+{
+
+}
+
+static void teardown(void)
+{
+
+}
+
+START_TEST(Server_ImportBasicNodeClassTest)
+{
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    handler.file = nodesetPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(NodesetLoader_sort(loader));
+
+    int nodeCount=0;
+
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &nodeCount,
+                                  (NodesetLoader_forEachNode_Func)addNode);
+    }
+
+    ck_assert_int_eq(nodeCount, 8);
+
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+START_TEST(Server_ImportBasicNodeClassFromBufferTest)
+{
+    FILE *f = fopen(nodesetPath, "rb");
+    ck_assert(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    ck_assert(size > 0);
+    fseek(f, 0, SEEK_SET);
+    char *data = (char *)malloc((size_t)size);
+    ck_assert(data);
+    ck_assert(fread(data, 1, (size_t)size, f) == (size_t)size);
+    fclose(f);
+
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(!NodesetLoader_importBuffer(loader, &handler, data, 0));
+    ck_assert(NodesetLoader_importBuffer(loader, &handler, data, (size_t)size));
+    free(data);
+    ck_assert(NodesetLoader_sort(loader));
+
+    int nodeCount = 0;
+
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &nodeCount,
+                                  (NodesetLoader_forEachNode_Func)addNode);
+    }
+
+    ck_assert_int_eq(nodeCount, 8);
+
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+START_TEST(Server_ImportAfterParsingErrorTest)
+{
+    const char *broken = "<?xml version=\"1.0\"?><UANodeSet><Aliases>";
+
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.file = nodesetPath;
+
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    NodesetLoader_setParserOptions(loader, NL_PARSER_OPTIONS_DEFAULT |
+                                               NL_PARSER_OPTION_HUGE);
+    ck_assert(
+        !NodesetLoader_importBuffer(loader, &handler, broken, strlen(broken)));
+    // the parser is reused for the next file
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(NodesetLoader_sort(loader));
+
+    int nodeCount = 0;
+
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &nodeCount,
+                                  (NodesetLoader_forEachNode_Func)addNode);
+    }
+
+    ck_assert_int_eq(nodeCount, 8);
+
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+// with the cache, the files are imported by the sort
+START_TEST(Server_ImportCachedParsingErrorTest)
+{
+    const char *brokenPath = "cachedParsingError.xml";
+    FILE *f = fopen(brokenPath, "wb");
+    ck_assert(f);
+    fputs("<?xml version=\"1.0\"?><UANodeSet><Aliases>", f);
+    ck_assert_int_eq(fclose(f), 0);
+
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    NodesetLoader_setCacheDir(loader, ".");
+    handler.file = nodesetPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    handler.file = brokenPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(!NodesetLoader_sort(loader));
+    ck_assert(!NodesetLoader_sort(loader));
+    int nodeCount = 0;
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        ck_assert_uint_eq(
+            NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &nodeCount,
+                                      (NodesetLoader_forEachNode_Func)addNode),
+            0);
+    }
+    ck_assert_int_eq(nodeCount, 0);
+    NodesetLoader_delete(loader);
+    remove(brokenPath);
+}
+END_TEST
+
+static long readFile(void *file, char *buffer, size_t size)
+{
+    // small pieces, the parser has to deal with short reads
+    return (long)fread(buffer, 1, size > 100 ? 100 : size, (FILE *)file);
+}
+
+START_TEST(Server_ImportBasicNodeClassFromStreamTest)
+{
+    FILE *f = fopen(nodesetPath, "rb");
+    ck_assert(f);
+
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(!NodesetLoader_importStream(loader, &handler, NULL, f));
+    ck_assert(NodesetLoader_importStream(loader, &handler, readFile, f));
+    fclose(f);
+    ck_assert(NodesetLoader_sort(loader));
+
+    int nodeCount = 0;
+
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &nodeCount,
+                                  (NodesetLoader_forEachNode_Func)addNode);
+    }
+
+    ck_assert_int_eq(nodeCount, 8);
+
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+struct Dump
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+};
+
+static void appendDump(struct Dump *dump, const char *s)
+{
+    size_t len = strlen(s);
+    if (dump->size + len + 1 > dump->capacity)
+    {
+        dump->capacity = 2 * (dump->size + len + 1);
+        dump->data = (char *)realloc(dump->data, dump->capacity);
+        ck_assert(dump->data);
+    }
+    memcpy(dump->data + dump->size, s, len + 1);
+    dump->size += len;
+}
+
+static void appendRefs(struct Dump *dump, const NL_Reference *ref)
+{
+    char line[512];
+    for (; ref; ref = ref->next)
+    {
+        snprintf(line, sizeof(line), " %d:%s %d:%s %d", ref->refType.nsIdx,
+                 ref->refType.id, ref->target.nsIdx, ref->target.id,
+                 ref->isForward);
+        appendDump(dump, line);
+    }
+}
+
+static void appendData(struct Dump *dump, const NL_Data *data)
+{
+    appendDump(dump, " ");
+    appendDump(dump, data->name);
+    if (data->type == DATATYPE_PRIMITIVE)
+    {
+        appendDump(dump, "=");
+        appendDump(dump, data->val.primitiveData.value
+                             ? data->val.primitiveData.value
+                             : "");
+        return;
+    }
+    appendDump(dump, "{");
+    for (size_t i = 0; i < data->val.complexData.membersSize; i++)
+    {
+        appendData(dump, data->val.complexData.members[i]);
+    }
+    appendDump(dump, " }");
+}
+
+static void dumpNode(void *userContext, const NL_Node *node)
+{
+    struct Dump *dump = (struct Dump *)userContext;
+    char line[512];
+    snprintf(line, sizeof(line), "%d %d:%s %d:%s", node->nodeClass,
+             node->id.nsIdx, node->id.id, node->browseName.nsIdx,
+             node->browseName.name);
+    appendDump(dump, line);
+    appendRefs(dump, node->hierachicalRefs);
+    appendDump(dump, " |");
+    appendRefs(dump, node->nonHierachicalRefs);
+    appendDump(dump, " |");
+    appendRefs(dump, node->unknownRefs);
+    appendDump(dump, " |");
+    if (node->nodeClass == NODECLASS_OBJECT)
+    {
+        appendRefs(dump, ((const NL_ObjectNode *)node)->refToTypeDef);
+    }
+    if (node->nodeClass == NODECLASS_VARIABLE)
+    {
+        const NL_VariableNode *var = (const NL_VariableNode *)node;
+        appendRefs(dump, var->refToTypeDef);
+        snprintf(line, sizeof(line), " | %d %u %u %d %u",
+                 var->typed.valueRank, var->typed.accessLevel,
+                 var->typed.userAccessLevel, var->typed.historizing,
+                 var->typed.arrayDimensionsSize);
+        appendDump(dump, line);
+        const NL_Value *value =
+            NodesetLoader_getValue((const NL_VariableNode *)node);
+        if (value && value->data)
+        {
+            appendDump(dump, " |");
+            appendData(dump, value->data);
+        }
+    }
+    appendDump(dump, "\n");
+}
+
+static void dumpBiDirectionalRefs(struct Dump *dump,
+                                  const NodesetLoader *loader)
+{
+    char line[512];
+    for (const NL_BiDirectionalReference *ref =
+             NodesetLoader_getBidirectionalRefs(loader);
+         ref; ref = ref->next)
+    {
+        snprintf(line, sizeof(line), "%d:%s %d:%s\n", ref->source.nsIdx,
+                 ref->source.id, ref->target.nsIdx, ref->target.id);
+        appendDump(dump, line);
+    }
+}
+
+static struct Dump dumpLoader(NodesetLoader *loader)
+{
+    struct Dump dump = {NULL, 0, 0};
+    appendDump(&dump, "");
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &dump,
+                                  (NodesetLoader_forEachNode_Func)dumpNode);
+    }
+    dumpBiDirectionalRefs(&dump, loader);
+    return dump;
+}
+
+// imports the large nodeset file or, if data is set, the buffer
+static struct Dump importLarge(size_t threads, int options, const char *data,
+                               size_t size)
+{
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.file = largeNodesetPath;
+
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    NodesetLoader_setParserOptions(loader, options);
+    NodesetLoader_setParseThreads(loader, threads);
+    ck_assert(data ? NodesetLoader_importBuffer(loader, &handler, data, size)
+                   : NodesetLoader_importFile(loader, &handler));
+    ck_assert(NodesetLoader_sort(loader));
+
+    struct Dump dump = dumpLoader(loader);
+    NodesetLoader_delete(loader);
+    return dump;
+}
+
+START_TEST(Server_ImportParallelTest)
+{
+    const int options[] = {NL_PARSER_OPTIONS_DEFAULT,
+                           NL_PARSER_OPTIONS_DEFAULT |
+                               NL_PARSER_OPTION_FAST_TOKENIZER};
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++)
+    {
+        struct Dump serial = importLarge(1, options[i], NULL, 0);
+        ck_assert_uint_gt(serial.size, 0);
+        for (size_t threads = 2; threads <= 8; threads *= 2)
+        {
+            struct Dump parallel = importLarge(threads, options[i], NULL, 0);
+            ck_assert_uint_eq(parallel.size, serial.size);
+            ck_assert(!memcmp(parallel.data, serial.data, serial.size));
+            free(parallel.data);
+        }
+        free(serial.data);
+    }
+}
+END_TEST
+
+// a document large enough to be split, with a node element in a comment
+// before each node or with aliases after the nodes
+static struct Dump fallbackDocument(bool comments, bool trailingAliases)
+{
+    struct Dump doc = {NULL, 0, 0};
+    appendDump(&doc, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                     "<UANodeSet xmlns=\"http://opcfoundation.org/UA/2011/"
+                     "03/UANodeSet.xsd\">\n"
+                     "<NamespaceUris><Uri>urn:test</Uri></NamespaceUris>\n"
+                     "<Aliases><Alias Alias=\"Organizes\">i=35</Alias>"
+                     "</Aliases>\n");
+    char node[256];
+    for (int i = 0; i < 20000; i++)
+    {
+        if (comments)
+        {
+            snprintf(node, sizeof(node), "<!-- <UAObject NodeId=\"i=%d\"> -->",
+                     i);
+            appendDump(&doc, node);
+        }
+        snprintf(node, sizeof(node),
+                 "<UAObject NodeId=\"ns=1;i=%d\" BrowseName=\"1:n%d\">"
+                 "<References><Reference ReferenceType=\"Organizes\" "
+                 "IsForward=\"false\">i=85</Reference></References>"
+                 "</UAObject>\n",
+                 i, i);
+        appendDump(&doc, node);
+    }
+    if (trailingAliases)
+    {
+        appendDump(&doc, "<Aliases><Alias Alias=\"HasComponent\">i=47</Alias>"
+                         "</Aliases>\n");
+    }
+    appendDump(&doc, "</UANodeSet>\n");
+    return doc;
+}
+
+static void assertParallelEqualsSerial(struct Dump *doc)
+{
+    struct Dump serial =
+        importLarge(1, NL_PARSER_OPTIONS_DEFAULT, doc->data, doc->size);
+    ck_assert_uint_gt(serial.size, 0);
+    struct Dump parallel =
+        importLarge(4, NL_PARSER_OPTIONS_DEFAULT, doc->data, doc->size);
+    ck_assert_uint_eq(parallel.size, serial.size);
+    ck_assert(!memcmp(parallel.data, serial.data, serial.size));
+    free(parallel.data);
+    free(serial.data);
+    free(doc->data);
+}
+
+// the split points are guessed, a node element in a comment must not be
+// taken for one
+START_TEST(Server_ImportParallelCommentTest)
+{
+    struct Dump doc = fallbackDocument(true, false);
+    assertParallelEqualsSerial(&doc);
+}
+END_TEST
+
+// aliases after the nodes make the parallel parse fall back to the serial one
+START_TEST(Server_ImportParallelTrailingAliasesTest)
+{
+    struct Dump doc = fallbackDocument(false, true);
+    assertParallelEqualsSerial(&doc);
+}
+END_TEST
+
+static int addNamespaceToDump(void *userContext, const char *uri)
+{
+    struct Dump *namespaces = (struct Dump *)userContext;
+    // the uri of basicNodeClasses.xml is not a plain text
+    appendDump(namespaces, uri ? uri : "(null)");
+    appendDump(namespaces, "\n");
+    return (int)namespaces->size;
+}
+
+// the files are imported with addNamespaceToDump, the dump of the nodes is
+// appended to the namespaces
+static struct Dump importFiles(const char **paths, size_t count, bool batch,
+                               size_t threads, int options,
+                               bool expectedStatus)
+{
+    struct Dump dump = {NULL, 0, 0};
+    appendDump(&dump, "");
+    NL_FileContext handlers[4];
+    ck_assert_uint_le(count, 4);
+    for (size_t i = 0; i < count; i++)
+    {
+        memset(&handlers[i], 0, sizeof(NL_FileContext));
+        handlers[i].addNamespace = addNamespaceToDump;
+        handlers[i].userContext = &dump;
+        handlers[i].file = paths[i];
+    }
+
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    NodesetLoader_setParseThreads(loader, threads);
+    NodesetLoader_setParserOptions(loader, options);
+    bool status = true;
+    if (batch)
+    {
+        status = NodesetLoader_importFiles(loader, handlers, count);
+    }
+    for (size_t i = 0; !batch && status && i < count; i++)
+    {
+        status = NodesetLoader_importFile(loader, &handlers[i]);
+    }
+    ck_assert(status == expectedStatus);
+    ck_assert(NodesetLoader_sort(loader));
+
+    struct Dump nodes = dumpLoader(loader);
+    appendDump(&dump, nodes.data);
+    free(nodes.data);
+    NodesetLoader_delete(loader);
+    return dump;
+}
+
+static void assertDumpEq(struct Dump *dump, struct Dump *expected)
+{
+    ck_assert_uint_eq(dump->size, expected->size);
+    ck_assert(!memcmp(dump->data, expected->data, expected->size));
+    free(dump->data);
+}
+
+START_TEST(Server_ImportLazyValuesTest)
+{
+    struct Dump eager = importLarge(1, NL_PARSER_OPTIONS_DEFAULT, NULL, 0);
+    int options = NL_PARSER_OPTIONS_DEFAULT | NL_PARSER_OPTION_LAZY_VALUES;
+    struct Dump lazy = importLarge(1, options, NULL, 0);
+    assertDumpEq(&lazy, &eager);
+    lazy = importLarge(4, options, NULL, 0);
+    assertDumpEq(&lazy, &eager);
+    free(eager.data);
+}
+END_TEST
+
+static bool skipNamespaceZero(void *userContext, NL_NodeClass nodeClass,
+                              const NL_NodeId *id,
+                              const NL_BrowseName *browseName)
+{
+    return id->nsIdx != 0 && browseName->name;
+}
+
+static void countCompanionNode(void *userContext, const NL_Node *node)
+{
+    if (node->id.nsIdx != 0)
+    {
+        (*(size_t *)userContext)++;
+    }
+}
+
+// the nodes of the companion nodeset after importing it on top of the large
+// nodeset
+static size_t countCompanionNodes(NL_nodeFilterCallback filter,
+                                  size_t threads)
+{
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.filterNode = filter;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    NodesetLoader_setParseThreads(loader, threads);
+    handler.file = largeNodesetPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    handler.file = companionNodesetPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(NodesetLoader_sort(loader));
+    size_t count = 0;
+    size_t companion = 0;
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        count += NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &companion,
+                                           (NodesetLoader_forEachNode_Func)
+                                               countCompanionNode);
+    }
+    NodesetLoader_delete(loader);
+    // a filter only leaves the nodes of the companion
+    ck_assert(!filter || count == companion);
+    return companion;
+}
+
+START_TEST(Server_ImportFilterTest)
+{
+    size_t expected = countCompanionNodes(NULL, 1);
+    ck_assert_uint_gt(expected, 0);
+    ck_assert_uint_eq(countCompanionNodes(skipNamespaceZero, 1), expected);
+    ck_assert_uint_eq(countCompanionNodes(skipNamespaceZero, 4), expected);
+}
+END_TEST
+
+START_TEST(Server_ImportFilesTest)
+{
+    const char *paths[] = {largeNodesetPath, companionNodesetPath};
+    struct Dump serial =
+        importFiles(paths, 2, false, 1, NL_PARSER_OPTIONS_DEFAULT, true);
+    ck_assert_uint_gt(serial.size, 0);
+    for (size_t threads = 1; threads <= 8; threads *= 2)
+    {
+        struct Dump batch = importFiles(paths, 2, true, threads,
+                                        NL_PARSER_OPTIONS_DEFAULT, true);
+        assertDumpEq(&batch, &serial);
+    }
+    free(serial.data);
+
+    // the namespace indices of the last file refer to the namespaces of all
+    // files before it
+    if (dependentNodesetPath)
+    {
+        const char *chain[] = {largeNodesetPath, companionNodesetPath,
+                               dependentNodesetPath};
+        serial =
+            importFiles(chain, 3, false, 1, NL_PARSER_OPTIONS_DEFAULT, true);
+        for (size_t threads = 1; threads <= 8; threads *= 4)
+        {
+            struct Dump batch = importFiles(chain, 3, true, threads,
+                                            NL_PARSER_OPTIONS_DEFAULT, true);
+            assertDumpEq(&batch, &serial);
+        }
+        free(serial.data);
+    }
+
+    // the files before the missing one are imported
+    const char *missing[] = {largeNodesetPath, "doesNotExist.xml",
+                             companionNodesetPath};
+    serial =
+        importFiles(missing, 3, false, 1, NL_PARSER_OPTIONS_DEFAULT, false);
+    struct Dump batch =
+        importFiles(missing, 3, true, 4, NL_PARSER_OPTIONS_DEFAULT, false);
+    assertDumpEq(&batch, &serial);
+    free(serial.data);
+}
+END_TEST
+
+START_TEST(Server_ImportReadAheadTest)
+{
+    const char *paths[] = {largeNodesetPath, companionNodesetPath};
+    struct Dump mapped =
+        importFiles(paths, 2, false, 1, NL_PARSER_OPTIONS_DEFAULT, true);
+    int options = NL_PARSER_OPTIONS_DEFAULT | NL_PARSER_OPTION_READ_AHEAD;
+    struct Dump readAhead = importFiles(paths, 2, false, 1, options, true);
+    assertDumpEq(&readAhead, &mapped);
+    // the parser threads read the whole file
+    readAhead = importFiles(paths, 2, false, 4, options, true);
+    assertDumpEq(&readAhead, &mapped);
+    free(mapped.data);
+
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    NodesetLoader_setParserOptions(loader, options);
+    handler.file = largeNodesetPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    handler.file = nodesetPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(NodesetLoader_sort(loader));
+
+    FILE *f = fopen(largeNodesetPath, "rb");
+    ck_assert(f);
+    fseek(f, 0, SEEK_END);
+    size_t size = (size_t)ftell(f);
+    fclose(f);
+    const NL_ImportTiming *timings = NULL;
+    ck_assert_uint_eq(NodesetLoader_getImportTimings(loader, &timings), 2);
+    ck_assert_str_eq(timings[0].file, largeNodesetPath);
+    ck_assert_uint_eq(timings[0].bytes, size);
+    ck_assert(timings[0].ioWaitMs >= 0);
+    ck_assert(timings[0].parseMs > 0);
+    ck_assert_str_eq(timings[1].file, nodesetPath);
+    ck_assert_uint_gt(timings[1].bytes, 0);
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+// loads the image and imports the files on top of it like importFiles
+static struct Dump loadImage(const char *image, const char **paths,
+                             size_t count)
+{
+    struct Dump dump = {NULL, 0, 0};
+    appendDump(&dump, "");
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespaceToDump;
+    handler.userContext = &dump;
+    handler.file = image;
+
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(NodesetLoader_loadImage(loader, &handler));
+    for (size_t i = 0; i < count; i++)
+    {
+        handler.file = paths[i];
+        ck_assert(NodesetLoader_importFile(loader, &handler));
+    }
+    ck_assert(NodesetLoader_sort(loader));
+
+    struct Dump nodes = dumpLoader(loader);
+    appendDump(&dump, nodes.data);
+    free(nodes.data);
+    NodesetLoader_delete(loader);
+    return dump;
+}
+
+static int cmpLines(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// the nodes of a file imported on top of an image are sorted after the nodes
+// of the image, only the set of nodes is the same as for a serial import
+static void sortLines(struct Dump *dump)
+{
+    size_t count = 0;
+    char **lines = NULL;
+    for (char *line = strtok(dump->data, "\n"); line;
+         line = strtok(NULL, "\n"))
+    {
+        lines = (char **)realloc(lines, (count + 1) * sizeof(char *));
+        ck_assert(lines);
+        lines[count++] = line;
+    }
+    qsort(lines, count, sizeof(char *), cmpLines);
+    struct Dump sorted = {NULL, 0, 0};
+    appendDump(&sorted, "");
+    for (size_t i = 0; i < count; i++)
+    {
+        appendDump(&sorted, lines[i]);
+        appendDump(&sorted, "\n");
+    }
+    free(lines);
+    free(dump->data);
+    *dump = sorted;
+}
+
+struct StreamedId
+{
+    // "nsIdx:id"
+    char *key;
+    size_t position;
+};
+
+struct Stream
 {
-    (*((int*)userContext))++;
+    struct Dump nodes;
+    // the streamed nodes in their order
+    struct StreamedId *ids;
+    size_t idsSize;
+    // the streamed node and the target of its inverse hierarchical reference
+    size_t *parentNodes;
+    char **parents;
+    size_t parentsSize;
+};
+
+static char *idKey(const NL_NodeId *id)
+{
+    char key[512];
+    snprintf(key, sizeof(key), "%d:%s", id->nsIdx, id->id);
+    char *copy = (char *)malloc(strlen(key) + 1);
+    ck_assert(copy);
+    strcpy(copy, key);
+    return copy;
 }
 
-char *nodesetPath = NULL;
+static void streamNode(void *userContext, const NL_Node *node)
+{
+    struct Stream *stream = (struct Stream *)userContext;
+    dumpNode(&stream->nodes, node);
+    for (const NL_Reference *ref = node->hierachicalRefs; ref; ref = ref->next)
+    {
+        if (ref->isForward)
+        {
+            continue;
+        }
+        stream->parents = (char **)realloc(
+            stream->parents, (stream->parentsSize + 1) * sizeof(char *));
+        stream->parentNodes = (size_t *)realloc(
+            stream->parentNodes, (stream->parentsSize + 1) * sizeof(size_t));
+        ck_assert(stream->parents && stream->parentNodes);
+        stream->parentNodes[stream->parentsSize] = stream->idsSize;
+        stream->parents[stream->parentsSize++] = idKey(&ref->target);
+    }
+    stream->ids = (struct StreamedId *)realloc(
+        stream->ids, (stream->idsSize + 1) * sizeof(struct StreamedId));
+    ck_assert(stream->ids);
+    stream->ids[stream->idsSize].key = idKey(&node->id);
+    stream->ids[stream->idsSize].position = stream->idsSize;
+    stream->idsSize++;
+}
 
-static void setup(void)
+static int cmpStreamedIds(const void *a, const void *b)
 {
+    return strcmp(((const struct StreamedId *)a)->key,
+                  ((const struct StreamedId *)b)->key);
+}
 
+// the parents which were streamed have to come before their children
+static void assertStreamOrder(struct Stream *stream)
+{
+    qsort(stream->ids, stream->idsSize, sizeof(struct StreamedId),
+          cmpStreamedIds);
+    for (size_t i = 0; i < stream->parentsSize; i++)
+    {
+        struct StreamedId parent = {stream->parents[i], 0};
+        const struct StreamedId *streamed = (const struct StreamedId *)bsearch(
+            &parent, stream->ids, stream->idsSize, sizeof(struct StreamedId),
+            cmpStreamedIds);
+        if (streamed)
+        {
+            ck_assert_uint_lt(streamed->position, stream->parentNodes[i]);
+        }
+        free(stream->parents[i]);
+    }
+    for (size_t i = 0; i < stream->idsSize; i++)
+    {
+        free(stream->ids[i].key);
+    }
+    free(stream->ids);
+    free(stream->parents);
+    free(stream->parentNodes);
 }
 
-static void teardown(void)
+START_TEST(Server_ImportStreamTest)
 {
+    const char *paths[] = {largeNodesetPath, companionNodesetPath};
+    struct Stream stream;
+    memset(&stream, 0, sizeof(stream));
+    appendDump(&stream.nodes, "");
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(NodesetLoader_setNodeStream(
+        loader, &stream, (NodesetLoader_forEachNode_Func)streamNode));
+    for (size_t i = 0; i < 2; i++)
+    {
+        handler.file = paths[i];
+        ck_assert(NodesetLoader_importFile(loader, &handler));
+    }
+    // most nodes are ready before the sort
+    size_t beforeSort = stream.idsSize;
+    ck_assert(NodesetLoader_sort(loader));
+    ck_assert_uint_gt(beforeSort, stream.idsSize / 2);
+    int rest = 0;
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &rest,
+                                  (NodesetLoader_forEachNode_Func)addNode);
+    }
+    ck_assert_int_eq(rest, 0);
+    NodesetLoader_delete(loader);
+
+    struct Dump expected = {NULL, 0, 0};
+    appendDump(&expected, "");
+    loader = NodesetLoader_new(NULL, NULL);
+    for (size_t i = 0; i < 2; i++)
+    {
+        handler.file = paths[i];
+        ck_assert(NodesetLoader_importFile(loader, &handler));
+    }
+    ck_assert(NodesetLoader_sort(loader));
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &expected,
+                                  (NodesetLoader_forEachNode_Func)dumpNode);
+    }
+    NodesetLoader_delete(loader);
 
+    assertStreamOrder(&stream);
+    sortLines(&stream.nodes);
+    sortLines(&expected);
+    assertDumpEq(&stream.nodes, &expected);
+    free(expected.data);
 }
+END_TEST
 
-START_TEST(Server_ImportBasicNodeClassTest)
+// the dump of the streamed nodes of the document
+static struct Dump streamBuffer(const struct Dump *doc, size_t budget,
+                                NL_Stats *stats)
 {
     NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
     handler.addNamespace = addNamespace;
+    struct Dump dump = {NULL, 0, 0};
+    appendDump(&dump, "");
 
     NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
-    handler.file = nodesetPath;
+    ck_assert(NodesetLoader_setNodeStream(
+        loader, &dump, (NodesetLoader_forEachNode_Func)dumpNode));
+    ck_assert(NodesetLoader_setMemoryBudget(loader, budget));
+    ck_assert(
+        NodesetLoader_importBuffer(loader, &handler, doc->data, doc->size));
+    ck_assert(NodesetLoader_sort(loader));
+    NodesetLoader_getStats(loader, stats);
+    NodesetLoader_delete(loader);
+    return dump;
+}
+
+// the variables come before their parent, so all of them are held back
+START_TEST(Server_ImportMemoryBudgetTest)
+{
+    struct Dump doc = {NULL, 0, 0};
+    appendDump(&doc, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                     "<UANodeSet xmlns=\"http://opcfoundation.org/UA/2011/"
+                     "03/UANodeSet.xsd\">\n"
+                     "<NamespaceUris><Uri>urn:test</Uri></NamespaceUris>\n"
+                     "<Aliases><Alias Alias=\"Organizes\">i=35</Alias>"
+                     "<Alias Alias=\"HasComponent\">i=47</Alias>"
+                     "</Aliases>\n");
+    char node[512];
+    for (int i = 2; i < 5000; i++)
+    {
+        snprintf(node, sizeof(node),
+                 "<UAVariable NodeId=\"ns=1;i=%d\" BrowseName=\"1:v%d\" "
+                 "DataType=\"String\"><DisplayName>v%d</DisplayName>"
+                 "<References><Reference ReferenceType=\"HasComponent\" "
+                 "IsForward=\"false\">ns=1;i=1</Reference></References>"
+                 "<Value><String xmlns=\"http://opcfoundation.org/UA/2008/"
+                 "02/Types.xsd\">value %d</String></Value></UAVariable>\n",
+                 i, i, i, i);
+        appendDump(&doc, node);
+    }
+    // replace the first held back variable, which stays in memory, and the
+    // last one, which is spilled
+    const int duplicates[] = {2, 4999};
+    for (size_t i = 0; i < 2; i++)
+    {
+        snprintf(node, sizeof(node),
+                 "<UAVariable NodeId=\"ns=1;i=%d\" BrowseName=\"1:dup%d\" "
+                 "DataType=\"String\"><References><Reference "
+                 "ReferenceType=\"HasComponent\" IsForward=\"false\">"
+                 "ns=1;i=1</Reference></References></UAVariable>\n",
+                 duplicates[i], duplicates[i]);
+        appendDump(&doc, node);
+    }
+    appendDump(&doc, "<UAObject NodeId=\"ns=1;i=1\" BrowseName=\"1:parent\">"
+                     "<References><Reference ReferenceType=\"Organizes\" "
+                     "IsForward=\"false\">i=85</Reference></References>"
+                     "</UAObject>\n</UANodeSet>\n");
+
+    const size_t budget = 16 * 1024;
+    NL_Stats stats;
+    struct Dump expected = streamBuffer(&doc, 0, &stats);
+    ck_assert_uint_eq(stats.spilledNodes, 0);
+    ck_assert_uint_gt(stats.peakHeldBytes, 10 * budget);
+    struct Dump spilled = streamBuffer(&doc, budget, &stats);
+    ck_assert_uint_gt(stats.spilledNodes, 0);
+    ck_assert_uint_gt(stats.peakHeldBytes, 0);
+    ck_assert_uint_le(stats.peakHeldBytes, budget);
+    ck_assert(strstr(expected.data, " 1:dup2 "));
+    ck_assert(strstr(expected.data, " 1:dup4999 "));
+    ck_assert(!strstr(expected.data, " 1:v2 "));
+    assertDumpEq(&spilled, &expected);
+    free(expected.data);
+    free(doc.data);
+
+    // without a stream nothing is held back
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(!NodesetLoader_setMemoryBudget(loader, budget));
+    ck_assert(NodesetLoader_setMemoryBudget(loader, 0));
+    ck_assert(NodesetLoader_setNodeStream(
+        loader, NULL, (NodesetLoader_forEachNode_Func)addNode));
+    ck_assert(NodesetLoader_setMemoryBudget(loader, budget));
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+// each namespace of the document gets its own index
+static int addNextNamespace(void *userContext, const char *uri)
+{
+    return ++*(int *)userContext;
+}
+
+// the parent in the second namespace of the file comes after its child
+START_TEST(Server_ImportStreamNamespacesTest)
+{
+    const char doc[] =
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "<UANodeSet xmlns=\"http://opcfoundation.org/UA/2011/03/"
+        "UANodeSet.xsd\">\n"
+        "<NamespaceUris><Uri>urn:a</Uri><Uri>urn:b</Uri></NamespaceUris>\n"
+        "<Aliases><Alias Alias=\"Organizes\">i=35</Alias></Aliases>\n"
+        "<UAObject NodeId=\"ns=1;i=1\" BrowseName=\"1:child\">"
+        "<References><Reference ReferenceType=\"Organizes\" "
+        "IsForward=\"false\">ns=2;i=1</Reference></References>"
+        "</UAObject>\n"
+        "<UAObject NodeId=\"ns=2;i=1\" BrowseName=\"2:parent\">"
+        "<References><Reference ReferenceType=\"Organizes\" "
+        "IsForward=\"false\">i=85</Reference></References>"
+        "</UAObject>\n</UANodeSet>\n";
+    int namespaces = 0;
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNextNamespace;
+    handler.userContext = &namespaces;
+    struct Stream stream;
+    memset(&stream, 0, sizeof(stream));
+    appendDump(&stream.nodes, "");
+
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(NodesetLoader_setNodeStream(
+        loader, &stream, (NodesetLoader_forEachNode_Func)streamNode));
+    ck_assert(
+        NodesetLoader_importBuffer(loader, &handler, doc, sizeof(doc) - 1));
+    // the child waits for its parent, the parent only for namespace 0
+    ck_assert_uint_eq(stream.idsSize, 2);
+    ck_assert_str_eq(stream.ids[0].key, "2:i=1");
+    ck_assert(NodesetLoader_sort(loader));
+    NodesetLoader_delete(loader);
+    ck_assert_uint_eq(stream.idsSize, 2);
+    assertStreamOrder(&stream);
+    free(stream.nodes.data);
+}
+END_TEST
+
+// one object below the objects folder with the browse name %s
+#define DUPLICATE_DOCUMENT                                                     \
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"                           \
+    "<UANodeSet xmlns=\"http://opcfoundation.org/UA/2011/03/"                 \
+    "UANodeSet.xsd\">\n"                                                      \
+    "<NamespaceUris><Uri>urn:test</Uri></NamespaceUris>\n"                    \
+    "<Aliases><Alias Alias=\"Organizes\">i=35</Alias></Aliases>\n"            \
+    "<UAObject NodeId=\"ns=1;i=1\" BrowseName=\"1:%s\">"                      \
+    "<References><Reference ReferenceType=\"Organizes\" "                    \
+    "IsForward=\"false\">i=85</Reference></References>"                      \
+    "</UAObject>\n</UANodeSet>\n"
+
+// the dump of two documents with the same node, the loader sorts after each
+// document if sortEach is set
+static struct Dump importDuplicate(bool stream, bool sortEach)
+{
+    struct Dump dump = {NULL, 0, 0};
+    appendDump(&dump, "");
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(!stream ||
+              NodesetLoader_setNodeStream(
+                  loader, &dump, (NodesetLoader_forEachNode_Func)dumpNode));
+    const char *names[] = {"first", "second"};
+    char doc[1024];
+    for (size_t i = 0; i < 2; i++)
+    {
+        int length = snprintf(doc, sizeof(doc), DUPLICATE_DOCUMENT, names[i]);
+        ck_assert(NodesetLoader_importBuffer(loader, &handler, doc,
+                                             (size_t)length));
+        ck_assert(!sortEach || NodesetLoader_sort(loader));
+    }
+    ck_assert(NodesetLoader_sort(loader));
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &dump,
+                                  (NodesetLoader_forEachNode_Func)dumpNode);
+    }
+    NodesetLoader_delete(loader);
+    return dump;
+}
+
+// a node replaces a pending node with its NodeId, a node with the NodeId of a
+// sorted or streamed node is dropped
+START_TEST(Server_ImportDuplicateNodeIdTest)
+{
+    struct Dump pending = importDuplicate(false, false);
+    ck_assert(strstr(pending.data, " 1:second "));
+    ck_assert(!strstr(pending.data, " 1:first "));
+    free(pending.data);
+
+    struct Dump sorted = importDuplicate(false, true);
+    ck_assert(strstr(sorted.data, " 1:first "));
+    ck_assert(!strstr(sorted.data, " 1:second "));
+    struct Dump streamed = importDuplicate(true, false);
+    assertDumpEq(&streamed, &sorted);
+    free(sorted.data);
+}
+END_TEST
+
+struct ProgressRecord
+{
+    size_t calls;
+    size_t lastBytes;
+    size_t lastNodes;
+    NL_ProgressPhase lastPhase;
+    // the call which returns false, 0 never cancels
+    size_t cancelAt;
+    NL_ProgressPhase cancelPhase;
+};
+
+static bool recordProgress(void *userContext, const NL_Progress *progress)
+{
+    struct ProgressRecord *record = (struct ProgressRecord *)userContext;
+    ck_assert(progress->phase >= record->lastPhase);
+    // the report at the end of a file has no bytes
+    if (progress->bytes)
+    {
+        ck_assert_uint_gt(progress->bytes, record->lastBytes);
+        record->lastBytes = progress->bytes;
+    }
+    if (progress->phase == record->lastPhase)
+    {
+        ck_assert(progress->nodes >= record->lastNodes);
+    }
+    record->calls++;
+    record->lastNodes = progress->nodes;
+    record->lastPhase = progress->phase;
+    return !(record->cancelAt && progress->phase == record->cancelPhase &&
+             record->calls >= record->cancelAt);
+}
+
+static size_t countNodes(NodesetLoader *loader)
+{
+    int nodeCount = 0;
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &nodeCount,
+                                  (NodesetLoader_forEachNode_Func)addNode);
+    }
+    return (size_t)nodeCount;
+}
+
+START_TEST(Server_ImportProgressTest)
+{
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.file = largeNodesetPath;
+    handler.progress = recordProgress;
+
+    struct ProgressRecord record;
+    memset(&record, 0, sizeof(record));
+    handler.userContext = &record;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
     ck_assert(NodesetLoader_importFile(loader, &handler));
+    // one call per MiB and the one at the end of the file
+    ck_assert_uint_gt(record.calls, 2);
+    ck_assert_int_eq(record.lastPhase, NL_PROGRESS_PARSE);
+    const size_t parsed = record.lastNodes;
+    ck_assert_uint_gt(parsed, 0);
+    const size_t parseCalls = record.calls;
     ck_assert(NodesetLoader_sort(loader));
+    ck_assert_uint_gt(record.calls, parseCalls);
+    ck_assert_int_eq(record.lastPhase, NL_PROGRESS_SORT);
+    ck_assert_uint_eq(record.lastNodes, countNodes(loader));
+    NodesetLoader_delete(loader);
 
-    int nodeCount=0;
+    // the loader is empty after a cancel and can be used again
+    memset(&record, 0, sizeof(record));
+    record.cancelAt = 1;
+    record.cancelPhase = NL_PROGRESS_PARSE;
+    loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(!NodesetLoader_importFile(loader, &handler));
+    ck_assert_uint_eq(record.calls, 1);
+    ck_assert(NodesetLoader_sort(loader));
+    ck_assert_uint_eq(countNodes(loader), 0);
+    memset(&record, 0, sizeof(record));
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(NodesetLoader_sort(loader));
+    ck_assert_uint_eq(countNodes(loader), record.lastNodes);
+    NodesetLoader_delete(loader);
+
+    memset(&record, 0, sizeof(record));
+    record.cancelAt = parseCalls + 1;
+    record.cancelPhase = NL_PROGRESS_SORT;
+    loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(!NodesetLoader_sort(loader));
+    ck_assert_uint_eq(countNodes(loader), 0);
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+START_TEST(Server_ImportStatsTest)
+{
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.file = largeNodesetPath;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    NL_Stats stats;
+    NodesetLoader_getStats(loader, &stats);
+    ck_assert_uint_eq(stats.bytes, 0);
+    ck_assert_uint_eq(stats.arenaBytes, 0);
+
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(NodesetLoader_sort(loader));
+    size_t nodeCount = countNodes(loader);
+    NodesetLoader_getStats(loader, &stats);
+    size_t counted = 0;
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        counted += stats.nodes[i];
+    }
+    ck_assert_uint_eq(counted, nodeCount);
+    ck_assert_uint_gt(stats.nodes[NODECLASS_REFERENCETYPE], 0);
+    const NL_ImportTiming *timings = NULL;
+    ck_assert_uint_eq(NodesetLoader_getImportTimings(loader, &timings), 1);
+    ck_assert_uint_eq(stats.bytes, timings[0].bytes);
+    ck_assert_uint_eq(stats.parseChunks, timings[0].parseChunks);
+    ck_assert_uint_gt(stats.parseChunks, 0);
+    ck_assert(stats.importMs > 0);
+    ck_assert(stats.forEachNodeMs > 0);
+    ck_assert_uint_gt(stats.hierarchicalRefs, nodeCount / 2);
+    ck_assert_uint_gt(stats.nonHierarchicalRefs, 0);
+    ck_assert(stats.unknownRefsResolved <= stats.unknownRefs);
+    ck_assert_uint_gt(stats.arenaBytes, 0);
+    ck_assert(stats.peakSortNodes >= nodeCount);
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+static size_t liveBytes(const NL_MemoryUsage *usage,
+                        const NL_MemoryUsage *before, int category)
+{
+    return usage[category].live - before[category].live;
+}
+
+// live bytes per node of NodeSet2.xml after the sort, catches bloat
+static const size_t memoryPerNode[NL_MEMORY_CATEGORY_COUNT] = {
+    224, 192, 112, 704, 144, 8};
+
+START_TEST(Server_ImportMemoryTest)
+{
+    NL_MemoryUsage before[NL_MEMORY_CATEGORY_COUNT];
+    ck_assert(NodesetLoader_getMemoryUsage(before));
+    NodesetLoader_resetMemoryUsage();
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.file = largeNodesetPath;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    NL_MemoryUsage usage[NL_MEMORY_CATEGORY_COUNT];
+    ck_assert(NodesetLoader_getMemoryUsage(usage));
+    for (int i = 0; i < NL_MEMORY_CATEGORY_COUNT; i++)
+    {
+        ck_assert(usage[i].peak >= usage[i].live);
+        ck_assert(usage[i].allocated >= liveBytes(usage, before, i));
+    }
+    ck_assert_uint_gt(liveBytes(usage, before, NL_MEMORY_NODES), 0);
+    ck_assert_uint_gt(liveBytes(usage, before, NL_MEMORY_SORT), 0);
+
+    ck_assert(NodesetLoader_sort(loader));
+    size_t nodes = countNodes(loader);
+    ck_assert(NodesetLoader_getMemoryUsage(usage));
+    for (int i = 0; i < NL_MEMORY_CATEGORY_COUNT; i++)
+    {
+        ck_assert_msg(liveBytes(usage, before, i) <= memoryPerNode[i] * nodes,
+                      "%s: %zu bytes per node", NL_MEMORY_CATEGORY_NAME[i],
+                      liveBytes(usage, before, i) / nodes);
+    }
+    NodesetLoader_delete(loader);
+    ck_assert(NodesetLoader_getMemoryUsage(usage));
+    for (int i = 0; i < NL_MEMORY_CATEGORY_COUNT; i++)
+    {
+        ck_assert_uint_eq(usage[i].live, before[i].live);
+    }
+}
+END_TEST
+
+START_TEST(Server_ImportImageTest)
+{
+    const char *image = "parserTest.image";
+    const char *paths[] = {largeNodesetPath, companionNodesetPath};
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.file = largeNodesetPath;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    // only sorted nodes are written
+    ck_assert(!NodesetLoader_writeImage(loader, image));
+    ck_assert(NodesetLoader_sort(loader));
+    ck_assert(NodesetLoader_writeImage(loader, image));
+    NodesetLoader_delete(loader);
 
+    struct Dump expected =
+        importFiles(paths, 1, false, 1, NL_PARSER_OPTIONS_DEFAULT, true);
+    struct Dump loaded = loadImage(image, NULL, 0);
+    assertDumpEq(&loaded, &expected);
+    free(expected.data);
+    expected = importFiles(paths, 2, false, 1, NL_PARSER_OPTIONS_DEFAULT, true);
+    loaded = loadImage(image, &paths[1], 1);
+    sortLines(&expected);
+    sortLines(&loaded);
+    assertDumpEq(&loaded, &expected);
+    free(expected.data);
+
+    // a truncated image is rejected and the xml can be imported instead
+    FILE *f = fopen(image, "rb");
+    ck_assert(f);
+    char header[256];
+    ck_assert_uint_eq(fread(header, 1, sizeof(header), f), sizeof(header));
+    fclose(f);
+    f = fopen(image, "wb");
+    ck_assert(f);
+    ck_assert_uint_eq(fwrite(header, 1, sizeof(header), f), sizeof(header));
+    fclose(f);
+    loader = NodesetLoader_new(NULL, NULL);
+    handler.file = image;
+    ck_assert(!NodesetLoader_loadImage(loader, &handler));
+    handler.file = nodesetPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(NodesetLoader_sort(loader));
+    int nodeCount = 0;
     for (int i = 0; i < NL_NODECLASS_COUNT; i++)
     {
         NodesetLoader_forEachNode(loader, (NL_NodeClass)i, &nodeCount,
                                   (NodesetLoader_forEachNode_Func)addNode);
     }
+    ck_assert_int_gt(nodeCount, 0);
+    NodesetLoader_delete(loader);
+    remove(image);
+}
+END_TEST
+
+static const char typedNodeset[] =
+    "<UANodeSet><NamespaceUris><Uri>http://typed</Uri></NamespaceUris>"
+    "<UAVariable NodeId=\"ns=1;i=1\" BrowseName=\"1:Matrix\" "
+    "ValueRank=\"2\" ArrayDimensions=\"2,3\" AccessLevel=\"3\" "
+    "UserAccessLevel=\"0\" Historizing=\"true\"/>"
+    "<UAVariable NodeId=\"ns=1;i=2\" BrowseName=\"1:Scalar\"/>"
+    "<UAVariable NodeId=\"ns=1;i=3\" BrowseName=\"1:Large\" "
+    "ValueRank=\"5\" ArrayDimensions=\"1,2,3,4,5\"/>"
+    "<UAVariableType NodeId=\"ns=1;i=4\" BrowseName=\"1:Type\" "
+    "IsAbstract=\"true\" ValueRank=\"1\" ArrayDimensions=\"0\"/>"
+    "<UAObject NodeId=\"ns=1;i=5\" BrowseName=\"1:Object\" "
+    "EventNotifier=\"5\"/>"
+    "<UAMethod NodeId=\"ns=1;i=6\" BrowseName=\"1:Method\" "
+    "Executable=\"false\"/>"
+    "<UAReferenceType NodeId=\"ns=1;i=7\" BrowseName=\"1:Ref\" "
+    "Symmetric=\"true\"/>"
+    "<UAView NodeId=\"ns=1;i=8\" BrowseName=\"1:View\" "
+    "ContainsNoLoops=\"true\" EventNotifier=\"1\"/>"
+    "</UANodeSet>";
+
+static void checkTypedNode(void *context, const NL_Node *node)
+{
+    (*(int *)context)++;
+    const char *id = node->id.id;
+    if (!strcmp(id, "i=1"))
+    {
+        const NL_VariableNode *var = (const NL_VariableNode *)node;
+        ck_assert_int_eq(var->typed.valueRank, 2);
+        ck_assert_uint_eq(var->typed.arrayDimensionsSize, 2);
+        ck_assert_uint_eq(var->typed.arrayDimensions[0], 2);
+        ck_assert_uint_eq(var->typed.arrayDimensions[1], 3);
+        ck_assert_uint_eq(var->typed.accessLevel, 3);
+        ck_assert_uint_eq(var->typed.userAccessLevel, 0);
+        ck_assert(var->typed.historizing);
+    }
+    else if (!strcmp(id, "i=2"))
+    {
+        // the defaults
+        const NL_VariableNode *var = (const NL_VariableNode *)node;
+        ck_assert_int_eq(var->typed.valueRank, -1);
+        ck_assert_uint_eq(var->typed.arrayDimensionsSize, 0);
+        ck_assert_uint_eq(var->typed.accessLevel, 1);
+        ck_assert_uint_eq(var->typed.userAccessLevel, 1);
+        ck_assert(!var->typed.historizing);
+    }
+    else if (!strcmp(id, "i=3"))
+    {
+        const NL_VariableNode *var = (const NL_VariableNode *)node;
+        ck_assert_uint_eq(var->typed.arrayDimensionsSize, 5);
+        ck_assert_uint_eq(
+            var->typed.arrayDimensions[NL_MAX_ARRAY_DIMENSIONS - 1],
+            NL_MAX_ARRAY_DIMENSIONS);
+    }
+    else if (!strcmp(id, "i=4"))
+    {
+        const NL_VariableTypeNode *type = (const NL_VariableTypeNode *)node;
+        ck_assert(type->typed.isAbstract);
+        ck_assert_int_eq(type->typed.valueRank, 1);
+        ck_assert_uint_eq(type->typed.arrayDimensionsSize, 1);
+        ck_assert_uint_eq(type->typed.arrayDimensions[0], 0);
+    }
+    else if (!strcmp(id, "i=5"))
+    {
+        ck_assert_uint_eq(((const NL_ObjectNode *)node)->typed.eventNotifier,
+                          5);
+    }
+    else if (!strcmp(id, "i=6"))
+    {
+        const NL_MethodNode *method = (const NL_MethodNode *)node;
+        ck_assert(!method->typed.executable);
+        ck_assert(method->typed.userExecutable);
+    }
+    else if (!strcmp(id, "i=7"))
+    {
+        ck_assert(((const NL_ReferenceTypeNode *)node)->typed.symmetric);
+    }
+    else if (!strcmp(id, "i=8"))
+    {
+        const NL_ViewNode *view = (const NL_ViewNode *)node;
+        ck_assert(view->typed.containsNoLoops);
+        ck_assert_uint_eq(view->typed.eventNotifier, 1);
+    }
+}
 
+START_TEST(Server_ImportTypedAttributesTest)
+{
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(NodesetLoader_importBuffer(loader, &handler, typedNodeset,
+                                         sizeof(typedNodeset) - 1));
+    ck_assert(NodesetLoader_sort(loader));
+    int nodeCount = 0;
+    for (int i = 0; i < NL_NODECLASS_COUNT; i++)
+    {
+        NodesetLoader_forEachNode(
+            loader, (NL_NodeClass)i, &nodeCount,
+            (NodesetLoader_forEachNode_Func)checkTypedNode);
+    }
     ck_assert_int_eq(nodeCount, 8);
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+START_TEST(Server_ImportEmbeddedImageTest)
+{
+    const char *paths[] = {nodesetPath};
+    struct Dump expected =
+        importFiles(paths, 1, false, 1, NL_PARSER_OPTIONS_DEFAULT, true);
+    struct Dump dump = {NULL, 0, 0};
+    appendDump(&dump, "");
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespaceToDump;
+    handler.userContext = &dump;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(NodesetLoader_loadImageBuffer(
+        loader, &handler, basicNodeClassesImage, basicNodeClassesImageSize));
+    ck_assert(NodesetLoader_sort(loader));
+    struct Dump nodes = dumpLoader(loader);
+    appendDump(&dump, nodes.data);
+    free(nodes.data);
+    NodesetLoader_delete(loader);
+    assertDumpEq(&dump, &expected);
+    free(expected.data);
+
+    loader = NodesetLoader_new(NULL, NULL);
+    ck_assert(!NodesetLoader_loadImageBuffer(loader, &handler,
+                                             basicNodeClassesImage,
+                                             basicNodeClassesImageSize - 8));
+    ck_assert(!NodesetLoader_loadImageBuffer(loader, &handler, NULL, 0));
+    NodesetLoader_delete(loader);
+}
+END_TEST
+
+// imports the files with the image cache in the working directory like
+// importFiles, image is set to a copy of the path of the loaded image or NULL
+static struct Dump importCached(const char **paths, size_t count, int options,
+                                char **image)
+{
+    struct Dump dump = {NULL, 0, 0};
+    appendDump(&dump, "");
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespaceToDump;
+    handler.userContext = &dump;
+
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    NodesetLoader_setParserOptions(loader, options);
+    NodesetLoader_setCacheDir(loader, ".");
+    for (size_t i = 0; i < count; i++)
+    {
+        handler.file = paths[i];
+        ck_assert(NodesetLoader_importFile(loader, &handler));
+    }
+    ck_assert(NodesetLoader_sort(loader));
+
+    struct Dump nodes = dumpLoader(loader);
+    appendDump(&dump, nodes.data);
+    free(nodes.data);
+    const NL_ImportTiming *timings = NULL;
+    size_t timingCount = NodesetLoader_getImportTimings(loader, &timings);
+    ck_assert_uint_gt(timingCount, 0);
+    *image = NULL;
+    if (strstr(timings[0].file, ".nlimage"))
+    {
+        *image = (char *)malloc(strlen(timings[0].file) + 1);
+        ck_assert(*image);
+        strcpy(*image, timings[0].file);
+    }
+    // waits for the image to be written
+    NodesetLoader_delete(loader);
+    return dump;
+}
+
+START_TEST(Server_ImportCacheTest)
+{
+    const char *paths[] = {largeNodesetPath, companionNodesetPath};
+    const int defaults = NL_PARSER_OPTIONS_DEFAULT;
+    struct Dump expected = importFiles(paths, 2, false, 1, defaults, true);
+    // an image of an earlier run may already be there
+    char *image = NULL;
+    struct Dump cached = importCached(paths, 2, defaults, &image);
+    assertDumpEq(&cached, &expected);
+    free(image);
+    cached = importCached(paths, 2, defaults, &image);
+    ck_assert(image);
+    assertDumpEq(&cached, &expected);
+
+    // another set of files has another key
+    struct Dump expectedLarge =
+        importFiles(paths, 1, false, 1, NL_PARSER_OPTIONS_DEFAULT, true);
+    char *largeImage = NULL;
+    cached = importCached(paths, 1, defaults, &largeImage);
+    assertDumpEq(&cached, &expectedLarge);
+    free(largeImage);
+    cached = importCached(paths, 1, defaults, &largeImage);
+    ck_assert(largeImage);
+    ck_assert(strcmp(largeImage, image));
+    assertDumpEq(&cached, &expectedLarge);
+    // other parser options have another key
+    char *optionsImage = NULL;
+    const int options = defaults | NL_PARSER_OPTION_LAZY_VALUES;
+    cached = importCached(paths, 1, options, &optionsImage);
+    assertDumpEq(&cached, &expectedLarge);
+    free(optionsImage);
+    cached = importCached(paths, 1, options, &optionsImage);
+    ck_assert(optionsImage);
+    ck_assert(strcmp(optionsImage, largeImage));
+    assertDumpEq(&cached, &expectedLarge);
+    remove(optionsImage);
+    free(optionsImage);
+    free(expectedLarge.data);
+
+    // without the image of both files the companion is imported on top of the
+    // image of the first one
+    ck_assert_int_eq(remove(image), 0);
+    char *prefixImage = NULL;
+    cached = importCached(paths, 2, defaults, &prefixImage);
+    ck_assert(prefixImage);
+    ck_assert_str_eq(prefixImage, largeImage);
+    sortLines(&cached);
+    sortLines(&expected);
+    assertDumpEq(&cached, &expected);
+    free(prefixImage);
+    // the image of both files is written again, in the order of this import
+    cached = importCached(paths, 2, defaults, &prefixImage);
+    ck_assert_str_eq(prefixImage, image);
+    sortLines(&cached);
+    assertDumpEq(&cached, &expected);
+    free(prefixImage);
+
+    free(expected.data);
+    remove(image);
+    remove(largeImage);
+    free(image);
+    free(largeImage);
+}
+END_TEST
+
+// the nodes of the hierarchy of nodesetGen start at ns=1;i=1000
+static void countGeneratedNode(void *context, NL_Node *node)
+{
+    if (node->id.nsIdx == 1 && atoi(node->id.id + 2) >= 1000)
+    {
+        (*(size_t *)context)++;
+    }
+}
 
+START_TEST(Server_ImportGeneratedTest)
+{
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    handler.file = largeNodesetPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    NL_Stats large;
+    NodesetLoader_getStats(loader, &large);
+    handler.file = generatedNodesetPath;
+    ck_assert(NodesetLoader_importFile(loader, &handler));
+    ck_assert(NodesetLoader_sort(loader));
+    size_t generated = 0;
+    NodesetLoader_forEachNode(loader, NODECLASS_OBJECT, &generated,
+                              countGeneratedNode);
+    NodesetLoader_forEachNode(loader, NODECLASS_VARIABLE, &generated,
+                              countGeneratedNode);
+    ck_assert_uint_eq(generated, GENERATED_NODES);
+    // every node has a parent and a type definition and references to other
+    // generated nodes
+    NL_Stats stats;
+    NodesetLoader_getStats(loader, &stats);
+    ck_assert(stats.hierarchicalRefs - large.hierarchicalRefs >=
+              GENERATED_NODES);
+    ck_assert_uint_gt(stats.nonHierarchicalRefs - large.nonHierarchicalRefs,
+                      GENERATED_NODES);
     NodesetLoader_delete(loader);
 }
 END_TEST
@@ -55,6 +1560,43 @@ static Suite *testSuite_Client(void)
     TCase *tc_server = tcase_create("server nodeset import");
     tcase_add_unchecked_fixture(tc_server, setup, teardown);
     tcase_add_test(tc_server, Server_ImportBasicNodeClassTest);
+    tcase_add_test(tc_server, Server_ImportBasicNodeClassFromBufferTest);
+    tcase_add_test(tc_server, Server_ImportBasicNodeClassFromStreamTest);
+    tcase_add_test(tc_server, Server_ImportAfterParsingErrorTest);
+    tcase_add_test(tc_server, Server_ImportCachedParsingErrorTest);
+    tcase_add_test(tc_server, Server_ImportParallelCommentTest);
+    tcase_add_test(tc_server, Server_ImportParallelTrailingAliasesTest);
+    tcase_add_test(tc_server, Server_ImportMemoryBudgetTest);
+    tcase_add_test(tc_server, Server_ImportStreamNamespacesTest);
+    tcase_add_test(tc_server, Server_ImportDuplicateNodeIdTest);
+    tcase_add_test(tc_server, Server_ImportEmbeddedImageTest);
+    tcase_add_test(tc_server, Server_ImportTypedAttributesTest);
+    if (largeNodesetPath)
+    {
+        tcase_add_test(tc_server, Server_ImportParallelTest);
+        tcase_add_test(tc_server, Server_ImportProgressTest);
+        tcase_add_test(tc_server, Server_ImportStatsTest);
+        // only counted when built with ENABLE_MEMORY_STATS
+        NL_MemoryUsage usage[NL_MEMORY_CATEGORY_COUNT];
+        if (NodesetLoader_getMemoryUsage(usage))
+        {
+            tcase_add_test(tc_server, Server_ImportMemoryTest);
+        }
+    }
+    if (companionNodesetPath)
+    {
+        tcase_add_test(tc_server, Server_ImportLazyValuesTest);
+        tcase_add_test(tc_server, Server_ImportFilterTest);
+        tcase_add_test(tc_server, Server_ImportStreamTest);
+        tcase_add_test(tc_server, Server_ImportFilesTest);
+        tcase_add_test(tc_server, Server_ImportReadAheadTest);
+        tcase_add_test(tc_server, Server_ImportImageTest);
+        tcase_add_test(tc_server, Server_ImportCacheTest);
+    }
+    if (generatedNodesetPath)
+    {
+        tcase_add_test(tc_server, Server_ImportGeneratedTest);
+    }
     suite_add_tcase(s, tc_server);
     return s;
 }
@@ -64,6 +1606,22 @@ int main(int argc, char *argv[])
     if (!(argc > 1))
         return 1;
     nodesetPath = argv[1];
+    if (argc > 2)
+    {
+        largeNodesetPath = argv[2];
+    }
+    if (argc > 3)
+    {
+        companionNodesetPath = argv[3];
+    }
+    if (argc > 4)
+    {
+        generatedNodesetPath = argv[4];
+    }
+    if (argc > 5)
+    {
+        dependentNodesetPath = argv[5];
+    }
     Suite *s = testSuite_Client();
     SRunner *sr = srunner_create(s);
     srunner_set_fork_status(sr, CK_NOFORK);
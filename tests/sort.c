@@ -165,6 +165,89 @@ START_TEST(cycleDetect) {
 }
 END_TEST
 
+// nodeB -> nodeA, nodeD -> external node of namespace 2
+// expect: nodeC and nodeD while they are added, nodeA and nodeB after nodeA
+START_TEST(streamNodes) {
+    sortedNodesCnt = 0;
+    SortContext *ctx = Sort_init();
+    Sort_setStream(ctx, NULL, sortCallback);
+
+    NL_VariableNode a;
+    initNode(&a);
+    a.id.nsIdx = 1;
+    a.id.id = "nodeA";
+
+    NL_Reference ref;
+    ref.isForward = false;
+    ref.target = a.id;
+    ref.next = NULL;
+
+    NL_VariableNode b;
+    initNode(&b);
+    b.hierachicalRefs = &ref;
+    b.id.nsIdx = 1;
+    b.id.id = "nodeB";
+
+    NL_VariableNode c;
+    initNode(&c);
+    c.id.nsIdx = 1;
+    c.id.id = "nodeC";
+
+    NL_Reference externalRef;
+    externalRef.isForward = false;
+    externalRef.target.nsIdx = 2;
+    externalRef.target.id = "external";
+    externalRef.next = NULL;
+
+    NL_VariableNode d;
+    initNode(&d);
+    d.hierachicalRefs = &externalRef;
+    d.id.nsIdx = 1;
+    d.id.id = "nodeD";
+
+    Sort_addNode(ctx, (NL_Node *)&b);
+    ck_assert(sortedNodesCnt == 0);
+    Sort_addNode(ctx, (NL_Node *)&c);
+    ck_assert(sortedNodesCnt == 1);
+    Sort_addNode(ctx, (NL_Node *)&d);
+    ck_assert(sortedNodesCnt == 2);
+    Sort_addNode(ctx, (NL_Node *)&a);
+    ck_assert(sortedNodesCnt == 4);
+    ck_assert(!NodesetLoader_NodeId_cmp(&sortedNodes[2]->id, &a.id));
+    ck_assert(!NodesetLoader_NodeId_cmp(&sortedNodes[3]->id, &b.id));
+    ck_assert(Sort_start(ctx, NULL, sortCallback, NULL));
+    ck_assert(sortedNodesCnt == 4);
+    Sort_cleanup(ctx);
+}
+END_TEST
+
+// nodeB -> nodeA, nodeA is never added
+// expect: nodeB is held back until the sort
+START_TEST(streamBlockedNode) {
+    sortedNodesCnt = 0;
+    SortContext *ctx = Sort_init();
+    Sort_setStream(ctx, NULL, sortCallback);
+
+    NL_Reference ref;
+    ref.isForward = false;
+    ref.target.nsIdx = 1;
+    ref.target.id = "nodeA";
+    ref.next = NULL;
+
+    NL_VariableNode b;
+    initNode(&b);
+    b.hierachicalRefs = &ref;
+    b.id.nsIdx = 1;
+    b.id.id = "nodeB";
+
+    Sort_addNode(ctx, (NL_Node *)&b);
+    ck_assert(sortedNodesCnt == 0);
+    ck_assert(Sort_start(ctx, NULL, sortCallback, NULL));
+    ck_assert(sortedNodesCnt == 1);
+    Sort_cleanup(ctx);
+}
+END_TEST
+
 START_TEST(empty)
 {
     SortContext *ctx = Sort_init();
@@ -181,6 +264,8 @@ int main(void) {
     tcase_add_test(tc, nodeWithRefs_1);
     tcase_add_test(tc, nodeWithRefs_2);
     tcase_add_test(tc, cycleDetect);
+    tcase_add_test(tc, streamNodes);
+    tcase_add_test(tc, streamBlockedNode);
     tcase_add_test(tc, empty);
     suite_add_tcase(s, tc);
 
@@ -0,0 +1,347 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+ * differential test: the events of the tokenizer have to be the same as the
+ * events of libxml2, for every character scan implementation
+ * usage: tokenizer nodeset1.xml nodeset2.xml ...
+ */
+
+#include "CharScan.h"
+#include "Parser.h"
+#include "Tokenizer.h"
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char **files = NULL;
+static int fileCount = 0;
+
+struct Log
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+    // characters are collected until the next element event, libxml2 and
+    // the tokenizer split text differently
+    char *text;
+    size_t textSize;
+    size_t textCapacity;
+};
+
+static void append(char **data, size_t *size, size_t *capacity,
+                   const char *s, size_t len)
+{
+    if (*size + len + 1 > *capacity)
+    {
+        *capacity = 2 * (*size + len + 1);
+        *data = (char *)realloc(*data, *capacity);
+        ck_assert(*data);
+    }
+    memcpy(*data + *size, s, len);
+    *size += len;
+    (*data)[*size] = '\0';
+}
+
+static void appendString(struct Log *log, const char *s)
+{
+    s = s ? s : "-";
+    append(&log->data, &log->size, &log->capacity, s, strlen(s));
+}
+
+static void flushText(struct Log *log)
+{
+    if (!log->textSize)
+    {
+        return;
+    }
+    appendString(log, "T ");
+    append(&log->data, &log->size, &log->capacity, log->text, log->textSize);
+    appendString(log, "\n");
+    log->textSize = 0;
+}
+
+static void appendName(struct Log *log, const char *localname,
+                       const char *prefix, const char *URI)
+{
+    appendString(log, "{");
+    appendString(log, URI);
+    appendString(log, "}");
+    appendString(log, prefix);
+    appendString(log, ":");
+    appendString(log, localname);
+}
+
+static void onStart(void *ctx, const char *localname, const char *prefix,
+                    const char *URI, int nb_namespaces, const char **namespaces,
+                    int nb_attributes, int nb_defaulted,
+                    const char **attributes)
+{
+    struct Log *log = (struct Log *)ctx;
+    flushText(log);
+    appendString(log, "S ");
+    appendName(log, localname, prefix, URI);
+    for (int i = 0; i < nb_namespaces; i++)
+    {
+        appendString(log, " ns ");
+        appendString(log, namespaces[2 * i]);
+        appendString(log, "=");
+        appendString(log, namespaces[2 * i + 1]);
+    }
+    for (int i = 0; i < nb_attributes; i++)
+    {
+        const char **a = attributes + 5 * i;
+        appendString(log, " ");
+        appendName(log, a[0], a[1], a[2]);
+        appendString(log, "=\"");
+        append(&log->data, &log->size, &log->capacity, a[3],
+               (size_t)(a[4] - a[3]));
+        appendString(log, "\"");
+    }
+    appendString(log, "\n");
+}
+
+static void onEnd(void *ctx, const char *localname, const char *prefix,
+                  const char *URI)
+{
+    struct Log *log = (struct Log *)ctx;
+    flushText(log);
+    appendString(log, "E ");
+    appendName(log, localname, prefix, URI);
+    appendString(log, "\n");
+}
+
+static void onChars(void *ctx, const char *ch, int len)
+{
+    struct Log *log = (struct Log *)ctx;
+    append(&log->text, &log->textSize, &log->textCapacity, ch, (size_t)len);
+}
+
+static void clearLog(struct Log *log)
+{
+    free(log->data);
+    free(log->text);
+    memset(log, 0, sizeof(struct Log));
+}
+
+static int runLibxml(const char *data, size_t size, struct Log *log)
+{
+    Parser *parser = Parser_new(log);
+    int status = Parser_runBuffer(parser, data, size, onStart, onEnd, onChars);
+    Parser_delete(parser);
+    flushText(log);
+    return status;
+}
+
+static Tokenizer_Status runTokenizer(const char *data, size_t size,
+                                     struct Log *log)
+{
+    Tokenizer *tokenizer = Tokenizer_new();
+    ck_assert(tokenizer);
+    Tokenizer_Status status =
+        Tokenizer_run(tokenizer, data, size, log, onStart, onEnd, onChars);
+    Tokenizer_delete(tokenizer);
+    flushText(log);
+    return status;
+}
+
+static const CharScan_Implementation implementations[] = {
+    CHARSCAN_SCALAR, CHARSCAN_SSE2, CHARSCAN_AVX2};
+
+// compares the events for every implementation which is supported
+static void compare(const char *data, size_t size)
+{
+    struct Log expected;
+    memset(&expected, 0, sizeof(struct Log));
+    ck_assert_int_eq(runLibxml(data, size, &expected), 0);
+    CharScan_Implementation best = CharScan_selected();
+    for (size_t i = 0; i < sizeof(implementations) / sizeof(implementations[0]);
+         i++)
+    {
+        if (!CharScan_select(implementations[i]))
+        {
+            continue;
+        }
+        struct Log log;
+        memset(&log, 0, sizeof(struct Log));
+        ck_assert_int_eq(runTokenizer(data, size, &log), TOKENIZER_OK);
+        ck_assert_msg(log.size == expected.size &&
+                          !memcmp(log.data, expected.data, log.size),
+                      "events differ with %s",
+                      CharScan_name(implementations[i]));
+        clearLog(&log);
+    }
+    CharScan_select(best);
+    clearLog(&expected);
+}
+
+static void compareString(const char *xml) { compare(xml, strlen(xml)); }
+
+// both parsers have to reject the document
+static void expectError(const char *xml)
+{
+    struct Log log;
+    memset(&log, 0, sizeof(struct Log));
+    ck_assert_int_ne(runLibxml(xml, strlen(xml), &log), 0);
+    clearLog(&log);
+    ck_assert_int_eq(runTokenizer(xml, strlen(xml), &log), TOKENIZER_ERROR);
+    clearLog(&log);
+}
+
+static char *readFile(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    ck_assert_msg(f, "cannot open %s", path);
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    ck_assert(len > 0);
+    fseek(f, 0, SEEK_SET);
+    char *data = (char *)malloc((size_t)len);
+    ck_assert((size_t)len == fread(data, 1, (size_t)len, f));
+    fclose(f);
+    *size = (size_t)len;
+    return data;
+}
+
+START_TEST(nodesets)
+{
+    ck_assert_int_gt(fileCount, 0);
+    for (int i = 0; i < fileCount; i++)
+    {
+        size_t size;
+        char *data = readFile(files[i], &size);
+        compare(data, size);
+        free(data);
+    }
+}
+END_TEST
+
+START_TEST(namespaces)
+{
+    compareString(
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "<UANodeSet xmlns=\"http://opcfoundation.org/UA/2011/03/UANodeSet.xsd\""
+        " xmlns:uax=\"http://opcfoundation.org/UA/2008/02/Types.xsd\">"
+        "<Value><uax:Int32>5</uax:Int32>"
+        "<a xmlns=\"\"><b uax:x='1' y=\"2\" xml:lang=\"en\"/></a>"
+        "<uax:c xmlns:uax=\"urn:other\"/></Value></UANodeSet>");
+    // libxml2 reports undeclared prefixes, but they are not fatal
+    compareString("<p:a q:x=\"1\"><p:b/></p:a>");
+}
+END_TEST
+
+START_TEST(text)
+{
+    compareString("<a>1 &lt; 2 &amp;&amp; 3 &gt; 2 &quot;&apos;</a>");
+    compareString("<a>&#65;&#x42;&#xe4;&#x20AC;&#x1F600;</a>");
+    compareString("<a>line\r\nline\rline\n\r\n</a>");
+    compareString("<a><![CDATA[<b>&amp;\r\n]]>after</a>");
+    compareString("<!-- before --><?pi data?>\n<a><!-- x --><?pi?>t</a>"
+                  "<!-- after -->\n");
+    compareString("\xef\xbb\xbf<a>bom</a>");
+    compareString("<a>\xc3\xa4\xe2\x82\xac</a >");
+}
+END_TEST
+
+START_TEST(attributes)
+{
+    compareString("<a x=\"tab\there\" y=\"nl\nhere\" z=\"crlf\r\nhere\"/>");
+    compareString("<a x='&lt;&amp;&#10;&#x9;' y=\"'\" z='\"' />");
+    compareString("<a\n  x = \"1\"\n  y\t=\t'2'></a>");
+}
+END_TEST
+
+// the special characters at every position of the vector registers
+START_TEST(boundaries)
+{
+    const char specials[] = {'&', '\r', '\n', '\t', '"'};
+    char xml[256];
+    for (size_t s = 0; s < sizeof(specials); s++)
+    {
+        for (int pos = 0; pos < 70; pos++)
+        {
+            char filler[80];
+            memset(filler, 'x', sizeof(filler));
+            filler[pos] = specials[s];
+            filler[pos + 1] = '\0';
+            const char *entity = specials[s] == '&' ? "amp;" : "";
+            const char *quote = specials[s] == '"' ? "'" : "\"";
+            snprintf(xml, sizeof(xml), "<a v=%s%s%s%s>%s%sy</a>", quote,
+                     filler, entity, quote, filler, entity);
+            compareString(xml);
+        }
+    }
+}
+END_TEST
+
+START_TEST(errors)
+{
+    expectError("<a></b>");
+    expectError("<a><b></a></b>");
+    expectError("<a>");
+    expectError("<a>&unknown;</a>");
+    expectError("<a x=\"1\" x=\"2\"/>");
+    expectError("<a x=\"<\"/>");
+    expectError("<a/><b/>");
+    expectError("<a x=\"1\"y=\"2\"/>");
+    expectError("text<a/>");
+}
+END_TEST
+
+START_TEST(unsupported)
+{
+    const char *docs[] = {
+        "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?><a>\xe4</a>",
+        "<!DOCTYPE a [<!ELEMENT a (#PCDATA)>]><a>x</a>"};
+    for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); i++)
+    {
+        struct Log log;
+        memset(&log, 0, sizeof(struct Log));
+        ck_assert_int_eq(runTokenizer(docs[i], strlen(docs[i]), &log),
+                         TOKENIZER_UNSUPPORTED);
+        ck_assert_uint_eq(log.size, 0);
+
+        // the parser falls back to libxml2
+        struct Log expected;
+        memset(&expected, 0, sizeof(struct Log));
+        ck_assert_int_eq(runLibxml(docs[i], strlen(docs[i]), &expected), 0);
+        Parser *parser = Parser_new(&log);
+        Parser_setOptions(parser, NL_PARSER_OPTION_FAST_TOKENIZER);
+        ck_assert_int_eq(Parser_runBuffer(parser, docs[i], strlen(docs[i]),
+                                          onStart, onEnd, onChars),
+                         0);
+        Parser_delete(parser);
+        flushText(&log);
+        ck_assert_str_eq(log.data, expected.data);
+        clearLog(&log);
+        clearLog(&expected);
+    }
+}
+END_TEST
+
+int main(int argc, char *argv[])
+{
+    files = argv + 1;
+    fileCount = argc - 1;
+    CharScan_init();
+    Suite *s = suite_create("Tokenizer tests");
+    TCase *tc = tcase_create("test cases");
+    tcase_set_timeout(tc, 60);
+    tcase_add_test(tc, nodesets);
+    tcase_add_test(tc, namespaces);
+    tcase_add_test(tc, text);
+    tcase_add_test(tc, attributes);
+    tcase_add_test(tc, boundaries);
+    tcase_add_test(tc, errors);
+    tcase_add_test(tc, unsupported);
+    suite_add_tcase(s, tc);
+
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? 0 : -1;
+}
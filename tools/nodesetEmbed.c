@@ -0,0 +1,168 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+ * imports and sorts the nodesets in the given order and writes the image of
+ * the nodes as a C source file, so it can be linked into a binary and loaded
+ * with NodesetLoader_loadImageBuffer, see nodesetloader_embed
+ * usage: nodesetEmbed name output nodeset1.xml nodeset2.xml ...
+ * writes output.c with the image in the array name and its size in nameSize
+ * and output.h with the declarations
+ */
+
+#include <NodesetLoader/NodesetLoader.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int addNamespace(void *userContext, const char *uri)
+{
+    return ++*(int *)userContext;
+}
+
+static char *concat(const char *a, const char *b)
+{
+    char *s = (char *)malloc(strlen(a) + strlen(b) + 1);
+    if (s)
+    {
+        strcpy(s, a);
+        strcat(s, b);
+    }
+    return s;
+}
+
+static bool writeImage(char **files, int count, const char *path)
+{
+    int nsIdx = 0;
+    NL_FileContext handler;
+    memset(&handler, 0, sizeof(NL_FileContext));
+    handler.addNamespace = addNamespace;
+    handler.userContext = &nsIdx;
+    NodesetLoader *loader = NodesetLoader_new(NULL, NULL);
+    bool status = true;
+    for (int i = 0; i < count && status; i++)
+    {
+        handler.file = files[i];
+        status = NodesetLoader_importFile(loader, &handler);
+    }
+    status = NodesetLoader_sort(loader) && status;
+    status = status && NodesetLoader_writeImage(loader, path);
+    NodesetLoader_delete(loader);
+    return status;
+}
+
+static char *readImage(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    // padded to whole words
+    char *data = length > 0
+                     ? (char *)calloc((size_t)length / 8 + 1, sizeof(uint64_t))
+                     : NULL;
+    if (data && fread(data, 1, (size_t)length, f) != (size_t)length)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (size_t)length;
+    return data;
+}
+
+// the image is emitted as words, so the array has the alignment of the image
+static bool writeSource(const char *path, const char *header, const char *name,
+                        const char *data, size_t size)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return false;
+    }
+    fprintf(f, "/* generated by nodesetEmbed, do not edit */\n\n");
+    fprintf(f, "#include \"%s\"\n\n", header);
+    fprintf(f, "const uint64_t %s[] = {", name);
+    size_t words = (size + 7) / 8;
+    for (size_t i = 0; i < words; i++)
+    {
+        uint64_t word;
+        memcpy(&word, data + i * 8, sizeof(word));
+        fprintf(f, "%s0x%016llxu,", i % 4 ? " " : "\n    ",
+                (unsigned long long)word);
+    }
+    fprintf(f, "\n};\n\nconst size_t %sSize = %zu;\n", name, size);
+    return !fclose(f);
+}
+
+static bool writeHeader(const char *path, const char *name)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return false;
+    }
+    fprintf(f, "/* generated by nodesetEmbed, do not edit */\n\n");
+    fprintf(f, "#ifndef NODESETEMBED_%s_H\n#define NODESETEMBED_%s_H\n", name,
+            name);
+    fprintf(f, "#include <stddef.h>\n#include <stdint.h>\n\n");
+    fprintf(f, "#ifdef __cplusplus\nextern \"C\" {\n#endif\n");
+    fprintf(f, "// image for NodesetLoader_loadImageBuffer\n");
+    fprintf(f, "extern const uint64_t %s[];\n", name);
+    fprintf(f, "extern const size_t %sSize;\n", name);
+    fprintf(f, "#ifdef __cplusplus\n}\n#endif\n#endif\n");
+    return !fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        printf("usage: nodesetEmbed name output nodeset.xml ...\n");
+        return 1;
+    }
+    const char *name = argv[1];
+    char *image = concat(argv[2], ".image");
+    char *source = concat(argv[2], ".c");
+    char *header = concat(argv[2], ".h");
+    if (!image || !source || !header)
+    {
+        return 1;
+    }
+    // the generated source includes the header next to it
+    const char *headerName = strrchr(header, '/');
+    headerName = headerName ? headerName + 1 : header;
+
+    int status = 1;
+    size_t size = 0;
+    char *data = NULL;
+    if (!writeImage(&argv[3], argc - 3, image))
+    {
+        printf("nodesetEmbed: the nodesets could not be imported\n");
+    }
+    else if (!(data = readImage(image, &size)))
+    {
+        printf("nodesetEmbed: the image could not be read\n");
+    }
+    else if (!writeHeader(header, name) ||
+             !writeSource(source, headerName, name, data, size))
+    {
+        printf("nodesetEmbed: %s could not be written\n", source);
+    }
+    else
+    {
+        status = 0;
+    }
+    remove(image);
+    free(data);
+    free(image);
+    free(source);
+    free(header);
+    return status;
+}
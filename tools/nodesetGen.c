@@ -0,0 +1,417 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+ * writes a synthetic nodeset of any size which depends on namespace zero only,
+ * to measure how the import scales
+ * usage: nodesetGen [-n nodes] [-d depth] [-f fanout] [-r refs]
+ *                   [-c customPercent] [-a aliases] [-v arraySize]
+ *                   [-e nesting] [-s seed] output.xml
+ * -n objects and variables of the hierarchy, they get the ids ns=1;i=1000 to
+ *    ns=1;i=999+n and are written parents first
+ * -d levels of one tree below the ObjectsFolder, further trees are added until
+ *    there are n nodes, the last level of a tree consists of variables
+ * -f children of each object
+ * -r non hierarchical references of each node to random nodes, which are
+ *    often not imported yet
+ * -c percentage of these references which use one of the custom reference
+ *    types of the nodeset instead of NonHierarchicalReferences
+ * -a aliases for the first nodes, references to them use the alias, together
+ *    with the standard aliases at most the 300 the loader keeps
+ * -v elements of the ListOfInt32 value of each variable, 0 for a Double
+ * -e structures nested into each other, every 16th variable has an
+ *    ExtensionObject of the outermost one as value
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CUSTOM_REFERENCE_TYPES 8
+#define OBJECT_TYPE_ID 100
+#define DATATYPE_ID 200
+#define ENCODING_ID 300
+#define MAX_NESTING 64
+#define FIRST_NODE_ID 1000
+#define EXTENSION_OBJECT_INTERVAL 16
+// MAX_ALIAS of the alias list, further aliases are dropped by the loader
+#define MAX_ALIASES 300
+
+struct Options
+{
+    size_t nodes;
+    size_t depth;
+    size_t fanout;
+    size_t refs;
+    size_t customPercent;
+    size_t aliases;
+    size_t arraySize;
+    size_t nesting;
+    uint64_t seed;
+};
+
+static const char *standardAliases[][2] = {
+    {"Int32", "i=6"},
+    {"Double", "i=11"},
+    {"NonHierarchicalReferences", "i=32"},
+    {"Organizes", "i=35"},
+    {"HasEncoding", "i=38"},
+    {"HasTypeDefinition", "i=40"},
+    {"HasSubtype", "i=45"},
+    {"HasComponent", "i=47"}};
+
+#define STANDARD_ALIASES (sizeof(standardAliases) / sizeof(standardAliases[0]))
+
+// xorshift64, the nodeset only depends on the options
+static uint64_t nextRandom(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void writeHeader(FILE *f, const struct Options *o)
+{
+    fprintf(f,
+            "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+            "<UANodeSet "
+            "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+            "xmlns:uax=\"http://opcfoundation.org/UA/2008/02/Types.xsd\" "
+            "xmlns=\"http://opcfoundation.org/UA/2011/03/UANodeSet.xsd\" "
+            "xmlns:xsd=\"http://www.w3.org/2001/XMLSchema\">\n"
+            "    <NamespaceUris>\n"
+            "        <Uri>http://nodesetloader.org/Generated/</Uri>\n"
+            "    </NamespaceUris>\n"
+            "    <Models>\n"
+            "        <Model ModelUri=\"http://nodesetloader.org/Generated/\" "
+            "Version=\"1.0.0\" PublicationDate=\"2020-01-01T00:00:00Z\">\n"
+            "            <RequiredModel "
+            "ModelUri=\"http://opcfoundation.org/UA/\" Version=\"1.04\" "
+            "PublicationDate=\"2019-05-01T00:00:00Z\"/>\n"
+            "        </Model>\n"
+            "    </Models>\n"
+            "    <Aliases>\n");
+    for (size_t i = 0; i < STANDARD_ALIASES; i++)
+    {
+        fprintf(f, "        <Alias Alias=\"%s\">%s</Alias>\n",
+                standardAliases[i][0], standardAliases[i][1]);
+    }
+    for (size_t i = 0; i < o->aliases; i++)
+    {
+        fprintf(f, "        <Alias Alias=\"Node%zu\">ns=1;i=%zu</Alias>\n", i,
+                FIRST_NODE_ID + i);
+    }
+    fprintf(f, "    </Aliases>\n");
+}
+
+static void writeTypes(FILE *f, const struct Options *o)
+{
+    for (int i = 1; i <= CUSTOM_REFERENCE_TYPES; i++)
+    {
+        fprintf(f,
+                "    <UAReferenceType NodeId=\"ns=1;i=%d\" "
+                "BrowseName=\"1:CustomReference%d\">\n"
+                "        <DisplayName>CustomReference%d</DisplayName>\n"
+                "        <References>\n"
+                "            <Reference ReferenceType=\"HasSubtype\" "
+                "IsForward=\"false\">i=32</Reference>\n"
+                "        </References>\n"
+                "        <InverseName>CustomReferenceOf%d</InverseName>\n"
+                "    </UAReferenceType>\n",
+                i, i, i, i);
+    }
+    fprintf(f,
+            "    <UAObjectType NodeId=\"ns=1;i=%d\" "
+            "BrowseName=\"1:GeneratedObjectType\">\n"
+            "        <DisplayName>GeneratedObjectType</DisplayName>\n"
+            "        <References>\n"
+            "            <Reference ReferenceType=\"HasSubtype\" "
+            "IsForward=\"false\">i=58</Reference>\n"
+            "        </References>\n"
+            "    </UAObjectType>\n",
+            OBJECT_TYPE_ID);
+    // Nested<k> contains Nested<k - 1> in its field Inner
+    for (size_t k = 1; k <= o->nesting; k++)
+    {
+        fprintf(f,
+                "    <UADataType NodeId=\"ns=1;i=%zu\" "
+                "BrowseName=\"1:Nested%zu\">\n"
+                "        <DisplayName>Nested%zu</DisplayName>\n"
+                "        <References>\n"
+                "            <Reference ReferenceType=\"HasEncoding\">"
+                "ns=1;i=%zu</Reference>\n"
+                "            <Reference ReferenceType=\"HasSubtype\" "
+                "IsForward=\"false\">i=22</Reference>\n"
+                "        </References>\n"
+                "        <Definition Name=\"1:Nested%zu\">\n"
+                "            <Field DataType=\"Int32\" Name=\"Value\"/>\n",
+                DATATYPE_ID + k, k, k, ENCODING_ID + k, k);
+        if (k > 1)
+        {
+            fprintf(f,
+                    "            <Field DataType=\"ns=1;i=%zu\" "
+                    "Name=\"Inner\"/>\n",
+                    DATATYPE_ID + k - 1);
+        }
+        fprintf(f,
+                "        </Definition>\n"
+                "    </UADataType>\n"
+                "    <UAObject SymbolicName=\"DefaultXml\" "
+                "NodeId=\"ns=1;i=%zu\" BrowseName=\"Default XML\">\n"
+                "        <DisplayName>Default XML</DisplayName>\n"
+                "        <References>\n"
+                "            <Reference ReferenceType=\"HasEncoding\" "
+                "IsForward=\"false\">ns=1;i=%zu</Reference>\n"
+                "            <Reference ReferenceType=\"HasTypeDefinition\">"
+                "i=76</Reference>\n"
+                "        </References>\n"
+                "    </UAObject>\n",
+                ENCODING_ID + k, DATATYPE_ID + k);
+    }
+}
+
+static void writeValue(FILE *f, const struct Options *o, size_t node)
+{
+    fprintf(f, "        <Value>\n");
+    if (o->nesting && node % EXTENSION_OBJECT_INTERVAL == 0)
+    {
+        fprintf(f,
+                "            <ExtensionObject>\n"
+                "                <TypeId>\n"
+                "                    <Identifier>ns=1;i=%zu</Identifier>\n"
+                "                </TypeId>\n"
+                "                <Body>\n"
+                "                    <Nested%zu>",
+                ENCODING_ID + o->nesting, o->nesting);
+        for (size_t k = o->nesting; k > 1; k--)
+        {
+            fprintf(f, "<Value>%zu</Value><Inner>", k);
+        }
+        fprintf(f, "<Value>1</Value>");
+        for (size_t k = o->nesting; k > 1; k--)
+        {
+            fprintf(f, "</Inner>");
+        }
+        fprintf(f,
+                "</Nested%zu>\n"
+                "                </Body>\n"
+                "            </ExtensionObject>\n",
+                o->nesting);
+    }
+    else if (o->arraySize)
+    {
+        fprintf(f, "            <uax:ListOfInt32>\n");
+        for (size_t i = 0; i < o->arraySize; i++)
+        {
+            fprintf(f, "                <uax:Int32>%zu</uax:Int32>\n",
+                    node + i);
+        }
+        fprintf(f, "            </uax:ListOfInt32>\n");
+    }
+    else
+    {
+        fprintf(f, "            <uax:Double>%zu.5</uax:Double>\n", node);
+    }
+    fprintf(f, "        </Value>\n");
+}
+
+static void writeNode(FILE *f, const struct Options *o, size_t treeSize,
+                      size_t node, uint64_t *random)
+{
+    size_t tree = node / treeSize;
+    size_t pos = node % treeSize;
+    // level of the position in a tree numbered breadth first
+    size_t level = 0;
+    size_t levelBegin = 0;
+    size_t levelSize = 1;
+    while (pos >= levelBegin + levelSize)
+    {
+        levelBegin += levelSize;
+        levelSize *= o->fanout;
+        level++;
+    }
+    int variable = o->depth > 1 && level == o->depth - 1;
+    const char *tag = variable ? "UAVariable" : "UAObject";
+    fprintf(f, "    <%s NodeId=\"ns=1;i=%zu\" BrowseName=\"1:Node%zu\"", tag,
+            FIRST_NODE_ID + node, node);
+    if (pos > 0)
+    {
+        fprintf(f, " ParentNodeId=\"ns=1;i=%zu\"",
+                FIRST_NODE_ID + tree * treeSize + (pos - 1) / o->fanout);
+    }
+    if (variable && o->nesting && node % EXTENSION_OBJECT_INTERVAL == 0)
+    {
+        fprintf(f, " DataType=\"ns=1;i=%zu\"", DATATYPE_ID + o->nesting);
+    }
+    else if (variable && o->arraySize)
+    {
+        fprintf(f,
+                " DataType=\"Int32\" ValueRank=\"1\" "
+                "ArrayDimensions=\"%zu\"",
+                o->arraySize);
+    }
+    else if (variable)
+    {
+        fprintf(f, " DataType=\"Double\"");
+    }
+    fprintf(f,
+            ">\n"
+            "        <DisplayName>Node%zu</DisplayName>\n"
+            "        <References>\n",
+            node);
+    if (variable)
+    {
+        fprintf(f, "            <Reference ReferenceType=\"HasTypeDefinition\">"
+                   "i=63</Reference>\n");
+    }
+    else
+    {
+        fprintf(f,
+                "            <Reference ReferenceType=\"HasTypeDefinition\">"
+                "ns=1;i=%d</Reference>\n",
+                OBJECT_TYPE_ID);
+    }
+    if (pos > 0)
+    {
+        fprintf(f,
+                "            <Reference ReferenceType=\"HasComponent\" "
+                "IsForward=\"false\">ns=1;i=%zu</Reference>\n",
+                FIRST_NODE_ID + tree * treeSize + (pos - 1) / o->fanout);
+    }
+    else
+    {
+        fprintf(f, "            <Reference ReferenceType=\"Organizes\" "
+                   "IsForward=\"false\">i=85</Reference>\n");
+    }
+    for (size_t i = 0; i < o->refs; i++)
+    {
+        size_t target = (size_t)(nextRandom(random) % o->nodes);
+        fprintf(f, "            <Reference ReferenceType=\"");
+        if (nextRandom(random) % 100 < o->customPercent)
+        {
+            fprintf(f, "ns=1;i=%d",
+                    1 + (int)(nextRandom(random) % CUSTOM_REFERENCE_TYPES));
+        }
+        else
+        {
+            fprintf(f, "NonHierarchicalReferences");
+        }
+        if (target < o->aliases)
+        {
+            fprintf(f, "\">Node%zu</Reference>\n", target);
+        }
+        else
+        {
+            fprintf(f, "\">ns=1;i=%zu</Reference>\n", FIRST_NODE_ID + target);
+        }
+    }
+    fprintf(f, "        </References>\n");
+    if (variable)
+    {
+        writeValue(f, o, node);
+    }
+    fprintf(f, "    </%s>\n", tag);
+}
+
+static int parseSize(const char *s, size_t *value)
+{
+    char *end = NULL;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (!*s || *end)
+    {
+        return 0;
+    }
+    *value = (size_t)v;
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    struct Options o = {10000, 6, 8, 2, 20, 100, 0, 0, 1};
+    int first = 1;
+    int valid = 1;
+    while (valid && first + 1 < argc && argv[first][0] == '-' &&
+           strlen(argv[first]) == 2)
+    {
+        size_t value = 0;
+        valid = parseSize(argv[first + 1], &value);
+        switch (argv[first][1])
+        {
+        case 'n':
+            o.nodes = value;
+            break;
+        case 'd':
+            o.depth = value;
+            break;
+        case 'f':
+            o.fanout = value;
+            break;
+        case 'r':
+            o.refs = value;
+            break;
+        case 'c':
+            o.customPercent = value;
+            break;
+        case 'a':
+            o.aliases = value;
+            break;
+        case 'v':
+            o.arraySize = value;
+            break;
+        case 'e':
+            o.nesting = value;
+            break;
+        case 's':
+            o.seed = value;
+            break;
+        default:
+            valid = 0;
+        }
+        first += 2;
+    }
+    if (!valid || first + 1 != argc || !o.nodes || !o.depth || !o.fanout ||
+        o.customPercent > 100 || o.aliases > o.nodes ||
+        o.aliases > MAX_ALIASES - STANDARD_ALIASES ||
+        o.nesting > MAX_NESTING)
+    {
+        printf("usage: nodesetGen [-n nodes] [-d depth] [-f fanout] "
+               "[-r refs] [-c customPercent] [-a aliases] [-v arraySize] "
+               "[-e nesting] [-s seed] output.xml\n");
+        return 1;
+    }
+    // xorshift needs a state which is not 0
+    uint64_t random = o.seed ? o.seed : 1;
+    // nodes of one tree, a tree is not larger than the whole nodeset
+    size_t treeSize = 0;
+    size_t levelSize = 1;
+    for (size_t l = 0; l < o.depth && treeSize < o.nodes; l++)
+    {
+        treeSize += levelSize;
+        levelSize *= o.fanout;
+    }
+
+    FILE *f = fopen(argv[first], "w");
+    if (!f)
+    {
+        printf("%s could not be opened\n", argv[first]);
+        return 1;
+    }
+    writeHeader(f, &o);
+    writeTypes(f, &o);
+    for (size_t i = 0; i < o.nodes; i++)
+    {
+        writeNode(f, &o, treeSize, i, &random);
+    }
+    fprintf(f, "</UANodeSet>\n");
+    if (fclose(f))
+    {
+        printf("%s could not be written\n", argv[first]);
+        return 1;
+    }
+    return 0;
+}